@@ -0,0 +1,222 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "fixture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/stat.h>
+
+#include "files/file.h"
+
+namespace bench {
+    namespace {
+        //! 2026-01-01; old enough for the catalog to trust it.
+        constexpr int64_t c_fixture_time = 1767225600;
+        constexpr uint64_t c_sparse_minimum = 8 * 1024 * 1024;
+        constexpr uint64_t c_sparse_stride = 1024 * 1024;
+        constexpr uint64_t c_sparse_extent = 64 * 1024;
+        constexpr uint64_t c_edit_size = 4096;
+        constexpr size_t c_write_buffer = 1024 * 1024;
+
+        //! SplitMix64: tiny, fast, and the same sequence everywhere, unlike the std distributions.
+        class Random {
+           public:
+            explicit Random(uint64_t seed) : m_state(seed) {}
+
+            uint64_t next() {
+                uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                return z ^ (z >> 31);
+            }
+            //! In [0, 1).
+            double real() {
+                return (double) (next() >> 11) * 0x1.0p-53;
+            }
+            uint64_t below(uint64_t bound) {
+                return bound ? next() % bound : 0;
+            }
+
+           private:
+            uint64_t m_state;
+        };
+
+        uint64_t draw_size(Random& random, const FixtureOptions& options) {
+            double mean = (double) options.mean_size;
+            double size = mean;
+            switch (options.distribution) {
+                case SizeDistribution::Fixed: break;
+                case SizeDistribution::Uniform: size = random.real() * 2 * mean; break;
+                case SizeDistribution::Exponential: size = -mean * std::log1p(-random.real()); break;
+                case SizeDistribution::Pareto: size = mean / 3 / std::pow(1 - random.real(), 1 / 1.5); break;
+            }
+            return std::min((uint64_t) size, options.max_size);
+        }
+
+        //! Fills `out` with the stream of `seed`, so contents follow from the seed alone.
+        void fill(Random& stream, byte* out, size_t size) {
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8) {
+                uint64_t word = stream.next();
+                std::memcpy(out + i, &word, 8);
+            }
+            if (i < size) {
+                uint64_t word = stream.next();
+                std::memcpy(out + i, &word, size - i);
+            }
+        }
+
+        bool set_time(const std::string& path, int64_t seconds) {
+            timespec times[2] = { { seconds, 0 }, { seconds, 0 } };
+            return ::utimensat(AT_FDCWD, path.c_str(), times, AT_SYMLINK_NOFOLLOW) == 0;
+        }
+
+        bool write_entry(const std::string& path, const PlannedEntry& entry, std::vector<byte>& buffer) {
+            files::File file;
+            if (!file.open(path, files::FileMode::Write)) return false;
+            Random stream(entry.content);
+            if (entry.kind == EntryKind::Sparse) {
+                // Extents at every stride, holes in between; the size makes the tail a hole as well.
+                for (uint64_t offset = 0; offset + c_sparse_extent <= entry.size; offset += c_sparse_stride) {
+                    fill(stream, buffer.data(), c_sparse_extent);
+                    if (!file.write_all_at(buffer.data(), c_sparse_extent, offset)) return false;
+                }
+                return file.truncate(entry.size);
+            }
+            for (uint64_t written = 0; written < entry.size;) {
+                size_t size = (size_t) std::min<uint64_t>(buffer.size(), entry.size - written);
+                fill(stream, buffer.data(), size);
+                if (!file.write_all(buffer.data(), size)) return false;
+                written += size;
+            }
+            return true;
+        }
+    }  // namespace
+
+    bool parse_size_distribution(std::string_view name, SizeDistribution& distribution) {
+        if (name == "fixed") distribution = SizeDistribution::Fixed;
+        else if (name == "uniform") distribution = SizeDistribution::Uniform;
+        else if (name == "exponential") distribution = SizeDistribution::Exponential;
+        else if (name == "pareto") distribution = SizeDistribution::Pareto;
+        else return false;
+        return true;
+    }
+
+    void plan_fixture(const FixtureOptions& options, FixturePlan& plan) {
+        plan = {};
+        Random random(options.seed);
+        // Only plain data files are originals, so a duplicate or link never points at a hole.
+        std::vector<uint32_t> originals;
+
+        auto visit = [&](auto& self, const std::string& directory, uint32_t level) -> void {
+            plan.directories.push_back(directory);
+            std::string prefix = directory.empty() ? "" : directory + "/";
+            char name[32];
+            for (uint32_t i = 0; i < options.files_per_directory; ++i) {
+                std::snprintf(name, sizeof(name), "f%04u.dat", i);
+                PlannedEntry entry{ prefix + name, EntryKind::Data, 0, 0, 0 };
+                double roll = random.real();
+                if (!originals.empty() && roll < options.hard_link_ratio) {
+                    entry.kind = EntryKind::HardLink;
+                    entry.target = originals[random.below(originals.size())];
+                    entry.size = plan.entries[entry.target].size;
+                    entry.content = plan.entries[entry.target].content;
+                } else if (!originals.empty() && roll < options.hard_link_ratio + options.duplicate_ratio) {
+                    const auto& original = plan.entries[originals[random.below(originals.size())]];
+                    entry.kind = EntryKind::Duplicate;
+                    entry.size = original.size;
+                    entry.content = original.content;
+                } else if (roll < options.hard_link_ratio + options.duplicate_ratio + options.sparse_ratio) {
+                    entry.kind = EntryKind::Sparse;
+                    entry.size = std::max(draw_size(random, options), c_sparse_minimum);
+                    entry.content = random.next();
+                } else {
+                    entry.size = draw_size(random, options);
+                    entry.content = random.next();
+                    originals.push_back((uint32_t) plan.entries.size());
+                }
+                plan.entries.push_back(std::move(entry));
+            }
+            if (level == options.depth) return;
+            for (uint32_t i = 0; i < options.fan_out; ++i) {
+                std::snprintf(name, sizeof(name), "d%02u", i);
+                self(self, prefix + name, level + 1);
+            }
+        };
+        visit(visit, "", 0);
+    }
+
+    bool generate_fixture(const std::string& root, const FixtureOptions& options, FixtureStats& stats) {
+        stats = {};
+        FixturePlan plan;
+        plan_fixture(options, plan);
+
+        std::error_code error;
+        for (const auto& directory : plan.directories) {
+            std::filesystem::create_directories(directory.empty() ? root : root + "/" + directory, error);
+            if (error) {
+                ERROR("Could not create '{}/{}': {}", root, directory, error.message());
+                return false;
+            }
+        }
+
+        std::vector<byte> buffer(c_write_buffer);
+        for (const auto& entry : plan.entries) {
+            std::string path = root + "/" + entry.path;
+            if (entry.kind == EntryKind::HardLink) {
+                std::filesystem::create_hard_link(root + "/" + plan.entries[entry.target].path, path, error);
+                if (error) {
+                    ERROR("Could not link '{}': {}", path, error.message());
+                    return false;
+                }
+                stats.hard_links++;
+            } else {
+                if (!write_entry(path, entry, buffer) || !set_time(path, c_fixture_time)) {
+                    ERROR("Could not write '{}'.", path);
+                    return false;
+                }
+                if (entry.kind == EntryKind::Duplicate) stats.duplicates++;
+                if (entry.kind == EntryKind::Sparse) stats.sparse++;
+            }
+            stats.files++;
+            stats.bytes += entry.size;
+        }
+        // Deepest first, so creating the children no longer touches a parent's time.
+        for (auto it = plan.directories.rbegin(); it != plan.directories.rend(); ++it) {
+            if (!set_time(it->empty() ? root : root + "/" + *it, c_fixture_time)) return false;
+        }
+        stats.directories = plan.directories.size();
+        return true;
+    }
+
+    bool modify_fixture(const std::string& root, const FixtureOptions& options, double ratio, uint64_t seed, uint64_t& changed) {
+        changed = 0;
+        FixturePlan plan;
+        plan_fixture(options, plan);
+        Random random(seed);
+        std::vector<byte> block(c_edit_size);
+        for (const auto& entry : plan.entries) {
+            if (entry.kind != EntryKind::Data && entry.kind != EntryKind::Duplicate) continue;
+            if (random.real() >= ratio) continue;
+
+            std::string path = root + "/" + entry.path;
+            files::File file;
+            if (!file.open(path, files::FileMode::ReadWrite)) return false;
+            uint64_t size = file.size();
+            fill(random, block.data(), block.size());
+            uint64_t offset = size > c_edit_size ? random.below(size - c_edit_size) : 0;
+            if (!file.write_all_at(block.data(), c_edit_size, offset) || !file.write_all_at(block.data(), c_edit_size, std::max(size, c_edit_size))) return false;
+            file.close();
+            // A day later, still well in the past.
+            if (!set_time(path, c_fixture_time + 86400)) return false;
+            changed++;
+        }
+        return true;
+    }
+}  // namespace bench
@@ -0,0 +1,89 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "system.h"
+
+namespace bench {
+    enum class SizeDistribution : uint8_t {
+        //! Every file has the mean size.
+        Fixed,
+        //! Evenly spread between empty and twice the mean.
+        Uniform,
+        //! Many small files and few large ones, like a home directory.
+        Exponential,
+        //! Pareto with shape 1.5: mostly small files with a long tail of huge ones, like source trees
+        //! next to media.
+        Pareto
+    };
+
+    COMP_NO_DISCARD bool parse_size_distribution(std::string_view name, SizeDistribution& distribution);
+
+    struct FixtureOptions {
+        uint64_t seed = 1;
+        //! Directory levels below the root.
+        uint32_t depth = 3;
+        //! Subdirectories of every directory above the deepest level.
+        uint32_t fan_out = 4;
+        //! Entries of every directory besides its subdirectories.
+        uint32_t files_per_directory = 64;
+        SizeDistribution distribution = SizeDistribution::Exponential;
+        uint64_t mean_size = 16 * 1024;
+        //! Drawn sizes are clamped to this.
+        uint64_t max_size = 256 * 1024 * 1024;
+        //! Share of files with the contents of an earlier one.
+        double duplicate_ratio = 0.1;
+        //! Share of files that are mostly holes: a few data extents spread over at least 8 MiB.
+        double sparse_ratio = 0.01;
+        //! Share of entries that are hard links to an earlier file.
+        double hard_link_ratio = 0.01;
+    };
+
+    struct FixtureStats {
+        //! Every regular entry, hard links included.
+        uint64_t files = 0;
+        uint64_t directories = 0;
+        //! Apparent size of every regular entry, what a backup reads the first time.
+        uint64_t bytes = 0;
+        uint64_t duplicates = 0;
+        uint64_t sparse = 0;
+        uint64_t hard_links = 0;
+    };
+
+    enum class EntryKind : uint8_t {
+        Data,
+        Duplicate,
+        Sparse,
+        HardLink
+    };
+
+    //! One regular entry of a fixture, relative to its root.
+    struct PlannedEntry {
+        std::string path;
+        EntryKind kind;
+        uint64_t size;
+        //! Seed of the contents; duplicates share it with their original.
+        uint64_t content;
+        //! The entry a hard link points at.
+        uint32_t target;
+    };
+
+    //! Every directory and entry of a fixture, a pure function of the options.
+    struct FixturePlan {
+        std::vector<std::string> directories;
+        std::vector<PlannedEntry> entries;
+    };
+
+    void plan_fixture(const FixtureOptions& options, FixturePlan& plan);
+    //! Creates the tree of `options` below `root`, which must not exist yet or be empty. The same
+    //! options give the same tree byte for byte, names, sizes and timestamps included, on any machine.
+    bool generate_fixture(const std::string& root, const FixtureOptions& options, FixtureStats& stats);
+    //! Changes `ratio` of the data files of a fixture as an edit would: a block overwritten in place and
+    //! a block appended, with a later mtime. Which files, and how, follows from `seed`.
+    bool modify_fixture(const std::string& root, const FixtureOptions& options, double ratio, uint64_t seed, uint64_t& changed);
+}  // namespace bench
@@ -0,0 +1,278 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <unistd.h>
+
+#include "commands/arguments.h"
+#include "commands/commands.h"
+#include "files/scanner.h"
+#include "fixture.h"
+#include "runner.h"
+
+namespace {
+    //! One measured step of the suite; `files` and `bytes` are the share of the fixture it covers, for
+    //! the rates.
+    struct Run {
+        std::string scenario;
+        uint32_t round;
+        uint64_t files;
+        uint64_t bytes;
+        bench::Measurement measurement;
+    };
+
+    void print_usage() {
+        PRINTLN("usage: benchmarks <command> ...");
+        PRINTLN("    benchmarks fixture <directory> [fixture options]");
+        PRINTLN("    benchmarks run [--fward <path>] [--work <directory>] [--image <size>] [--cold] [--repeat <n>] [--modify <ratio>] [--json <file>] [--keep] [--verbose] [fixture options]");
+        PRINTLN("fixture options:");
+        PRINTLN("    --seed <n> --depth <n> --fan-out <n> --files <n> --distribution fixed|uniform|exponential|pareto");
+        PRINTLN("    --mean-size <size> --max-size <size> --duplicates <ratio> --sparse <ratio> --hard-links <ratio>");
+    }
+
+    bool parse_ratio(const commands::Arguments& arguments, std::string_view name, double& ratio) {
+        if (!arguments.has(name)) return true;
+        std::string text = arguments.value(name);
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), ratio);
+        return error == std::errc() && end == text.data() + text.size() && ratio >= 0 && ratio <= 1;
+    }
+
+    bool parse_fixture_options(const commands::Arguments& arguments, bench::FixtureOptions& options) {
+        uint64_t depth = options.depth;
+        uint64_t fan_out = options.fan_out;
+        uint64_t files = options.files_per_directory;
+        bool valid = arguments.number("seed", options.seed) && arguments.number("depth", depth) && arguments.number("fan-out", fan_out) &&
+                     arguments.number("files", files) && parse_ratio(arguments, "duplicates", options.duplicate_ratio) &&
+                     parse_ratio(arguments, "sparse", options.sparse_ratio) && parse_ratio(arguments, "hard-links", options.hard_link_ratio);
+        if (arguments.has("distribution")) valid = valid && bench::parse_size_distribution(arguments.value("distribution"), options.distribution);
+        if (arguments.has("mean-size")) valid = valid && commands::parse_size(arguments.value("mean-size"), options.mean_size);
+        if (arguments.has("max-size")) valid = valid && commands::parse_size(arguments.value("max-size"), options.max_size);
+        options.depth = (uint32_t) std::min<uint64_t>(depth, 16);
+        options.fan_out = (uint32_t) std::min<uint64_t>(fan_out, 1024);
+        options.files_per_directory = (uint32_t) std::min<uint64_t>(files, 1u << 20);
+        return valid && options.duplicate_ratio + options.sparse_ratio + options.hard_link_ratio <= 1;
+    }
+
+    //! FORMAT has no precision, and a table wants fixed widths anyway.
+    template<typename... T>
+    std::string columns(const char* format, T... values) {
+        char line[256];
+        std::snprintf(line, sizeof(line), format, values...);
+        return line;
+    }
+
+    void print_fixture(const bench::FixtureStats& stats) {
+        LOG("{} files in {} directories, {} MB: {} duplicates, {} sparse, {} hard links.", stats.files, stats.directories,
+            columns("%.1f", (double) stats.bytes / 1e6), stats.duplicates, stats.sparse, stats.hard_links);
+    }
+
+    //! Runs a shell command of the suite's own setup; only fixed paths of the work directory go in.
+    bool shell(const std::string& command) {
+        if (std::system(command.c_str()) == 0) return true;
+        ERROR("'{}' failed.", command);
+        return false;
+    }
+
+    void print_runs(const std::vector<Run>& runs) {
+        PRINTLN("{}", columns("%-18s %5s %9s %11s %9s %10s %11s %9s %9s", "scenario", "round", "seconds", "files/s", "MB/s", "peak RSS", "syscalls", "reads", "writes"));
+        for (const auto& run : runs) {
+            const auto& m = run.measurement;
+            double seconds = std::max(m.seconds, 1e-9);
+            std::string syscalls = m.syscalls < 0 ? "-" : std::to_string(m.syscalls);
+            PRINTLN("{}{}",
+                    columns("%-18s %5u %9.3f %11.0f %9.1f %8.1fMB %11s %9llu %9llu", run.scenario.c_str(), run.round, m.seconds, (double) run.files / seconds,
+                            (double) run.bytes / 1e6 / seconds, (double) m.peak_rss / 1e6, syscalls.c_str(), (unsigned long long) m.read_calls,
+                            (unsigned long long) m.write_calls),
+                    m.exit_code ? FORMAT("  (exit {})", m.exit_code) : std::string());
+        }
+    }
+
+    //! Medians over the rounds, in the order the scenarios ran.
+    void print_medians(const std::vector<Run>& runs) {
+        std::vector<std::string> order;
+        std::map<std::string, std::vector<const Run*>> by_scenario;
+        for (const auto& run : runs) {
+            if (!by_scenario.contains(run.scenario)) order.push_back(run.scenario);
+            by_scenario[run.scenario].push_back(&run);
+        }
+        PRINTLN("{}", columns("%-18s %9s %11s %9s %10s", "median", "seconds", "files/s", "MB/s", "peak RSS"));
+        for (const auto& scenario : order) {
+            auto list = by_scenario[scenario];
+            std::sort(list.begin(), list.end(), [](const Run* a, const Run* b) { return a->measurement.seconds < b->measurement.seconds; });
+            const Run& median = *list[list.size() / 2];
+            double seconds = std::max(median.measurement.seconds, 1e-9);
+            uint64_t peak = 0;
+            for (const Run* run : list) peak = std::max(peak, run->measurement.peak_rss);
+            PRINTLN("{}", columns("%-18s %9.3f %11.0f %9.1f %8.1fMB", scenario.c_str(), median.measurement.seconds, (double) median.files / seconds,
+                                  (double) median.bytes / 1e6 / seconds, (double) peak / 1e6));
+        }
+    }
+
+    bool write_json(const std::string& path, const bench::FixtureOptions& options, const bench::FixtureStats& stats, const std::vector<Run>& runs) {
+        std::ofstream out(path);
+        out << "{\"fixture\":{";
+        out << FORMAT(R"("seed":{},"depth":{},"fan_out":{},"files_per_directory":{},"distribution":{},"mean_size":{},"max_size":{},)", options.seed,
+                      options.depth, options.fan_out, options.files_per_directory, (uint32_t) options.distribution, options.mean_size, options.max_size);
+        out << FORMAT(R"("duplicate_ratio":{},"sparse_ratio":{},"hard_link_ratio":{},"files":{},"directories":{},"bytes":{})", options.duplicate_ratio,
+                      options.sparse_ratio, options.hard_link_ratio, stats.files, stats.directories, stats.bytes);
+        out << "},\"runs\":[";
+        for (size_t i = 0; i < runs.size(); ++i) {
+            const auto& run = runs[i];
+            const auto& m = run.measurement;
+            out << (i ? ",{" : "{");
+            out << FORMAT(R"("scenario":"{}","round":{},"exit_code":{},"seconds":{},"user_seconds":{},"system_seconds":{},"files":{},"bytes":{},)", run.scenario,
+                          run.round, m.exit_code, m.seconds, m.user_seconds, m.system_seconds, run.files, run.bytes);
+            out << FORMAT(R"("peak_rss":{},"syscalls":{},"read_calls":{},"write_calls":{},"storage_read":{},"storage_written":{},)", m.peak_rss, m.syscalls,
+                          m.read_calls, m.write_calls, m.storage_read, m.storage_written);
+            out << FORMAT(R"("major_faults":{},"minor_faults":{},"voluntary_switches":{},"involuntary_switches":{})", m.major_faults, m.minor_faults,
+                          m.voluntary_switches, m.involuntary_switches);
+            out << "}";
+        }
+        out << "]}\n";
+        return (bool) out.flush();
+    }
+
+    int32_t fixture(int32_t argc, char** argv) {
+        commands::Arguments arguments(argc, argv, { "seed", "depth", "fan-out", "files", "distribution", "mean-size", "max-size", "duplicates", "sparse", "hard-links" });
+        bench::FixtureOptions options;
+        if (!arguments.valid() || arguments.positional_count() != 1 || !parse_fixture_options(arguments, options)) {
+            if (!arguments.valid()) ERROR("{}", arguments.error());
+            print_usage();
+            return 2;
+        }
+        bench::FixtureStats stats;
+        if (!bench::generate_fixture(arguments.positional(0), options, stats)) return 1;
+        print_fixture(stats);
+        return 0;
+    }
+
+    //! Every round starts from a fresh fixture and an empty repository, then goes through a repository's
+    //! life: first backup, unchanged and modified backups, both verify levels, a restore and a prune.
+    int32_t run(int32_t argc, char** argv) {
+        commands::Arguments arguments(argc, argv, { "fward", "work", "image", "repeat", "modify", "json", "seed", "depth", "fan-out", "files", "distribution",
+                                                    "mean-size", "max-size", "duplicates", "sparse", "hard-links" });
+        bench::FixtureOptions options;
+        uint64_t rounds = 1;
+        uint64_t image_size = 0;
+        double modify_ratio = 0.1;
+        bool valid = arguments.valid() && arguments.positional_count() == 0 && parse_fixture_options(arguments, options) && arguments.number("repeat", rounds) &&
+                     parse_ratio(arguments, "modify", modify_ratio);
+        if (arguments.has("image")) valid = valid && commands::parse_size(arguments.value("image"), image_size);
+        if (!valid || rounds == 0) {
+            if (!arguments.valid()) ERROR("{}", arguments.error());
+            print_usage();
+            return 2;
+        }
+        const std::string fward = arguments.value("fward", FWARD_BINARY);
+        const bool cold = arguments.flag("cold");
+        const bool quiet = !arguments.flag("verbose");
+        if ((cold || image_size) && ::geteuid() != 0) WARN("--cold and --image need root; expect them to fail.");
+
+        std::error_code error;
+        std::string work = arguments.value("work");
+        if (work.empty()) {
+            std::string pattern = (std::filesystem::temp_directory_path() / "fward-bench-XXXXXX").string();
+            if (!::mkdtemp(pattern.data())) {
+                ERROR("Could not create a work directory.");
+                return 1;
+            }
+            work = pattern;
+        }
+        std::filesystem::create_directories(work, error);
+        work = std::filesystem::absolute(work).string();
+
+        // On an image of its own, the whole suite sees the same freshly made ext4 whatever the host has.
+        std::string base = work;
+        const std::string image = work + "/fixture.img";
+        const std::string mount = work + "/mount";
+        if (image_size) {
+            std::filesystem::create_directories(mount, error);
+            if (!shell(FORMAT("truncate -s {} '{}' && mkfs.ext4 -q -F '{}' && mount -o loop '{}' '{}'", image_size, image, image, image, mount))) return 1;
+            base = mount;
+        }
+        const std::string source = base + "/source";
+        const std::string repository = base + "/repository";
+        const std::string target = base + "/target";
+
+        std::vector<Run> runs;
+        bench::FixtureStats stats;
+        bool failed = false;
+        for (uint32_t round = 0; round < rounds && !failed; ++round) {
+            for (const auto& path : { source, repository, target }) std::filesystem::remove_all(path, error);
+            if (!bench::generate_fixture(source, options, stats)) {
+                failed = true;
+                break;
+            }
+            if (round == 0) print_fixture(stats);
+
+            auto step = [&](const std::string& scenario, const std::function<bool(bench::Measurement&)>& body) {
+                if (failed) return;
+                if (cold && !bench::drop_caches()) WARN("Could not drop the caches before {}.", scenario);
+                Run entry{ scenario, round, stats.files, stats.bytes, {} };
+                if (!body(entry.measurement) || entry.measurement.exit_code != 0) {
+                    ERROR("{} failed with exit code {}.", scenario, entry.measurement.exit_code);
+                    failed = true;
+                }
+                runs.push_back(std::move(entry));
+            };
+            auto command = [&](std::initializer_list<std::string> tail) {
+                std::vector<std::string> line{ fward };
+                line.insert(line.end(), tail);
+                return [line = std::move(line), quiet](bench::Measurement& measurement) { return bench::measure_command(line, quiet, measurement); };
+            };
+
+            step("scan", [&](bench::Measurement& measurement) {
+                return bench::measure([&] { return files::scan(source, nullptr, [](const files::ScanEntry&) { return true; }).errors ? 1 : 0; }, quiet,
+                                      measurement);
+            });
+            step("backup-initial", command({ "backup", source, repository }));
+            step("backup-unchanged", command({ "backup", source, repository }));
+            uint64_t changed = 0;
+            if (!failed && !bench::modify_fixture(source, options, modify_ratio, options.seed + round + 1, changed)) {
+                ERROR("Could not modify the fixture.");
+                failed = true;
+            }
+            step("backup-modified", command({ "backup", source, repository }));
+            step("verify-quick", command({ "verify", repository }));
+            step("verify-full", command({ "verify", repository, "--full" }));
+            step("restore", command({ "restore", repository, target }));
+            step("prune", command({ "prune", repository, "--keep-last", "1" }));
+        }
+
+        print_runs(runs);
+        if (rounds > 1) print_medians(runs);
+        if (arguments.has("json") && !write_json(arguments.value("json"), options, stats, runs)) {
+            ERROR("Could not write '{}'.", arguments.value("json"));
+            failed = true;
+        }
+
+        bool mounted = image_size && !shell(FORMAT("umount '{}'", mount));
+        if (mounted) failed = true;
+        // Never clean up through a mount that is still there.
+        if (!arguments.flag("keep") && !mounted) {
+            for (const auto& path : { source, repository, target, image, mount }) std::filesystem::remove_all(path, error);
+            if (!arguments.has("work")) std::filesystem::remove(work, error);
+        }
+        return failed ? 1 : 0;
+    }
+}  // namespace
+
+int32_t main(int32_t argc, char** argv) {
+    if (argc < 2) {
+        print_usage();
+        return 2;
+    }
+    std::string_view command = argv[1];
+    if (command == "fixture") return fixture(argc - 2, argv + 2);
+    if (command == "run") return run(argc - 2, argv + 2);
+    ERROR("Unknown command '{}'.", command);
+    print_usage();
+    return 2;
+}
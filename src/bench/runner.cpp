@@ -0,0 +1,142 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "runner.h"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace bench {
+    namespace {
+        //! Id of the raw_syscalls:sys_enter tracepoint, -1 when tracefs is not mounted.
+        int64_t syscall_tracepoint() {
+            static const int64_t id = [] {
+                for (const char* path : { "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id", "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id" }) {
+                    std::ifstream file(path);
+                    int64_t value = -1;
+                    if (file >> value) return value;
+                }
+                return (int64_t) -1;
+            }();
+            return id;
+        }
+
+        //! Counts the syscalls of `pid` and of the children it forks from now on; -1 when not possible.
+        int32_t open_syscall_counter(pid_t pid) {
+            int64_t id = syscall_tracepoint();
+            if (id < 0) return -1;
+            perf_event_attr attributes{};
+            attributes.type = PERF_TYPE_TRACEPOINT;
+            attributes.size = sizeof(attributes);
+            attributes.config = (uint64_t) id;
+            attributes.inherit = 1;
+            return (int32_t) ::syscall(SYS_perf_event_open, &attributes, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        }
+
+        void read_process_io(pid_t pid, Measurement& measurement) {
+            std::ifstream file(FORMAT("/proc/{}/io", pid));
+            std::string key;
+            uint64_t value = 0;
+            while (file >> key >> value) {
+                if (key == "syscr:") measurement.read_calls = value;
+                else if (key == "syscw:") measurement.write_calls = value;
+                else if (key == "read_bytes:") measurement.storage_read = value;
+                else if (key == "write_bytes:") measurement.storage_written = value;
+            }
+        }
+
+        double seconds(const timeval& time) {
+            return (double) time.tv_sec + (double) time.tv_usec / 1e6;
+        }
+    }  // namespace
+
+    bool measure(const std::function<int32_t()>& body, bool quiet, Measurement& measurement) {
+        measurement = {};
+        int32_t release[2];
+        if (::pipe2(release, O_CLOEXEC) != 0) return false;
+        std::fflush(nullptr);
+
+        pid_t pid = ::fork();
+        if (pid < 0) {
+            ::close(release[0]);
+            ::close(release[1]);
+            return false;
+        }
+        if (pid == 0) {
+            ::close(release[1]);
+            char go = 0;
+            if (::read(release[0], &go, 1) != 1) ::_exit(127);
+            ::close(release[0]);
+            if (quiet) {
+                int32_t null = ::open("/dev/null", O_WRONLY);
+                ::dup2(null, STDOUT_FILENO);
+                ::dup2(null, STDERR_FILENO);
+                ::close(null);
+            }
+            int32_t result = body();
+            std::fflush(nullptr);
+            ::_exit(result);
+        }
+
+        ::close(release[0]);
+        int32_t counter = open_syscall_counter(pid);
+        auto start = std::chrono::steady_clock::now();
+        char go = 1;
+        bool released = ::write(release[1], &go, 1) == 1;
+        ::close(release[1]);
+        if (!released) ::kill(pid, SIGKILL);
+
+        // Exited but not reaped, so /proc/<pid>/io still holds the totals.
+        siginfo_t info{};
+        while (::waitid(P_PID, (id_t) pid, &info, WEXITED | WNOWAIT) != 0 && errno == EINTR) {}
+        measurement.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        read_process_io(pid, measurement);
+
+        int32_t status = 0;
+        rusage usage{};
+        while (::wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {}
+        if (counter >= 0) {
+            uint64_t count = 0;
+            if (::read(counter, &count, sizeof(count)) == sizeof(count)) measurement.syscalls = (int64_t) count;
+            ::close(counter);
+        }
+
+        measurement.exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        measurement.user_seconds = seconds(usage.ru_utime);
+        measurement.system_seconds = seconds(usage.ru_stime);
+        measurement.peak_rss = (uint64_t) usage.ru_maxrss * 1024;
+        measurement.major_faults = (uint64_t) usage.ru_majflt;
+        measurement.minor_faults = (uint64_t) usage.ru_minflt;
+        measurement.voluntary_switches = (uint64_t) usage.ru_nvcsw;
+        measurement.involuntary_switches = (uint64_t) usage.ru_nivcsw;
+        return released;
+    }
+
+    bool measure_command(const std::vector<std::string>& command, bool quiet, Measurement& measurement) {
+        std::vector<char*> arguments;
+        for (const auto& argument : command) arguments.push_back(const_cast<char*>(argument.c_str()));
+        arguments.push_back(nullptr);
+        return measure(
+            [&] {
+                ::execv(arguments[0], arguments.data());
+                return 127;
+            },
+            quiet, measurement);
+    }
+
+    bool drop_caches() {
+        ::sync();
+        std::ofstream file("/proc/sys/vm/drop_caches");
+        return (bool) (file << "3\n" << std::flush);
+    }
+}  // namespace bench
@@ -0,0 +1,44 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "system.h"
+
+namespace bench {
+    //! What one run cost, as the kernel accounted it for the process and everything it waited for.
+    struct Measurement {
+        int32_t exit_code = -1;
+        double seconds = 0;
+        double user_seconds = 0;
+        double system_seconds = 0;
+        uint64_t peak_rss = 0;
+        //! Every system call, or -1 when the raw_syscalls tracepoint is out of reach: tracefs not
+        //! mounted or perf events not permitted.
+        int64_t syscalls = -1;
+        //! Read and write class calls, from /proc/<pid>/io; always there.
+        uint64_t read_calls = 0;
+        uint64_t write_calls = 0;
+        //! Bytes that reached storage, as opposed to the page cache.
+        uint64_t storage_read = 0;
+        uint64_t storage_written = 0;
+        uint64_t major_faults = 0;
+        uint64_t minor_faults = 0;
+        uint64_t voluntary_switches = 0;
+        uint64_t involuntary_switches = 0;
+    };
+
+    //! Runs `body` in a forked child and measures it from the moment it starts until it exits; its result
+    //! is the exit code. The syscall counter is attached before the child is released, so nothing of
+    //! the run is missed. `quiet` sends the child's output to /dev/null.
+    bool measure(const std::function<int32_t()>& body, bool quiet, Measurement& measurement);
+    //! Measures running the executable `command[0]` with the rest as its arguments.
+    bool measure_command(const std::vector<std::string>& command, bool quiet, Measurement& measurement);
+
+    //! Writes dirty pages back and drops the page, dentry and inode caches; false without the privilege.
+    bool drop_caches();
+}  // namespace bench
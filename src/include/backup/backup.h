@@ -0,0 +1,54 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <string>
+
+#include "backup/catalog.h"
+#include "backup/chunker.h"
+#include "backup/repository.h"
+
+namespace backup {
+    struct BackupOptions {
+        std::string source;
+        const files::PathFilter* filter = nullptr;
+        //! Files whose size and mtime match their record here reuse its chunks instead of being read.
+        Catalog* catalog = nullptr;
+        //! Keeps each file's content digest in its extended attributes (see load_cached_hash) and reuses
+        //! the chunks of the previous snapshot for files whose digest is found there, which covers a
+        //! lost catalog and renamed files. Only consulted for files the catalog can't vouch for.
+        bool hash_xattrs = false;
+    };
+
+    struct BackupStats {
+        uint64_t files = 0;
+        uint64_t files_unchanged = 0;
+        uint64_t directories = 0;
+        uint64_t bytes_read = 0;
+        uint64_t bytes_added = 0;
+        uint64_t chunks_added = 0;
+        uint64_t chunks_reused = 0;
+        //! New chunks stored as a delta against the previous version of their file.
+        uint64_t chunks_delta = 0;
+        uint64_t errors = 0;
+    };
+
+    //! Timestamps this close to the start of a backup or verify may still change within the same tick,
+    //! so no cache can vouch for them; such files are read again next time.
+    inline constexpr int64_t c_racy_window_ns = 2'000'000'000;
+    //! Files up to this size are backed up and restored in batches rather than one by one; each is a
+    //! single chunk.
+    inline constexpr uint64_t c_small_file_size = 64 * 1024;
+    static_assert(c_small_file_size <= ChunkerOptions {}.min_size);
+
+    //! Captures `options.source`, stores every file's chunks and writes a snapshot with its Merkle tree.
+    //! Files that have to be read are read in parallel, per disk as files::DeviceQueues schedules them.
+    //! Small files go in batches taken in inode order, which is roughly where a filesystem keeps their
+    //! inodes and data; every batch is read with plain reads, hashed, and stored in one go, so its
+    //! chunks sit next to each other in the pack and its catalog records share a journal record.
+    bool run_backup(Repository& repository, const BackupOptions& options, Snapshot& snapshot, BackupStats& stats);
+
+    //! Chunks and hashes `path` into `chunks` the same way a backup would, without storing anything.
+    bool hash_file(const std::string& path, std::vector<ChunkRef>& chunks, uint64_t& size);
+}  // namespace backup
@@ -0,0 +1,78 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "backup/snapshot.h"
+#include "files/journal.h"
+#include "files/path_filter.h"
+
+namespace backup {
+    //! What the last backup saw of a file, so an unchanged file can reuse its chunk list without being read.
+    struct CatalogRecord {
+        uint64_t size = 0;
+        int64_t mtime_ns = 0;
+        std::vector<ChunkRef> chunks;
+    };
+
+    struct CatalogUpdate {
+        std::string path;
+        CatalogRecord record;
+    };
+
+    //! Persistent map from absolute source path to CatalogRecord:
+    //!
+    //!     <dir>/checkpoint   full state as of some lsn, replaced atomically
+    //!     <dir>/journal      files::Journal of the mutations after it
+    //!
+    //! Mutations are applied in memory and appended to the journal in the same order, so writers only
+    //! pay for a buffer copy; wait() or sync() make them durable through one group commit. Only one
+    //! process can have a catalog open; open() fails for the others.
+    class Catalog {
+       public:
+        bool open(const std::string& directory, const files::JournalOptions& options = {});
+        void close();
+
+        bool find(const std::string& path, CatalogRecord& record) const;
+        //! Both return the lsn to wait() on.
+        uint64_t put(const std::string& path, const CatalogRecord& record);
+        //! Puts all of `updates` as a single journal record, so a tree of small files doesn't pay for a
+        //! record, a lock and a checksum per file.
+        uint64_t put(std::span<const CatalogUpdate> updates);
+        uint64_t erase(const std::string& path);
+
+        bool wait(uint64_t lsn) {
+            return m_journal.wait(lsn);
+        }
+        bool sync() {
+            return m_journal.sync();
+        }
+
+        //! Writes the full state and empties the journal.
+        bool checkpoint();
+        //! True once replaying the journal would cost more than loading a fresh checkpoint.
+        COMP_NO_DISCARD bool checkpoint_due() const;
+
+        COMP_NO_DISCARD size_t size() const;
+
+       private:
+        void apply(std::string_view path, CatalogRecord* record);
+        bool replay(const byte* data, size_t size);
+        bool load_checkpoint(uint64_t& lsn);
+
+        std::string m_directory;
+        files::Journal m_journal;
+        //! Holds an exclusive flock on <dir>/lock while open.
+        files::File m_lock;
+        uint64_t m_checkpoint_bytes = 0;
+
+        mutable std::shared_mutex m_mutex;
+        std::unordered_map<std::string, CatalogRecord, files::StringViewHash, std::equal_to<>> m_records;
+    };
+}  // namespace backup
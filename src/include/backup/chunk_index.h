@@ -0,0 +1,140 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <functional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hashing/sha256.h"
+
+namespace backup {
+    struct ChunkLocation {
+        uint32_t pack;
+        uint32_t length;
+        uint64_t offset;
+        //! PackEntry flags, e.g. c_pack_entry_delta.
+        uint32_t flags;
+        uint32_t checksum;
+        //! Position of the entry in its pack's index.
+        uint32_t entry;
+    };
+
+    //! Blocked Bloom filter over chunk digests. A digest sets 8 bits inside a single 64-byte block, so
+    //! answering "not stored" touches one cache line. Digests are SHA-256 and uniform already, so their
+    //! own bits pick the block and the bits without further hashing.
+    class ChunkFilter {
+       public:
+        //! Empties the filter and sizes it for `capacity` digests at about 1% false positives.
+        void reset(uint64_t capacity);
+        void insert(const hashing::Digest& digest);
+        COMP_NO_DISCARD bool may_contain(const hashing::Digest& digest) const;
+        COMP_NO_DISCARD uint64_t capacity() const {
+            return m_capacity;
+        }
+
+       private:
+        struct alignas(64) Block {
+            uint64_t words[8];
+        };
+
+        COMP_NO_DISCARD size_t block_of(const hashing::Digest& digest) const;
+
+        std::vector<Block> m_blocks;
+        uint64_t m_capacity = 0;
+    };
+
+    //! Digest to location of every stored chunk. Most entries sit in one run sorted by digest, 64 bytes
+    //! each, either owned or mapped straight from a cache file; entries inserted since the run was built
+    //! wait in a hash map until compact(). A ChunkFilter in front of both answers most lookups of chunks
+    //! that aren't stored. The others look up the leading digest bits in a directory of run positions,
+    //! one slot per few records, and interpolate within the slot: digests are uniform, so the first
+    //! guess is usually the record, where a binary search over the run would take thirty probes.
+    //!
+    //! Reads are thread-safe, inserts are not.
+    class ChunkIndex {
+       public:
+        ChunkIndex() = default;
+        ~ChunkIndex();
+        ChunkIndex(const ChunkIndex&) = delete;
+        ChunkIndex& operator=(const ChunkIndex&) = delete;
+
+        void clear();
+        //! Maps the cache file at `path` as the sorted run, replacing everything, and rebuilds the filter
+        //! from it. `packs` receives the pack ids the locations refer to, by position. False when the
+        //! file is missing, damaged or from another version; the index is empty then.
+        bool load(const std::string& path, std::vector<std::string>& packs);
+        //! Writes the cache file atomically, merging the entries inserted since into the run on the way,
+        //! and maps it as the new run; `packs` names the pack of every location.
+        bool save(const std::string& path, const std::vector<std::string>& packs);
+        //! Receives one entry of a rebuild; false stops it.
+        using AddEntry = std::function<bool(const hashing::Digest& digest, const ChunkLocation& location)>;
+        //! Replaces everything by the entries `produce` hands to its argument, written to the cache file
+        //! at `path` and loaded from there. They are sorted within files::memory_budget(), spilling runs
+        //! next to `path`, so at no point are they all in memory. Where a digest comes twice, the lower
+        //! pack wins, as with insert() in pack order. `packs` is read once `produce` returned, so it may
+        //! fill it. False when a run or the file couldn't be written; the index is empty then.
+        bool rebuild(const std::string& path, const std::function<bool(const AddEntry&)>& produce, const std::vector<std::string>& packs);
+        //! Folds the entries inserted since the last compaction into the sorted run.
+        void compact();
+
+        //! Adds `digest` unless it is already indexed; true when it was added.
+        bool insert(const hashing::Digest& digest, const ChunkLocation& location);
+        COMP_NO_DISCARD bool find(const hashing::Digest& digest, ChunkLocation& location) const;
+        COMP_NO_DISCARD bool contains(const hashing::Digest& digest) const;
+
+        COMP_NO_DISCARD size_t size() const {
+            return m_sorted.size() + m_recent.size();
+        }
+        //! Entries inserted since the last compaction.
+        COMP_NO_DISCARD size_t recent_count() const {
+            return m_recent.size();
+        }
+        template<typename Visit>
+        void for_each(Visit&& visit) const {
+            for (const auto& record : m_sorted) visit(record.digest, location_of(record));
+            for (const auto& [digest, location] : m_recent) visit(digest, location);
+        }
+
+       private:
+        //! Layout of the sorted run in memory and in the cache file.
+        struct Record {
+            hashing::Digest digest;
+            uint32_t pack;
+            uint32_t length;
+            uint64_t offset;
+            uint32_t flags;
+            uint32_t checksum;
+            uint32_t entry;
+            uint32_t reserved;
+        };
+        static_assert(sizeof(Record) == 64);
+
+        static ChunkLocation location_of(const Record& record) {
+            return { record.pack, record.length, record.offset, record.flags, record.checksum, record.entry };
+        }
+        COMP_NO_DISCARD const Record* search(const hashing::Digest& digest) const;
+        COMP_NO_DISCARD std::vector<Record> sorted_recent() const;
+        //! Maps the run of a cache file this index just wrote; its contents are already in the filter.
+        bool map_run(const std::string& path, uint64_t records, uint64_t count);
+        COMP_NO_DISCARD size_t slot_of(uint64_t key) const {
+            return m_slot_shift < 64 ? (size_t) (key >> m_slot_shift) : 0;
+        }
+        void build_directory();
+        void unmap();
+        void rebuild_filter(uint64_t capacity);
+
+        std::span<const Record> m_sorted;
+        std::vector<Record> m_owned;
+        //! Position of the first record of every slot, and the run size at the end.
+        std::vector<uint64_t> m_directory = { 0, 0 };
+        uint32_t m_slot_shift = 64;
+        const byte* m_mapping = nullptr;
+        size_t m_mapping_size = 0;
+        std::unordered_map<hashing::Digest, ChunkLocation, hashing::DigestHash> m_recent;
+        ChunkFilter m_filter;
+    };
+}  // namespace backup
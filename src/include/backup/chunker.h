@@ -0,0 +1,42 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <functional>
+#include <vector>
+
+#include "files/reader.h"
+#include "system.h"
+
+namespace backup {
+    struct ChunkerOptions {
+        uint32_t min_size = 256 * 1024;
+        uint32_t average_size = 1024 * 1024;
+        uint32_t max_size = 4 * 1024 * 1024;
+    };
+
+    //! Content-defined chunking (FastCDC with normalized chunking) over a gear rolling hash, so an insert
+    //! in the middle of a file only changes the chunks around it.
+    class Chunker {
+       public:
+        explicit Chunker(const ChunkerOptions& options = {});
+
+        //! Length of the first chunk in `data`. When `size` is below the maximum and no cut point is found
+        //! it returns `size`; callers that have more input pending should refill before cutting.
+        COMP_NO_DISCARD size_t next_cut(const byte* data, size_t size) const;
+
+        COMP_NO_DISCARD const ChunkerOptions& options() const {
+            return m_options;
+        }
+
+       private:
+        ChunkerOptions m_options;
+        uint64_t m_mask_small;
+        uint64_t m_mask_large;
+    };
+
+    //! Streams the file behind `reader` through `chunker`, calling `callback(data, size)` per chunk. Returns
+    //! false on a read error.
+    bool chunk_file(files::Reader& reader, const Chunker& chunker, const std::function<bool(const byte* data, size_t size)>& callback);
+}  // namespace backup
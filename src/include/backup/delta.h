@@ -0,0 +1,54 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <algorithm>
+#include <vector>
+
+#include "hashing/sha256.h"
+
+namespace backup {
+    //! Granularity at which a delta can refer back to its base; small enough for database pages.
+    inline constexpr size_t c_delta_block_size = 4096;
+
+    //! rsync-style signature of a base: the weak rolling checksum of every whole block, with a
+    //! 64 Kbit presence filter in front so most positions of the target are rejected with one bit test.
+    class DeltaSignature {
+       public:
+        DeltaSignature(const byte* base, size_t size);
+
+        //! Calls `match(block)` for every base block with this checksum until it returns true.
+        template<typename Match>
+        bool find(uint32_t checksum, Match&& match) const {
+            uint32_t tag = (checksum ^ (checksum >> 16)) & 0xFFFF;
+            if (!(m_filter[tag >> 6] & (1ull << (tag & 63)))) return false;
+            auto it = std::lower_bound(m_blocks.begin(), m_blocks.end(), std::pair<uint32_t, uint32_t>(checksum, 0));
+            for (; it != m_blocks.end() && it->first == checksum; ++it) {
+                if (match(it->second)) return true;
+            }
+            return false;
+        }
+
+       private:
+        //! (checksum, block index), sorted.
+        std::vector<std::pair<uint32_t, uint32_t>> m_blocks;
+        std::vector<uint64_t> m_filter;
+    };
+
+    //! Encodes `target` as copies from `base` and literals:
+    //!
+    //!     base digest, target size varint, then ops until the end
+    //!     copy     varint (length << 1 | 1), varint offset into the base
+    //!     literal  varint (length << 1), bytes
+    //!
+    //! Every match is confirmed byte for byte, so a checksum collision can only cost space. Gives up
+    //! and returns false once the delta would exceed `limit` bytes.
+    bool delta_encode(const hashing::Digest& base_digest, const byte* base, const DeltaSignature& signature,
+                      const byte* target, size_t target_size, size_t limit, std::vector<byte>& out);
+
+    //! The base digest a delta was encoded against.
+    bool delta_base(const byte* delta, size_t size, hashing::Digest& base_digest);
+    //! Rebuilds the target; false when the delta is malformed or doesn't fit `base`.
+    bool delta_apply(const byte* base, size_t base_size, const byte* delta, size_t size, std::vector<byte>& out);
+}  // namespace backup
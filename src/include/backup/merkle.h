@@ -0,0 +1,36 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <functional>
+#include <vector>
+
+#include "backup/snapshot.h"
+
+namespace backup {
+    //! Content node of a file: its size and ordered chunk digests.
+    hashing::Digest merkle_file_digest(uint64_t size, std::span<const ChunkRef> chunks);
+
+    //! Fills the Merkle nodes of `snapshot` bottom-up: metadata nodes always, directory content nodes
+    //! when `with_content` is set (file content nodes must already be present then).
+    void merkle_build(Snapshot& snapshot, bool with_content);
+
+    //! Recomputes every content node from the chunk lists and reports the entries whose stored node
+    //! doesn't match. Catches manifests that were damaged after they were written.
+    bool merkle_check(const Snapshot& snapshot, std::vector<files::PathId>& corrupt);
+
+    enum class TreeChange : uint8_t {
+        //! Present in the stored tree, gone from the other one.
+        Removed,
+        //! Only present in the other tree.
+        Added,
+        //! Both have it but the metadata differs.
+        Changed
+    };
+
+    //! Compares two trees top-down on their metadata nodes, descending only into differing subtrees.
+    //! `stored_id`/`live_id` are c_invalid_path for the side that doesn't have the entry.
+    using TreeChangeVisitor = std::function<void(TreeChange change, files::PathId stored_id, files::PathId live_id)>;
+    void merkle_diff(const Snapshot& stored, const Snapshot& live, const TreeChangeVisitor& visitor);
+}  // namespace backup
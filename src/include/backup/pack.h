@@ -0,0 +1,70 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <string>
+#include <vector>
+
+#include "backup/shards.h"
+#include "files/file.h"
+#include "hashing/sha256.h"
+
+namespace backup {
+    //! The entry holds a delta (see delta_encode) instead of the chunk itself.
+    inline constexpr uint32_t c_pack_entry_delta = 0x01;
+    //! The entry carries the CRC-32C of its stored bytes; entries of version 0 packs don't.
+    inline constexpr uint32_t c_pack_entry_checksum = 0x02;
+    //! Length of the delta chain behind an entry, stored in bits 8-15 of its flags.
+    inline constexpr uint32_t c_pack_delta_depth_shift = 8;
+
+    //! Location of one chunk inside a pack file.
+    struct PackEntry {
+        hashing::Digest digest;
+        uint64_t offset;
+        uint32_t length;
+        uint32_t flags;
+        //! CRC-32C of the stored bytes, checked on every read; 0 without c_pack_entry_checksum.
+        uint32_t checksum;
+    };
+
+    //! Pack layout: magic, chunk payloads back to back, the entry index, then a fixed size footer holding
+    //! the entry count, the format version, the index offset and the SHA-256 of the index. The pack id is
+    //! that index digest. Version 1 added the entry checksums; version 0 packs are still read.
+    inline constexpr char c_pack_magic[8] = { 'F', 'W', 'P', 'A', 'C', 'K', '0', '1' };
+    inline constexpr char c_pack_footer_magic[8] = { 'F', 'W', 'P', 'K', 'E', 'N', 'D', '1' };
+    inline constexpr size_t c_pack_footer_size = 4 + 4 + 8 + 32 + 8;
+    inline constexpr uint32_t c_pack_version = 1;
+
+    //! Appends chunks to a temporary file and publishes it under its id once finished.
+    class PackWriter {
+       public:
+        bool open(const std::string& temporary_path);
+        //! Appends one chunk and returns its offset inside the pack.
+        bool append(const hashing::Digest& digest, const byte* data, size_t size, uint64_t& offset, uint32_t flags = 0);
+        //! Writes the index and footer, fsyncs and renames the pack to `<directory>/<id>.pack`.
+        bool finish(const std::string& directory, std::string& id);
+        //! Drops the temporary file.
+        void abort();
+
+        COMP_NO_DISCARD bool is_open() const {
+            return m_file.is_open();
+        }
+        COMP_NO_DISCARD uint64_t size() const {
+            return m_size;
+        }
+        COMP_NO_DISCARD const std::vector<PackEntry>& entries() const {
+            return m_entries;
+        }
+
+       private:
+        files::File m_file;
+        std::string m_temporary_path;
+        std::vector<PackEntry> m_entries;
+        uint64_t m_size = 0;
+    };
+
+    //! Reads and validates the index of a finished pack, whole or sharded; `id` receives the index digest
+    //! the pack is named after.
+    bool read_pack_index(const PackFile& file, std::vector<PackEntry>& entries, hashing::Digest* id = nullptr);
+}  // namespace backup
@@ -0,0 +1,50 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <chrono>
+
+#include "backup/repository.h"
+#include "tasks/scheduler.h"
+
+namespace backup {
+    struct PruneOptions {
+        //! Newest snapshots of each source to keep.
+        uint32_t keep_last = 0;
+        //! Snapshots younger than this are kept.
+        std::chrono::milliseconds keep_within {};
+        //! Packs with a smaller share of live bytes are rewritten; emptier ones are only deleted.
+        double repack_below = 0.5;
+        //! Snapshots marked at the same time, 0 for one per worker; bounds the manifests in memory.
+        uint32_t threads = 0;
+        //! Only reports what would be removed.
+        bool dry_run = false;
+        tasks::Priority priority = tasks::Priority::Normal;
+    };
+
+    struct PruneStats {
+        uint64_t snapshots_kept = 0;
+        uint64_t snapshots_removed = 0;
+        uint64_t chunks_live = 0;
+        uint64_t chunks_removed = 0;
+        //! Chunks that kept snapshots reference but the repository doesn't have.
+        uint64_t chunks_missing = 0;
+        uint64_t packs_removed = 0;
+        uint64_t packs_repacked = 0;
+        uint64_t packs_written = 0;
+        //! Pack bytes deleted, less what the rewritten packs take.
+        uint64_t bytes_freed = 0;
+    };
+
+    //! Forgets the snapshots outside the retention policy and reclaims the chunks no remaining snapshot
+    //! uses. With neither keep option set every snapshot stays and only garbage is collected; the
+    //! newest snapshot of every source is always kept.
+    //!
+    //! Live chunks and the delta bases behind them are marked in a bitmap with one bit per pack entry,
+    //! the snapshots in parallel. Packs without live entries are deleted, packs below `repack_below`
+    //! have their live entries copied into new packs first. Backups keep running meanwhile: the
+    //! repository lock is only taken exclusively at the end, where the snapshots saved since the mark
+    //! are marked too and the packs they still need are spared before anything is deleted.
+    bool run_prune(Repository& repository, const PruneOptions& options, PruneStats& stats);
+}  // namespace backup
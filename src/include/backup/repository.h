@@ -0,0 +1,151 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "backup/chunk_index.h"
+#include "backup/pack.h"
+#include "backup/shards.h"
+#include "backup/snapshot.h"
+
+namespace backup {
+    //! Packs are closed once they reach this size; a pack can exceed it by at most one chunk.
+    inline constexpr uint64_t c_pack_target_size = 16 * 1024 * 1024;
+    //! Longest chain of deltas a chunk may sit behind; a deeper one is stored in full again.
+    inline constexpr uint32_t c_max_delta_depth = 8;
+
+    //! A content-addressed backup repository on a local path:
+    //!
+    //!     <path>/config                marker with the format version
+    //!     <path>/packs/<id>.pack       chunk data, see PackWriter
+    //!     <path>/snapshots/<id>.snap   snapshot manifests
+    //!     <path>/lock                  see lock()
+    //!     <path>/index                 cache of the chunk index, see ChunkIndex
+    //!     <path>/shards                where packs are striped instead, see ShardLayout
+    //!
+    //! The chunk index is mapped from the cache on open, with the packs published since read on top;
+    //! it is rebuilt from the pack indexes when the cache is missing or names a pack that is gone. Under
+    //! a files::memory_budget() that rebuild sorts on disk and writes the cache as it goes, so only the
+    //! index's filter and directory, about 2.5 bytes per chunk, stay in memory.
+    //!
+    //! With a shard layout every pack is striped once published and leaves packs/; a pack is read
+    //! from packs/ while it is there and from its shards otherwise.
+    //! Reads are thread-safe, writes are not.
+    class Repository {
+       public:
+        Repository() = default;
+        ~Repository();
+        Repository(const Repository&) = delete;
+        Repository& operator=(const Repository&) = delete;
+
+        static bool create(const std::string& path);
+        bool open(const std::string& path);
+        //! Adds packs other processes published since open(), so a long-lived instance stays current.
+        //! When packs were removed the whole index is rebuilt, as it may point into them.
+        bool refresh();
+        //! Backups, restores and verifies hold the repository lock shared for as long as they use the
+        //! index; prune takes it exclusively, and only to delete. Waits for the lock, then refreshes.
+        //! A repository that can't be written to isn't locked at all, as nothing can prune it either.
+        bool lock(bool exclusive);
+        void unlock();
+
+        COMP_NO_DISCARD const std::string& path() const {
+            return m_path;
+        }
+        COMP_NO_DISCARD bool contains(const hashing::Digest& digest) const {
+            return m_index.contains(digest);
+        }
+        bool locate(const hashing::Digest& digest, ChunkLocation& location) const;
+        //! Reads a chunk, resolving deltas against their bases.
+        bool read_chunk(const hashing::Digest& digest, std::vector<byte>& out) const;
+        //! The chunk a stored delta is based on, read from the delta itself.
+        bool read_delta_base(const hashing::Digest& digest, hashing::Digest& base) const;
+        //! 0 for a chunk stored in full, otherwise the number of deltas to apply to reach it.
+        COMP_NO_DISCARD uint32_t delta_depth(const hashing::Digest& digest) const;
+
+        //! Stores a chunk unless the repository already has it; `added` tells which of the two happened.
+        bool store_chunk(const hashing::Digest& digest, const byte* data, size_t size, bool& added);
+        //! Stores a chunk as `delta` against the base named inside it, which must already be stored.
+        bool store_delta(const hashing::Digest& digest, const byte* delta, size_t size, bool& added);
+        //! Publishes the pack that is currently being written and waits until every published pack is
+        //! striped.
+        bool flush();
+
+        COMP_NO_DISCARD size_t pack_count() const {
+            return m_packs.size();
+        }
+        COMP_NO_DISCARD const std::string& pack_id(uint32_t pack) const {
+            return m_packs[pack];
+        }
+        COMP_NO_DISCARD std::string pack_path(uint32_t pack) const;
+        bool open_pack(uint32_t pack, PackFile& file) const;
+        //! Deletes a pack with all its shards; true when there was anything to delete.
+        bool remove_pack(uint32_t pack);
+        COMP_NO_DISCARD const ShardLayout& shard_layout() const {
+            return m_layout;
+        }
+        //! Moves the published pack `id` from packs/ into shards, if the repository has a layout and
+        //! the pack is still whole. False when striping failed, which leaves the pack whole.
+        bool stripe_pack(const std::string& id) const;
+        COMP_NO_DISCARD size_t chunk_count() const {
+            return m_index.size();
+        }
+        template<typename Visit>
+        void for_each_chunk(Visit&& visit) const {
+            m_index.for_each(visit);
+        }
+        //! Packs whose index could not be read on open; their chunks are not in the index.
+        COMP_NO_DISCARD const std::vector<std::string>& unreadable_packs() const {
+            return m_unreadable_packs;
+        }
+
+        //! Assigns a unique snapshot id, sortable by time, and writes the manifest atomically. When the id
+        //! is taken, `time_ns` moves on by a nanosecond instead of replacing the other snapshot.
+        bool save_snapshot(Snapshot& snapshot);
+        bool load_snapshot(const std::string& id, Snapshot& snapshot) const;
+        //! Snapshot ids, oldest first.
+        COMP_NO_DISCARD std::vector<std::string> snapshot_ids() const;
+        //! Id of the snapshot with the highest time_ns, empty when there are none. Only reads the start of
+        //! every manifest, so a damaged one can still be chosen and fail to load later.
+        COMP_NO_DISCARD std::string latest_snapshot_id() const;
+
+       private:
+        bool open_pack(const std::string& id, PackFile& file) const;
+        bool load_pack(const std::string& id);
+        //! Rebuilds the index and its cache from all of `present` through ChunkIndex::rebuild().
+        bool rebuild_index(const std::vector<std::string>& present);
+        void clear_index();
+        //! Merges recently added entries into the sorted run and rewrites the cache, once they are many.
+        void update_index_cache();
+        bool open_pack_file(uint32_t pack, PackFile*& file) const;
+        bool read_stored(const ChunkLocation& location, std::vector<byte>& out) const;
+        bool append(const hashing::Digest& digest, const byte* data, size_t size, uint32_t flags);
+        bool finish_pack();
+        bool stripe_pack(const std::string& id, std::vector<byte>& buffer) const;
+        //! Stripes `id` on a thread of its own while the next pack fills, after the previous one is done.
+        void stripe_later(const std::string& id);
+        void wait_striping();
+
+        std::string m_path;
+        //! Pack ids in load order; the pack being written has an empty id until flush().
+        std::vector<std::string> m_packs;
+        std::vector<std::string> m_unreadable_packs;
+        ChunkIndex m_index;
+        PackWriter m_writer;
+        std::string m_pending_path;
+        files::File m_lock;
+        ShardLayout m_layout;
+        std::thread m_striper;
+        //! Scratch space of the striping thread.
+        std::vector<byte> m_stripe_buffer;
+
+        mutable std::mutex m_files_mutex;
+        mutable std::unordered_map<uint32_t, PackFile> m_files;
+    };
+}  // namespace backup
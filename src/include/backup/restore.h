@@ -0,0 +1,23 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <string>
+
+#include "backup/repository.h"
+
+namespace backup {
+    struct RestoreStats {
+        uint64_t files = 0;
+        uint64_t directories = 0;
+        uint64_t links = 0;
+        uint64_t bytes_written = 0;
+        uint64_t errors = 0;
+    };
+
+    //! Recreates `snapshot` below `target`: contents, symlinks, modes and mtimes. Every chunk is
+    //! checked against its digest after deltas are resolved; files that fail are counted as errors.
+    //! Small files are restored in batches per directory, created relative to it in pack order.
+    bool run_restore(const Repository& repository, const Snapshot& snapshot, const std::string& target, RestoreStats& stats);
+}  // namespace backup
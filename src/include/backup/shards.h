@@ -0,0 +1,95 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <string>
+#include <vector>
+
+#include "files/file.h"
+#include "utils/reed_solomon.h"
+
+namespace backup {
+    //! Packs striped over several directories, normally one per disk, instead of kept in the
+    //! repository: `data` shards hold the pack cut in equal parts, `parity` shards a ReedSolomon code
+    //! over them, so the pack survives the loss of any `parity` directories. Shard i of a pack is
+    //! `<directories[i]>/<id>.shard`:
+    //!
+    //!     header     magic, pack id, shard index, data and parity count, pack size; padded to a block
+    //!     payload    the shard itself, a whole number of blocks
+    //!     checksums  CRC-32C of every payload block, then one of the header and checksums together
+    struct ShardLayout {
+        uint32_t data = 0;
+        uint32_t parity = 0;
+        //! One per shard, data shards first.
+        std::vector<std::string> directories;
+        ReedSolomon codec;
+
+        COMP_NO_DISCARD bool enabled() const {
+            return data != 0;
+        }
+    };
+
+    //! Shards are checked and rebuilt in blocks of this size.
+    inline constexpr uint32_t c_shard_block = 4096;
+
+    //! Reads `<repository>/shards`; a repository without one keeps its packs whole and `layout` stays
+    //! disabled. False when the file is there but invalid.
+    bool load_shard_layout(const std::string& repository, ShardLayout& layout);
+    //! Creates the directories and writes `<repository>/shards`.
+    bool save_shard_layout(const std::string& repository, const ShardLayout& layout);
+
+    //! Stripes the finished pack at `path` into the layout's directories. All shards are written and
+    //! synced before this returns true; on failure none are left behind. `buffer` is scratch space,
+    //! worth keeping across packs.
+    bool write_shards(const ShardLayout& layout, const std::string& path, const std::string& id, std::vector<byte>& buffer);
+    //! Removes every shard of pack `id`; true when there was any.
+    bool remove_shards(const ShardLayout& layout, const std::string& id);
+    //! Ids of the packs with at least one shard in the layout's directories.
+    COMP_NO_DISCARD std::vector<std::string> list_sharded_packs(const ShardLayout& layout);
+    //! Removes what interrupted writes left in the layout's directories.
+    void remove_stale_shards(const ShardLayout& layout);
+
+    //! A pack read from its file or from its shards. Reads of a sharded pack go to the data shard
+    //! holding the range and have every block checked; ranges of missing or damaged shards are rebuilt
+    //! from the others on the fly, nothing is written. Reads are thread-safe.
+    class PackFile {
+       public:
+        bool open(const std::string& path);
+        //! False unless at least `layout.data` shards of pack `id` have an intact header. The layout
+        //! must outlive the PackFile.
+        bool open(const ShardLayout& layout, const std::string& id);
+        void close();
+
+        COMP_NO_DISCARD bool is_open() const {
+            return m_file.is_open() || m_layout;
+        }
+        COMP_NO_DISCARD bool sharded() const {
+            return m_layout != nullptr;
+        }
+        COMP_NO_DISCARD uint64_t size() const {
+            return m_layout ? m_size : m_file.size();
+        }
+
+        bool read_exact_at(void* data, size_t size, uint64_t offset) const;
+        //! Checks every block of every shard and rewrites the missing and damaged ones from the
+        //! others; `rebuilt` counts the shards that had to be written. A whole pack needs nothing.
+        bool repair(uint32_t& rebuilt);
+
+       private:
+        //! Reads blocks [first, first + count) of `shard`, rebuilding them from other shards where
+        //! they fail their checksums.
+        bool read_blocks(uint32_t shard, uint64_t first, uint64_t count, byte* out) const;
+        //! Reads blocks of `shard` as stored; false when any of them fails its checksum.
+        bool read_intact(uint32_t shard, uint64_t first, uint64_t count, byte* out) const;
+
+        files::File m_file;
+        const ShardLayout* m_layout = nullptr;
+        std::string m_id;
+        uint64_t m_size = 0;
+        uint64_t m_shard_size = 0;
+        std::vector<files::File> m_shards;
+        //! Block checksums per shard, empty for the missing ones.
+        std::vector<std::vector<uint32_t>> m_checksums;
+    };
+}  // namespace backup
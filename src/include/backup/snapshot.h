@@ -0,0 +1,83 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "files/path_store.h"
+#include "files/scanner.h"
+#include "hashing/sha256.h"
+
+namespace backup {
+    struct ChunkRef {
+        hashing::Digest digest;
+        uint32_t length;
+    };
+
+    //! The file could not be read while backing up; it has no chunks and no content digest.
+    inline constexpr uint8_t c_entry_unreadable = 0x01;
+
+    struct SnapshotEntry {
+        files::EntryType type = files::EntryType::Other;
+        uint8_t flags = 0;
+        uint32_t mode = 0;
+        uint64_t size = 0;
+        int64_t mtime_ns = 0;
+        uint32_t first_chunk = 0;
+        uint32_t chunk_count = 0;
+        //! Merkle node over the contents: chunk list, link target or directory listing.
+        hashing::Digest content {};
+        //! Merkle node over the metadata, comparable against a stat-only walk of the live tree.
+        hashing::Digest meta {};
+        //! Inode number on the source filesystem, for reading files in inode order. Only set by
+        //! capture_snapshot(), not stored.
+        uint64_t inode = 0;
+    };
+
+    //! One backup of a source tree. Entries are indexed by their PathId, whose root is the source itself.
+    class Snapshot {
+       public:
+        std::string id;
+        std::string source;
+        int64_t time_ns = 0;
+        files::PathStore paths;
+        std::vector<SnapshotEntry> entries;
+        std::vector<ChunkRef> chunks;
+        std::unordered_map<files::PathId, std::string> link_targets;
+        //! Rules of the filter the tree was captured with, so a later walk can leave out the same paths.
+        std::vector<std::string> filter_rules;
+        bool filter_ignore_case = false;
+
+        COMP_NO_DISCARD std::span<const ChunkRef> chunks_of(files::PathId id) const {
+            const auto& entry = entries[id];
+            return { chunks.data() + entry.first_chunk, entry.chunk_count };
+        }
+        COMP_NO_DISCARD std::string_view link_target(files::PathId id) const;
+        //! Absolute path of an entry below `source`.
+        void source_path(files::PathId id, std::string& out) const;
+
+        //! Builds the name-sorted child lists used by children(); loading and merkle_build() call it.
+        void index_children();
+        COMP_NO_DISCARD std::span<const files::PathId> children(files::PathId id) const {
+            return { m_children.data() + m_child_offsets[id], m_child_offsets[id + 1] - m_child_offsets[id] };
+        }
+
+       private:
+        std::vector<uint32_t> m_child_offsets;
+        std::vector<files::PathId> m_children;
+    };
+
+    //! Walks `source` and records the metadata of every included entry, without reading file contents.
+    bool capture_snapshot(const std::string& source, const files::PathFilter* filter, Snapshot& snapshot, files::ScanStats* stats = nullptr);
+
+    //! Binary manifest with the per-entry content digests and a trailing SHA-256 over the whole file.
+    void serialize_snapshot(const Snapshot& snapshot, std::vector<byte>& out);
+    bool deserialize_snapshot(const byte* data, size_t size, Snapshot& snapshot);
+    //! Reads the creation time from the start of a manifest, `data` may be just its first bytes. The
+    //! checksum isn't verified, that needs the whole file.
+    bool peek_snapshot_time(const byte* data, size_t size, int64_t& time_ns);
+}  // namespace backup
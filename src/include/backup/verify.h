@@ -0,0 +1,67 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <string>
+#include <vector>
+
+#include "backup/repository.h"
+#include "tasks/scheduler.h"
+
+namespace backup {
+    enum class VerifyIssue : uint8_t {
+        //! The manifest's Merkle node doesn't match its children or chunk list.
+        TreeCorrupt,
+        //! A referenced chunk is not in any readable pack.
+        ChunkMissing,
+        //! A stored chunk no longer hashes to its digest.
+        ChunkCorrupt,
+        //! The file was unreadable when it was backed up.
+        Unreadable,
+        //! The live file has different contents than the backup.
+        Modified,
+        //! In the backup but no longer on the live filesystem.
+        Removed,
+        //! On the live filesystem but not in the backup.
+        Added
+    };
+
+    COMP_NO_DISCARD const char* verify_issue_name(VerifyIssue issue);
+
+    struct VerifyProblem {
+        VerifyIssue issue;
+        std::string snapshot;
+        std::string path;
+    };
+
+    struct VerifyReport {
+        std::vector<VerifyProblem> problems;
+        uint64_t entries_checked = 0;
+        uint64_t files_rehashed = 0;
+        uint64_t chunks_checked = 0;
+        uint64_t bytes_checked = 0;
+        //! Missing or damaged shards of striped packs that were written anew.
+        uint64_t shards_rebuilt = 0;
+        std::vector<std::string> unreadable_packs;
+
+        //! True when nothing in the backup itself is damaged; differences with the live tree don't count.
+        COMP_NO_DISCARD bool intact() const;
+    };
+
+    //! Checks the Merkle tree and chunk presence of `snapshot`, then compares it against `live_root`
+    //! top-down. Unchanged subtrees are skipped on their metadata node and only files whose metadata
+    //! differs are read and rehashed. The cached hash in a file's extended attributes is never trusted
+    //! here, as anyone who can write the file can forge it along with the mtime; with `hash_xattrs` the
+    //! digests read are stored there for later backups. The live tree is walked with the
+    //! filter rules recorded in the snapshot, followed by those of `filter`.
+    bool verify_quick(const Repository& repository, const Snapshot& snapshot, const std::string& live_root, const files::PathFilter* filter,
+                      bool hash_xattrs, VerifyReport& report);
+
+    //! Rehashes every stored chunk, at most `threads` packs at a time on the shared scheduler (0 for
+    //! one per worker), and reports each file of `snapshots` that references a damaged or missing
+    //! chunk, plus any damage to the manifests themselves. Striped packs have their missing and
+    //! damaged shards rewritten first.
+    bool verify_full(const Repository& repository, const std::vector<const Snapshot*>& snapshots, uint32_t threads, VerifyReport& report,
+                     tasks::Priority priority = tasks::Priority::Foreground);
+}  // namespace backup
@@ -0,0 +1,48 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "system.h"
+
+namespace commands {
+    //! Command line of a single sub-command: positionals, `--flag`s and `--option value`s. Options
+    //! may repeat; the accessors for a single value return the last one.
+    class Arguments {
+       public:
+        //! `with_value` lists the options that take a value, everything else starting with `--` is a flag.
+        Arguments(int32_t argc, char** argv, std::initializer_list<std::string_view> with_value);
+
+        COMP_NO_DISCARD bool valid() const {
+            return m_error.empty();
+        }
+        COMP_NO_DISCARD const std::string& error() const {
+            return m_error;
+        }
+
+        COMP_NO_DISCARD size_t positional_count() const {
+            return m_positionals.size();
+        }
+        COMP_NO_DISCARD const std::string& positional(size_t index) const {
+            return m_positionals[index];
+        }
+
+        COMP_NO_DISCARD bool flag(std::string_view name) const;
+        COMP_NO_DISCARD bool has(std::string_view name) const;
+        COMP_NO_DISCARD std::string value(std::string_view name, std::string_view fallback = {}) const;
+        COMP_NO_DISCARD std::vector<std::string> values(std::string_view name) const;
+        //! False when the option is present but not an unsigned number.
+        bool number(std::string_view name, uint64_t& out) const;
+
+       private:
+        std::vector<std::string> m_positionals;
+        std::vector<std::string> m_flags;
+        std::vector<std::pair<std::string, std::string>> m_options;
+        std::string m_error;
+    };
+}  // namespace commands
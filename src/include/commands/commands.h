@@ -0,0 +1,69 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <chrono>
+
+#include "backup/prune.h"
+#include "commands/arguments.h"
+#include "files/path_filter.h"
+#include "metrics/exporter.h"
+#include "service/daemon.h"
+
+namespace commands {
+    //! Every command receives the arguments after its own name and returns the process exit code.
+    using Command = int32_t (*)(int32_t argc, char** argv);
+
+    //! `fward backup <source> <repository> [--exclude <pattern>]... [--exclude-from <file>] [--ignore-case] [--rehash] [--hash-xattrs]`
+    int32_t backup(int32_t argc, char** argv);
+    //! `fward verify <repository> [--snapshot <id>] [--full] [--against <path>] [--threads <n>] [--exclude <pattern>]... [--hash-xattrs]`
+    int32_t verify(int32_t argc, char** argv);
+    //! `fward restore <repository> <target> [--snapshot <id>]`
+    int32_t restore(int32_t argc, char** argv);
+    //! `fward prune <repository> [--keep-last <n>] [--keep-within <duration>] [--repack-below <percent>] [--threads <n>] [--dry-run]`
+    int32_t prune(int32_t argc, char** argv);
+    //! `fward shards <repository> <directory>... --data <n> --parity <n>` stripes the packs over the
+    //! directories, one shard each, so any `parity` of them may be lost.
+    int32_t shards(int32_t argc, char** argv);
+    //! `fward daemon <config>`, where every line of the config schedules one job:
+    //!
+    //!     backup <source> <repository> --every <duration> [backup options]
+    //!     scrub <repository> --every <duration> [--threads <n>]
+    //!     prune <repository> --every <duration> [prune options]
+    //!
+    //! Durations take an s, m, h or d suffix. A job first runs one interval after start or reload.
+    int32_t daemon(int32_t argc, char** argv);
+
+    //! Options that go before the command name and apply to every command.
+    struct GlobalOptions {
+        std::string metrics_path;
+        metrics::ExportFormat metrics_format = metrics::ExportFormat::Prometheus;
+        std::chrono::milliseconds metrics_interval { 10000 };
+        //! Chrome trace-event JSON of every TRACE_ZONE, written when the command finishes.
+        std::string trace_path;
+        //! Bytes large sorts may hold in memory before spilling to disk, see files::set_memory_budget().
+        uint64_t memory_budget = 0;
+    };
+
+    //! Consumes the leading global options; `consumed` is the number of arguments they took.
+    bool parse_global_options(int32_t argc, char** argv, GlobalOptions& options, int32_t& consumed);
+
+    //! Looks up a command by name, nullptr when there is none.
+    COMP_NO_DISCARD Command find_command(std::string_view name);
+    void print_usage();
+
+    //! A number with an optional unit: s, m, h or d. Seconds when there is none.
+    bool parse_duration(std::string_view text, std::chrono::milliseconds& duration);
+    //! A byte count with an optional binary unit: K, M or G.
+    bool parse_size(std::string_view text, uint64_t& size);
+    //! Fills the prune options from `--keep-last`, `--keep-within`, `--repack-below`, `--threads` and `--dry-run`.
+    bool build_prune_options(const Arguments& arguments, backup::PruneOptions& options);
+    //! Builds the path filter from `--exclude`, `--exclude-from` and `--ignore-case`.
+    bool build_filter(const Arguments& arguments, files::PathFilter& filter);
+    //! Splits a daemon config line on whitespace; single or double quotes keep a pattern with spaces
+    //! in one word. False on an unterminated quote.
+    bool split_words(std::string_view line, std::vector<std::string>& words);
+    //! Fills `job` from one daemon config line split into words, the job kind first.
+    bool parse_job(std::vector<std::string>& words, service::JobConfig& job);
+}  // namespace commands
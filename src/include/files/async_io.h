@@ -0,0 +1,227 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <sys/stat.h>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "system.h"
+#include "tasks/scheduler.h"
+
+namespace files {
+    class IoContext;
+
+    namespace detail {
+        struct IoPromiseBase {
+            std::coroutine_handle<> continuation;
+            //! Set for tasks started with IoContext::spawn(); they free themselves when done.
+            IoContext* owner = nullptr;
+
+            std::suspend_always initial_suspend() noexcept {
+                return {};
+            }
+            struct FinalAwaiter {
+                bool await_ready() noexcept {
+                    return false;
+                }
+                template<typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept;
+                void await_resume() noexcept { }
+            };
+            FinalAwaiter final_suspend() noexcept {
+                return {};
+            }
+            void unhandled_exception() noexcept {
+                std::abort();
+            }
+        };
+
+        template<typename T>
+        struct IoPromise : IoPromiseBase {
+            T value {};
+            void return_value(T result) {
+                value = std::move(result);
+            }
+        };
+        template<>
+        struct IoPromise<void> : IoPromiseBase {
+            void return_void() { }
+        };
+    }  // namespace detail
+
+    //! Lazily started coroutine: runs when it is co_awaited or handed to IoContext::spawn().
+    template<typename T = void>
+    class IoTask {
+       public:
+        struct promise_type : detail::IoPromise<T> {
+            IoTask get_return_object() {
+                return IoTask(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+        };
+
+        IoTask(IoTask&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) { }
+        IoTask& operator=(IoTask&& other) noexcept {
+            if (this != &other) {
+                if (m_handle) m_handle.destroy();
+                m_handle = std::exchange(other.m_handle, nullptr);
+            }
+            return *this;
+        }
+        ~IoTask() {
+            if (m_handle) m_handle.destroy();
+        }
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept {
+            m_handle.promise().continuation = continuation;
+            return m_handle;
+        }
+        T await_resume() {
+            if constexpr (!std::is_void_v<T>) return std::move(m_handle.promise().value);
+        }
+
+       private:
+        friend class IoContext;
+        explicit IoTask(std::coroutine_handle<promise_type> handle) : m_handle(handle) { }
+
+        std::coroutine_handle<promise_type> m_handle;
+    };
+
+    enum class IoOpcode : uint8_t {
+        Read,
+        Write,
+        ReadFixed,
+        WriteFixed,
+        OpenAt,
+        Statx,
+        Close
+    };
+
+    //! Awaitable for one operation; resumes with the syscall result, or -errno on failure.
+    class IoOperation {
+       public:
+        bool await_ready() const noexcept {
+            return false;
+        }
+        void await_suspend(std::coroutine_handle<> handle);
+        int32_t await_resume() const noexcept {
+            return m_result;
+        }
+
+       private:
+        friend class IoContext;
+        IoOperation(IoContext& context, IoOpcode opcode, int32_t fd) : m_context(context), m_opcode(opcode), m_fd(fd) { }
+
+        IoContext& m_context;
+        IoOpcode m_opcode;
+        int32_t m_fd;
+        //! Buffer, or the path for OpenAt and Statx.
+        const void* m_data = nullptr;
+        //! Byte count, the open mode, or the statx mask.
+        uint32_t m_length = 0;
+        uint64_t m_offset = 0;
+        //! Open or statx flags, or the registered buffer index.
+        int32_t m_flags = 0;
+        struct statx* m_statx = nullptr;
+
+        std::coroutine_handle<> m_handle;
+        int32_t m_result = 0;
+    };
+
+    struct IoOptions {
+        //! Operations in flight at once; the ring is sized to match.
+        uint32_t queue_depth = 256;
+        //! False forces the thread-pool fallback, e.g. where seccomp forbids io_uring.
+        bool use_io_uring = true;
+    };
+
+    //! Runs coroutines on the calling thread and their I/O through io_uring: operations queue up as
+    //! coroutines suspend and go to the kernel in one io_uring_enter once nothing else can run.
+    //! Without io_uring every operation becomes a blocking call on the shared task scheduler and
+    //! completions are handed back to this thread, so callers see the same behaviour either way.
+    //! Should io_uring_enter fail for good, the operations the ring holds complete with its -errno
+    //! and the context carries on with the fallback.
+    class IoContext {
+       public:
+        IoContext();
+        ~IoContext();
+        IoContext(const IoContext&) = delete;
+        IoContext& operator=(const IoContext&) = delete;
+
+        bool open(const IoOptions& options = {});
+        void close();
+        COMP_NO_DISCARD bool uses_io_uring() const;
+
+        //! Pins `buffers` for read_fixed() and write_fixed(), which skip the per-call page mapping.
+        //! Also succeeds without io_uring, where the fixed variants are plain reads and writes.
+        bool register_buffers(const std::vector<std::span<byte>>& buffers);
+
+        IoOperation read(int32_t fd, void* data, uint32_t size, uint64_t offset);
+        IoOperation write(int32_t fd, const void* data, uint32_t size, uint64_t offset);
+        //! `data` must lie inside registered buffer `buffer`.
+        IoOperation read_fixed(int32_t fd, uint32_t buffer, void* data, uint32_t size, uint64_t offset);
+        IoOperation write_fixed(int32_t fd, uint32_t buffer, const void* data, uint32_t size, uint64_t offset);
+        //! `path` must stay valid until the operation completed.
+        IoOperation openat(int32_t directory, const char* path, int32_t flags, uint32_t mode = 0);
+        IoOperation statx(int32_t directory, const char* path, int32_t flags, uint32_t mask, struct statx* out);
+        IoOperation close_fd(int32_t fd);
+
+        //! Starts `task` on the next run(); it is freed once it finishes.
+        void spawn(IoTask<void> task);
+        //! Drives every spawned task and the I/O it issues until all of them finished.
+        void run();
+
+       private:
+        friend class IoOperation;
+        friend struct detail::IoPromiseBase::FinalAwaiter;
+        struct Ring;
+
+        void queue(IoOperation* operation);
+        void complete(IoOperation* operation, int32_t result);
+        //! Hands queued operations to the ring or the pool, within the queue depth.
+        void issue();
+        //! Blocks until at least one operation completed.
+        void wait_completions();
+        //! Fails everything the ring holds with `error` and switches to the fallback.
+        void abandon_ring(int32_t error);
+        void run_blocking(IoOperation* operation);
+
+        IoOptions m_options;
+        std::unique_ptr<Ring> m_ring;
+        //! Operations handed to the ring that haven't completed yet.
+        std::unordered_set<IoOperation*> m_submitted;
+        std::deque<std::coroutine_handle<>> m_ready;
+        std::deque<IoOperation*> m_queued;
+        uint32_t m_in_flight = 0;
+        uint64_t m_live_tasks = 0;
+
+        //! Fallback: the blocking calls and the completions they hand back.
+        std::unique_ptr<tasks::TaskGroup> m_pool;
+        std::mutex m_mutex;
+        std::condition_variable m_completed_signal;
+        std::vector<std::pair<IoOperation*, int32_t>> m_completed;
+    };
+
+    template<typename Promise>
+    std::coroutine_handle<> detail::IoPromiseBase::FinalAwaiter::await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+        auto& promise = handle.promise();
+        if (IoContext* owner = promise.owner) {
+            handle.destroy();
+            owner->m_live_tasks--;
+            return std::noop_coroutine();
+        }
+        return promise.continuation ? promise.continuation : std::noop_coroutine();
+    }
+}  // namespace files
@@ -0,0 +1,78 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "system.h"
+#include "tasks/scheduler.h"
+
+namespace files {
+    //! The disk behind a filesystem, as sysfs describes it.
+    struct BlockDevice {
+        //! Device number of the whole disk, shared by its partitions; the filesystem's own number when
+        //! sysfs doesn't know it, as for tmpfs, network and FUSE mounts.
+        uint64_t id = 0;
+        //! Kernel name such as `sda` or `nvme0n1`, empty when unknown.
+        std::string name;
+        bool rotational = false;
+        //! Requests the block layer queues for the disk, 0 when unknown.
+        uint32_t queue_depth = 0;
+
+        //! Files to read at once: one for a spinning disk, which loses most of its throughput to seeks
+        //! as soon as two readers take turns, and enough to keep the queue of any other one full.
+        COMP_NO_DISCARD uint32_t readers() const;
+    };
+
+    //! Looks up the disk holding the filesystem with device number `dev`, a file's st_dev, in the sysfs
+    //! mounted at `sysfs`.
+    BlockDevice block_device(uint64_t dev, const std::string& sysfs = "/sys");
+
+    //! Where the data of the open file `fd` starts on its disk, from FIEMAP. False where the filesystem
+    //! can't tell, the data isn't allocated yet or lives inside the inode.
+    bool physical_offset(int32_t fd, uint64_t& offset);
+
+    //! Spreads file reads over the disks they hit. Every disk gets its own queue, drained by as many
+    //! tasks as it has readers, so a run over several disks keeps each of them busy at its own best
+    //! rate. Queues of rotational disks are sorted by physical offset first, so the head sweeps across
+    //! the platter once instead of seeking between files in directory order.
+    class DeviceQueues {
+       public:
+        explicit DeviceQueues(std::string sysfs = "/sys") : m_sysfs(std::move(sysfs)) {}
+
+        //! Queues `tag` on the disk `path` is stored on. Files that can't be stat'ed share a queue; the
+        //! job finds out when it opens them.
+        void add(const std::string& path, uint64_t tag);
+        COMP_NO_DISCARD size_t device_count() const {
+            return m_queues.size();
+        }
+
+        //! Calls `job` for every queued tag on `group` and waits for all of them; a cancelled group
+        //! stops after the jobs that are running. The queues are empty afterwards.
+        void run(tasks::TaskGroup& group, const std::function<void(uint64_t tag)>& job);
+
+       private:
+        struct Item {
+            uint64_t offset;
+            uint64_t tag;
+        };
+        struct Queue {
+            BlockDevice device;
+            std::vector<Item> items;
+            std::atomic<size_t> next = 0;
+        };
+
+        Queue& queue_of(uint64_t dev);
+
+        std::string m_sysfs;
+        std::vector<std::unique_ptr<Queue>> m_queues;
+        //! Filesystem device number to queue.
+        std::unordered_map<uint64_t, size_t> m_by_dev;
+    };
+}  // namespace files
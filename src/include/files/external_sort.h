@@ -0,0 +1,262 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "files/file.h"
+#include "system.h"
+
+namespace files {
+    //! Bytes the large sorts of this process may hold in memory, 0 for no bound. Sorts that would need
+    //! more spill sorted runs to disk and merge them instead.
+    void set_memory_budget(uint64_t bytes);
+    COMP_NO_DISCARD uint64_t memory_budget();
+
+    //! Sequential reads and writes of spilled runs go in requests of this size.
+    inline constexpr size_t c_sort_run_buffer = 1 << 20;
+    //! Smallest budget that can merge: a read buffer for each of two runs and one for the output.
+    inline constexpr uint64_t c_min_memory_budget = 3 * c_sort_run_buffer;
+
+    //! Tournament tree for a k-way merge. Every inner node keeps the loser of the match played there and
+    //! the winner comes out on top, so replacing the winner replays one leaf-to-root path of log2 k
+    //! comparisons against the stored losers, about half of what a heap's sift-down costs.
+    template<typename T, typename Less>
+    class LoserTree {
+       public:
+        LoserTree(size_t sources, Less less) : m_heads(sources, nullptr), m_tree(std::max<size_t>(1, sources)), m_less(less) {}
+
+        //! Sets the first record of `source`, nullptr when it is empty; call build() once all are set.
+        void set(size_t source, const T* head) {
+            m_heads[source] = head;
+        }
+        void build() {
+            size_t k = m_heads.size();
+            if (k == 0) return;
+            std::vector<size_t> winners(2 * k);
+            for (size_t i = 0; i < k; ++i) winners[k + i] = i;
+            for (size_t node = k - 1; node > 0; --node) {
+                size_t a = winners[2 * node];
+                size_t b = winners[2 * node + 1];
+                bool first = beats(a, b);
+                winners[node] = first ? a : b;
+                m_tree[node] = first ? b : a;
+            }
+            m_tree[0] = winners[1];
+        }
+
+        //! The smallest record of all sources, nullptr once they are all exhausted.
+        COMP_NO_DISCARD const T* top() const {
+            return m_heads.empty() ? nullptr : m_heads[m_tree[0]];
+        }
+        //! The source top() came from.
+        COMP_NO_DISCARD size_t winner() const {
+            return m_tree[0];
+        }
+        //! Replaces top() by the next record of its source, nullptr when that ran out.
+        void replace(const T* next) {
+            size_t winner = m_tree[0];
+            m_heads[winner] = next;
+            for (size_t node = (winner + m_heads.size()) / 2; node > 0; node /= 2) {
+                if (beats(m_tree[node], winner)) std::swap(m_tree[node], winner);
+            }
+            m_tree[0] = winner;
+        }
+
+       private:
+        //! Exhausted sources lose every match; equal records go to the earlier source, which keeps
+        //! merges stable.
+        COMP_NO_DISCARD bool beats(size_t a, size_t b) const {
+            const T* x = m_heads[a];
+            const T* y = m_heads[b];
+            if (!x || !y) return x != nullptr;
+            if (m_less(*x, *y)) return true;
+            if (m_less(*y, *x)) return false;
+            return a < b;
+        }
+
+        std::vector<const T*> m_heads;
+        //! m_tree[0] is the winner, m_tree[1..k) the losers of the inner nodes; leaf i is node k + i.
+        std::vector<size_t> m_tree;
+        Less m_less;
+    };
+
+    //! Sorts more records than fit in a memory budget. Records collect in a buffer up to the budget,
+    //! which is sorted and written out as a run to a nameless file whenever it fills; merge() then
+    //! streams the runs through a LoserTree, each read back in large sequential requests. A merge reads
+    //! as many runs at once as the budget has read buffers for, its fan-in. Once that many runs of one
+    //! level are on disk they are merged into a run of the next level, so the open runs grow with the
+    //! logarithm of the input rather than with it, and a budget of B bytes still sorts about
+    //! B * B / 1 MiB bytes in two passes over the data. Without a budget, or when everything fits, it
+    //! is a plain in-memory sort.
+    //!
+    //! Records must be trivially copyable, they are written to disk as they are. Not stable.
+    template<typename T, typename Less = std::less<T>>
+    class ExternalSorter {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+       public:
+        //! Runs go to `directory`, which should be on a disk rather than tmpfs. A `budget` of 0 keeps
+        //! everything in memory.
+        ExternalSorter(uint64_t budget, std::string directory, Less less = {}) : m_budget(budget), m_directory(std::move(directory)), m_less(less) {}
+
+        //! False when a run couldn't be written.
+        bool push(const T& record) {
+            if (m_budget && m_buffer.size() >= buffer_capacity()) {
+                if (!spill()) return false;
+            }
+            // Reserved once, so growing never holds two copies; pages are only touched as records come.
+            if (m_budget && m_buffer.capacity() == 0) m_buffer.reserve(buffer_capacity());
+            m_buffer.push_back(record);
+            ++m_count;
+            return true;
+        }
+        COMP_NO_DISCARD uint64_t size() const {
+            return m_count;
+        }
+        //! Runs written to disk so far.
+        COMP_NO_DISCARD size_t run_count() const {
+            return m_runs.size();
+        }
+
+        //! Hands every record to `visit`, a `bool(const T&)`, in order. False when a run couldn't be
+        //! written or read back, or `visit` returned false. Consumes the records.
+        template<typename Visit>
+        bool merge(Visit&& visit) {
+            if (m_runs.empty()) {
+                std::sort(m_buffer.begin(), m_buffer.end(), m_less);
+                for (const auto& record : m_buffer) {
+                    if (!visit(record)) return false;
+                }
+                m_buffer = {};
+                return true;
+            }
+            if (!m_buffer.empty() && !spill()) return false;
+            m_buffer = {};
+            // The smallest runs first, they are at the back.
+            while (m_runs.size() > fan_in()) {
+                if (!merge_pass(fan_in())) return false;
+            }
+            bool merged = merge_runs(0, m_runs.size(), visit);
+            m_runs.clear();
+            return merged;
+        }
+
+       private:
+        struct Run {
+            File file;
+            uint64_t records = 0;
+            //! 0 for a spilled buffer, one more than its inputs for a merged run.
+            uint32_t level = 0;
+        };
+        //! Streams one run back through a buffer.
+        struct RunReader {
+            const Run* run = nullptr;
+            std::vector<T> buffer;
+            uint64_t next = 0;
+            size_t position = 0;
+            size_t count = 0;
+
+            COMP_NO_DISCARD const T* current() const {
+                return position < count ? &buffer[position] : nullptr;
+            }
+            bool advance() {
+                return ++position < count || refill();
+            }
+            bool refill() {
+                position = 0;
+                count = (size_t) std::min<uint64_t>(buffer.size(), run->records - next);
+                if (count && !run->file.read_exact_at(buffer.data(), count * sizeof(T), next * sizeof(T))) return false;
+                next += count;
+                return true;
+            }
+        };
+
+        COMP_NO_DISCARD size_t buffer_capacity() const {
+            return (size_t) std::max<uint64_t>(1, m_budget / sizeof(T));
+        }
+        COMP_NO_DISCARD static size_t records_per_buffer() {
+            return std::max<size_t>(1, c_sort_run_buffer / sizeof(T));
+        }
+        //! Runs merged at once: one read buffer each and one for the output of a pass.
+        COMP_NO_DISCARD size_t fan_in() const {
+            return (size_t) std::max<uint64_t>(3, m_budget / c_sort_run_buffer) - 1;
+        }
+
+        bool spill() {
+            std::sort(m_buffer.begin(), m_buffer.end(), m_less);
+            Run run;
+            if (!run.file.open_temporary(m_directory) || !run.file.write_all(m_buffer.data(), m_buffer.size() * sizeof(T))) return false;
+            run.records = m_buffer.size();
+            m_runs.push_back(std::move(run));
+            m_buffer.clear();
+
+            // Levels only go down towards the back, so a full level is always the last fan-in runs.
+            // Merging those right away keeps the descriptors and read buffers merge() needs bounded.
+            size_t count = fan_in();
+            while (m_runs.size() >= count && m_runs[m_runs.size() - count].level == m_runs.back().level) {
+                // The merge's buffers take the place of the record buffer; push() reserves it again.
+                m_buffer = {};
+                if (!merge_pass(count)) return false;
+            }
+            return true;
+        }
+
+        //! Merges the last `count` runs into one, one level above the highest of them.
+        bool merge_pass(size_t count) {
+            Run output;
+            if (!output.file.open_temporary(m_directory)) return false;
+            std::vector<T> pending;
+            pending.reserve(records_per_buffer());
+            auto flush = [&]() {
+                bool written = output.file.write_all(pending.data(), pending.size() * sizeof(T));
+                output.records += pending.size();
+                pending.clear();
+                return written;
+            };
+            size_t first = m_runs.size() - count;
+            bool merged = merge_runs(first, count, [&](const T& record) {
+                pending.push_back(record);
+                return pending.size() < records_per_buffer() || flush();
+            });
+            if (!merged || !flush()) return false;
+            output.level = m_runs[first].level + 1;
+            m_runs.erase(m_runs.begin() + (ptrdiff_t) first, m_runs.end());
+            m_runs.push_back(std::move(output));
+            return true;
+        }
+
+        //! Hands the records of runs [first, first + count) to `visit` in order.
+        template<typename Visit>
+        bool merge_runs(size_t first, size_t count, Visit&& visit) {
+            std::vector<RunReader> readers(count);
+            LoserTree<T, Less> tree(count, m_less);
+            for (size_t i = 0; i < count; ++i) {
+                readers[i].run = &m_runs[first + i];
+                readers[i].buffer.resize(records_per_buffer());
+                if (!readers[i].refill()) return false;
+                tree.set(i, readers[i].current());
+            }
+            tree.build();
+            while (const T* record = tree.top()) {
+                if (!visit(*record)) return false;
+                auto& reader = readers[tree.winner()];
+                if (!reader.advance()) return false;
+                tree.replace(reader.current());
+            }
+            return true;
+        }
+
+        uint64_t m_budget;
+        std::string m_directory;
+        Less m_less;
+        std::vector<T> m_buffer;
+        std::vector<Run> m_runs;
+        uint64_t m_count = 0;
+    };
+}  // namespace files
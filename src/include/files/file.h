@@ -0,0 +1,75 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <string>
+#include <vector>
+
+#include "system.h"
+
+namespace files {
+    enum class FileMode : uint8_t {
+        Read,
+        //! Creates or truncates; fails rather than follow a symlink in the last component.
+        Write,
+        //! Creates if missing, keeps the contents.
+        ReadWrite,
+        Append,
+        //! An existing directory, never reached through a symlink in the last component.
+        Directory
+    };
+
+    //! Move-only owner of a file descriptor with positional, EINTR-safe I/O.
+    class File {
+       public:
+        File() = default;
+        ~File();
+        File(File&& other) noexcept;
+        File& operator=(File&& other) noexcept;
+        File(const File&) = delete;
+        File& operator=(const File&) = delete;
+
+        bool open(const std::string& path, FileMode mode);
+        //! Opens `name` relative to the open directory `directory`, which saves resolving its path again.
+        bool open_at(int32_t directory, const std::string& name, FileMode mode);
+        //! Like open_at() for FileMode::Write, but first removes a symlink that is in the way.
+        bool create_at(int32_t directory, const std::string& name);
+        //! Creates a nameless file in `directory` for reading and writing; it is gone once closed.
+        bool open_temporary(const std::string& directory);
+        void close();
+        COMP_NO_DISCARD bool is_open() const {
+            return m_fd >= 0;
+        }
+        COMP_NO_DISCARD int32_t descriptor() const {
+            return m_fd;
+        }
+
+        //! Reads up to `size` bytes at the current position, returns the count or -1 on error.
+        int64_t read(void* data, size_t size);
+        //! Reads up to `size` bytes at `offset`, short only at end of file; -1 on error.
+        int64_t read_at(void* data, size_t size, uint64_t offset) const;
+        bool read_exact_at(void* data, size_t size, uint64_t offset) const;
+        bool write_all(const void* data, size_t size);
+        bool write_all_at(const void* data, size_t size, uint64_t offset);
+        bool sync();
+        bool truncate(uint64_t size);
+        //! Allocates blocks up to `size` so later writes below it don't have to extend the file.
+        bool reserve(uint64_t size);
+        COMP_NO_DISCARD uint64_t size() const;
+
+       private:
+        int32_t m_fd = -1;
+    };
+
+    //! Writes `data` to `path` through a temporary file, fsync and rename, so readers never see a torn file.
+    bool write_file_atomic(const std::string& path, const void* data, size_t size);
+    //! Like write_file_atomic(), but fails with EEXIST instead of replacing an existing `path`.
+    bool write_file_exclusive(const std::string& path, const void* data, size_t size);
+    bool read_whole_file(const std::string& path, std::vector<byte>& out);
+    //! Appends up to `limit` bytes of `path` to `out` with just an open, the reads and a close, for
+    //! files too small to be worth what a Reader sets up. Returns the count, -1 on error.
+    int64_t read_small_file(const std::string& path, size_t limit, std::vector<byte>& out);
+    //! Fsyncs a directory so renames and creations inside it are durable.
+    bool sync_directory(const std::string& path);
+}  // namespace files
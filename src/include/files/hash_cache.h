@@ -0,0 +1,27 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <string>
+
+#include "hashing/sha256.h"
+
+namespace files {
+    enum class HashAlgorithm : uint8_t {
+        //! Merkle node over the SHA-256 digests of the default content-defined chunks, the content
+        //! digest snapshots record for a file.
+        ChunkedSha256 = 1
+    };
+
+    //! A file's digest kept in its own `user.fward.hash` extended attribute together with the size and
+    //! mtime it was taken at, so any fward process on any host can skip rereading a file that was hashed
+    //! before, without a central index. The ctime can't be part of the key: setting the attribute changes it.
+    //! Whoever can write the file can forge the attribute too, so it only spares backups a read; verify
+    //! always rehashes.
+    //!
+    //! False when there is no attribute, it holds another algorithm or the metadata no longer matches.
+    bool load_cached_hash(const std::string& path, HashAlgorithm algorithm, uint64_t size, int64_t mtime_ns, hashing::Digest& digest);
+    //! Best effort; false when the filesystem or the permissions don't allow the attribute.
+    bool store_cached_hash(const std::string& path, HashAlgorithm algorithm, uint64_t size, int64_t mtime_ns, const hashing::Digest& digest);
+}  // namespace files
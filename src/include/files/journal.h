@@ -0,0 +1,90 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "files/file.h"
+
+namespace files {
+    struct JournalOptions {
+        //! How long a commit may wait for other writers to join its batch before it syncs.
+        uint32_t max_delay_us = 1000;
+        //! A batch is synced right away once this many bytes are pending.
+        size_t max_batch_bytes = 1024 * 1024;
+    };
+
+    //! Append-only write-ahead log with group commit.
+    //!
+    //!     header   "FWJRNL01", base lsn u64
+    //!     record   length u32, crc32c u32 over length and payload, payload
+    //!
+    //! Records get consecutive log sequence numbers after the base. Appending only buffers; wait()
+    //! makes everything up to an lsn durable. The first waiter becomes the leader: it gives other
+    //! writers up to `max_delay_us` to join, then writes and syncs the whole batch once while the
+    //! others sleep until their lsn is covered. Replay stops at the first torn or corrupt record,
+    //! or the first one the visitor rejects, and cuts the log there.
+    class Journal {
+       public:
+        using ReplayVisitor = std::function<bool(uint64_t lsn, const byte* data, size_t size)>;
+
+        Journal() = default;
+        ~Journal();
+        Journal(const Journal&) = delete;
+        Journal& operator=(const Journal&) = delete;
+
+        //! Opens or creates the log, replaying every intact record through `replay` first. A record
+        //! `replay` returns false for ends the log like a corrupt one.
+        bool open(const std::string& path, const ReplayVisitor& replay, const JournalOptions& options = {});
+        void close();
+
+        //! Buffers a record and returns its lsn; thread-safe.
+        uint64_t append(const void* data, size_t size);
+        //! Blocks until every record up to `lsn` is durable. False once a write or sync has failed.
+        bool wait(uint64_t lsn);
+        bool commit(const void* data, size_t size) {
+            return wait(append(data, size));
+        }
+        bool sync() {
+            return wait(last_lsn());
+        }
+
+        //! Starts an empty log at `base` after a checkpoint covered everything up to it. Writers
+        //! must be quiesced so that `base` is the last appended lsn.
+        bool reset(uint64_t base);
+
+        COMP_NO_DISCARD uint64_t last_lsn() const;
+        COMP_NO_DISCARD uint64_t durable_lsn() const;
+        //! Bytes of records in the log, pending ones included.
+        COMP_NO_DISCARD uint64_t size() const;
+
+       private:
+        bool create(uint64_t base);
+        bool flush_batch(std::unique_lock<std::mutex>& lock);
+
+        std::string m_path;
+        JournalOptions m_options;
+        File m_file;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_batch_full;
+        std::condition_variable m_durable_changed;
+        std::vector<byte> m_pending;
+        std::vector<byte> m_writing;
+        uint64_t m_base = 0;
+        uint64_t m_appended = 0;
+        uint64_t m_durable = 0;
+        //! Where the next batch goes and how far the file has been preallocated.
+        uint64_t m_offset = 0;
+        uint64_t m_reserved = 0;
+        uint32_t m_last_batch_records = 0;
+        uint32_t m_pending_records = 0;
+        bool m_flushing = false;
+        bool m_failed = false;
+    };
+}  // namespace files
@@ -0,0 +1,131 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "system.h"
+
+namespace files {
+    //! Result of matching a single path against the rule set.
+    enum class FilterVerdict : uint8_t {
+        Unmatched,
+        Included,
+        Excluded
+    };
+
+    //! Transparent hasher so string_view names can be looked up without a copy.
+    struct StringViewHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const {
+            return std::hash<std::string_view> {}(value);
+        }
+    };
+    using NameMap = std::unordered_map<std::string, uint32_t, StringViewHash, std::equal_to<>>;
+
+    //! Gitignore-style include/exclude rules compiled into a single component automaton.
+    //!
+    //! Rules follow gitignore: `#` comments, `!` re-includes, a trailing `/` only matches directories and a
+    //! leading or inner `/` anchors the rule to the root, otherwise the rule matches at any depth. `*`, `?`,
+    //! `[...]` and `**` are supported. The last matching rule wins and an excluded directory prunes its
+    //! whole subtree, exactly like git does.
+    //!
+    //! All rules share one trie keyed by path component, so a path is matched in a single walk over its
+    //! components instead of once per rule. Literal components, `*.ext` suffixes and `prefix*` patterns are
+    //! hash lookups; only the remaining globs are tested one by one.
+    class PathFilter {
+       public:
+        //! Matcher position inside a directory, handed from a directory to its children while scanning.
+        class Cursor {
+           public:
+            //! True when no rule can match anything below this directory anymore.
+            COMP_NO_DISCARD bool exhausted() const {
+                return m_states.empty();
+            }
+
+           private:
+            friend class PathFilter;
+            std::vector<uint32_t> m_states;
+        };
+
+        explicit PathFilter(bool case_insensitive = false);
+
+        //! Adds one rule line; blank lines and comments are accepted and ignored.
+        bool add_rule(std::string_view line);
+        //! Adds every line of a rules file (e.g. a `.fwardignore`).
+        bool load(const std::string& path);
+        //! Freezes the rule set; must be called once after adding rules and before matching.
+        void compile();
+
+        COMP_NO_DISCARD bool case_insensitive() const {
+            return m_case_insensitive;
+        }
+        COMP_NO_DISCARD size_t rule_count() const {
+            return m_rules.size();
+        }
+        //! The accepted rule lines in order, without blanks and comments; adding them to a new filter
+        //! with the same case sensitivity rebuilds this one.
+        COMP_NO_DISCARD const std::vector<std::string>& rules() const {
+            return m_lines;
+        }
+
+        //! Cursor for the root the rules are relative to.
+        COMP_NO_DISCARD Cursor root() const;
+        //! Matches a direct child of the directory at `parent`.
+        COMP_NO_DISCARD FilterVerdict match(const Cursor& parent, std::string_view name, bool is_directory) const;
+        //! Cursor for a child directory; only meaningful when that directory was not excluded.
+        COMP_NO_DISCARD Cursor enter(const Cursor& parent, std::string_view name) const;
+
+        //! Matches a relative '/' separated path in one go, honouring excluded parent directories.
+        COMP_NO_DISCARD FilterVerdict match(std::string_view path, bool is_directory) const;
+        //! Convenience for callers that only need a yes/no answer.
+        COMP_NO_DISCARD bool excluded(std::string_view path, bool is_directory) const {
+            return match(path, is_directory) == FilterVerdict::Excluded;
+        }
+
+       private:
+        struct AffixBucket {
+            uint32_t length = 0;
+            NameMap targets;
+        };
+        struct Glob {
+            std::string pattern;
+            uint32_t target = 0;
+        };
+        struct Node {
+            NameMap literals;
+            std::vector<AffixBucket> suffixes;
+            std::vector<AffixBucket> prefixes;
+            std::vector<Glob> globs;
+            //! Node reached through `**`, stays active on every component below.
+            uint32_t recursive = 0;
+            bool is_recursive = false;
+            //! Highest rule index ending here, for any entry or for directories only (-1 when none).
+            int32_t accept_any = -1;
+            int32_t accept_directory = -1;
+        };
+        struct Rule {
+            bool negated = false;
+            bool directory_only = false;
+        };
+
+        uint32_t child(uint32_t node, std::string_view component);
+        void close(std::vector<uint32_t>& states) const;
+        template<typename Visit>
+        void step(const std::vector<uint32_t>& states, std::string_view name, Visit&& visit) const;
+        COMP_NO_DISCARD FilterVerdict verdict(int32_t rule) const;
+
+        bool m_case_insensitive;
+        bool m_compiled = false;
+        std::vector<Node> m_nodes;
+        std::vector<Rule> m_rules;
+        std::vector<std::string> m_lines;
+    };
+
+    //! Matches `name` against a single glob component (`*`, `?`, `[...]`, `\` escapes).
+    COMP_NO_DISCARD bool glob_match(std::string_view pattern, std::string_view name);
+}  // namespace files
@@ -0,0 +1,98 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "system.h"
+
+namespace files {
+    //! Compact handle to a path inside a PathStore; equal ids mean equal paths.
+    using PathId = uint32_t;
+    //! The store root, i.e. "/".
+    inline constexpr PathId c_root_path = 0;
+    inline constexpr PathId c_invalid_path = UINT32_MAX;
+
+    //! Prefix-compressed storage for large numbers of absolute paths.
+    //!
+    //! Every directory is interned once in a parent-pointer tree and every entry costs a 12 byte node plus
+    //! its own name in a shared arena, instead of a full std::string per path. Full paths are only rebuilt
+    //! on demand into a caller supplied buffer. Not thread-safe; use one store per writer.
+    class PathStore {
+       public:
+        PathStore();
+
+        //! Nodes below this depth can't be added; the functions adding them return c_invalid_path.
+        static constexpr uint32_t c_max_depth = UINT16_MAX;
+
+        //! Returns the directory `name` below `parent`, creating it if it doesn't exist yet.
+        PathId intern_directory(PathId parent, std::string_view name);
+        //! Looks up an interned directory without creating it.
+        COMP_NO_DISCARD PathId find_directory(PathId parent, std::string_view name) const;
+        //! Appends a leaf (file, symlink, ...) below `parent`. Leaves are not deduplicated.
+        PathId add_leaf(PathId parent, std::string_view name);
+        //! Interns all directories of an absolute '/' separated path, the last component becomes a leaf
+        //! unless `is_directory` is set.
+        PathId intern(std::string_view path, bool is_directory);
+
+        COMP_NO_DISCARD PathId parent(PathId id) const {
+            return m_nodes[id].parent;
+        }
+        COMP_NO_DISCARD std::string_view name(PathId id) const;
+        COMP_NO_DISCARD bool is_directory(PathId id) const {
+            return m_nodes[id].length & c_directory_bit;
+        }
+        COMP_NO_DISCARD uint32_t depth(PathId id) const {
+            return m_nodes[id].depth;
+        }
+        COMP_NO_DISCARD size_t size() const {
+            return m_nodes.size();
+        }
+
+        //! Writes the full path of `id` into `buffer` like snprintf: returns the length of the path (without a
+        //! terminator) and only writes when it fits, including the terminating zero.
+        size_t path(PathId id, char* buffer, size_t capacity) const;
+        //! Replaces `out` with the full path of `id`, reusing its capacity.
+        void path(PathId id, std::string& out) const;
+        COMP_NO_DISCARD std::string path(PathId id) const;
+
+        //! Orders two ids like their full paths would sort component-wise, without rebuilding them.
+        COMP_NO_DISCARD int32_t compare(PathId left, PathId right) const;
+        //! True when `ancestor` is `id` or one of its parent directories.
+        COMP_NO_DISCARD bool contains(PathId ancestor, PathId id) const;
+
+        //! Bytes held by nodes, names and the directory index.
+        COMP_NO_DISCARD size_t memory_usage() const;
+
+       private:
+        static constexpr uint16_t c_directory_bit = 0x8000;
+        static constexpr uint32_t c_block_bits = 20;
+        static constexpr uint32_t c_block_size = 1u << c_block_bits;
+
+        struct Node {
+            PathId parent;
+            uint32_t name;
+            //! Name length with c_directory_bit set for directories.
+            uint16_t length;
+            uint16_t depth;
+        };
+        static_assert(sizeof(Node) == 12);
+
+        PathId append(PathId parent, std::string_view name, bool is_directory);
+        uint32_t store_name(std::string_view name);
+        COMP_NO_DISCARD size_t slot(PathId parent, std::string_view name) const;
+        void grow_index();
+
+        std::vector<Node> m_nodes;
+        //! Names live in fixed blocks so views stay valid while the arena grows.
+        std::vector<std::unique_ptr<char[]>> m_blocks;
+        uint32_t m_block_used = c_block_size;
+        //! Open addressing table of directory ids keyed by (parent, name).
+        std::vector<PathId> m_index;
+        size_t m_directories = 0;
+    };
+}  // namespace files
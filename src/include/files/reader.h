@@ -0,0 +1,87 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <memory>
+#include <span>
+#include <string>
+
+#include "files/file.h"
+#include "system.h"
+
+namespace files {
+    enum class ReadStrategy : uint8_t {
+        //! Picks one of the others from the file size, whether the file is cached and the options.
+        Auto,
+        //! pread into a sliding window, with sequential readahead hints.
+        Buffered,
+        //! The whole file mapped read-only; windows point straight into the page cache.
+        Mapped,
+        //! O_DIRECT into an aligned window, bypassing the page cache altogether.
+        Direct
+    };
+
+    struct ReadOptions {
+        ReadStrategy strategy = ReadStrategy::Auto;
+        //! Leave the page cache as it was found: files that weren't cached are read around it or
+        //! dropped behind the reader, files that were are left alone.
+        bool keep_cache_clean = true;
+        //! The caller guarantees the file won't shrink while it is open. Only then is mapping it
+        //! safe, as touching a page past a truncated end raises SIGBUS.
+        bool immutable = false;
+    };
+
+    //! Reads a file through windows that move forward, in large requests whatever the strategy.
+    class Reader {
+       public:
+        Reader();
+        ~Reader();
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        bool open(const std::string& path, const ReadOptions& options = {});
+        void close();
+        COMP_NO_DISCARD bool is_open() const {
+            return m_file.is_open();
+        }
+        COMP_NO_DISCARD ReadStrategy strategy() const {
+            return m_strategy;
+        }
+        //! Size when opened; a live file may still grow or shrink while it is read.
+        COMP_NO_DISCARD uint64_t size() const {
+            return m_size;
+        }
+
+        //! Points `out` at bytes [offset, offset + length) of the file, fewer at the end of file. The
+        //! span stays valid until the next call. Offsets should not go back, doing so rereads.
+        bool view(uint64_t offset, size_t length, std::span<const byte>& out);
+
+       private:
+        struct AlignedFree {
+            void operator()(byte* data) const;
+        };
+
+        bool fill(uint64_t offset, size_t length);
+        //! Clears O_DIRECT after a direct read failed, so the window can be read again buffered.
+        bool fall_back_to_buffered();
+        //! Evicts what was read before `offset`, if the file wasn't cached when it was opened.
+        void drop_behind(uint64_t offset);
+
+        File m_file;
+        ReadStrategy m_strategy = ReadStrategy::Buffered;
+        uint64_t m_size = 0;
+        bool m_drop_cache = false;
+        uint64_t m_dropped = 0;
+
+        const byte* m_mapping = nullptr;
+
+        std::unique_ptr<byte, AlignedFree> m_buffer;
+        size_t m_capacity = 0;
+        //! Offset and direct I/O alignment, 1 when reads needn't be aligned.
+        size_t m_align = 1;
+        uint64_t m_buffer_offset = 0;
+        size_t m_buffered = 0;
+        bool m_eof = false;
+    };
+}  // namespace files
@@ -0,0 +1,42 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "files/path_filter.h"
+
+namespace files {
+    enum class EntryType : uint8_t {
+        File,
+        Directory,
+        Symlink,
+        Other
+    };
+
+    //! A directory entry as seen by the scanner, only valid for the duration of the visit.
+    struct ScanEntry {
+        std::string_view path;
+        std::string_view name;
+        EntryType type;
+        uint32_t depth;
+    };
+
+    struct ScanStats {
+        uint64_t files = 0;
+        uint64_t directories = 0;
+        //! Entries skipped by the filter; an excluded directory counts once for its whole subtree.
+        uint64_t excluded = 0;
+        uint64_t errors = 0;
+    };
+
+    //! Called for every included entry; return false for a directory to not descend into it.
+    using ScanVisitor = std::function<bool(const ScanEntry& entry)>;
+
+    //! Walks `root` depth-first without following symlinks. Excluded directories are pruned before they
+    //! are opened, so a filter on e.g. `node_modules/` never pays for the entries below it.
+    ScanStats scan(const std::string& root, const PathFilter* filter, const ScanVisitor& visitor);
+}  // namespace files
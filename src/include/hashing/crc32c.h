@@ -0,0 +1,14 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include "system.h"
+#include "utils/cpu.h"
+
+namespace hashing {
+    //! CRC-32C (Castagnoli) as used by iSCSI and ext4. Pass the previous result as `crc` to continue a checksum.
+    COMP_NO_DISCARD uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0);
+    //! Implementation crc32c() picks on a CPU with `cpu`, e.g. "sse4.2+pclmul" or "generic".
+    COMP_NO_DISCARD const char* crc32c_kernel(const CpuFeatures& cpu = cpu_features());
+}  // namespace hashing
@@ -0,0 +1,23 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include "system.h"
+#include "utils/cpu.h"
+
+namespace hashing {
+    //! rsync's weak checksum of a window: `a` is the byte sum and `b` the sum weighted by distance to
+    //! the window end, both modulo 2^16, packed as `a | b << 16`.
+    COMP_NO_DISCARD uint32_t rolling_checksum(const byte* data, size_t size);
+    //! Implementation rolling_checksum() picks on a CPU with `cpu`: "avx2" or "generic", which is
+    //! itself SSE2 or NEON where the build target has them.
+    COMP_NO_DISCARD const char* rolling_checksum_kernel(const CpuFeatures& cpu = cpu_features());
+
+    //! Slides the window of `size` bytes one position: drops `out` at the front, adds `in` at the back.
+    COMP_NO_DISCARD inline uint32_t rolling_update(uint32_t checksum, byte out, byte in, size_t size) {
+        uint32_t a = ((checksum & 0xFFFF) - out + in) & 0xFFFF;
+        uint32_t b = ((checksum >> 16) - (uint32_t) size * out + a) & 0xFFFF;
+        return a | (b << 16);
+    }
+}  // namespace hashing
@@ -0,0 +1,56 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <array>
+#include <cstring>
+#include <string_view>
+
+#include "system.h"
+#include "utils/cpu.h"
+
+namespace hashing {
+    //! Content address of chunks, files and tree nodes.
+    using Digest = std::array<byte, 32>;
+
+    //! Digests are already uniformly distributed, so the first word is a perfect hash.
+    struct DigestHash {
+        size_t operator()(const Digest& digest) const {
+            size_t value;
+            std::memcpy(&value, digest.data(), sizeof(value));
+            return value;
+        }
+    };
+
+    //! Incremental SHA-256, on the SHA extensions of x86 and ARMv8 where the CPU has them.
+    class Sha256 {
+       public:
+        Sha256();
+
+        void update(const void* data, size_t size);
+        void update(std::string_view data) {
+            update(data.data(), data.size());
+        }
+        template<typename T>
+        void update_value(const T& value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            update(&value, sizeof(T));
+        }
+        COMP_NO_DISCARD Digest finish();
+
+        static Digest digest(const void* data, size_t size);
+        //! Block function picked on a CPU with `cpu`: "sha-ni", "armv8-sha2" or "generic".
+        COMP_NO_DISCARD static const char* kernel(const CpuFeatures& cpu = cpu_features());
+
+       private:
+        //! Runs the block function over `blocks` consecutive 64-byte blocks, with the fastest
+        //! implementation the CPU supports.
+        void compress(const byte* data, size_t blocks);
+
+        uint32_t m_state[8];
+        byte m_buffer[64];
+        uint64_t m_length = 0;
+        size_t m_buffered = 0;
+    };
+}  // namespace hashing
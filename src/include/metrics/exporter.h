@@ -0,0 +1,50 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "system.h"
+
+namespace metrics {
+    enum class ExportFormat : uint8_t {
+        //! Text exposition format, for node_exporter's textfile collector.
+        Prometheus,
+        Json
+    };
+
+    //! Writes every metric to a file at a fixed interval and once more on stop(). Each write replaces
+    //! the file atomically, so a collector never reads half of it.
+    class Exporter {
+       public:
+        Exporter() = default;
+        ~Exporter();
+        Exporter(const Exporter&) = delete;
+        Exporter& operator=(const Exporter&) = delete;
+
+        bool start(const std::string& path, ExportFormat format, std::chrono::milliseconds interval);
+        void stop();
+
+        //! Writes the current values right away.
+        bool write() const;
+
+       private:
+        void run();
+
+        std::string m_path;
+        ExportFormat m_format = ExportFormat::Prometheus;
+        std::chrono::milliseconds m_interval {};
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        bool m_stopping = false;
+    };
+
+    //! Parses "prometheus" or "json".
+    bool parse_export_format(std::string_view name, ExportFormat& format);
+}  // namespace metrics
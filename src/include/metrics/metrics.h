@@ -0,0 +1,139 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <atomic>
+#include <bit>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "system.h"
+
+namespace metrics {
+    //! Slots every thread has room for; a counter takes one, a histogram one per bucket plus two.
+    inline constexpr uint32_t c_max_slots = 4096;
+
+    namespace detail {
+        //! One thread's values. Only the owning thread writes, so an update is a plain load and store;
+        //! the relaxed atomics only make the concurrent reads on scrape well-defined. Blocks are
+        //! cache-line aligned so no two threads ever write the same line.
+        struct alignas(64) ThreadSlots {
+            std::atomic<uint64_t> values[c_max_slots];
+            ThreadSlots* next = nullptr;
+            ThreadSlots* previous = nullptr;
+        };
+
+#if defined(COMP_TAG_GCC) || defined(COMP_TAG_CLANG)
+        // fward-lib is never dlopen'ed, so the cheapest TLS model is safe and avoids __tls_get_addr.
+        inline thread_local ThreadSlots* t_slots __attribute__((tls_model("initial-exec"))) = nullptr;
+#else
+        inline thread_local ThreadSlots* t_slots = nullptr;
+#endif
+
+        //! Registers the calling thread's block; folds it back into the totals when the thread exits.
+        ThreadSlots* attach();
+
+        inline std::atomic<uint64_t>& slot(uint32_t index) {
+            ThreadSlots* slots = t_slots;
+            if (!slots) [[unlikely]]
+                slots = attach();
+            return slots->values[index];
+        }
+        inline void add(uint32_t index, uint64_t value) {
+            auto& target = slot(index);
+            target.store(target.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+    }  // namespace detail
+
+    enum class MetricType : uint8_t {
+        Counter,
+        Gauge,
+        Histogram
+    };
+
+    //! Monotonic count, summed over all threads on scrape.
+    class Counter {
+       public:
+        explicit Counter(uint32_t slot) : m_slot(slot) { }
+
+        void add(uint64_t value = 1) {
+            detail::add(m_slot, value);
+        }
+        COMP_NO_DISCARD uint32_t slot() const {
+            return m_slot;
+        }
+
+       private:
+        uint32_t m_slot;
+    };
+
+    //! Value that goes up and down. add() is per thread like a counter; set() stores a shared
+    //! value the per-thread deltas are added to, meant for gauges that are only ever sampled.
+    class Gauge {
+       public:
+        explicit Gauge(uint32_t slot) : m_slot(slot) { }
+
+        void add(int64_t value = 1) {
+            detail::add(m_slot, (uint64_t) value);
+        }
+        void sub(int64_t value = 1) {
+            detail::add(m_slot, (uint64_t) -value);
+        }
+        void set(int64_t value) {
+            m_shared.store(value, std::memory_order_relaxed);
+        }
+        COMP_NO_DISCARD int64_t shared() const {
+            return m_shared.load(std::memory_order_relaxed);
+        }
+        COMP_NO_DISCARD uint32_t slot() const {
+            return m_slot;
+        }
+
+       private:
+        uint32_t m_slot;
+        std::atomic<int64_t> m_shared = 0;
+    };
+
+    //! Distribution over fixed upper bounds. Slots: one per bound, one for +Inf, then the sum as double bits.
+    class Histogram {
+       public:
+        Histogram(uint32_t slot, std::vector<double> bounds) : m_slot(slot), m_bounds(std::move(bounds)) { }
+
+        void observe(double value) {
+            uint32_t bucket = 0;
+            while (bucket < m_bounds.size() && value > m_bounds[bucket]) ++bucket;
+            detail::add(m_slot + bucket, 1);
+            auto& sum = detail::slot(m_slot + (uint32_t) m_bounds.size() + 1);
+            sum.store(std::bit_cast<uint64_t>(std::bit_cast<double>(sum.load(std::memory_order_relaxed)) + value), std::memory_order_relaxed);
+        }
+
+        COMP_NO_DISCARD const std::vector<double>& bounds() const {
+            return m_bounds;
+        }
+        COMP_NO_DISCARD uint32_t first_slot() const {
+            return m_slot;
+        }
+
+       private:
+        uint32_t m_slot;
+        std::vector<double> m_bounds;
+    };
+
+    //! Returns the metric registered under `name`, creating it on first use. Metrics live as long
+    //! as the process, so the reference can be kept in a static.
+    Counter& counter(std::string_view name, std::string_view help);
+    Gauge& gauge(std::string_view name, std::string_view help);
+    Histogram& histogram(std::string_view name, std::string_view help, std::vector<double> bounds);
+
+    //! Bounds in seconds from 10 us to 10 s, for latencies.
+    COMP_NO_DISCARD std::vector<double> latency_bounds();
+
+    //! Aggregates every thread's slots and renders them in the Prometheus text exposition format.
+    void write_prometheus(std::string& out);
+    //! The same snapshot as a flat JSON object.
+    void write_json(std::string& out);
+    //! Appends `value` as a quoted JSON string, escaping quotes, backslashes and control characters.
+    void append_json_string(std::string& out, std::string_view value);
+}  // namespace metrics
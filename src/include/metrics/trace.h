@@ -0,0 +1,48 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "system.h"
+
+namespace metrics {
+    namespace detail {
+        inline std::atomic<bool> g_tracing = false;
+
+        inline uint64_t trace_now() {
+            return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+        //! Appends a finished zone to the calling thread's buffer.
+        void trace_record(const char* name, uint64_t begin_ns, uint64_t end_ns);
+    }  // namespace detail
+
+    //! Scoped zone; while tracing is off it costs one relaxed load and a branch. `name` must
+    //! outlive the trace, in practice a string literal.
+    class TraceZone {
+       public:
+        explicit TraceZone(const char* name) : m_name(name), m_begin(detail::g_tracing.load(std::memory_order_relaxed) ? detail::trace_now() : 0) { }
+        ~TraceZone() {
+            if (m_begin) [[unlikely]]
+                detail::trace_record(m_name, m_begin, detail::trace_now());
+        }
+        TraceZone(const TraceZone&) = delete;
+        TraceZone& operator=(const TraceZone&) = delete;
+
+       private:
+        const char* m_name;
+        uint64_t m_begin;
+    };
+
+    //! Starts recording zones from every thread.
+    void trace_start();
+    //! Stops recording and writes everything recorded as Chrome trace-event JSON, which
+    //! chrome://tracing and Perfetto open directly.
+    bool trace_stop(const std::string& path);
+}  // namespace metrics
+
+//! Records the rest of the enclosing scope as a zone named `name` when tracing is on.
+#define TRACE_ZONE(name) ::metrics::TraceZone COMP_MACRO_CONCAT(trace_zone_, __LINE__)(name)
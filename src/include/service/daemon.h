@@ -0,0 +1,90 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+#include "backup/backup.h"
+#include "backup/prune.h"
+#include "service/event_loop.h"
+
+namespace service {
+    enum class JobKind : uint8_t {
+        Backup,
+        //! verify --full over every snapshot.
+        Scrub,
+        Prune
+    };
+
+    struct JobConfig {
+        JobKind kind = JobKind::Backup;
+        std::string repository;
+        //! Absolute; backups only.
+        std::string source;
+        std::chrono::milliseconds interval {};
+        files::PathFilter filter;
+        bool rehash = false;
+        bool hash_xattrs = false;
+        //! Scrub threads, 0 for one per core.
+        uint32_t threads = 0;
+        backup::PruneOptions prune;
+    };
+
+    //! Reads the job list; called on start and again on every SIGHUP.
+    using ConfigLoader = std::function<bool(std::vector<JobConfig>& jobs)>;
+
+    //! Long-lived scheduler. The event loop owns the timers and signals; jobs run one at a time on a
+    //! worker thread against repositories that stay open between runs, so the chunk index, the
+    //! catalog and the compiled filters are loaded once instead of once per job.
+    //!
+    //!     SIGHUP           reload the configuration, keeping repositories that are still used
+    //!     SIGTERM, SIGINT  stop once the running job is done
+    class Daemon {
+       public:
+        Daemon() = default;
+        ~Daemon();
+        Daemon(const Daemon&) = delete;
+        Daemon& operator=(const Daemon&) = delete;
+
+        //! Runs until a stop signal; false when the configuration or the loop could not be set up.
+        bool run(ConfigLoader loader);
+
+       private:
+        //! What stays warm between jobs. Only the worker thread touches the members.
+        struct RepositoryState {
+            std::string path;
+            std::unique_ptr<backup::Repository> repository;
+            std::unique_ptr<backup::Catalog> catalog;
+        };
+        struct Job {
+            JobConfig config;
+            std::shared_ptr<RepositoryState> state;
+            int32_t timer = -1;
+            //! Set while the job waits in the queue or runs, so a slow job is never queued twice.
+            std::atomic<bool> queued = false;
+        };
+
+        bool configure(std::vector<JobConfig> configs);
+        void enqueue(const std::shared_ptr<Job>& job);
+        void work();
+        bool run_job(Job& job);
+        bool open_repository(RepositoryState& state, bool create, bool with_catalog);
+
+        ConfigLoader m_loader;
+        EventLoop m_loop;
+        std::vector<std::shared_ptr<Job>> m_jobs;
+        std::unordered_map<std::string, std::shared_ptr<RepositoryState>> m_states;
+
+        std::thread m_worker;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::deque<std::shared_ptr<Job>> m_queue;
+        bool m_stopping = false;
+    };
+}  // namespace service
@@ -0,0 +1,61 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "system.h"
+
+namespace service {
+    //! Single-threaded epoll loop. Timers are timerfds and signals a signalfd, so every event arrives
+    //! as a readable descriptor and callbacks never run in signal context. Everything except post()
+    //! and stop() must be called on the loop thread.
+    class EventLoop {
+       public:
+        using Callback = std::function<void()>;
+
+        EventLoop() = default;
+        ~EventLoop();
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        bool open();
+        void close();
+
+        //! Calls `callback` after `delay` and then every `interval`; `id` is for remove_timer().
+        bool add_timer(std::chrono::milliseconds delay, std::chrono::milliseconds interval, Callback callback, int32_t& id);
+        void remove_timer(int32_t id);
+
+        //! Blocks `signals` for the whole process and delivers them to `callback` instead. Threads
+        //! started afterwards inherit the mask, so they never take the signal themselves.
+        bool add_signals(std::initializer_list<int32_t> signals, std::function<void(int32_t signal)> callback);
+
+        //! Runs `callback` on the loop thread; safe from any thread.
+        void post(Callback callback);
+
+        //! Dispatches events until stop().
+        bool run();
+        void stop();
+
+       private:
+        bool watch(int32_t fd, Callback callback);
+        void unwatch(int32_t fd);
+        void run_posted();
+
+        int32_t m_epoll = -1;
+        //! eventfd that wakes the loop for posted callbacks.
+        int32_t m_wake = -1;
+        std::unordered_map<int32_t, Callback> m_sources;
+        std::vector<int32_t> m_owned;
+
+        std::mutex m_mutex;
+        std::vector<Callback> m_posted;
+        bool m_stopping = false;
+    };
+}  // namespace service
@@ -457,6 +457,14 @@ static_assert(sizeof(double_t) == 8);
 #endif  // __has_feature
 #define COMP_NO_SANITIZE  COMP_NO_ASAN COMP_NO_MSAN COMP_NO_TSAN
 
+//! Compiles a single function for instruction set extensions beyond the build's baseline, e.g.
+//! COMP_TARGET("avx2"). Only call it once utils/cpu.h said the CPU has them.
+#if defined(COMP_TAG_GCC) || defined(COMP_TAG_CLANG)
+    #define COMP_TARGET(features) __attribute__((target(features)))
+#else
+    #define COMP_TARGET(features)
+#endif
+
 //! Create macros for exporting functions for external use.
 #define COMP_C_FUNCTION   extern "C"
 #define COMP_CXX_FUNCTION extern "C++"
@@ -848,54 +856,54 @@ inline std::string g_format(std::string_view fmt, const T&... args) {
 
 #define FORMAT(...) g_format(__VA_ARGS__)
 
-namespace log {
+namespace logging {
     void print_enable_ansi_coloring(bool enabled);
     void print_debug(const char* color, const std::string& str);
-}  // namespace log
+}  // namespace logging
 
 #if !defined(NDEBUG) && !defined(WASM)
 // Commented this out to increase capacity of debug emscripten build
-    #define DEBUG(...)                print_debug(::terminal_coloring::foreground_bold_blue, FORMAT(__VA_ARGS__))
-    #define DEBUG_COLORED(color, ...) print_debug(color, FORMAT(__VA_ARGS__))
+    #define DEBUG(...)                ::logging::print_debug(::terminal_coloring::foreground_bold_blue, FORMAT(__VA_ARGS__))
+    #define DEBUG_COLORED(color, ...) ::logging::print_debug(color, FORMAT(__VA_ARGS__))
 #else
     #define DEBUG(...)
     #define DEBUG_COLORED(...)
 #endif
 #if !defined(PRINT)
-namespace log {
+namespace logging {
     void print(const std::string& str);
-}  // namespace log
-    #define PRINT(...) print(FORMAT(__VA_ARGS__))
+}  // namespace logging
+    #define PRINT(...) ::logging::print(FORMAT(__VA_ARGS__))
 #endif
 #if !defined(PRINTLN)
-namespace log {
+namespace logging {
     void println(const std::string& str);
-}  // namespace log
-    #define PRINTLN(...) println(FORMAT(__VA_ARGS__))
+}  // namespace logging
+    #define PRINTLN(...) ::logging::println(FORMAT(__VA_ARGS__))
 #endif
 #if !defined(LOG)
-namespace log {
+namespace logging {
     void print_log(const std::string& str);
-}  // namespace log
-    #define LOG(...) print_log(FORMAT(__VA_ARGS__))
+}  // namespace logging
+    #define LOG(...) ::logging::print_log(FORMAT(__VA_ARGS__))
 #endif
 #if !defined(SUCCESS)
-namespace log {
+namespace logging {
     void print_success(const std::string& str);
-}  // namespace log
-    #define SUCCESS(...) print_success(FORMAT(__VA_ARGS__))
+}  // namespace logging
+    #define SUCCESS(...) ::logging::print_success(FORMAT(__VA_ARGS__))
 #endif
 #if !defined(WARN)
-namespace log {
+namespace logging {
     void print_warn(const std::string& str);
-}  // namespace log
-    #define WARN(...) print_warn(FORMAT(__VA_ARGS__))
+}  // namespace logging
+    #define WARN(...) ::logging::print_warn(FORMAT(__VA_ARGS__))
 #endif
 #if !defined(ERROR)
-namespace log {
+namespace logging {
     void print_error(const std::string& str);
-}  // namespace log
-    #define ERROR(...) print_error(FORMAT(__VA_ARGS__))
+}  // namespace logging
+    #define ERROR(...) ::logging::print_error(FORMAT(__VA_ARGS__))
 #endif
 
 #define SOURCE_LOCATION         (FORMAT("file: {}({}) `{}`.", COMP_FILENAME, COMP_LINE, COMP_FUNCTION))
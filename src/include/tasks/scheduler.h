@@ -0,0 +1,136 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "system.h"
+
+namespace tasks {
+    //! Workers always take the highest class that has work, from their own deque or anyone's, so
+    //! foreground work overtakes background work at the next task boundary.
+    enum class Priority : uint8_t {
+        //! Someone is waiting on it, e.g. a restore or an interactive verify.
+        Foreground,
+        Normal,
+        //! Scheduled maintenance such as scrubs.
+        Background
+    };
+    inline constexpr uint32_t c_priority_count = 3;
+
+    class TaskGroup;
+
+    struct Task {
+        std::function<void()> function;
+        TaskGroup* group = nullptr;
+    };
+
+    //! Which CPUs belong to which NUMA node, limited to the CPUs this process may run on.
+    struct CpuTopology {
+        //! One list of CPUs per node; a single node when the machine (or sysfs) has no NUMA info.
+        std::vector<std::vector<uint32_t>> nodes;
+
+        static CpuTopology detect();
+        COMP_NO_DISCARD uint32_t cpu_count() const;
+    };
+
+    //! Fixed pool with one work-stealing deque per worker and priority. A worker pushes and pops
+    //! its own tasks at the back, so nested work stays cache-hot; thieves take from the front,
+    //! trying workers on their own NUMA node before crossing to another. Tasks submitted from
+    //! outside the pool go through a shared injection queue.
+    class Scheduler {
+       public:
+        //! `workers` 0 means one per CPU the process may use.
+        explicit Scheduler(uint32_t workers = 0);
+        ~Scheduler();
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+
+        //! The pool every subsystem shares, so they don't oversubscribe the cores between them.
+        static Scheduler& global();
+
+        COMP_NO_DISCARD uint32_t worker_count() const {
+            return (uint32_t) m_workers.size();
+        }
+        //! Runs one queued task on the calling thread, false when there was none. For threads that
+        //! wait on something the pool itself has to produce, so they help instead of blocking a core.
+        bool run_pending();
+
+       private:
+        friend class TaskGroup;
+
+        struct alignas(64) Worker {
+            std::mutex mutex;
+            std::deque<Task> queues[c_priority_count];
+            uint32_t node = 0;
+            //! Other workers in stealing order: same node first.
+            std::vector<uint32_t> victims;
+            std::thread thread;
+        };
+
+        void submit(Task task, Priority priority);
+        //! Runs one task if there is any; false when every queue was empty.
+        bool run_one(int32_t self);
+        bool take(int32_t self, Task& task);
+        void run(uint32_t index, const std::vector<uint32_t>& cpus);
+
+        std::vector<std::unique_ptr<Worker>> m_workers;
+        std::mutex m_injected_mutex;
+        std::deque<Task> m_injected[c_priority_count];
+
+        std::atomic<uint64_t> m_pending = 0;
+        std::mutex m_sleep_mutex;
+        std::condition_variable m_sleep;
+        bool m_stopping = false;
+    };
+
+    //! Tasks that are waited for and cancelled together. The group must outlive its tasks, which
+    //! the destructor guarantees by waiting.
+    class TaskGroup {
+       public:
+        explicit TaskGroup(Priority priority = Priority::Normal, Scheduler& scheduler = Scheduler::global())
+            : m_scheduler(scheduler), m_priority(priority) { }
+        ~TaskGroup() {
+            wait();
+        }
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        void run(std::function<void()> function);
+        //! Returns once every task finished or was skipped; the caller runs queued tasks meanwhile
+        //! instead of blocking a core.
+        void wait();
+
+        //! Tasks that haven't started are skipped; running ones can poll cancelled() to stop early.
+        void cancel() {
+            m_cancelled.store(true, std::memory_order_relaxed);
+        }
+        COMP_NO_DISCARD bool cancelled() const {
+            return m_cancelled.load(std::memory_order_relaxed);
+        }
+
+        COMP_NO_DISCARD Scheduler& scheduler() const {
+            return m_scheduler;
+        }
+
+       private:
+        friend class Scheduler;
+
+        void finish();
+
+        Scheduler& m_scheduler;
+        Priority m_priority;
+        std::atomic<bool> m_cancelled = false;
+        std::atomic<uint64_t> m_pending = 0;
+        std::mutex m_mutex;
+        std::condition_variable m_done;
+    };
+}  // namespace tasks
@@ -0,0 +1,98 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "system.h"
+
+//! Appends little-endian values and LEB128 varints to a byte buffer.
+class BinaryWriter {
+   public:
+    explicit BinaryWriter(std::vector<byte>& buffer) : m_buffer(buffer) { }
+
+    template<typename T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        put_bytes(&value, sizeof(T));
+    }
+    void put_varint(uint64_t value) {
+        while (value >= 0x80) {
+            m_buffer.push_back((byte) (value | 0x80));
+            value >>= 7;
+        }
+        m_buffer.push_back((byte) value);
+    }
+    void put_bytes(const void* data, size_t size) {
+        auto bytes = (const byte*) data;
+        m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+    }
+    void put_string(std::string_view value) {
+        put_varint(value.size());
+        put_bytes(value.data(), value.size());
+    }
+
+   private:
+    std::vector<byte>& m_buffer;
+};
+
+//! Reads what BinaryWriter wrote. Reading past the end sets a sticky error and yields zeroes.
+class BinaryReader {
+   public:
+    BinaryReader(const byte* data, size_t size) : m_data(data), m_size(size) { }
+
+    template<typename T>
+    T get() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value {};
+        get_bytes(&value, sizeof(T));
+        return value;
+    }
+    uint64_t get_varint() {
+        uint64_t value = 0;
+        for (uint32_t shift = 0; shift < 64; shift += 7) {
+            if (m_offset >= m_size) break;
+            byte part = m_data[m_offset++];
+            value |= (uint64_t) (part & 0x7F) << shift;
+            if (!(part & 0x80)) return value;
+        }
+        m_error = true;
+        return 0;
+    }
+    void get_bytes(void* out, size_t size) {
+        if (m_error || size > m_size - m_offset) {
+            m_error = true;
+            std::memset(out, 0, size);
+            return;
+        }
+        std::memcpy(out, m_data + m_offset, size);
+        m_offset += size;
+    }
+    std::string_view get_string() {
+        uint64_t size = get_varint();
+        if (m_error || size > m_size - m_offset) {
+            m_error = true;
+            return {};
+        }
+        std::string_view value((const char*) m_data + m_offset, size);
+        m_offset += size;
+        return value;
+    }
+
+    COMP_NO_DISCARD bool error() const {
+        return m_error;
+    }
+    COMP_NO_DISCARD size_t remaining() const {
+        return m_size - m_offset;
+    }
+
+   private:
+    const byte* m_data;
+    size_t m_size;
+    size_t m_offset = 0;
+    bool m_error = false;
+};
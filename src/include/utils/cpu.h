@@ -0,0 +1,36 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <string>
+#include <string_view>
+
+#include "system.h"
+
+//! Instruction set extensions of the CPU we run on, as far as the OS saves their state. Kernels
+//! built with COMP_TARGET pick their variant from this once, so one binary runs anywhere.
+struct CpuFeatures {
+    bool ssse3 = false;
+    bool sse41 = false;
+    bool sse42 = false;
+    bool pclmul = false;
+    bool avx2 = false;
+    //! AVX-512 F, BW and VL, which the kernels only use together.
+    bool avx512 = false;
+    //! SHA-NI on x86, the SHA-256 instructions of ARMv8.
+    bool sha = false;
+
+    bool neon = false;
+    bool arm_crc32 = false;
+    bool arm_pmull = false;
+};
+
+//! Detected on first use. FWARD_CPU_DISABLE, a comma separated list such as "avx2,sha", hides
+//! features so the fallbacks can be tested and compared on a machine that has them.
+const CpuFeatures& cpu_features();
+//! The enabled features by name, e.g. "sse4.2 pclmul avx2".
+std::string cpu_feature_names();
+//! Clears the features named in `list`, comma separated, ignoring case and surrounding spaces.
+//! Unknown names are skipped; false when there were any.
+bool disable_cpu_features(CpuFeatures& features, std::string_view list);
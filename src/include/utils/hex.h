@@ -0,0 +1,24 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <string>
+#include <string_view>
+
+#include "system.h"
+#include "utils/cpu.h"
+
+//! Writes `size` bytes as `2 * size` lowercase hex characters into `out`.
+void hex_encode(const byte* data, size_t size, char* out);
+//! Implementation hex_encode() picks on a CPU with `cpu`: "ssse3", "neon" or "generic".
+COMP_NO_DISCARD const char* hex_encode_kernel(const CpuFeatures& cpu = cpu_features());
+//! Parses exactly `2 * size` hex characters, returns false on any other input.
+bool hex_decode(std::string_view hex, byte* out, size_t size);
+
+template<typename T>
+inline std::string to_hex(const T& bytes) {
+    std::string hex(bytes.size() * 2, '\0');
+    hex_encode((const byte*) bytes.data(), bytes.size(), hex.data());
+    return hex;
+}
@@ -0,0 +1,48 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#pragma once
+#include <span>
+#include <vector>
+
+#include "system.h"
+#include "utils/cpu.h"
+
+//! Systematic Reed-Solomon erasure code over GF(2^8): `data` shards of equal size gain `parity`
+//! shards, and any `data` of the lot rebuild all the others. The parity rows form a Cauchy matrix,
+//! so every square selection of generator rows is invertible. A shard is multiplied by a constant
+//! through two 16-entry tables, one per nibble, which PSHUFB (SSSE3, AVX2) or TBL (NEON) look up
+//! 16 or 32 bytes at a time.
+class ReedSolomon {
+   public:
+    //! GF(2^8) has room for no more shards than this.
+    static constexpr uint32_t c_max_shards = 256;
+
+    //! False unless 1 <= data, 1 <= parity and data + parity <= c_max_shards.
+    bool init(uint32_t data, uint32_t parity);
+    COMP_NO_DISCARD uint32_t data_shards() const {
+        return m_data;
+    }
+    COMP_NO_DISCARD uint32_t parity_shards() const {
+        return m_parity;
+    }
+
+    //! Computes every parity shard from the data shards, `size` bytes each.
+    void encode(std::span<const byte* const> data, std::span<byte* const> parity, size_t size) const;
+    //! Rebuilds shards from the others: `shards` holds data then parity shards, `present` tells which
+    //! of them hold valid bytes. Absent shards with a buffer are written, absent ones that are nullptr
+    //! are skipped. False when fewer than data_shards() are present.
+    bool reconstruct(std::span<byte* const> shards, std::span<const bool> present, size_t size) const;
+
+    //! Table lookup picked on a CPU with `cpu`: "avx2", "ssse3", "neon" or "generic".
+    COMP_NO_DISCARD static const char* kernel(const CpuFeatures& cpu = cpu_features());
+
+   private:
+    uint32_t m_data = 0;
+    uint32_t m_parity = 0;
+    //! Coefficients of the parity rows, `parity` rows of `data` columns.
+    std::vector<uint8_t> m_matrix;
+    //! Nibble tables of m_matrix, 32 bytes per coefficient, one vector per parity row.
+    std::vector<std::vector<uint8_t>> m_tables;
+};
@@ -0,0 +1,398 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/backup.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+
+#include "backup/delta.h"
+#include "backup/merkle.h"
+#include "files/device.h"
+#include "files/hash_cache.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+
+namespace backup {
+    static metrics::Counter& g_files = metrics::counter("fward_backup_files_total", "Files backed up, unchanged ones included.");
+    static metrics::Counter& g_files_unchanged = metrics::counter("fward_backup_files_unchanged_total", "Files reused from the catalog without reading.");
+    static metrics::Counter& g_bytes_read = metrics::counter("fward_backup_read_bytes_total", "Bytes read from source files.");
+    static metrics::Counter& g_bytes_written = metrics::counter("fward_backup_written_bytes_total", "Bytes of new chunks and deltas written to packs.");
+    static metrics::Counter& g_chunks_new = metrics::counter("fward_backup_chunks_new_total", "Chunks stored in full.");
+    static metrics::Counter& g_chunks_delta = metrics::counter("fward_backup_chunks_delta_total", "Chunks stored as a delta.");
+    static metrics::Counter& g_chunks_reused = metrics::counter("fward_backup_chunks_reused_total", "Chunks the repository already had.");
+    static metrics::Counter& g_errors = metrics::counter("fward_backup_errors_total", "Entries that could not be read.");
+    static metrics::Counter& g_batches = metrics::counter("fward_backup_small_batches_total", "Batches of small files read and stored together.");
+
+    static bool chunk_path(const std::string& path, const Chunker& chunker,
+                           const std::function<bool(const hashing::Digest& digest, const byte* data, size_t size)>& callback) {
+        files::Reader reader;
+        if (!reader.open(path)) return false;
+        return chunk_file(reader, chunker, [&](const byte* data, size_t size) {
+            hashing::Digest digest;
+            {
+                TRACE_ZONE("hash");
+                digest = hashing::Sha256::digest(data, size);
+            }
+            return callback(digest, data, size);
+        });
+    }
+
+    bool hash_file(const std::string& path, std::vector<ChunkRef>& chunks, uint64_t& size) {
+        chunks.clear();
+        size = 0;
+        return chunk_path(path, Chunker(), [&](const hashing::Digest& digest, const byte*, size_t length) {
+            chunks.push_back({ digest, (uint32_t) length });
+            size += length;
+            return true;
+        });
+    }
+
+    //! The Merkle digest over the default chunking, the same `entry.content` holds.
+    static constexpr files::HashAlgorithm c_hash_algorithm = files::HashAlgorithm::ChunkedSha256;
+    //! Files at least this large are stored as deltas against their previous version when they change.
+    static constexpr uint64_t c_delta_min_file_size = 16 * 1024 * 1024;
+    //! A batch of small files ends at whichever of these it reaches first.
+    static constexpr uint64_t c_batch_bytes = 4 * 1024 * 1024;
+    static constexpr size_t c_batch_files = 1024;
+    //! Marks batch numbers among the tags of the device queues; the other tags index the pending files.
+    static constexpr uint64_t c_batch_tag = 1ull << 63;
+    //! Catalog records per journal record.
+    static constexpr size_t c_catalog_batch = 4096;
+
+    static bool unchanged(const Repository& repository, const CatalogRecord& record, const SnapshotEntry& entry) {
+        if (record.size != entry.size || record.mtime_ns != entry.mtime_ns) return false;
+        // A record may outlive its chunks, e.g. when a pack didn't make it to disk.
+        return std::all_of(record.chunks.begin(), record.chunks.end(), [&](const ChunkRef& chunk) { return repository.contains(chunk.digest); });
+    }
+
+    //! Chunk lists of the files in the newest earlier snapshot of the same source, by content digest,
+    //! for files whose cached hash says they were backed up before. Loaded on first use.
+    class KnownContents {
+       public:
+        KnownContents(const Repository& repository, const std::string& source) : m_repository(repository), m_source(source) { }
+
+        bool find(const hashing::Digest& digest, std::span<const ChunkRef>& chunks) {
+            if (!m_loaded) load();
+            auto it = m_files.find(digest);
+            if (it == m_files.end()) return false;
+            chunks = m_snapshot.chunks_of(it->second);
+            return std::all_of(chunks.begin(), chunks.end(), [&](const ChunkRef& chunk) { return m_repository.contains(chunk.digest); });
+        }
+
+       private:
+        void load() {
+            TRACE_ZONE("known");
+            m_loaded = true;
+            auto ids = m_repository.snapshot_ids();
+            for (auto id = ids.rbegin(); id != ids.rend(); ++id) {
+                if (!m_repository.load_snapshot(*id, m_snapshot) || m_snapshot.source != m_source) continue;
+                for (files::PathId path = 0; path < m_snapshot.entries.size(); ++path) {
+                    const auto& entry = m_snapshot.entries[path];
+                    if (entry.type == files::EntryType::File && !(entry.flags & c_entry_unreadable)) m_files.try_emplace(entry.content, path);
+                }
+                return;
+            }
+            m_snapshot = {};
+        }
+
+        const Repository& m_repository;
+        const std::string& m_source;
+        bool m_loaded = false;
+        Snapshot m_snapshot;
+        std::unordered_map<hashing::Digest, files::PathId, hashing::DigestHash> m_files;
+    };
+
+    //! Picks, for a new chunk of a changed file, the chunk that covered the same region in the
+    //! previous version and stores the new one as an rsync-style delta against it.
+    class DeltaStore {
+       public:
+        DeltaStore(Repository& repository, const std::vector<ChunkRef>& previous) : m_repository(repository), m_previous(previous) {
+            m_offsets.reserve(previous.size() + 1);
+            uint64_t offset = 0;
+            for (const auto& chunk : previous) {
+                m_offsets.push_back(offset);
+                offset += chunk.length;
+            }
+            m_offsets.push_back(offset);
+        }
+
+        //! False when no delta is worth storing; `stored` is the size written otherwise.
+        bool store(const hashing::Digest& digest, const byte* data, size_t size, uint64_t offset, size_t& stored) {
+            if (m_previous.empty()) return false;
+            TRACE_ZONE("delta");
+            // The content-defined boundaries realign right after a change, so the middle of the new
+            // chunk almost always falls in the chunk it replaced.
+            uint64_t middle = offset + size / 2;
+            auto it = std::upper_bound(m_offsets.begin(), m_offsets.end() - 1, middle);
+            const auto& base = m_previous[std::min<size_t>(it - m_offsets.begin(), m_previous.size()) - 1];
+            if (base.digest == digest || !m_repository.contains(base.digest) || m_repository.delta_depth(base.digest) >= c_max_delta_depth) return false;
+            if (!m_repository.read_chunk(base.digest, m_base) || hashing::Sha256::digest(m_base.data(), m_base.size()) != base.digest) return false;
+
+            DeltaSignature signature(m_base.data(), m_base.size());
+            if (!delta_encode(base.digest, m_base.data(), signature, data, size, size / 2, m_delta)) return false;
+            bool added = false;
+            if (!m_repository.store_delta(digest, m_delta.data(), m_delta.size(), added)) return false;
+            stored = added ? m_delta.size() : 0;
+            return true;
+        }
+
+       private:
+        Repository& m_repository;
+        const std::vector<ChunkRef>& m_previous;
+        std::vector<uint64_t> m_offsets;
+        std::vector<byte> m_base;
+        std::vector<byte> m_delta;
+    };
+
+    //! A file that has to be read, and what reading it gave.
+    struct PendingFile {
+        files::PathId id = 0;
+        std::string path;
+        //! Chunks of the previous version, for files large enough to be stored as deltas.
+        std::vector<ChunkRef> previous;
+        std::vector<ChunkRef> chunks;
+        uint64_t size = 0;
+        bool readable = false;
+    };
+
+    //! Consecutive pending files, by position in inode order.
+    struct SmallBatch {
+        size_t first;
+        size_t count;
+    };
+
+    bool run_backup(Repository& repository, const BackupOptions& options, Snapshot& snapshot, BackupStats& stats) {
+        snapshot.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        TRACE_ZONE("backup");
+        files::ScanStats scanned {};
+        {
+            TRACE_ZONE("scan");
+            if (!capture_snapshot(options.source, options.filter, snapshot, &scanned)) return false;
+        }
+        stats.errors += scanned.errors;
+
+        // Always the default chunking, so verify can rehash live files into comparable chunk lists.
+        Chunker chunker;
+        KnownContents known(repository, options.source);
+        std::vector<PendingFile> pending;
+        std::vector<size_t> small;
+        files::DeviceQueues queues;
+        std::string path;
+        for (files::PathId id = 0; id < snapshot.entries.size(); ++id) {
+            auto& entry = snapshot.entries[id];
+            if (entry.type == files::EntryType::Directory) {
+                stats.directories++;
+                continue;
+            }
+            if (entry.type != files::EntryType::File) continue;
+
+            stats.files++;
+            g_files.add();
+            snapshot.source_path(id, path);
+
+            CatalogRecord previous;
+            bool has_previous = options.catalog && options.catalog->find(path, previous);
+            std::span<const ChunkRef> reused;
+            hashing::Digest cached {};
+            bool reuse = has_previous && unchanged(repository, previous, entry);
+            if (reuse) {
+                // The catalog settles it without a getxattr. Files it knows were read once, and got
+                // their attribute then if --hash-xattrs was on.
+                reused = previous.chunks;
+            } else if (options.hash_xattrs && files::load_cached_hash(path, c_hash_algorithm, entry.size, entry.mtime_ns, cached) &&
+                       known.find(cached, reused)) {
+                reuse = true;
+                // Found by content, so the catalog learns the new path.
+                if (options.catalog && entry.mtime_ns < snapshot.time_ns - c_racy_window_ns) {
+                    options.catalog->put(path, { entry.size, entry.mtime_ns, { reused.begin(), reused.end() } });
+                }
+            }
+            if (reuse) {
+                entry.first_chunk = (uint32_t) snapshot.chunks.size();
+                snapshot.chunks.insert(snapshot.chunks.end(), reused.begin(), reused.end());
+                entry.chunk_count = (uint32_t) (snapshot.chunks.size() - entry.first_chunk);
+                entry.content = merkle_file_digest(entry.size, snapshot.chunks_of(id));
+                stats.files_unchanged++;
+                stats.chunks_reused += entry.chunk_count;
+                g_files_unchanged.add();
+                g_chunks_reused.add(entry.chunk_count);
+                continue;
+            }
+
+            auto& file = pending.emplace_back();
+            file.id = id;
+            file.path = path;
+            if (has_previous && entry.size >= c_delta_min_file_size) file.previous = std::move(previous.chunks);
+            if (entry.size <= c_small_file_size) {
+                small.push_back(pending.size() - 1);
+            } else {
+                queues.add(file.path, pending.size() - 1);
+            }
+        }
+
+        std::sort(small.begin(), small.end(), [&](size_t a, size_t b) { return snapshot.entries[pending[a].id].inode < snapshot.entries[pending[b].id].inode; });
+        std::vector<SmallBatch> batches;
+        uint64_t batch_bytes = 0;
+        for (size_t i = 0; i < small.size(); ++i) {
+            if (batches.empty() || batches.back().count == c_batch_files || batch_bytes >= c_batch_bytes) {
+                batches.push_back({ i, 0 });
+                batch_bytes = 0;
+                // The queue of a rotational disk orders batches by where their first file lies.
+                queues.add(pending[small[i]].path, c_batch_tag | (batches.size() - 1));
+            }
+            batches.back().count++;
+            batch_bytes += snapshot.entries[pending[small[i]].id].size;
+        }
+
+        // Reading and hashing run per disk in parallel; the repository's writes aren't thread-safe, so
+        // storing a chunk, and the index lookups around it, take turns.
+        std::mutex store_mutex;
+        bool written = true;
+        tasks::TaskGroup group;
+        // With store_mutex held.
+        auto store = [&](const hashing::Digest& digest, const byte* data, size_t length, DeltaStore* deltas, uint64_t offset) {
+            if (!written) return false;
+            size_t stored = 0;
+            if (deltas && !repository.contains(digest) && deltas->store(digest, data, length, offset, stored)) {
+                stats.chunks_delta++;
+                stats.bytes_added += stored;
+                g_chunks_delta.add();
+                g_bytes_written.add(stored);
+                return true;
+            }
+            TRACE_ZONE("store");
+            bool added = false;
+            if (!repository.store_chunk(digest, data, length, added)) {
+                written = false;
+                group.cancel();
+                return false;
+            }
+            if (added) {
+                stats.chunks_added++;
+                stats.bytes_added += length;
+                g_chunks_new.add();
+                g_bytes_written.add(length);
+            } else {
+                stats.chunks_reused++;
+                g_chunks_reused.add();
+            }
+            return true;
+        };
+        auto read_file = [&](PendingFile& file) {
+            TRACE_ZONE("file");
+            std::optional<DeltaStore> deltas;
+            if (!file.previous.empty()) deltas.emplace(repository, file.previous);
+            file.readable = chunk_path(file.path, chunker, [&](const hashing::Digest& digest, const byte* data, size_t length) {
+                {
+                    std::lock_guard lock(store_mutex);
+                    if (!store(digest, data, length, deltas ? &*deltas : nullptr, file.size)) return false;
+                }
+                file.chunks.push_back({ digest, (uint32_t) length });
+                file.size += length;
+                g_bytes_read.add(length);
+                return true;
+            });
+        };
+        auto read_batch = [&](const SmallBatch& batch) {
+            TRACE_ZONE("batch");
+            struct Read {
+                PendingFile* file;
+                size_t offset;
+                size_t length;
+                hashing::Digest digest;
+            };
+            std::vector<Read> reads;
+            reads.reserve(batch.count);
+            std::vector<byte> data;
+            for (size_t i = batch.first; i < batch.first + batch.count && !group.cancelled(); ++i) {
+                auto& file = pending[small[i]];
+                uint64_t expected = snapshot.entries[file.id].size;
+                size_t offset = data.size();
+                // One byte more than expected tells a file that grew, which takes the usual path.
+                int64_t length = files::read_small_file(file.path, expected + 1, data);
+                if (length > (int64_t) expected) {
+                    data.resize(offset);
+                    read_file(file);
+                } else if (length >= 0) {
+                    reads.push_back({ &file, offset, (size_t) length, {} });
+                }
+            }
+            {
+                TRACE_ZONE("hash");
+                for (auto& read : reads) {
+                    if (read.length) read.digest = hashing::Sha256::digest(data.data() + read.offset, read.length);
+                }
+            }
+            {
+                std::lock_guard lock(store_mutex);
+                for (const auto& read : reads) {
+                    if (read.length && !store(read.digest, data.data() + read.offset, read.length, nullptr, 0)) return;
+                }
+            }
+            for (const auto& read : reads) {
+                if (read.length) read.file->chunks.push_back({ read.digest, (uint32_t) read.length });
+                read.file->size = read.length;
+                read.file->readable = true;
+            }
+            g_bytes_read.add(data.size());
+            g_batches.add();
+        };
+        queues.run(group, [&](uint64_t tag) {
+            if (tag & c_batch_tag) {
+                read_batch(batches[tag & ~c_batch_tag]);
+            } else {
+                read_file(pending[tag]);
+            }
+        });
+        if (!written) return false;
+
+        std::vector<CatalogUpdate> updates;
+        for (auto& file : pending) {
+            auto& entry = snapshot.entries[file.id];
+            stats.bytes_read += file.size;
+            if (!file.readable) {
+                // Keep the entry so the tree stays complete, but without half a chunk list.
+                entry.flags |= c_entry_unreadable;
+                if (options.catalog) options.catalog->erase(file.path);
+                stats.errors++;
+                g_errors.add();
+                continue;
+            }
+            // Record what was actually read; the file may have changed since it was stat'ed.
+            bool stable = file.size == entry.size;
+            entry.size = file.size;
+            entry.first_chunk = (uint32_t) snapshot.chunks.size();
+            snapshot.chunks.insert(snapshot.chunks.end(), file.chunks.begin(), file.chunks.end());
+            entry.chunk_count = (uint32_t) file.chunks.size();
+            entry.content = merkle_file_digest(file.size, snapshot.chunks_of(file.id));
+            if (stable && entry.mtime_ns < snapshot.time_ns - c_racy_window_ns) {
+                if (options.hash_xattrs) files::store_cached_hash(file.path, c_hash_algorithm, entry.size, entry.mtime_ns, entry.content);
+                if (options.catalog) updates.push_back({ std::move(file.path), { entry.size, entry.mtime_ns, std::move(file.chunks) } });
+            }
+            if (updates.size() == c_catalog_batch) {
+                options.catalog->put(updates);
+                updates.clear();
+            }
+        }
+        if (!updates.empty()) options.catalog->put(updates);
+        {
+            TRACE_ZONE("flush");
+            if (!repository.flush()) return false;
+        }
+        // Records only name chunks that are now durable in a pack, and all of them share one sync.
+        if (options.catalog) {
+            TRACE_ZONE("catalog");
+            if (!options.catalog->sync() || (options.catalog->checkpoint_due() && !options.catalog->checkpoint())) WARN("Could not update the catalog.");
+        }
+
+        TRACE_ZONE("snapshot");
+        merkle_build(snapshot, true);
+        return repository.save_snapshot(snapshot);
+    }
+}  // namespace backup
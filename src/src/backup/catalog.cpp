@@ -0,0 +1,229 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/catalog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <sys/file.h>
+
+#include "hashing/crc32c.h"
+#include "utils/binary.h"
+
+namespace backup {
+    static constexpr char c_checkpoint_magic[8] = { 'F', 'W', 'C', 'A', 'T', 'C', 'K', '1' };
+    //! Below this the journal is never worth compacting.
+    static constexpr uint64_t c_min_checkpoint_journal = 16 * 1024 * 1024;
+
+    enum class CatalogOp : uint8_t {
+        Put = 1,
+        Erase = 2,
+        PutBatch = 3
+    };
+
+    static void write_record(BinaryWriter& writer, std::string_view path, const CatalogRecord& record) {
+        writer.put_string(path);
+        writer.put_varint(record.size);
+        writer.put(record.mtime_ns);
+        writer.put_varint(record.chunks.size());
+        for (const auto& chunk : record.chunks) {
+            writer.put(chunk.digest);
+            writer.put_varint(chunk.length);
+        }
+    }
+
+    static bool read_record(BinaryReader& reader, std::string_view& path, CatalogRecord& record) {
+        path = reader.get_string();
+        record.size = reader.get_varint();
+        record.mtime_ns = reader.get<int64_t>();
+        uint64_t count = reader.get_varint();
+        if (reader.error() || count > reader.remaining()) return false;
+        record.chunks.resize(count);
+        for (auto& chunk : record.chunks) {
+            chunk.digest = reader.get<hashing::Digest>();
+            chunk.length = (uint32_t) reader.get_varint();
+        }
+        return !reader.error();
+    }
+
+    bool Catalog::open(const std::string& directory, const files::JournalOptions& options) {
+        close();
+        m_directory = directory;
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error) return false;
+        // One writer per catalog: a second one would interleave its records with ours.
+        if (!m_lock.open(directory + "/lock", files::FileMode::ReadWrite) || ::flock(m_lock.descriptor(), LOCK_EX | LOCK_NB) != 0) {
+            m_lock.close();
+            return false;
+        }
+
+        uint64_t checkpoint_lsn = 0;
+        if (!load_checkpoint(checkpoint_lsn)) {
+            // The catalog only saves rereading files, so a damaged one is dropped rather than trusted.
+            WARN("Catalog in '{}' is damaged, starting over.", directory);
+            m_records.clear();
+            m_checkpoint_bytes = 0;
+            std::filesystem::remove(directory + "/checkpoint", error);
+            std::filesystem::remove(directory + "/journal", error);
+            checkpoint_lsn = 0;
+        }
+        // A crash between writing the checkpoint and resetting the journal leaves records it already covers.
+        // A record that doesn't parse is dropped with everything after it, like a torn tail.
+        return m_journal.open(
+            directory + "/journal",
+            [&](uint64_t lsn, const byte* data, size_t size) {
+                if (lsn <= checkpoint_lsn || replay(data, size)) return true;
+                WARN("Catalog journal in '{}' is damaged at record {}, dropping it and the records after it.", directory, lsn);
+                return false;
+            },
+            options);
+    }
+
+    void Catalog::close() {
+        m_journal.close();
+        std::unique_lock lock(m_mutex);
+        m_records.clear();
+        m_checkpoint_bytes = 0;
+        m_lock.close();
+    }
+
+    bool Catalog::load_checkpoint(uint64_t& lsn) {
+        std::string path = m_directory + "/checkpoint";
+        lsn = 0;
+        if (!std::filesystem::exists(path)) return true;
+
+        std::vector<byte> data;
+        if (!files::read_whole_file(path, data) || data.size() < sizeof(c_checkpoint_magic) + sizeof(uint32_t)) return false;
+        size_t body = data.size() - sizeof(uint32_t);
+        uint32_t crc;
+        std::memcpy(&crc, data.data() + body, sizeof(crc));
+        if (std::memcmp(data.data(), c_checkpoint_magic, sizeof(c_checkpoint_magic)) != 0 || crc != hashing::crc32c(data.data(), body)) return false;
+
+        BinaryReader reader(data.data() + sizeof(c_checkpoint_magic), body - sizeof(c_checkpoint_magic));
+        lsn = reader.get<uint64_t>();
+        uint64_t count = reader.get_varint();
+        if (reader.error() || count > reader.remaining()) return false;
+        m_records.reserve(count);
+        for (uint64_t i = 0; i < count; ++i) {
+            std::string_view path_view;
+            CatalogRecord record;
+            if (!read_record(reader, path_view, record)) return false;
+            m_records.insert_or_assign(std::string(path_view), std::move(record));
+        }
+        m_checkpoint_bytes = data.size();
+        return reader.remaining() == 0;
+    }
+
+    bool Catalog::replay(const byte* data, size_t size) {
+        BinaryReader reader(data, size);
+        auto op = (CatalogOp) reader.get<uint8_t>();
+        if (op == CatalogOp::Erase) {
+            std::string_view path = reader.get_string();
+            if (reader.error()) return false;
+            apply(path, nullptr);
+            return true;
+        }
+        std::string_view path;
+        CatalogRecord record;
+        if (op == CatalogOp::PutBatch) {
+            uint64_t count = reader.get_varint();
+            if (reader.error() || count > reader.remaining()) return false;
+            // Parsed in full first, so a record that turns out bad leaves nothing of its batch behind.
+            std::vector<std::pair<std::string_view, CatalogRecord>> batch(count);
+            for (auto& [batch_path, batch_record] : batch) {
+                if (!read_record(reader, batch_path, batch_record)) return false;
+            }
+            for (auto& [batch_path, batch_record] : batch) apply(batch_path, &batch_record);
+            return true;
+        }
+        if (op != CatalogOp::Put || !read_record(reader, path, record)) return false;
+        apply(path, &record);
+        return true;
+    }
+
+    void Catalog::apply(std::string_view path, CatalogRecord* record) {
+        if (!record) {
+            auto it = m_records.find(path);
+            if (it != m_records.end()) m_records.erase(it);
+            return;
+        }
+        auto it = m_records.find(path);
+        if (it == m_records.end()) {
+            m_records.emplace(std::string(path), std::move(*record));
+        } else {
+            it->second = std::move(*record);
+        }
+    }
+
+    bool Catalog::find(const std::string& path, CatalogRecord& record) const {
+        std::shared_lock lock(m_mutex);
+        auto it = m_records.find(path);
+        if (it == m_records.end()) return false;
+        record = it->second;
+        return true;
+    }
+
+    uint64_t Catalog::put(const std::string& path, const CatalogRecord& record) {
+        std::vector<byte> payload;
+        BinaryWriter writer(payload);
+        writer.put(CatalogOp::Put);
+        write_record(writer, path, record);
+
+        // The journal order has to match the order the map sees, hence one lock around both.
+        std::unique_lock lock(m_mutex);
+        m_records.insert_or_assign(path, record);
+        return m_journal.append(payload.data(), payload.size());
+    }
+
+    uint64_t Catalog::put(std::span<const CatalogUpdate> updates) {
+        std::vector<byte> payload;
+        BinaryWriter writer(payload);
+        writer.put(CatalogOp::PutBatch);
+        writer.put_varint(updates.size());
+        for (const auto& update : updates) write_record(writer, update.path, update.record);
+
+        std::unique_lock lock(m_mutex);
+        for (const auto& update : updates) m_records.insert_or_assign(update.path, update.record);
+        return m_journal.append(payload.data(), payload.size());
+    }
+
+    uint64_t Catalog::erase(const std::string& path) {
+        std::vector<byte> payload;
+        BinaryWriter writer(payload);
+        writer.put(CatalogOp::Erase);
+        writer.put_string(path);
+
+        std::unique_lock lock(m_mutex);
+        m_records.erase(path);
+        return m_journal.append(payload.data(), payload.size());
+    }
+
+    bool Catalog::checkpoint() {
+        std::unique_lock lock(m_mutex);
+        uint64_t lsn = m_journal.last_lsn();
+
+        std::vector<byte> data;
+        BinaryWriter writer(data);
+        writer.put_bytes(c_checkpoint_magic, sizeof(c_checkpoint_magic));
+        writer.put(lsn);
+        writer.put_varint(m_records.size());
+        for (const auto& [path, record] : m_records) write_record(writer, path, record);
+        writer.put(hashing::crc32c(data.data(), data.size()));
+
+        if (!files::write_file_atomic(m_directory + "/checkpoint", data.data(), data.size())) return false;
+        m_checkpoint_bytes = data.size();
+        return m_journal.reset(lsn);
+    }
+
+    bool Catalog::checkpoint_due() const {
+        return m_journal.size() > std::max(c_min_checkpoint_journal, m_checkpoint_bytes);
+    }
+
+    size_t Catalog::size() const {
+        std::shared_lock lock(m_mutex);
+        return m_records.size();
+    }
+}  // namespace backup
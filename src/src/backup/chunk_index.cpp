@@ -0,0 +1,394 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/chunk_index.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "files/external_sort.h"
+#include "files/file.h"
+#include "hashing/crc32c.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+#include "utils/binary.h"
+
+namespace backup {
+    static metrics::Counter& g_filter_rejects = metrics::counter("fward_index_filter_rejects_total", "Chunk lookups the filter answered alone.");
+    static metrics::Counter& g_spilled_runs = metrics::counter("fward_index_spilled_runs_total", "Sorted runs index rebuilds wrote to disk to stay within the memory budget.");
+
+    //! With 8 bits set per digest this gives about 1% false positives at full capacity.
+    static constexpr uint64_t c_filter_bits_per_digest = 12;
+    static constexpr uint64_t c_filter_min_capacity = 4096;
+    static constexpr uint64_t c_block_bits = 512;
+
+    static constexpr byte c_cache_magic[8] = { 'f', 'w', 'a', 'r', 'd', 'i', 'd', 'x' };
+    //! Written in native byte order, so a cache from a machine of the other endianness fails here too.
+    static constexpr uint32_t c_cache_version = 2;
+    //! Records the cache writer collects before each write.
+    static constexpr size_t c_write_batch = 16384;
+    //! Directory slots are sized for this many records on average; the directory adds a byte per record.
+    static constexpr size_t c_records_per_slot = 8;
+    //! Interpolation steps before the search falls back to bisection, for slots that aren't uniform.
+    static constexpr uint32_t c_interpolation_steps = 4;
+    static constexpr size_t c_scan_below = 4;
+
+    static uint64_t load_word(const byte* data) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        return word;
+    }
+
+    //! The leading digest bytes as a number that orders like the digests.
+    static uint64_t key_of(const hashing::Digest& digest) {
+        uint64_t key = load_word(digest.data());
+        if constexpr (std::endian::native == std::endian::little) key = std::byteswap(key);
+        return key;
+    }
+
+    static int32_t compare(const hashing::Digest& a, const hashing::Digest& b) {
+        return std::memcmp(a.data(), b.data(), sizeof(hashing::Digest));
+    }
+
+    //! Writes a cache file front to back: header, records, checksum. Derived data, so nothing is synced:
+    //! a torn file fails its checksum and is rebuilt from the packs.
+    class CacheWriter {
+       public:
+        explicit CacheWriter(std::string path) : m_path(std::move(path)), m_temporary(FORMAT("{}.{}.tmp", m_path, (int64_t) ::getpid())) {}
+        ~CacheWriter() {
+            if (m_file.is_open()) {
+                m_file.close();
+                ::unlink(m_temporary.c_str());
+            }
+        }
+
+        bool open(const std::vector<std::string>& packs) {
+            std::vector<byte> header;
+            BinaryWriter writer(header);
+            writer.put_bytes(c_cache_magic, sizeof(c_cache_magic));
+            writer.put(c_cache_version);
+            writer.put((uint32_t) packs.size());
+            size_t records_field = header.size();
+            writer.put((uint64_t) 0);
+            for (const auto& pack : packs) writer.put_string(pack);
+            // Records start on a cache line, so none of them straddles two.
+            m_records = (header.size() + c_record_size - 1) / c_record_size * c_record_size;
+            header.resize(m_records);
+            std::memcpy(header.data() + records_field, &m_records, sizeof(m_records));
+            m_checksum = hashing::crc32c(header.data(), header.size());
+            m_buffer.reserve(c_write_batch * c_record_size);
+            return m_file.open(m_temporary, files::FileMode::Write) && m_file.write_all(header.data(), header.size());
+        }
+        bool add(const void* record) {
+            m_buffer.insert(m_buffer.end(), (const byte*) record, (const byte*) record + c_record_size);
+            ++m_count;
+            return m_buffer.size() < m_buffer.capacity() || flush();
+        }
+        //! Publishes the file under its name.
+        bool finish() {
+            bool written = flush() && m_file.write_all(&m_checksum, sizeof(m_checksum));
+            m_file.close();
+            if (!written || ::rename(m_temporary.c_str(), m_path.c_str()) != 0) {
+                ::unlink(m_temporary.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        //! Offset of the first record.
+        COMP_NO_DISCARD uint64_t records() const {
+            return m_records;
+        }
+        COMP_NO_DISCARD uint64_t count() const {
+            return m_count;
+        }
+
+        static constexpr size_t c_record_size = 64;
+
+       private:
+        bool flush() {
+            m_checksum = hashing::crc32c(m_buffer.data(), m_buffer.size(), m_checksum);
+            bool written = m_file.write_all(m_buffer.data(), m_buffer.size());
+            m_buffer.clear();
+            return written;
+        }
+
+        std::string m_path;
+        std::string m_temporary;
+        files::File m_file;
+        std::vector<byte> m_buffer;
+        uint64_t m_records = 0;
+        uint64_t m_count = 0;
+        uint32_t m_checksum = 0;
+    };
+
+    void ChunkFilter::reset(uint64_t capacity) {
+        m_capacity = capacity;
+        m_blocks.assign(std::max<uint64_t>(1, (capacity * c_filter_bits_per_digest + c_block_bits - 1) / c_block_bits), Block {});
+    }
+
+    size_t ChunkFilter::block_of(const hashing::Digest& digest) const {
+        // Multiply-shift maps the word onto the block count without a division.
+        return (size_t) (((unsigned __int128) load_word(digest.data()) * m_blocks.size()) >> 64);
+    }
+
+    //! Eight 9-bit positions from digest bytes 8 to 23, which the block choice didn't use.
+    template<typename Visit>
+    static void for_each_bit(const hashing::Digest& digest, Visit&& visit) {
+        for (uint32_t half = 0; half < 2; ++half) {
+            uint64_t word = load_word(digest.data() + 8 + half * 8);
+            for (uint32_t i = 0; i < 4; ++i) visit((uint32_t) (word >> (i * 16)) & (c_block_bits - 1));
+        }
+    }
+
+    void ChunkFilter::insert(const hashing::Digest& digest) {
+        auto& block = m_blocks[block_of(digest)];
+        for_each_bit(digest, [&](uint32_t bit) { block.words[bit / 64] |= 1ull << (bit % 64); });
+    }
+
+    bool ChunkFilter::may_contain(const hashing::Digest& digest) const {
+        if (m_blocks.empty()) return false;
+        const auto& block = m_blocks[block_of(digest)];
+        bool all = true;
+        for_each_bit(digest, [&](uint32_t bit) { all &= (block.words[bit / 64] >> (bit % 64)) & 1; });
+        return all;
+    }
+
+    ChunkIndex::~ChunkIndex() {
+        unmap();
+    }
+
+    void ChunkIndex::unmap() {
+        if (m_mapping) ::munmap((void*) m_mapping, m_mapping_size);
+        m_mapping = nullptr;
+        m_mapping_size = 0;
+    }
+
+    void ChunkIndex::clear() {
+        m_sorted = {};
+        m_owned = {};
+        build_directory();
+        unmap();
+        m_recent.clear();
+        m_filter = {};
+    }
+
+    void ChunkIndex::rebuild_filter(uint64_t capacity) {
+        m_filter.reset(std::max(capacity, c_filter_min_capacity));
+        for_each([&](const hashing::Digest& digest, const ChunkLocation&) { m_filter.insert(digest); });
+    }
+
+    bool ChunkIndex::load(const std::string& path, std::vector<std::string>& packs) {
+        TRACE_ZONE("index.load");
+        clear();
+        packs.clear();
+        files::File file;
+        if (!file.open(path, files::FileMode::Read)) return false;
+        uint64_t size = file.size();
+        if (size < sizeof(c_cache_magic) + sizeof(uint32_t)) return false;
+        void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, file.descriptor(), 0);
+        if (mapping == MAP_FAILED) return false;
+        m_mapping = (const byte*) mapping;
+        m_mapping_size = size;
+
+        auto valid = [&]() {
+            size_t body = size - sizeof(uint32_t);
+            uint32_t checksum;
+            std::memcpy(&checksum, m_mapping + body, sizeof(checksum));
+            if (std::memcmp(m_mapping, c_cache_magic, sizeof(c_cache_magic)) != 0) return false;
+
+            BinaryReader reader(m_mapping + sizeof(c_cache_magic), body - sizeof(c_cache_magic));
+            if (reader.get<uint32_t>() != c_cache_version) return false;
+            auto pack_count = reader.get<uint32_t>();
+            auto records = reader.get<uint64_t>();
+            for (uint32_t i = 0; i < pack_count && !reader.error(); ++i) packs.emplace_back(reader.get_string());
+            if (reader.error() || records % sizeof(Record) != 0 || records > body || (body - records) % sizeof(Record) != 0) return false;
+            uint64_t record_count = (body - records) / sizeof(Record);
+            // Sequential for the one pass that checks it and fills the filter, random for the lookups after.
+            ::madvise(mapping, size, MADV_SEQUENTIAL);
+            if (hashing::crc32c(m_mapping, body) != checksum) return false;
+            m_sorted = { (const Record*) (m_mapping + records), record_count };
+            m_filter.reset(std::max(record_count + record_count / 4, c_filter_min_capacity));
+            for (size_t i = 0; i < m_sorted.size(); ++i) {
+                const auto& record = m_sorted[i];
+                if (record.pack >= pack_count || (i > 0 && compare(m_sorted[i - 1].digest, record.digest) >= 0)) return false;
+                m_filter.insert(record.digest);
+            }
+            build_directory();
+            ::madvise(mapping, size, MADV_RANDOM);
+            return true;
+        };
+        if (valid()) return true;
+        clear();
+        packs.clear();
+        return false;
+    }
+
+    std::vector<ChunkIndex::Record> ChunkIndex::sorted_recent() const {
+        std::vector<Record> recent;
+        recent.reserve(m_recent.size());
+        for (const auto& [digest, location] : m_recent) {
+            recent.push_back({ digest, location.pack, location.length, location.offset, location.flags, location.checksum, location.entry, 0 });
+        }
+        std::sort(recent.begin(), recent.end(), [](const Record& a, const Record& b) { return compare(a.digest, b.digest) < 0; });
+        return recent;
+    }
+
+    void ChunkIndex::compact() {
+        if (m_recent.empty()) return;
+        TRACE_ZONE("index.compact");
+        std::vector<Record> recent = sorted_recent();
+        std::vector<Record> merged(m_sorted.size() + recent.size());
+        std::merge(m_sorted.begin(), m_sorted.end(), recent.begin(), recent.end(), merged.begin(),
+                   [](const Record& a, const Record& b) { return compare(a.digest, b.digest) < 0; });
+        m_owned = std::move(merged);
+        m_sorted = m_owned;
+        unmap();
+        build_directory();
+        // Rather than clear(), which keeps the buckets every lookup would still have to touch.
+        m_recent = {};
+    }
+
+    bool ChunkIndex::map_run(const std::string& path, uint64_t records, uint64_t count) {
+        files::File file;
+        if (!file.open(path, files::FileMode::Read)) return false;
+        uint64_t size = file.size();
+        if (size != records + count * sizeof(Record) + sizeof(uint32_t)) return false;
+        void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, file.descriptor(), 0);
+        if (mapping == MAP_FAILED) return false;
+        ::madvise(mapping, size, MADV_RANDOM);
+        unmap();
+        m_mapping = (const byte*) mapping;
+        m_mapping_size = size;
+        m_sorted = { (const Record*) (m_mapping + records), count };
+        m_owned = {};
+        m_recent = {};
+        build_directory();
+        return true;
+    }
+
+    bool ChunkIndex::save(const std::string& path, const std::vector<std::string>& packs) {
+        TRACE_ZONE("index.save");
+        // Streams the run and the sorted recent entries into the file rather than merging them in memory
+        // first, then maps what was written; the filter already covers every entry.
+        std::vector<Record> recent = sorted_recent();
+        CacheWriter writer(path);
+        if (!writer.open(packs)) return false;
+        size_t i = 0;
+        size_t j = 0;
+        while (i < m_sorted.size() || j < recent.size()) {
+            bool from_run = j == recent.size() || (i < m_sorted.size() && compare(m_sorted[i].digest, recent[j].digest) < 0);
+            if (!writer.add(from_run ? &m_sorted[i++] : &recent[j++])) return false;
+        }
+        if (!writer.finish()) return false;
+        if (!map_run(path, writer.records(), writer.count())) compact();
+        return true;
+    }
+
+    bool ChunkIndex::rebuild(const std::string& path, const std::function<bool(const AddEntry&)>& produce, const std::vector<std::string>& packs) {
+        TRACE_ZONE("index.rebuild");
+        clear();
+        // Lower packs first among equal digests, so the merge below keeps the location insert() would.
+        auto less = [](const Record& a, const Record& b) {
+            int32_t order = compare(a.digest, b.digest);
+            return order < 0 || (order == 0 && a.pack < b.pack);
+        };
+        std::string directory = std::filesystem::path(path).parent_path().string();
+        files::ExternalSorter<Record, decltype(less)> sorter(files::memory_budget(), directory.empty() ? "." : directory, less);
+        bool produced = produce([&](const hashing::Digest& digest, const ChunkLocation& location) {
+            return sorter.push({ digest, location.pack, location.length, location.offset, location.flags, location.checksum, location.entry, 0 });
+        });
+        if (!produced) return false;
+        g_spilled_runs.add(sorter.run_count());
+
+        CacheWriter writer(path);
+        if (!writer.open(packs)) return false;
+        bool first = true;
+        hashing::Digest last {};
+        bool merged = sorter.merge([&](const Record& record) {
+            if (!first && compare(last, record.digest) == 0) return true;
+            first = false;
+            last = record.digest;
+            return writer.add(&record);
+        });
+        if (!merged || !writer.finish()) return false;
+        std::vector<std::string> loaded;
+        return load(path, loaded) && loaded == packs;
+    }
+
+    bool ChunkIndex::insert(const hashing::Digest& digest, const ChunkLocation& location) {
+        if (contains(digest)) return false;
+        if (size() >= m_filter.capacity()) rebuild_filter(2 * (size() + 1));
+        m_recent.emplace(digest, location);
+        m_filter.insert(digest);
+        return true;
+    }
+
+    void ChunkIndex::build_directory() {
+        size_t slots = std::bit_floor(std::max<size_t>(1, m_sorted.size() / c_records_per_slot));
+        m_slot_shift = 64 - (uint32_t) std::countr_zero(slots);
+        m_directory.assign(slots + 1, m_sorted.size());
+        size_t slot = 0;
+        for (size_t i = 0; i < m_sorted.size(); ++i) {
+            size_t record_slot = slot_of(key_of(m_sorted[i].digest));
+            while (slot <= record_slot) m_directory[slot++] = i;
+        }
+    }
+
+    const ChunkIndex::Record* ChunkIndex::search(const hashing::Digest& digest) const {
+        uint64_t key = key_of(digest);
+        size_t slot = slot_of(key);
+        size_t low = m_directory[slot];
+        size_t high = m_directory[slot + 1];
+        // The slot's key range is known exactly, which keeps even the first guess close.
+        uint64_t low_key = m_slot_shift < 64 ? (uint64_t) slot << m_slot_shift : 0;
+        uint64_t high_key = m_slot_shift < 64 ? low_key + ((1ull << m_slot_shift) - 1) : UINT64_MAX;
+        for (uint32_t step = 0; step < c_interpolation_steps && high - low > c_scan_below && high_key > low_key; ++step) {
+            double fraction = (double) (key - low_key) / (double) (high_key - low_key);
+            size_t probe = std::min(low + (size_t) (fraction * (double) (high - low)), high - 1);
+            int32_t order = compare(m_sorted[probe].digest, digest);
+            if (order == 0) return &m_sorted[probe];
+            if (order < 0) {
+                low = probe + 1;
+                low_key = key_of(m_sorted[probe].digest);
+            } else {
+                high = probe;
+                high_key = key_of(m_sorted[probe].digest);
+            }
+        }
+        auto it = std::lower_bound(m_sorted.begin() + (ptrdiff_t) low, m_sorted.begin() + (ptrdiff_t) high, digest,
+                                   [](const Record& record, const hashing::Digest& value) { return compare(record.digest, value) < 0; });
+        if (it == m_sorted.begin() + (ptrdiff_t) high || compare(it->digest, digest) != 0) return nullptr;
+        return &*it;
+    }
+
+    bool ChunkIndex::find(const hashing::Digest& digest, ChunkLocation& location) const {
+        if (!m_filter.may_contain(digest)) {
+            g_filter_rejects.add();
+            return false;
+        }
+        if (!m_recent.empty()) {
+            if (auto it = m_recent.find(digest); it != m_recent.end()) {
+                location = it->second;
+                return true;
+            }
+        }
+        const Record* record = search(digest);
+        if (!record) return false;
+        location = location_of(*record);
+        return true;
+    }
+
+    bool ChunkIndex::contains(const hashing::Digest& digest) const {
+        if (!m_filter.may_contain(digest)) {
+            g_filter_rejects.add();
+            return false;
+        }
+        return (!m_recent.empty() && m_recent.contains(digest)) || search(digest);
+    }
+}  // namespace backup
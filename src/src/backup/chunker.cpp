@@ -0,0 +1,86 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/chunker.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+#include "metrics/trace.h"
+
+namespace backup {
+    //! Gear table from splitmix64 so every build (and every other implementation) cuts identically.
+    static constexpr std::array<uint64_t, 256> c_gear = []() {
+        std::array<uint64_t, 256> table {};
+        uint64_t state = 0x66776172645f6364ull;
+        for (auto& value : table) {
+            state += 0x9E3779B97F4A7C15ull;
+            uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            value = z ^ (z >> 31);
+        }
+        return table;
+    }();
+
+    //! The gear hash shifts left, so the most significant bits have seen the most input.
+    static constexpr uint64_t top_bits(uint32_t count) {
+        return count == 0 ? 0 : ~0ull << (64 - count);
+    }
+
+    Chunker::Chunker(const ChunkerOptions& options) : m_options(options) {
+        ASSERT(options.min_size <= options.average_size && options.average_size <= options.max_size);
+        auto bits = (uint32_t) std::bit_width(options.average_size) - 1;
+        // Normalized chunking: harder to cut before the average size, easier after it.
+        m_mask_small = top_bits(bits + 2);
+        m_mask_large = top_bits(bits > 2 ? bits - 2 : 0);
+    }
+
+    size_t Chunker::next_cut(const byte* data, size_t size) const {
+        if (size <= m_options.min_size) return size;
+        size_t end = std::min<size_t>(size, m_options.max_size);
+        size_t normal = std::min<size_t>(end, m_options.average_size);
+
+        uint64_t hash = 0;
+        size_t i = m_options.min_size;
+        for (; i < normal; ++i) {
+            hash = (hash << 1) + c_gear[data[i]];
+            if (!(hash & m_mask_small)) return i + 1;
+        }
+        for (; i < end; ++i) {
+            hash = (hash << 1) + c_gear[data[i]];
+            if (!(hash & m_mask_large)) return i + 1;
+        }
+        return end;
+    }
+
+    bool chunk_file(files::Reader& reader, const Chunker& chunker, const std::function<bool(const byte* data, size_t size)>& callback) {
+        const size_t max_size = chunker.options().max_size;
+        const size_t window = max_size * 2;
+        uint64_t offset = 0;
+        std::span<const byte> data;
+        size_t start = 0;
+        bool eof = false;
+        while (true) {
+            // Keep at least one maximum chunk in view so a cut is never decided on partial input.
+            if (!eof && data.size() - start < max_size) {
+                TRACE_ZONE("read");
+                offset += start;
+                start = 0;
+                if (!reader.view(offset, window, data)) return false;
+                eof = data.size() < window;
+            }
+            if (start == data.size()) return true;
+
+            size_t cut;
+            {
+                TRACE_ZONE("chunk");
+                cut = chunker.next_cut(data.data() + start, data.size() - start);
+            }
+            if (!callback(data.data() + start, cut)) return false;
+            start += cut;
+        }
+    }
+}  // namespace backup
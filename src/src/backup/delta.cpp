@@ -0,0 +1,138 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/delta.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "hashing/rolling.h"
+#include "utils/binary.h"
+
+namespace backup {
+    DeltaSignature::DeltaSignature(const byte* base, size_t size) : m_filter(65536 / 64) {
+        size_t blocks = size / c_delta_block_size;
+        m_blocks.reserve(blocks);
+        for (size_t i = 0; i < blocks; ++i) {
+            uint32_t checksum = hashing::rolling_checksum(base + i * c_delta_block_size, c_delta_block_size);
+            uint32_t tag = (checksum ^ (checksum >> 16)) & 0xFFFF;
+            m_filter[tag >> 6] |= 1ull << (tag & 63);
+            m_blocks.emplace_back(checksum, (uint32_t) i);
+        }
+        std::sort(m_blocks.begin(), m_blocks.end());
+    }
+
+    class DeltaWriter {
+       public:
+        DeltaWriter(std::vector<byte>& out, size_t limit) : m_out(out), m_writer(out), m_limit(limit) { }
+
+        bool literal(const byte* data, size_t size) {
+            if (!size) return true;
+            flush_copy();
+            m_writer.put_varint(size << 1);
+            m_writer.put_bytes(data, size);
+            return m_out.size() <= m_limit;
+        }
+        //! Adjacent copies are merged, so an unchanged run costs a single op.
+        bool copy(uint64_t offset, size_t size) {
+            if (m_copy_size && m_copy_offset + m_copy_size == offset) {
+                m_copy_size += size;
+                return true;
+            }
+            flush_copy();
+            m_copy_offset = offset;
+            m_copy_size = size;
+            return m_out.size() <= m_limit;
+        }
+        bool finish() {
+            flush_copy();
+            return m_out.size() <= m_limit;
+        }
+
+       private:
+        void flush_copy() {
+            if (!m_copy_size) return;
+            m_writer.put_varint(m_copy_size << 1 | 1);
+            m_writer.put_varint(m_copy_offset);
+            m_copy_size = 0;
+        }
+
+        std::vector<byte>& m_out;
+        BinaryWriter m_writer;
+        size_t m_limit;
+        uint64_t m_copy_offset = 0;
+        size_t m_copy_size = 0;
+    };
+
+    bool delta_encode(const hashing::Digest& base_digest, const byte* base, const DeltaSignature& signature,
+                      const byte* target, size_t target_size, size_t limit, std::vector<byte>& out) {
+        out.clear();
+        BinaryWriter header(out);
+        header.put(base_digest);
+        header.put_varint(target_size);
+
+        DeltaWriter writer(out, limit);
+        size_t literal_start = 0;
+        size_t position = 0;
+        uint32_t checksum = 0;
+        bool rolled = false;
+        while (position + c_delta_block_size <= target_size) {
+            if (!rolled) checksum = hashing::rolling_checksum(target + position, c_delta_block_size);
+            const byte* window = target + position;
+            uint32_t matched = 0;
+            bool found = signature.find(checksum, [&](uint32_t block) {
+                matched = block;
+                return std::memcmp(base + (size_t) block * c_delta_block_size, window, c_delta_block_size) == 0;
+            });
+
+            if (found) {
+                if (!writer.literal(target + literal_start, position - literal_start)) return false;
+                if (!writer.copy((uint64_t) matched * c_delta_block_size, c_delta_block_size)) return false;
+                position += c_delta_block_size;
+                literal_start = position;
+                rolled = false;
+                continue;
+            }
+            if (position + c_delta_block_size < target_size) {
+                checksum = hashing::rolling_update(checksum, target[position], target[position + c_delta_block_size], c_delta_block_size);
+            }
+            rolled = true;
+            ++position;
+            // Bail out early on data that has nothing in common with the base.
+            if (position - literal_start > limit) return false;
+        }
+        return writer.literal(target + literal_start, target_size - literal_start) && writer.finish();
+    }
+
+    bool delta_base(const byte* delta, size_t size, hashing::Digest& base_digest) {
+        if (size < sizeof(base_digest)) return false;
+        std::memcpy(base_digest.data(), delta, sizeof(base_digest));
+        return true;
+    }
+
+    bool delta_apply(const byte* base, size_t base_size, const byte* delta, size_t size, std::vector<byte>& out) {
+        BinaryReader reader(delta, size);
+        reader.get<hashing::Digest>();
+        uint64_t target_size = reader.get_varint();
+        if (reader.error() || target_size > UINT32_MAX) return false;
+
+        out.clear();
+        out.reserve(target_size);
+        while (reader.remaining() && !reader.error()) {
+            uint64_t op = reader.get_varint();
+            uint64_t length = op >> 1;
+            if (length > target_size - out.size()) return false;
+            size_t at = out.size();
+            out.resize(at + length);
+            if (op & 1) {
+                uint64_t offset = reader.get_varint();
+                if (offset > base_size || length > base_size - offset) return false;
+                std::memcpy(out.data() + at, base + offset, length);
+            } else {
+                reader.get_bytes(out.data() + at, length);
+            }
+        }
+        return !reader.error() && out.size() == target_size;
+    }
+}  // namespace backup
@@ -0,0 +1,162 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/merkle.h"
+
+namespace backup {
+    // Every node kind gets its own domain tag so e.g. a file can never collide with a directory listing.
+    static constexpr byte c_tag_file = 'F';
+    static constexpr byte c_tag_link = 'L';
+    static constexpr byte c_tag_directory = 'D';
+    static constexpr byte c_tag_leaf_meta = 'm';
+    static constexpr byte c_tag_directory_meta = 'd';
+
+    static void update_name(hashing::Sha256& hasher, std::string_view name) {
+        hasher.update_value((uint32_t) name.size());
+        hasher.update(name);
+    }
+
+    hashing::Digest merkle_file_digest(uint64_t size, std::span<const ChunkRef> chunks) {
+        hashing::Sha256 hasher;
+        hasher.update_value(c_tag_file);
+        hasher.update_value(size);
+        for (const auto& chunk : chunks) {
+            hasher.update(chunk.digest.data(), chunk.digest.size());
+            hasher.update_value(chunk.length);
+        }
+        return hasher.finish();
+    }
+
+    static hashing::Digest link_digest(std::string_view target) {
+        hashing::Sha256 hasher;
+        hasher.update_value(c_tag_link);
+        update_name(hasher, target);
+        return hasher.finish();
+    }
+
+    static hashing::Digest leaf_meta_digest(const Snapshot& snapshot, files::PathId id) {
+        const auto& entry = snapshot.entries[id];
+        hashing::Sha256 hasher;
+        hasher.update_value(c_tag_leaf_meta);
+        hasher.update_value((uint8_t) entry.type);
+        hasher.update_value(entry.mode);
+        hasher.update_value(entry.size);
+        hasher.update_value(entry.mtime_ns);
+        if (entry.type == files::EntryType::Symlink) update_name(hasher, snapshot.link_target(id));
+        return hasher.finish();
+    }
+
+    //! Directory mtimes are left out on purpose: they change with every create or delete inside and
+    //! restores don't preserve them, while the listing itself already covers those changes.
+    static hashing::Digest directory_meta_digest(const Snapshot& snapshot, files::PathId id) {
+        hashing::Sha256 hasher;
+        hasher.update_value(c_tag_directory_meta);
+        hasher.update_value(snapshot.entries[id].mode);
+        for (files::PathId child : snapshot.children(id)) {
+            update_name(hasher, snapshot.paths.name(child));
+            hasher.update(snapshot.entries[child].meta.data(), sizeof(hashing::Digest));
+        }
+        return hasher.finish();
+    }
+
+    static hashing::Digest directory_content_digest(const Snapshot& snapshot, files::PathId id) {
+        hashing::Sha256 hasher;
+        hasher.update_value(c_tag_directory);
+        for (files::PathId child : snapshot.children(id)) {
+            update_name(hasher, snapshot.paths.name(child));
+            hasher.update_value((uint8_t) snapshot.entries[child].type);
+            hasher.update(snapshot.entries[child].content.data(), sizeof(hashing::Digest));
+        }
+        return hasher.finish();
+    }
+
+    void merkle_build(Snapshot& snapshot, bool with_content) {
+        snapshot.index_children();
+        // Children always have higher ids than their parent, so a reverse sweep is a post-order walk.
+        for (auto id = (files::PathId) snapshot.entries.size(); id-- > 0;) {
+            auto& entry = snapshot.entries[id];
+            if (entry.type == files::EntryType::Directory) {
+                entry.meta = directory_meta_digest(snapshot, id);
+                if (with_content) entry.content = directory_content_digest(snapshot, id);
+            } else {
+                entry.meta = leaf_meta_digest(snapshot, id);
+                if (with_content && entry.type == files::EntryType::Symlink) entry.content = link_digest(snapshot.link_target(id));
+            }
+        }
+    }
+
+    bool merkle_check(const Snapshot& snapshot, std::vector<files::PathId>& corrupt) {
+        size_t before = corrupt.size();
+        for (files::PathId id = 0; id < snapshot.entries.size(); ++id) {
+            const auto& entry = snapshot.entries[id];
+            hashing::Digest expected {};
+            switch (entry.type) {
+                case files::EntryType::Directory:
+                    expected = directory_content_digest(snapshot, id);
+                    break;
+                case files::EntryType::File:
+                    if (entry.flags & c_entry_unreadable) continue;
+                    expected = merkle_file_digest(entry.size, snapshot.chunks_of(id));
+                    break;
+                case files::EntryType::Symlink:
+                    expected = link_digest(snapshot.link_target(id));
+                    break;
+                default:
+                    continue;
+            }
+            if (expected != entry.content) corrupt.push_back(id);
+        }
+        return corrupt.size() == before;
+    }
+
+    void merkle_diff(const Snapshot& stored, const Snapshot& live, const TreeChangeVisitor& visitor) {
+        std::vector<std::pair<files::PathId, files::PathId>> pending;
+        if (stored.entries[files::c_root_path].meta != live.entries[files::c_root_path].meta) {
+            pending.emplace_back(files::c_root_path, files::c_root_path);
+        }
+
+        while (!pending.empty()) {
+            auto [stored_directory, live_directory] = pending.back();
+            pending.pop_back();
+
+            auto stored_children = stored.children(stored_directory);
+            auto live_children = live.children(live_directory);
+            size_t s = 0;
+            size_t l = 0;
+            while (s < stored_children.size() || l < live_children.size()) {
+                int32_t order;
+                if (s == stored_children.size()) {
+                    order = 1;
+                } else if (l == live_children.size()) {
+                    order = -1;
+                } else {
+                    order = stored.paths.name(stored_children[s]).compare(live.paths.name(live_children[l]));
+                }
+
+                if (order < 0) {
+                    visitor(TreeChange::Removed, stored_children[s++], files::c_invalid_path);
+                    continue;
+                }
+                if (order > 0) {
+                    visitor(TreeChange::Added, files::c_invalid_path, live_children[l++]);
+                    continue;
+                }
+
+                files::PathId stored_id = stored_children[s++];
+                files::PathId live_id = live_children[l++];
+                const auto& stored_entry = stored.entries[stored_id];
+                const auto& live_entry = live.entries[live_id];
+                if (stored_entry.meta == live_entry.meta) continue;
+                if (stored_entry.type != live_entry.type) {
+                    visitor(TreeChange::Removed, stored_id, files::c_invalid_path);
+                    visitor(TreeChange::Added, files::c_invalid_path, live_id);
+                } else if (stored_entry.type == files::EntryType::Directory) {
+                    pending.emplace_back(stored_id, live_id);
+                } else {
+                    visitor(TreeChange::Changed, stored_id, live_id);
+                }
+            }
+        }
+    }
+}  // namespace backup
@@ -0,0 +1,114 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/pack.h"
+
+#include <cstdio>
+
+#include "hashing/crc32c.h"
+#include "utils/binary.h"
+#include "utils/hex.h"
+
+namespace backup {
+    static constexpr size_t c_pack_entry_size = 32 + 8 + 4 + 4 + 4;
+    static constexpr size_t c_pack_entry_size_v0 = 32 + 8 + 4 + 4;
+
+    bool PackWriter::open(const std::string& temporary_path) {
+        m_entries.clear();
+        m_temporary_path = temporary_path;
+        if (!m_file.open(temporary_path, files::FileMode::Write)) return false;
+        m_size = sizeof(c_pack_magic);
+        return m_file.write_all(c_pack_magic, sizeof(c_pack_magic));
+    }
+
+    bool PackWriter::append(const hashing::Digest& digest, const byte* data, size_t size, uint64_t& offset, uint32_t flags) {
+        if (!m_file.write_all(data, size)) return false;
+        offset = m_size;
+        m_entries.push_back({ digest, m_size, (uint32_t) size, flags | c_pack_entry_checksum, hashing::crc32c(data, size) });
+        m_size += size;
+        return true;
+    }
+
+    bool PackWriter::finish(const std::string& directory, std::string& id) {
+        std::vector<byte> tail;
+        tail.reserve(m_entries.size() * c_pack_entry_size + c_pack_footer_size);
+        BinaryWriter writer(tail);
+        for (const auto& entry : m_entries) {
+            writer.put(entry.digest);
+            writer.put(entry.offset);
+            writer.put(entry.length);
+            writer.put(entry.flags);
+            writer.put(entry.checksum);
+        }
+        hashing::Digest index_digest = hashing::Sha256::digest(tail.data(), tail.size());
+        writer.put((uint32_t) m_entries.size());
+        writer.put(c_pack_version);
+        writer.put(m_size);
+        writer.put(index_digest);
+        writer.put_bytes(c_pack_footer_magic, sizeof(c_pack_footer_magic));
+
+        if (!m_file.write_all(tail.data(), tail.size()) || !m_file.sync()) {
+            abort();
+            return false;
+        }
+        m_file.close();
+
+        id = to_hex(index_digest);
+        std::string path = directory + "/" + id + ".pack";
+        if (std::rename(m_temporary_path.c_str(), path.c_str()) != 0) {
+            abort();
+            return false;
+        }
+        m_entries.clear();
+        m_size = 0;
+        return files::sync_directory(directory);
+    }
+
+    void PackWriter::abort() {
+        m_file.close();
+        if (!m_temporary_path.empty()) std::remove(m_temporary_path.c_str());
+        m_entries.clear();
+        m_size = 0;
+    }
+
+    bool read_pack_index(const PackFile& file, std::vector<PackEntry>& entries, hashing::Digest* id) {
+        uint64_t size = file.size();
+        if (size < sizeof(c_pack_magic) + c_pack_footer_size) return false;
+
+        byte footer[c_pack_footer_size];
+        if (!file.read_exact_at(footer, sizeof(footer), size - sizeof(footer))) return false;
+        BinaryReader reader(footer, sizeof(footer));
+        auto count = reader.get<uint32_t>();
+        auto version = reader.get<uint32_t>();
+        auto index_offset = reader.get<uint64_t>();
+        auto index_digest = reader.get<hashing::Digest>();
+        char magic[8];
+        reader.get_bytes(magic, sizeof(magic));
+        if (reader.error() || std::memcmp(magic, c_pack_footer_magic, sizeof(magic)) != 0 || version > c_pack_version) return false;
+        size_t entry_size = version == 0 ? c_pack_entry_size_v0 : c_pack_entry_size;
+        if (index_offset + (uint64_t) count * entry_size + c_pack_footer_size != size) return false;
+
+        std::vector<byte> index((size_t) count * entry_size);
+        if (!file.read_exact_at(index.data(), index.size(), index_offset)) return false;
+        if (hashing::Sha256::digest(index.data(), index.size()) != index_digest) return false;
+
+        BinaryReader entry_reader(index.data(), index.size());
+        entries.resize(count);
+        for (auto& entry : entries) {
+            entry.digest = entry_reader.get<hashing::Digest>();
+            entry.offset = entry_reader.get<uint64_t>();
+            entry.length = entry_reader.get<uint32_t>();
+            entry.flags = entry_reader.get<uint32_t>();
+            if (version == 0) {
+                entry.flags &= ~c_pack_entry_checksum;
+                entry.checksum = 0;
+            } else {
+                entry.checksum = entry_reader.get<uint32_t>();
+            }
+            if (entry.offset + entry.length > index_offset) return false;
+        }
+        if (id) *id = index_digest;
+        return !entry_reader.error();
+    }
+}  // namespace backup
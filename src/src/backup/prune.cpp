@@ -0,0 +1,400 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/prune.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <sys/file.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "files/reader.h"
+#include "hashing/crc32c.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+#include "utils/hex.h"
+
+namespace backup {
+    static metrics::Counter& g_prune_packs = metrics::counter("fward_prune_packs_removed_total", "Packs prune deleted, rewritten or not.");
+    static metrics::Counter& g_prune_bytes = metrics::counter("fward_prune_freed_bytes_total", "Pack bytes prune gave back.");
+
+    //! One bit per entry of every pack loaded when marking started, the entries of a pack from its base
+    //! on. Entries past the last one the index points at are duplicates and never live.
+    class LiveBitmap {
+       public:
+        explicit LiveBitmap(const Repository& repository) {
+            std::vector<uint32_t> counts(repository.pack_count(), 0);
+            repository.for_each_chunk([&](const hashing::Digest&, const ChunkLocation& location) {
+                counts[location.pack] = std::max(counts[location.pack], location.entry + 1);
+            });
+            m_bases.resize(counts.size() + 1, 0);
+            for (size_t pack = 0; pack < counts.size(); ++pack) m_bases[pack + 1] = m_bases[pack] + counts[pack];
+            m_words.resize((m_bases.back() + 63) / 64, 0);
+        }
+
+        //! True when the bit wasn't set yet, and always for packs published since, which are never
+        //! deleted but may hold deltas on older chunks. Safe from several threads.
+        bool mark(const ChunkLocation& location) {
+            if (location.pack >= pack_count()) return true;
+            uint64_t bit = m_bases[location.pack] + location.entry;
+            uint64_t mask = 1ULL << (bit % 64);
+            return !(std::atomic_ref(m_words[bit / 64]).fetch_or(mask, std::memory_order_relaxed) & mask);
+        }
+        COMP_NO_DISCARD bool live(uint32_t pack, uint32_t entry) const {
+            uint64_t bit = m_bases[pack] + entry;
+            return bit < m_bases[pack + 1] && (m_words[bit / 64] >> (bit % 64)) & 1;
+        }
+        COMP_NO_DISCARD uint64_t live_count(uint32_t pack) const {
+            uint64_t count = 0;
+            for (uint64_t bit = m_bases[pack]; bit < m_bases[pack + 1]; ++bit) count += (m_words[bit / 64] >> (bit % 64)) & 1;
+            return count;
+        }
+        COMP_NO_DISCARD uint64_t total_live() const {
+            return std::accumulate(m_words.begin(), m_words.end(), (uint64_t) 0, [](uint64_t sum, uint64_t word) { return sum + std::popcount(word); });
+        }
+        COMP_NO_DISCARD uint32_t pack_count() const {
+            return (uint32_t) (m_bases.size() - 1);
+        }
+
+       private:
+        std::vector<uint64_t> m_bases;
+        std::vector<uint64_t> m_words;
+    };
+
+    struct SnapshotInfo {
+        std::string source;
+        int64_t time_ns = 0;
+        bool keep = true;
+    };
+
+    enum class PackAction : uint8_t { Keep, Delete, Repack };
+
+    struct PackPlan {
+        PackAction action = PackAction::Keep;
+        uint64_t file_size = 0;
+        uint64_t entries = 0;
+        uint64_t live_entries = 0;
+        uint64_t live_bytes = 0;
+    };
+
+    //! Loads `ids` at most `threads` at a time and hands each to `visit` on a worker. Stops at the first
+    //! snapshot that can't be loaded, as there is no telling which chunks it uses.
+    static bool for_each_snapshot(const Repository& repository, const std::vector<std::string>& ids, uint32_t threads, tasks::Priority priority,
+                                  const std::function<void(size_t, const Snapshot&)>& visit) {
+        tasks::TaskGroup group(priority);
+        if (threads == 0) threads = group.scheduler().worker_count();
+        std::atomic<size_t> next = 0;
+        std::atomic<bool> failed = false;
+        std::function<void()> load_next = [&]() {
+            size_t index = next++;
+            if (index >= ids.size()) return;
+            Snapshot snapshot;
+            if (!repository.load_snapshot(ids[index], snapshot)) {
+                ERROR("Snapshot {} is missing or damaged.", ids[index]);
+                failed = true;
+                group.cancel();
+                return;
+            }
+            visit(index, snapshot);
+            group.run(load_next);
+        };
+        for (uint32_t i = 0; i < threads && i < ids.size(); ++i) group.run(load_next);
+        group.wait();
+        return !failed;
+    }
+
+    //! Per source the newest `keep_last`, everything within `keep_within` and always the newest one.
+    static void apply_retention(std::vector<SnapshotInfo>& snapshots, const PruneOptions& options) {
+        if (options.keep_last == 0 && options.keep_within.count() == 0) return;
+        int64_t cutoff = std::numeric_limits<int64_t>::max();
+        if (options.keep_within.count() > 0) {
+            auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());
+            cutoff = (now - std::chrono::duration_cast<std::chrono::nanoseconds>(options.keep_within)).count();
+        }
+        std::vector<size_t> order(snapshots.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return snapshots[a].time_ns > snapshots[b].time_ns; });
+        std::unordered_map<std::string, uint32_t> ranks;
+        for (size_t index : order) {
+            auto& snapshot = snapshots[index];
+            uint32_t rank = ranks[snapshot.source]++;
+            snapshot.keep = rank == 0 || rank < options.keep_last || snapshot.time_ns >= cutoff;
+        }
+    }
+
+    //! Marks the chunks of `snapshot`, collecting the deltas among them that weren't marked before.
+    static void mark_snapshot(const Repository& repository, const Snapshot& snapshot, LiveBitmap& live, std::vector<hashing::Digest>& deltas,
+                              uint64_t& missing) {
+        ChunkLocation location {};
+        for (const auto& chunk : snapshot.chunks) {
+            if (!repository.locate(chunk.digest, location)) {
+                missing++;
+                continue;
+            }
+            if (live.mark(location) && (location.flags & c_pack_entry_delta)) deltas.push_back(chunk.digest);
+        }
+    }
+
+    //! Marks the bases behind `deltas`, and theirs, until every chain ends in a full chunk. A delta that
+    //! can't be read fails the prune: its base might be needed, and nothing else says which it is.
+    static bool mark_bases(const Repository& repository, std::vector<hashing::Digest> deltas, LiveBitmap& live, uint64_t& missing) {
+        TRACE_ZONE("prune.bases");
+        std::vector<hashing::Digest> next;
+        ChunkLocation location {};
+        hashing::Digest base {};
+        while (!deltas.empty()) {
+            for (const auto& digest : deltas) {
+                if (!repository.read_delta_base(digest, base)) {
+                    ERROR("Delta {} can't be read, so its base is unknown.", to_hex(digest));
+                    return false;
+                }
+                if (!repository.locate(base, location)) {
+                    missing++;
+                    continue;
+                }
+                if (live.mark(location) && (location.flags & c_pack_entry_delta)) next.push_back(base);
+            }
+            deltas.swap(next);
+            next.clear();
+        }
+        return true;
+    }
+
+    //! Decides per pack whether to keep, delete or rewrite it, from its index and the live entries.
+    static bool plan_packs(const Repository& repository, const LiveBitmap& live, double repack_below, std::vector<PackPlan>& plans) {
+        TRACE_ZONE("prune.sweep");
+        plans.assign(live.pack_count(), {});
+        std::vector<PackEntry> entries;
+        for (uint32_t pack = 0; pack < live.pack_count(); ++pack) {
+            PackFile file;
+            if (!repository.open_pack(pack, file) || !read_pack_index(file, entries)) {
+                ERROR("Pack {} can't be read any more.", repository.pack_id(pack));
+                return false;
+            }
+            auto& plan = plans[pack];
+            plan.file_size = file.size();
+            plan.entries = entries.size();
+            uint64_t bytes = 0;
+            for (uint32_t i = 0; i < entries.size(); ++i) {
+                bytes += entries[i].length;
+                if (!live.live(pack, i)) continue;
+                plan.live_entries++;
+                plan.live_bytes += entries[i].length;
+            }
+            if (plan.live_entries == 0) {
+                plan.action = PackAction::Delete;
+            } else if ((double) plan.live_bytes < repack_below * (double) bytes) {
+                plan.action = PackAction::Repack;
+            }
+        }
+        return true;
+    }
+
+    //! Whether the stored bytes of an entry are still what was written.
+    static bool entry_intact(const PackEntry& entry, std::span<const byte> data) {
+        if (data.size() != entry.length) return false;
+        if (entry.flags & c_pack_entry_checksum) return hashing::crc32c(data.data(), data.size()) == entry.checksum;
+        // Version 0 entries only have their digest, which a delta doesn't hash to.
+        return (entry.flags & c_pack_entry_delta) || hashing::Sha256::digest(data.data(), data.size()) == entry.digest;
+    }
+
+    //! Copies the live entries of the packs planned for a rewrite into new packs. A pack with a damaged
+    //! live entry is kept instead, so the damage stays where verify reports it.
+    static bool repack(const Repository& repository, const LiveBitmap& live, std::vector<PackPlan>& plans, PruneStats& stats,
+                       uint64_t& bytes_written) {
+        TRACE_ZONE("prune.repack");
+        PackWriter writer;
+        uint32_t written = 0;
+        auto finish = [&]() {
+            if (!writer.is_open()) return true;
+            if (writer.entries().empty()) {
+                writer.abort();
+                return true;
+            }
+            std::string id;
+            std::error_code error;
+            if (!writer.finish(repository.path() + "/packs", id)) return false;
+            stats.packs_written++;
+            bytes_written += std::filesystem::file_size(repository.path() + "/packs/" + id + ".pack", error);
+            repository.stripe_pack(id);
+            return true;
+        };
+
+        std::vector<PackEntry> entries;
+        std::vector<byte> buffer;
+        files::ReadOptions read_options;
+        read_options.immutable = true;
+        for (uint32_t pack = 0; pack < plans.size(); ++pack) {
+            auto& plan = plans[pack];
+            if (plan.action != PackAction::Repack) continue;
+            PackFile file;
+            files::Reader reader;
+            if (!repository.open_pack(pack, file) || !read_pack_index(file, entries) ||
+                (!file.sharded() && !reader.open(repository.pack_path(pack), read_options))) {
+                plan.action = PackAction::Keep;
+                continue;
+            }
+            for (uint32_t i = 0; i < entries.size() && plan.action == PackAction::Repack; ++i) {
+                if (!live.live(pack, i)) continue;
+                const auto& entry = entries[i];
+                std::span<const byte> data;
+                bool read;
+                if (file.sharded()) {
+                    // Shards hold a pack in pieces, so entries are read one by one through their checks.
+                    buffer.resize(entry.length);
+                    read = file.read_exact_at(buffer.data(), buffer.size(), entry.offset);
+                    data = buffer;
+                } else {
+                    read = reader.view(entry.offset, entry.length, data);
+                }
+                if (!read || !entry_intact(entry, data)) {
+                    WARN("Chunk {} in pack {} is damaged, keeping the pack.", to_hex(entry.digest), repository.pack_id(pack));
+                    plan.action = PackAction::Keep;
+                    break;
+                }
+                if (!writer.is_open() && !writer.open(FORMAT("{}/packs/.pending-{}-prune-{}", repository.path(), (int64_t) ::getpid(), written++))) {
+                    return false;
+                }
+                uint64_t offset = 0;
+                // Flags move along, the checksum is computed anew; old entries gain one this way.
+                if (!writer.append(entry.digest, data.data(), data.size(), offset, entry.flags & ~c_pack_entry_checksum)) {
+                    writer.abort();
+                    return false;
+                }
+                if (writer.size() >= c_pack_target_size && !finish()) return false;
+            }
+        }
+        return finish();
+    }
+
+    //! Under the exclusive lock: marks what was saved since the mark, spares every pack that gained a
+    //! live entry through it and deletes the rest of the plan.
+    static bool collect(Repository& repository, const std::vector<std::string>& marked_packs, const std::vector<std::string>& considered,
+                        const std::vector<std::string>& forgotten, LiveBitmap& live, std::vector<PackPlan>& plans, PruneStats& stats) {
+        TRACE_ZONE("prune.delete");
+        for (uint32_t pack = 0; pack < marked_packs.size(); ++pack) {
+            if (pack >= repository.pack_count() || repository.pack_id(pack) != marked_packs[pack]) {
+                ERROR("Packs were removed while pruning, nothing deleted.");
+                return false;
+            }
+        }
+
+        std::unordered_set<std::string> known(considered.begin(), considered.end());
+        std::vector<hashing::Digest> deltas;
+        for (const auto& id : repository.snapshot_ids()) {
+            if (known.contains(id)) continue;
+            Snapshot snapshot;
+            if (!repository.load_snapshot(id, snapshot)) {
+                ERROR("Snapshot {} is missing or damaged.", id);
+                return false;
+            }
+            mark_snapshot(repository, snapshot, live, deltas, stats.chunks_missing);
+        }
+        if (!mark_bases(repository, std::move(deltas), live, stats.chunks_missing)) return false;
+
+        std::error_code error;
+        for (const auto& id : forgotten) std::filesystem::remove(repository.path() + "/snapshots/" + id + ".snap", error);
+        files::sync_directory(repository.path() + "/snapshots");
+
+        for (uint32_t pack = 0; pack < plans.size(); ++pack) {
+            auto& plan = plans[pack];
+            if (plan.action == PackAction::Keep) continue;
+            if (live.live_count(pack) != plan.live_entries) {
+                plan.action = PackAction::Keep;
+                continue;
+            }
+            if (!repository.remove_pack(pack)) continue;
+            (plan.action == PackAction::Delete ? stats.packs_removed : stats.packs_repacked)++;
+            stats.chunks_removed += plan.entries - plan.live_entries;
+            stats.bytes_freed += plan.file_size;
+            g_prune_packs.add();
+        }
+
+        // With the lock held no backup is running, so pending packs are what crashed ones left behind.
+        for (const auto& item : std::filesystem::directory_iterator(repository.path() + "/packs", error)) {
+            if (item.path().filename().string().starts_with(".pending-")) std::filesystem::remove(item.path(), error);
+        }
+        remove_stale_shards(repository.shard_layout());
+        return files::sync_directory(repository.path() + "/packs");
+    }
+
+    bool run_prune(Repository& repository, const PruneOptions& options, PruneStats& stats) {
+        TRACE_ZONE("prune");
+        files::File prune_lock;
+        if (!prune_lock.open(repository.path() + "/prune.lock", files::FileMode::ReadWrite) ||
+            ::flock(prune_lock.descriptor(), LOCK_EX | LOCK_NB) != 0) {
+            ERROR("Another prune is running on '{}'.", repository.path());
+            return false;
+        }
+        if (!repository.lock(false)) return false;
+        // Every return releases the lock, shared or exclusive, so a failed prune blocks no backup.
+        struct LockRelease {
+            Repository& repository;
+            ~LockRelease() {
+                repository.unlock();
+            }
+        } lock_release { repository };
+
+        std::vector<std::string> ids = repository.snapshot_ids();
+        std::vector<SnapshotInfo> snapshots(ids.size());
+        bool loaded = for_each_snapshot(repository, ids, options.threads, options.priority, [&](size_t index, const Snapshot& snapshot) {
+            snapshots[index].source = snapshot.source;
+            snapshots[index].time_ns = snapshot.time_ns;
+        });
+        if (!loaded) return false;
+        apply_retention(snapshots, options);
+        std::vector<std::string> kept, forgotten;
+        for (size_t i = 0; i < ids.size(); ++i) (snapshots[i].keep ? kept : forgotten).push_back(ids[i]);
+        stats.snapshots_kept = kept.size();
+        stats.snapshots_removed = forgotten.size();
+
+        LiveBitmap live(repository);
+        std::vector<std::string> marked_packs;
+        for (uint32_t pack = 0; pack < live.pack_count(); ++pack) marked_packs.push_back(repository.pack_id(pack));
+        std::vector<hashing::Digest> deltas;
+        std::mutex mutex;
+        {
+            TRACE_ZONE("prune.mark");
+            loaded = for_each_snapshot(repository, kept, options.threads, options.priority, [&](size_t, const Snapshot& snapshot) {
+                std::vector<hashing::Digest> found;
+                uint64_t missing = 0;
+                mark_snapshot(repository, snapshot, live, found, missing);
+                std::lock_guard lock(mutex);
+                deltas.insert(deltas.end(), found.begin(), found.end());
+                stats.chunks_missing += missing;
+            });
+        }
+        if (!loaded || !mark_bases(repository, std::move(deltas), live, stats.chunks_missing)) return false;
+
+        std::vector<PackPlan> plans;
+        if (!plan_packs(repository, live, options.repack_below, plans)) return false;
+        if (options.dry_run) {
+            for (const auto& plan : plans) {
+                if (plan.action == PackAction::Keep) continue;
+                (plan.action == PackAction::Delete ? stats.packs_removed : stats.packs_repacked)++;
+                stats.chunks_removed += plan.entries - plan.live_entries;
+                stats.bytes_freed += plan.file_size - plan.live_bytes;
+            }
+            stats.chunks_live = live.total_live();
+            return true;
+        }
+
+        // Written before the exclusive lock, so backups only wait for the deletes.
+        uint64_t bytes_written = 0;
+        if (!repack(repository, live, plans, stats, bytes_written) || !repository.lock(true)) return false;
+        bool collected = collect(repository, marked_packs, ids, forgotten, live, plans, stats);
+        stats.bytes_freed -= std::min(stats.bytes_freed, bytes_written);
+        stats.chunks_live = live.total_live();
+        g_prune_bytes.add(stats.bytes_freed);
+        return collected;
+    }
+}  // namespace backup
@@ -0,0 +1,415 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/repository.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <sys/file.h>
+#include <unistd.h>
+#include <unordered_set>
+
+#include "backup/delta.h"
+#include "files/external_sort.h"
+#include "hashing/crc32c.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+#include "utils/hex.h"
+
+namespace backup {
+    static constexpr std::string_view c_config = "fward-repository 1\n";
+    //! The cache is rewritten once the entries it lacks are this share of the index.
+    static constexpr size_t c_index_cache_lag = 16;
+
+    static metrics::Counter& g_checksum_errors = metrics::counter("fward_chunk_checksum_errors_total", "Stored chunks read back with a bad checksum.");
+
+    Repository::~Repository() {
+        if (m_writer.is_open()) m_writer.abort();
+        wait_striping();
+    }
+
+    bool Repository::create(const std::string& path) {
+        std::error_code error;
+        std::filesystem::create_directories(path + "/packs", error);
+        if (error) return false;
+        std::filesystem::create_directories(path + "/snapshots", error);
+        if (error) return false;
+        if (std::filesystem::exists(path + "/config")) return true;
+        return files::write_file_atomic(path + "/config", c_config.data(), c_config.size());
+    }
+
+    bool Repository::open(const std::string& path) {
+        std::vector<byte> config;
+        if (!files::read_whole_file(path + "/config", config)) return false;
+        if (std::string_view((const char*) config.data(), config.size()) != c_config) return false;
+
+        // The striping thread reads the layout.
+        wait_striping();
+        if (!load_shard_layout(path, m_layout)) return false;
+        m_path = path;
+        clear_index();
+        return refresh();
+    }
+
+    void Repository::clear_index() {
+        m_packs.clear();
+        m_index.clear();
+        m_unreadable_packs.clear();
+        std::lock_guard lock(m_files_mutex);
+        m_files.clear();
+    }
+
+    bool Repository::refresh() {
+        ASSERT_EX(!m_writer.is_open(), "Refresh while a pack is being written.");
+        std::vector<std::string> present;
+        std::error_code error;
+        for (const auto& item : std::filesystem::directory_iterator(m_path + "/packs", error)) {
+            if (item.path().extension() == ".pack") present.push_back(item.path().stem().string());
+        }
+        if (error) return false;
+        if (m_layout.enabled()) {
+            // A pack interrupted while being striped is in both places.
+            std::unordered_set<std::string> whole(present.begin(), present.end());
+            for (auto& id : list_sharded_packs(m_layout)) {
+                if (!whole.contains(id)) present.push_back(std::move(id));
+            }
+        }
+
+        std::unordered_set<std::string> known(m_packs.begin(), m_packs.end());
+        known.insert(m_unreadable_packs.begin(), m_unreadable_packs.end());
+        std::unordered_set<std::string> listed(present.begin(), present.end());
+        if (std::any_of(known.begin(), known.end(), [&](const std::string& id) { return !listed.contains(id); })) {
+            clear_index();
+            known.clear();
+        }
+        if (known.empty()) {
+            std::vector<std::string> cached;
+            if (m_index.load(m_path + "/index", cached) && std::all_of(cached.begin(), cached.end(), [&](const std::string& id) { return listed.contains(id); })) {
+                m_packs = std::move(cached);
+                known.insert(m_packs.begin(), m_packs.end());
+            } else if (files::memory_budget() && !present.empty() && rebuild_index(present)) {
+                known.insert(m_packs.begin(), m_packs.end());
+                known.insert(m_unreadable_packs.begin(), m_unreadable_packs.end());
+            } else {
+                // Without a budget, or where the cache can't be written, the packs are read into memory.
+                m_index.clear();
+            }
+        }
+        for (const auto& id : present) {
+            if (known.contains(id)) continue;
+            if (!load_pack(id)) m_unreadable_packs.push_back(id);
+        }
+        update_index_cache();
+        return true;
+    }
+
+    void Repository::update_index_cache() {
+        if (m_index.recent_count() * c_index_cache_lag <= m_index.size()) return;
+        // Only published packs can be named in the cache.
+        if (std::any_of(m_packs.begin(), m_packs.end(), [](const std::string& id) { return id.empty(); })) return;
+        // Best effort; without it the next open reads more pack indexes.
+        m_index.save(m_path + "/index", m_packs);
+    }
+
+    bool Repository::lock(bool exclusive) {
+        if (!m_lock.is_open() && !m_lock.open(m_path + "/lock", files::FileMode::ReadWrite) &&
+            !m_lock.open(m_path + "/lock", files::FileMode::Read)) {
+            return !exclusive && refresh();
+        }
+        while (::flock(m_lock.descriptor(), exclusive ? LOCK_EX : LOCK_SH) != 0) {
+            if (errno != EINTR) return false;
+        }
+        return refresh();
+    }
+
+    void Repository::unlock() {
+        m_lock.close();
+    }
+
+    bool Repository::open_pack(const std::string& id, PackFile& file) const {
+        if (file.open(m_path + "/packs/" + id + ".pack")) return true;
+        return m_layout.enabled() && file.open(m_layout, id);
+    }
+
+    bool Repository::open_pack(uint32_t pack, PackFile& file) const {
+        if (m_packs[pack].empty()) return file.open(m_pending_path);
+        return open_pack(m_packs[pack], file);
+    }
+
+    bool Repository::load_pack(const std::string& id) {
+        PackFile file;
+        std::vector<PackEntry> entries;
+        if (!open_pack(id, file) || !read_pack_index(file, entries)) return false;
+
+        auto pack = (uint32_t) m_packs.size();
+        m_packs.push_back(id);
+        for (uint32_t i = 0; i < entries.size(); ++i) {
+            const auto& entry = entries[i];
+            m_index.insert(entry.digest, ChunkLocation { pack, entry.length, entry.offset, entry.flags, entry.checksum, i });
+        }
+        return true;
+    }
+
+    bool Repository::rebuild_index(const std::vector<std::string>& present) {
+        std::vector<std::string> packs;
+        std::vector<std::string> unreadable;
+        bool rebuilt = m_index.rebuild(m_path + "/index", [&](const ChunkIndex::AddEntry& add) {
+            std::vector<PackEntry> entries;
+            for (const auto& id : present) {
+                PackFile file;
+                if (!open_pack(id, file) || !read_pack_index(file, entries)) {
+                    unreadable.push_back(id);
+                    continue;
+                }
+                auto pack = (uint32_t) packs.size();
+                packs.push_back(id);
+                for (uint32_t i = 0; i < entries.size(); ++i) {
+                    const auto& entry = entries[i];
+                    if (!add(entry.digest, ChunkLocation { pack, entry.length, entry.offset, entry.flags, entry.checksum, i })) return false;
+                }
+            }
+            return true;
+        }, packs);
+        if (!rebuilt) return false;
+        m_packs = std::move(packs);
+        m_unreadable_packs = std::move(unreadable);
+        return true;
+    }
+
+    std::string Repository::pack_path(uint32_t pack) const {
+        if (m_packs[pack].empty()) return m_pending_path;
+        return m_path + "/packs/" + m_packs[pack] + ".pack";
+    }
+
+    bool Repository::locate(const hashing::Digest& digest, ChunkLocation& location) const {
+        return m_index.find(digest, location);
+    }
+
+    bool Repository::remove_pack(uint32_t pack) {
+        {
+            std::lock_guard lock(m_files_mutex);
+            m_files.erase(pack);
+        }
+        bool removed = std::remove(pack_path(pack).c_str()) == 0;
+        if (m_layout.enabled() && remove_shards(m_layout, m_packs[pack])) removed = true;
+        return removed;
+    }
+
+    bool Repository::stripe_pack(const std::string& id) const {
+        std::vector<byte> buffer;
+        return stripe_pack(id, buffer);
+    }
+
+    bool Repository::stripe_pack(const std::string& id, std::vector<byte>& buffer) const {
+        std::string path = m_path + "/packs/" + id + ".pack";
+        if (!m_layout.enabled() || !std::filesystem::exists(path)) return true;
+        if (!write_shards(m_layout, path, id, buffer)) {
+            WARN("Could not stripe pack {}, keeping it whole.", id);
+            return false;
+        }
+        // The shards are synced, so the pack can go; until then it was readable from either.
+        std::remove(path.c_str());
+        files::sync_directory(m_path + "/packs");
+        return true;
+    }
+
+    bool Repository::open_pack_file(uint32_t pack, PackFile*& file) const {
+        auto it = m_files.find(pack);
+        if (it == m_files.end()) {
+            PackFile opened;
+            if (!open_pack(pack, opened)) return false;
+            it = m_files.emplace(pack, std::move(opened)).first;
+        }
+        file = &it->second;
+        return true;
+    }
+
+    bool Repository::read_stored(const ChunkLocation& location, std::vector<byte>& out) const {
+        PackFile* file = nullptr;
+        {
+            std::lock_guard lock(m_files_mutex);
+            if (!open_pack_file(location.pack, file)) return false;
+        }
+        out.resize(location.length);
+        if (!file->read_exact_at(out.data(), location.length, location.offset)) return false;
+        // Much cheaper than rehashing, so damaged or misplaced data is caught before anyone uses it.
+        if ((location.flags & c_pack_entry_checksum) && hashing::crc32c(out.data(), out.size()) != location.checksum) {
+            g_checksum_errors.add();
+            WARN("Chunk at offset {} of pack {} fails its checksum.", location.offset, pack_path(location.pack));
+            return false;
+        }
+        return true;
+    }
+
+    bool Repository::read_chunk(const hashing::Digest& digest, std::vector<byte>& out) const {
+        ChunkLocation location {};
+        if (!locate(digest, location) || !read_stored(location, out)) return false;
+        if (!(location.flags & c_pack_entry_delta)) return true;
+
+        // Walk down to the full chunk first, then apply the deltas on the way back up.
+        std::vector<std::vector<byte>> chain;
+        chain.push_back(std::move(out));
+        hashing::Digest base {};
+        while (true) {
+            if (chain.size() > c_max_delta_depth || !delta_base(chain.back().data(), chain.back().size(), base)) return false;
+            if (!locate(base, location)) return false;
+            std::vector<byte> stored;
+            if (!read_stored(location, stored)) return false;
+            if (!(location.flags & c_pack_entry_delta)) {
+                out = std::move(stored);
+                break;
+            }
+            chain.push_back(std::move(stored));
+        }
+        std::vector<byte> rebuilt;
+        for (size_t i = chain.size(); i-- > 0;) {
+            if (!delta_apply(out.data(), out.size(), chain[i].data(), chain[i].size(), rebuilt)) return false;
+            std::swap(out, rebuilt);
+        }
+        return true;
+    }
+
+    bool Repository::read_delta_base(const hashing::Digest& digest, hashing::Digest& base) const {
+        ChunkLocation location {};
+        std::vector<byte> stored;
+        if (!locate(digest, location) || !(location.flags & c_pack_entry_delta) || !read_stored(location, stored)) return false;
+        return delta_base(stored.data(), stored.size(), base);
+    }
+
+    uint32_t Repository::delta_depth(const hashing::Digest& digest) const {
+        ChunkLocation location {};
+        if (!m_index.find(digest, location)) return 0;
+        return (location.flags >> c_pack_delta_depth_shift) & 0xFF;
+    }
+
+    bool Repository::append(const hashing::Digest& digest, const byte* data, size_t size, uint32_t flags) {
+        if (!m_writer.is_open()) {
+            m_pending_path = FORMAT("{}/packs/.pending-{}-{}", m_path, (int64_t) ::getpid(), m_packs.size());
+            if (!m_writer.open(m_pending_path)) return false;
+            m_packs.emplace_back();
+        }
+        uint64_t offset = 0;
+        if (!m_writer.append(digest, data, size, offset, flags)) return false;
+        const PackEntry& entry = m_writer.entries().back();
+        m_index.insert(digest, ChunkLocation { (uint32_t) (m_packs.size() - 1), entry.length, offset, entry.flags, entry.checksum,
+                                                (uint32_t) (m_writer.entries().size() - 1) });
+
+        if (m_writer.size() >= c_pack_target_size) return finish_pack();
+        return true;
+    }
+
+    bool Repository::store_chunk(const hashing::Digest& digest, const byte* data, size_t size, bool& added) {
+        added = false;
+        if (m_index.contains(digest)) return true;
+        added = true;
+        return append(digest, data, size, 0);
+    }
+
+    bool Repository::store_delta(const hashing::Digest& digest, const byte* delta, size_t size, bool& added) {
+        added = false;
+        if (m_index.contains(digest)) return true;
+        hashing::Digest base {};
+        if (!delta_base(delta, size, base) || !m_index.contains(base)) return false;
+        uint32_t depth = delta_depth(base) + 1;
+        ASSERT_EX(depth <= c_max_delta_depth, "Delta chain too deep.");
+        added = true;
+        return append(digest, delta, size, c_pack_entry_delta | depth << c_pack_delta_depth_shift);
+    }
+
+    bool Repository::flush() {
+        bool finished = finish_pack();
+        wait_striping();
+        return finished;
+    }
+
+    bool Repository::finish_pack() {
+        if (!m_writer.is_open()) return true;
+        TRACE_ZONE("pack.finish");
+        auto pack = (uint32_t) (m_packs.size() - 1);
+        {
+            std::lock_guard lock(m_files_mutex);
+            m_files.erase(pack);
+        }
+        if (m_writer.entries().empty()) {
+            m_writer.abort();
+            m_packs.pop_back();
+            return true;
+        }
+        if (!m_writer.finish(m_path + "/packs", m_packs[pack])) return false;
+        if (m_layout.enabled()) stripe_later(m_packs[pack]);
+        return true;
+    }
+
+    void Repository::stripe_later(const std::string& id) {
+        // One pack at a time: with slow disks the backup waits here rather than piling packs up.
+        wait_striping();
+        // A pack that couldn't be striped is still safe where it is; the shards command retries it.
+        m_striper = std::thread([this, id]() { stripe_pack(id, m_stripe_buffer); });
+    }
+
+    void Repository::wait_striping() {
+        if (m_striper.joinable()) m_striper.join();
+    }
+
+    bool Repository::save_snapshot(Snapshot& snapshot) {
+        std::string root = to_hex(snapshot.entries[files::c_root_path].content).substr(0, 12);
+        std::vector<byte> data;
+        while (true) {
+            // Fixed width down to the nanosecond, so ids sort like their times.
+            std::time_t seconds = (std::time_t) (snapshot.time_ns / 1000000000);
+            std::tm utc {};
+            gmtime_r(&seconds, &utc);
+            char stamp[32];
+            std::strftime(stamp, sizeof(stamp), "%Y%m%dT%H%M%S", &utc);
+            char id[64];
+            std::snprintf(id, sizeof(id), "%s.%09lldZ-%s", stamp, (long long) (snapshot.time_ns % 1000000000), root.c_str());
+            snapshot.id = id;
+
+            serialize_snapshot(snapshot, data);
+            if (files::write_file_exclusive(m_path + "/snapshots/" + snapshot.id + ".snap", data.data(), data.size())) return true;
+            if (errno != EEXIST) return false;
+            snapshot.time_ns++;
+        }
+    }
+
+    bool Repository::load_snapshot(const std::string& id, Snapshot& snapshot) const {
+        std::vector<byte> data;
+        if (!files::read_whole_file(m_path + "/snapshots/" + id + ".snap", data)) return false;
+        return deserialize_snapshot(data.data(), data.size(), snapshot);
+    }
+
+    std::vector<std::string> Repository::snapshot_ids() const {
+        std::vector<std::string> ids;
+        std::error_code error;
+        for (const auto& item : std::filesystem::directory_iterator(m_path + "/snapshots", error)) {
+            if (item.path().extension() == ".snap") ids.push_back(item.path().stem().string());
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+
+    std::string Repository::latest_snapshot_id() const {
+        //! Enough for the magic, the id, the source path and the time.
+        static constexpr size_t c_header_size = 8 * 1024;
+        std::string latest;
+        int64_t latest_ns = INT64_MIN;
+        std::vector<byte> header(c_header_size);
+        for (const auto& id : snapshot_ids()) {
+            files::File file;
+            int64_t time_ns = 0;
+            if (!file.open(m_path + "/snapshots/" + id + ".snap", files::FileMode::Read)) continue;
+            int64_t read = file.read_at(header.data(), header.size(), 0);
+            if (read <= 0 || !peek_snapshot_time(header.data(), (size_t) read, time_ns)) continue;
+            // Ids sort by time as well, so ties go to the later id.
+            if (time_ns >= latest_ns) {
+                latest = id;
+                latest_ns = time_ns;
+            }
+        }
+        return latest;
+    }
+}  // namespace backup
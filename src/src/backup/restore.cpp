@@ -0,0 +1,242 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/restore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/stat.h>
+#include <tuple>
+#include <unistd.h>
+
+#include "backup/backup.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+#include "tasks/scheduler.h"
+
+namespace backup {
+    static metrics::Counter& g_restore_files = metrics::counter("fward_restore_files_total", "Files restored.");
+    static metrics::Counter& g_restore_bytes = metrics::counter("fward_restore_written_bytes_total", "Bytes written by restore.");
+    static metrics::Counter& g_restore_errors = metrics::counter("fward_restore_errors_total", "Entries that could not be restored.");
+    static metrics::Counter& g_restore_batches = metrics::counter("fward_restore_small_batches_total", "Batches of small files restored together.");
+
+    //! A batch of small files ends at whichever of these it reaches first.
+    static constexpr uint64_t c_batch_bytes = 4 * 1024 * 1024;
+    static constexpr size_t c_batch_files = 1024;
+
+    static void mtime_times(const SnapshotEntry& entry, struct timespec (&times)[2]) {
+        times[0].tv_sec = times[1].tv_sec = (time_t) (entry.mtime_ns / 1000000000);
+        times[0].tv_nsec = times[1].tv_nsec = (long) (entry.mtime_ns % 1000000000);
+    }
+
+    //! Writes the file `name` in `directory`, an open directory or AT_FDCWD, and sets its mode and
+    //! mtime through the same descriptor. A symlink in its place is replaced, never written through.
+    //! `path` is for messages.
+    static bool restore_file(const Repository& repository, const Snapshot& snapshot, files::PathId id, int32_t directory, const std::string& name,
+                             const std::string& path, std::vector<byte>& data, uint64_t& written) {
+        TRACE_ZONE("restore.file");
+        const auto& entry = snapshot.entries[id];
+        files::File file;
+        if (!file.create_at(directory, name)) return false;
+        // Allocated in one go, so the filesystem can lay the file out in one extent.
+        if (entry.size > c_small_file_size) file.reserve(entry.size);
+        for (const auto& chunk : snapshot.chunks_of(id)) {
+            if (!repository.read_chunk(chunk.digest, data) || hashing::Sha256::digest(data.data(), data.size()) != chunk.digest) {
+                ERROR("Chunk of '{}' is missing or damaged.", path);
+                return false;
+            }
+            if (!file.write_all(data.data(), data.size())) return false;
+            written += data.size();
+            g_restore_bytes.add(data.size());
+        }
+        struct timespec times[2];
+        mtime_times(entry, times);
+        ::fchmod(file.descriptor(), entry.mode & 07777);
+        ::futimens(file.descriptor(), times);
+        return true;
+    }
+
+    static void restore_attributes(const SnapshotEntry& entry, const std::string& path) {
+        struct timespec times[2];
+        mtime_times(entry, times);
+        if (entry.type == files::EntryType::Symlink) {
+            ::utimensat(AT_FDCWD, path.c_str(), times, AT_SYMLINK_NOFOLLOW);
+            return;
+        }
+        files::File directory;
+        if (!directory.open(path, files::FileMode::Directory)) return;
+        ::fchmod(directory.descriptor(), entry.mode & 07777);
+        ::futimens(directory.descriptor(), times);
+    }
+
+    bool run_restore(const Repository& repository, const Snapshot& snapshot, const std::string& target, RestoreStats& stats) {
+        std::error_code error;
+        std::filesystem::create_directories(target, error);
+        if (error) return false;
+
+        // The target itself may be reached through symlinks, that's the caller's choice; nothing below it is.
+        std::string root = std::filesystem::canonical(target, error).string();
+        if (error) return false;
+        std::string path;
+        auto destination = [&](files::PathId id) {
+            path = root;
+            if (id != files::c_root_path) path += snapshot.paths.path(id);
+            return path;
+        };
+
+        // Entries are created relative to their parent directory, which is only ever opened without
+        // following symlinks. A directory whose place in the target holds anything but a real directory
+        // is rejected together with everything below it, so nothing is written outside the target.
+        std::vector<bool> skipped(snapshot.entries.size(), false);
+        files::File parent_directory;
+        files::PathId parent_id = files::c_invalid_path;
+        auto enter_parent = [&](files::PathId parent) {
+            if (parent != parent_id) {
+                parent_id = parent;
+                std::string directory = root;
+                if (parent != files::c_root_path) directory += snapshot.paths.path(parent);
+                if (!parent_directory.open(directory, files::FileMode::Directory)) parent_directory.close();
+            }
+            return parent_directory.is_open();
+        };
+
+        // File contents are written by tasks while the pass goes on; their directories exist by then.
+        tasks::TaskGroup group(tasks::Priority::Foreground);
+        std::atomic<uint64_t> bytes_written = 0;
+        std::atomic<uint64_t> file_errors = 0;
+        auto failed = [&](const std::string& path) {
+            ERROR("Could not restore '{}'.", path);
+            file_errors.fetch_add(1, std::memory_order_relaxed);
+            g_restore_errors.add();
+        };
+
+        // Small files of one directory are restored by one task: the directory is opened once and the
+        // files are created relative to it, in the order their chunks lie in the packs. The scanner
+        // lists a directory in one go, so its files have consecutive ids.
+        std::vector<files::PathId> batch;
+        uint64_t batch_bytes = 0;
+        auto run_batch = [&]() {
+            if (batch.empty()) return;
+            group.run([&, ids = std::move(batch)]() {
+                TRACE_ZONE("restore.batch");
+                files::PathId parent = snapshot.paths.parent(ids.front());
+                std::string directory = root;
+                if (parent != files::c_root_path) directory += snapshot.paths.path(parent);
+                // Files without chunks or whose chunk can't be found go first; they fail or are empty.
+                std::vector<std::tuple<uint32_t, uint64_t, files::PathId>> order;
+                order.reserve(ids.size());
+                for (files::PathId id : ids) {
+                    ChunkLocation location {};
+                    auto chunks = snapshot.chunks_of(id);
+                    if (chunks.empty() || !repository.locate(chunks.front().digest, location)) location = {};
+                    order.emplace_back(location.pack, location.offset, id);
+                }
+                std::sort(order.begin(), order.end());
+
+                files::File dir;
+                bool opened = dir.open(directory, files::FileMode::Directory);
+                std::vector<byte> data;
+                uint64_t written = 0;
+                for (const auto& [pack, offset, id] : order) {
+                    std::string name(snapshot.paths.name(id));
+                    if (!opened || !restore_file(repository, snapshot, id, dir.descriptor(), name, directory + "/" + name, data, written)) {
+                        failed(directory + "/" + name);
+                    }
+                }
+                bytes_written.fetch_add(written, std::memory_order_relaxed);
+                g_restore_batches.add();
+            });
+            batch = {};
+            batch_bytes = 0;
+        };
+
+        // Parents come before their children in id order, so a single forward pass creates everything.
+        for (files::PathId id = 0; id < snapshot.entries.size(); ++id) {
+            const auto& entry = snapshot.entries[id];
+            destination(id);
+            if (id == files::c_root_path) {
+                stats.directories++;
+                continue;
+            }
+            files::PathId parent = snapshot.paths.parent(id);
+            if (skipped[parent]) {
+                skipped[id] = true;
+                continue;
+            }
+            std::string name(snapshot.paths.name(id));
+            bool restored = enter_parent(parent);
+            switch (entry.type) {
+                case files::EntryType::Directory: {
+                    struct stat info {};
+                    restored = restored && (::mkdirat(parent_directory.descriptor(), name.c_str(), 0700) == 0 || errno == EEXIST) &&
+                               ::fstatat(parent_directory.descriptor(), name.c_str(), &info, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(info.st_mode);
+                    if (!restored) {
+                        ERROR("'{}' is not a directory in the target, skipped with everything below it.", path);
+                        skipped[id] = true;
+                    }
+                    stats.directories++;
+                    break;
+                }
+                case files::EntryType::File:
+                    if (entry.flags & c_entry_unreadable) {
+                        WARN("'{}' was not readable when it was backed up, skipped.", path);
+                        stats.errors++;
+                        continue;
+                    }
+                    stats.files++;
+                    g_restore_files.add();
+                    if (entry.size <= c_small_file_size) {
+                        if (!batch.empty() && (snapshot.paths.parent(batch.front()) != parent || batch.size() == c_batch_files ||
+                                               batch_bytes >= c_batch_bytes)) {
+                            run_batch();
+                        }
+                        batch.push_back(id);
+                        batch_bytes += entry.size;
+                        continue;
+                    }
+                    // The parent was checked above and O_NOFOLLOW guards the file itself.
+                    group.run([&, id, path = path]() {
+                        std::vector<byte> data;
+                        uint64_t written = 0;
+                        if (!restore_file(repository, snapshot, id, AT_FDCWD, path, path, data, written)) failed(path);
+                        bytes_written.fetch_add(written, std::memory_order_relaxed);
+                    });
+                    continue;
+                case files::EntryType::Symlink:
+                    if (restored) {
+                        ::unlinkat(parent_directory.descriptor(), name.c_str(), 0);
+                        restored = ::symlinkat(std::string(snapshot.link_target(id)).c_str(), parent_directory.descriptor(), name.c_str()) == 0;
+                    }
+                    if (!restored) skipped[id] = true;
+                    stats.links++;
+                    break;
+                default:
+                    continue;
+            }
+            if (!restored) {
+                if (entry.type != files::EntryType::Directory) ERROR("Could not restore '{}'.", path);
+                stats.errors++;
+                g_restore_errors.add();
+            }
+        }
+        parent_directory.close();
+
+        run_batch();
+        group.wait();
+        stats.bytes_written += bytes_written;
+        stats.errors += file_errors;
+
+        // Attributes last and children first: writing into a directory would bump its mtime again.
+        // Files have theirs already.
+        for (auto id = (files::PathId) snapshot.entries.size(); id-- > 0;) {
+            const auto& entry = snapshot.entries[id];
+            if (entry.type == files::EntryType::Other || entry.type == files::EntryType::File || skipped[id]) continue;
+            restore_attributes(entry, destination(id));
+        }
+        return true;
+    }
+}  // namespace backup
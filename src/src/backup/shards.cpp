@@ -0,0 +1,391 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/shards.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <sstream>
+
+#include "hashing/crc32c.h"
+#include "hashing/sha256.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+#include "utils/binary.h"
+#include "utils/hex.h"
+
+namespace backup {
+    static constexpr std::string_view c_layout_magic = "fward-shards 1";
+    static constexpr char c_shard_magic[8] = { 'F', 'W', 'S', 'H', 'A', 'R', 'D', '1' };
+    //! Magic, pack id, index, data and parity count, a reserved word and the pack size.
+    static constexpr size_t c_shard_header_size = 8 + 32 + 4 + 4 + 4 + 4 + 8;
+    //! A repair holds this many blocks of every shard at a time.
+    static constexpr uint64_t c_repair_blocks = 256;
+
+    static metrics::Counter& g_shards_written = metrics::counter("fward_shards_written_total", "Shards written when striping packs.");
+    static metrics::Counter& g_shards_rebuilt = metrics::counter("fward_shards_rebuilt_total", "Missing or damaged shards rewritten by a repair.");
+    static metrics::Counter& g_degraded_blocks =
+        metrics::counter("fward_shard_degraded_blocks_total", "Shard blocks rebuilt from parity to serve a read.");
+
+    //! Every shard of a pack has this size, the last data shard padded with zeroes.
+    static uint64_t shard_size_of(uint64_t pack_size, uint32_t data) {
+        uint64_t size = (pack_size + data - 1) / data;
+        return std::max<uint64_t>(c_shard_block, (size + c_shard_block - 1) / c_shard_block * c_shard_block);
+    }
+
+    static std::string shard_path(const ShardLayout& layout, uint32_t index, const std::string& id) {
+        return layout.directories[index] + "/" + id + ".shard";
+    }
+
+    //! The header block, padded so the payload starts on a block boundary.
+    static std::vector<byte> make_header(const ShardLayout& layout, const hashing::Digest& id, uint32_t index, uint64_t pack_size) {
+        std::vector<byte> header;
+        header.reserve(c_shard_block);
+        BinaryWriter writer(header);
+        writer.put_bytes(c_shard_magic, sizeof(c_shard_magic));
+        writer.put(id);
+        writer.put(index);
+        writer.put(layout.data);
+        writer.put(layout.parity);
+        writer.put((uint32_t) 0);
+        writer.put(pack_size);
+        header.resize(c_shard_block);
+        return header;
+    }
+
+    static std::vector<byte> make_trailer(const std::vector<byte>& header, const std::vector<uint32_t>& checksums) {
+        std::vector<byte> trailer;
+        BinaryWriter writer(trailer);
+        for (uint32_t checksum : checksums) writer.put(checksum);
+        writer.put(hashing::crc32c(trailer.data(), trailer.size(), hashing::crc32c(header.data(), c_shard_header_size)));
+        return trailer;
+    }
+
+    static void block_checksums(const byte* payload, uint64_t size, std::vector<uint32_t>& checksums) {
+        for (uint64_t offset = 0; offset < size; offset += c_shard_block) checksums.push_back(hashing::crc32c(payload + offset, c_shard_block));
+    }
+
+    bool load_shard_layout(const std::string& repository, ShardLayout& layout) {
+        layout = {};
+        std::string path = repository + "/shards";
+        if (!std::filesystem::exists(path)) return true;
+        std::vector<byte> contents;
+        if (!files::read_whole_file(path, contents)) return false;
+
+        std::istringstream stream(std::string((const char*) contents.data(), contents.size()));
+        std::string line;
+        if (!std::getline(stream, line) || line != c_layout_magic || !std::getline(stream, line)) return false;
+        uint32_t data = 0;
+        uint32_t parity = 0;
+        if (std::sscanf(line.c_str(), "%u %u", &data, &parity) != 2 || !layout.codec.init(data, parity)) return false;
+        while (std::getline(stream, line)) {
+            if (!line.empty()) layout.directories.push_back(line);
+        }
+        if (layout.directories.size() != data + parity) return false;
+        layout.data = data;
+        layout.parity = parity;
+        return true;
+    }
+
+    bool save_shard_layout(const std::string& repository, const ShardLayout& layout) {
+        std::string contents = FORMAT("{}\n{} {}\n", c_layout_magic, layout.data, layout.parity);
+        for (const auto& directory : layout.directories) {
+            std::error_code error;
+            std::filesystem::create_directories(directory, error);
+            if (error) return false;
+            contents += directory + "\n";
+        }
+        return files::write_file_atomic(repository + "/shards", contents.data(), contents.size());
+    }
+
+    bool write_shards(const ShardLayout& layout, const std::string& path, const std::string& id, std::vector<byte>& buffer) {
+        TRACE_ZONE("pack.shard");
+        hashing::Digest digest {};
+        files::File pack;
+        if (!hex_decode(id, digest.data(), digest.size()) || !pack.open(path, files::FileMode::Read)) return false;
+        for (const auto& directory : layout.directories) {
+            // A disk that was replaced comes back empty.
+            std::error_code error;
+            std::filesystem::create_directories(directory, error);
+        }
+        uint64_t pack_size = pack.size();
+        uint64_t shard_size = shard_size_of(pack_size, layout.data);
+        uint32_t count = layout.data + layout.parity;
+
+        // The pack is read straight into the data shards; only the padding of the last one needs
+        // clearing, parity is overwritten whole.
+        buffer.resize(count * shard_size);
+        if (!pack.read_exact_at(buffer.data(), pack_size, 0)) return false;
+        std::memset(buffer.data() + pack_size, 0, layout.data * shard_size - pack_size);
+        std::vector<const byte*> data;
+        std::vector<byte*> parity;
+        for (uint32_t i = 0; i < layout.data; ++i) data.push_back(buffer.data() + i * shard_size);
+        for (uint32_t j = 0; j < layout.parity; ++j) parity.push_back(buffer.data() + (layout.data + j) * shard_size);
+        layout.codec.encode(data, parity, shard_size);
+
+        // Written to all disks first and synced after, so they flush side by side.
+        std::vector<files::File> shards(count);
+        bool written = true;
+        for (uint32_t i = 0; i < count && written; ++i) {
+            std::vector<uint32_t> checksums;
+            const byte* payload = buffer.data() + i * shard_size;
+            block_checksums(payload, shard_size, checksums);
+            std::vector<byte> header = make_header(layout, digest, i, pack_size);
+            std::vector<byte> trailer = make_trailer(header, checksums);
+            written = shards[i].open(shard_path(layout, i, id) + ".tmp", files::FileMode::Write) && shards[i].write_all(header.data(), header.size()) &&
+                      shards[i].write_all(payload, shard_size) && shards[i].write_all(trailer.data(), trailer.size());
+        }
+        for (uint32_t i = 0; i < count && written; ++i) written = shards[i].sync();
+        for (uint32_t i = 0; i < count && written; ++i) {
+            shards[i].close();
+            std::string target = shard_path(layout, i, id);
+            written = std::rename((target + ".tmp").c_str(), target.c_str()) == 0;
+        }
+        for (uint32_t i = 0; i < count && written; ++i) written = files::sync_directory(layout.directories[i]);
+        if (!written) {
+            for (uint32_t i = 0; i < count; ++i) {
+                std::string target = shard_path(layout, i, id);
+                std::remove((target + ".tmp").c_str());
+                std::remove(target.c_str());
+            }
+            return false;
+        }
+        g_shards_written.add(count);
+        return true;
+    }
+
+    bool remove_shards(const ShardLayout& layout, const std::string& id) {
+        bool removed = false;
+        for (uint32_t i = 0; i < layout.directories.size(); ++i) {
+            if (std::remove(shard_path(layout, i, id).c_str()) == 0) removed = true;
+        }
+        for (const auto& directory : layout.directories) files::sync_directory(directory);
+        return removed;
+    }
+
+    std::vector<std::string> list_sharded_packs(const ShardLayout& layout) {
+        std::set<std::string> ids;
+        for (const auto& directory : layout.directories) {
+            std::error_code error;
+            for (const auto& item : std::filesystem::directory_iterator(directory, error)) {
+                if (item.path().extension() == ".shard") ids.insert(item.path().stem().string());
+            }
+        }
+        return { ids.begin(), ids.end() };
+    }
+
+    void remove_stale_shards(const ShardLayout& layout) {
+        for (const auto& directory : layout.directories) {
+            std::error_code error;
+            for (const auto& item : std::filesystem::directory_iterator(directory, error)) {
+                if (item.path().extension() == ".tmp") std::filesystem::remove(item.path(), error);
+            }
+        }
+    }
+
+    bool PackFile::open(const std::string& path) {
+        close();
+        return m_file.open(path, files::FileMode::Read);
+    }
+
+    bool PackFile::open(const ShardLayout& layout, const std::string& id) {
+        close();
+        hashing::Digest digest {};
+        if (!hex_decode(id, digest.data(), digest.size())) return false;
+        uint32_t count = layout.data + layout.parity;
+        m_shards.resize(count);
+        m_checksums.assign(count, {});
+        uint32_t intact = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            files::File file;
+            std::vector<byte> header(c_shard_header_size);
+            if (!file.open(shard_path(layout, i, id), files::FileMode::Read) || !file.read_exact_at(header.data(), header.size(), 0)) continue;
+            BinaryReader reader(header.data(), header.size());
+            char magic[8];
+            reader.get_bytes(magic, sizeof(magic));
+            bool valid = std::memcmp(magic, c_shard_magic, sizeof(magic)) == 0;
+            valid &= reader.get<hashing::Digest>() == digest;
+            valid &= reader.get<uint32_t>() == i;
+            valid &= reader.get<uint32_t>() == layout.data;
+            valid &= reader.get<uint32_t>() == layout.parity;
+            reader.get<uint32_t>();
+            auto pack_size = reader.get<uint64_t>();
+            // Every intact shard names the same pack size; a shard that disagrees is damaged.
+            if (!valid || reader.error() || (intact && pack_size != m_size)) continue;
+            uint64_t shard_size = shard_size_of(pack_size, layout.data);
+            uint64_t blocks = shard_size / c_shard_block;
+            if (file.size() != c_shard_block + shard_size + blocks * 4 + 4) continue;
+
+            std::vector<byte> trailer(blocks * 4 + 4);
+            if (!file.read_exact_at(trailer.data(), trailer.size(), c_shard_block + shard_size)) continue;
+            uint32_t expected = hashing::crc32c(trailer.data(), blocks * 4, hashing::crc32c(header.data(), header.size()));
+            BinaryReader checksums(trailer.data(), trailer.size());
+            std::vector<uint32_t> table(blocks);
+            for (auto& checksum : table) checksum = checksums.get<uint32_t>();
+            if (checksums.get<uint32_t>() != expected) continue;
+
+            m_size = pack_size;
+            m_shard_size = shard_size;
+            m_shards[i] = std::move(file);
+            m_checksums[i] = std::move(table);
+            intact++;
+        }
+        if (intact < layout.data) {
+            close();
+            return false;
+        }
+        m_layout = &layout;
+        m_id = id;
+        return true;
+    }
+
+    void PackFile::close() {
+        m_file.close();
+        m_layout = nullptr;
+        m_id.clear();
+        m_size = 0;
+        m_shard_size = 0;
+        m_shards.clear();
+        m_checksums.clear();
+    }
+
+    bool PackFile::read_intact(uint32_t shard, uint64_t first, uint64_t count, byte* out) const {
+        if (!m_shards[shard].is_open() || !m_shards[shard].read_exact_at(out, count * c_shard_block, c_shard_block + first * c_shard_block)) return false;
+        for (uint64_t block = 0; block < count; ++block) {
+            if (hashing::crc32c(out + block * c_shard_block, c_shard_block) != m_checksums[shard][first + block]) return false;
+        }
+        return true;
+    }
+
+    bool PackFile::read_blocks(uint32_t shard, uint64_t first, uint64_t count, byte* out) const {
+        if (read_intact(shard, first, count, out)) return true;
+
+        uint32_t shard_count = m_layout->data + m_layout->parity;
+        size_t size = count * c_shard_block;
+        std::vector<byte> sources((size_t) m_layout->data * size);
+        std::vector<byte*> shards(shard_count, nullptr);
+        bool present[ReedSolomon::c_max_shards] = {};
+        uint32_t found = 0;
+        for (uint32_t i = 0; i < shard_count && found < m_layout->data; ++i) {
+            byte* buffer = sources.data() + found * size;
+            if (i == shard || !read_intact(i, first, count, buffer)) continue;
+            shards[i] = buffer;
+            present[i] = true;
+            found++;
+        }
+        if (found < m_layout->data) {
+            WARN("Pack {} has too few intact shards to rebuild blocks {} to {} of shard {}.", m_id, first, first + count, shard);
+            return false;
+        }
+        shards[shard] = out;
+        g_degraded_blocks.add(count);
+        return m_layout->codec.reconstruct(shards, { present, shard_count }, size);
+    }
+
+    bool PackFile::read_exact_at(void* data, size_t size, uint64_t offset) const {
+        if (!m_layout) return m_file.read_exact_at(data, size, offset);
+        if (offset + size > m_size) return false;
+        auto* out = (byte*) data;
+        std::vector<byte> blocks;
+        while (size) {
+            auto shard = (uint32_t) (offset / m_shard_size);
+            uint64_t within = offset % m_shard_size;
+            size_t length = (size_t) std::min<uint64_t>(size, m_shard_size - within);
+            uint64_t first = within / c_shard_block;
+            uint64_t end = (within + length + c_shard_block - 1) / c_shard_block;
+            blocks.resize((end - first) * c_shard_block);
+            if (!read_blocks(shard, first, end - first, blocks.data())) return false;
+            std::memcpy(out, blocks.data() + (within - first * c_shard_block), length);
+            out += length;
+            offset += length;
+            size -= length;
+        }
+        return true;
+    }
+
+    bool PackFile::repair(uint32_t& rebuilt) {
+        rebuilt = 0;
+        if (!m_layout) return true;
+        TRACE_ZONE("pack.repair");
+        hashing::Digest digest {};
+        hex_decode(m_id, digest.data(), digest.size());
+        uint32_t shard_count = m_layout->data + m_layout->parity;
+        uint64_t blocks = m_shard_size / c_shard_block;
+
+        // Missing shards are written anew next to where they belong, damaged ones in place.
+        std::vector<files::File> created(shard_count);
+        std::vector<std::vector<uint32_t>> created_checksums(shard_count);
+        std::vector<bool> damaged(shard_count, false);
+        auto discard = [&]() {
+            for (uint32_t i = 0; i < shard_count; ++i) {
+                if (created[i].is_open()) std::remove((shard_path(*m_layout, i, m_id) + ".tmp").c_str());
+            }
+            return false;
+        };
+        for (uint32_t i = 0; i < shard_count; ++i) {
+            if (m_shards[i].is_open()) continue;
+            std::error_code error;
+            std::filesystem::create_directories(m_layout->directories[i], error);
+            std::vector<byte> header = make_header(*m_layout, digest, i, m_size);
+            if (!created[i].open(shard_path(*m_layout, i, m_id) + ".tmp", files::FileMode::Write) || !created[i].write_all(header.data(), header.size())) {
+                return discard();
+            }
+        }
+
+        std::vector<byte> buffer(shard_count * c_repair_blocks * c_shard_block);
+        std::vector<byte*> shards(shard_count);
+        for (uint64_t first = 0; first < blocks; first += c_repair_blocks) {
+            uint64_t count = std::min(c_repair_blocks, blocks - first);
+            size_t size = count * c_shard_block;
+            bool present[ReedSolomon::c_max_shards] = {};
+            uint32_t intact = 0;
+            for (uint32_t i = 0; i < shard_count; ++i) {
+                shards[i] = buffer.data() + i * size;
+                present[i] = read_intact(i, first, count, shards[i]);
+                intact += present[i];
+            }
+            if (intact == shard_count) continue;
+            if (intact < m_layout->data || !m_layout->codec.reconstruct(shards, { present, shard_count }, size)) {
+                WARN("Pack {} has too few intact shards to repair blocks {} to {}.", m_id, first, first + count);
+                return discard();
+            }
+            for (uint32_t i = 0; i < shard_count; ++i) {
+                if (present[i]) continue;
+                uint64_t offset = c_shard_block + first * c_shard_block;
+                if (created[i].is_open()) {
+                    block_checksums(shards[i], size, created_checksums[i]);
+                    if (!created[i].write_all_at(shards[i], size, offset)) return discard();
+                    continue;
+                }
+                // The checksums of an existing shard are intact, so the rebuilt blocks match them again.
+                files::File file;
+                if (!file.open(shard_path(*m_layout, i, m_id), files::FileMode::ReadWrite) || !file.write_all_at(shards[i], size, offset) || !file.sync()) {
+                    return discard();
+                }
+                damaged[i] = true;
+            }
+        }
+
+        for (uint32_t i = 0; i < shard_count; ++i) {
+            if (!created[i].is_open()) {
+                rebuilt += damaged[i];
+                continue;
+            }
+            std::vector<byte> header = make_header(*m_layout, digest, i, m_size);
+            std::vector<byte> trailer = make_trailer(header, created_checksums[i]);
+            std::string target = shard_path(*m_layout, i, m_id);
+            if (!created[i].write_all_at(trailer.data(), trailer.size(), c_shard_block + m_shard_size) || !created[i].sync()) return discard();
+            created[i].close();
+            if (std::rename((target + ".tmp").c_str(), target.c_str()) != 0 || !files::sync_directory(m_layout->directories[i])) return false;
+            if (!m_shards[i].open(target, files::FileMode::Read)) return false;
+            m_checksums[i] = std::move(created_checksums[i]);
+            rebuilt++;
+        }
+        g_shards_rebuilt.add(rebuilt);
+        return true;
+    }
+}  // namespace backup
@@ -0,0 +1,288 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/snapshot.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "backup/merkle.h"
+#include "files/async_io.h"
+#include "metrics/trace.h"
+#include "utils/binary.h"
+
+namespace backup {
+    static constexpr char c_snapshot_magic[8] = { 'F', 'W', 'S', 'N', 'A', 'P', '0', '2' };
+    //! Manifests from before the filter rules were stored; they read back without any.
+    static constexpr char c_snapshot_magic_v1[8] = { 'F', 'W', 'S', 'N', 'A', 'P', '0', '1' };
+
+    //! Entries statted at once while capturing a snapshot.
+    static constexpr uint32_t c_stat_concurrency = 256;
+    static constexpr uint32_t c_stat_mask = STATX_MODE | STATX_SIZE | STATX_MTIME | STATX_INO;
+
+    static int64_t mtime_of(const struct stat& info) {
+#if defined(MACOS)
+        return (int64_t) info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+        return (int64_t) info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+    }
+
+    static uint64_t zigzag(int64_t value) {
+        return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+    }
+
+    static int64_t unzigzag(uint64_t value) {
+        return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+    }
+
+    std::string_view Snapshot::link_target(files::PathId id) const {
+        auto it = link_targets.find(id);
+        return it == link_targets.end() ? std::string_view {} : std::string_view(it->second);
+    }
+
+    void Snapshot::source_path(files::PathId id, std::string& out) const {
+        std::string_view base = source;
+        if (base.size() > 1 && base.back() == '/') base.remove_suffix(1);
+        if (id == files::c_root_path) {
+            out.assign(base);
+            return;
+        }
+        paths.path(id, out);
+        if (base != "/") out.insert(0, base);
+    }
+
+    void Snapshot::index_children() {
+        m_children.clear();
+        m_children.reserve(entries.size());
+        for (files::PathId id = 1; id < entries.size(); ++id) m_children.push_back(id);
+        std::sort(m_children.begin(), m_children.end(), [this](files::PathId left, files::PathId right) {
+            files::PathId left_parent = paths.parent(left);
+            files::PathId right_parent = paths.parent(right);
+            if (left_parent != right_parent) return left_parent < right_parent;
+            return paths.name(left) < paths.name(right);
+        });
+
+        m_child_offsets.assign(entries.size() + 1, 0);
+        for (files::PathId child : m_children) m_child_offsets[paths.parent(child) + 1]++;
+        for (size_t i = 1; i < m_child_offsets.size(); ++i) m_child_offsets[i] += m_child_offsets[i - 1];
+    }
+
+    static int64_t mtime_of(const struct statx& info) {
+        return (int64_t) info.stx_mtime.tv_sec * 1000000000 + info.stx_mtime.tv_nsec;
+    }
+
+    static void fill_entry(Snapshot& snapshot, files::PathId id, const std::string& path, int32_t result, const struct statx& info) {
+        auto& entry = snapshot.entries[id];
+        if (result == 0) {
+            entry.mode = (uint32_t) info.stx_mode;
+            entry.size = entry.type == files::EntryType::Directory ? 0 : (uint64_t) info.stx_size;
+            entry.mtime_ns = mtime_of(info);
+            entry.inode = info.stx_ino;
+        }
+
+        if (entry.type == files::EntryType::Symlink) {
+            // The target can grow between the stat and the read; a full buffer may have cut it short.
+            std::string target(std::min<uint64_t>(entry.size + 1, PATH_MAX), '\0');
+            ssize_t length = ::readlink(path.c_str(), target.data(), target.size());
+            while (length > 0 && (size_t) length == target.size() && target.size() < PATH_MAX) {
+                target.resize(std::min<size_t>(target.size() * 2, PATH_MAX));
+                length = ::readlink(path.c_str(), target.data(), target.size());
+            }
+            target.resize(length > 0 ? (size_t) length : 0);
+            snapshot.link_targets.emplace(id, std::move(target));
+        }
+    }
+
+    //! Takes the next unstatted id until none are left; several of these run at once so their
+    //! statx calls reach the kernel as one batch.
+    static files::IoTask<void> stat_entries(files::IoContext& io, Snapshot& snapshot, files::PathId& next) {
+        std::string path;
+        struct statx info {};
+        while (next < snapshot.entries.size()) {
+            files::PathId id = next++;
+            snapshot.source_path(id, path);
+            int32_t result = co_await io.statx(AT_FDCWD, path.c_str(), AT_SYMLINK_NOFOLLOW, c_stat_mask, &info);
+            fill_entry(snapshot, id, path, result, info);
+        }
+    }
+
+    bool capture_snapshot(const std::string& source, const files::PathFilter* filter, Snapshot& snapshot, files::ScanStats* stats) {
+        TRACE_ZONE("capture");
+        struct stat info {};
+        if (::lstat(source.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) return false;
+
+        snapshot.source = source;
+        snapshot.paths = files::PathStore();
+        snapshot.entries.clear();
+        snapshot.chunks.clear();
+        snapshot.link_targets.clear();
+        snapshot.filter_rules = filter ? filter->rules() : std::vector<std::string> {};
+        snapshot.filter_ignore_case = filter && filter->case_insensitive();
+        snapshot.entries.push_back({ files::EntryType::Directory, 0, (uint32_t) info.st_mode, 0, mtime_of(info) });
+
+        size_t prefix = source.size() + (source.back() == '/' ? 0 : 1);
+        uint64_t too_deep = 0;
+        files::ScanStats scanned = files::scan(source, filter, [&](const files::ScanEntry& scan_entry) {
+            SnapshotEntry entry {};
+            entry.type = scan_entry.type;
+            // The scanner yields a directory before its children, so ids are handed out in entry order.
+            bool is_directory = entry.type == files::EntryType::Directory;
+            files::PathId id = snapshot.paths.intern(scan_entry.path.substr(prefix), is_directory);
+            if (id == files::c_invalid_path) {
+                ERROR("'{}' is more than {} levels deep, skipped.", scan_entry.path, files::PathStore::c_max_depth);
+                too_deep++;
+                return false;
+            }
+            ASSERT_EX(id == snapshot.entries.size(), "Snapshot entries out of order at {}", scan_entry.path);
+            snapshot.entries.push_back(entry);
+            return true;
+        });
+        scanned.errors += too_deep;
+        if (stats) *stats = scanned;
+
+        // Stats the whole tree after the walk rather than one lstat per entry during it: with
+        // io_uring the kernel gets them a queue at a time and works on several at once. io_uring
+        // hands each statx to a kernel worker though, which on a single core only costs time.
+        files::PathId next = files::c_root_path + 1;
+        files::IoContext io;
+        if (tasks::Scheduler::global().worker_count() > 1 && io.open() && io.uses_io_uring()) {
+            for (uint32_t i = 0; i < c_stat_concurrency && next + i < snapshot.entries.size(); ++i) io.spawn(stat_entries(io, snapshot, next));
+            io.run();
+            return true;
+        }
+        std::string path;
+        struct statx entry_info {};
+        for (; next < snapshot.entries.size(); ++next) {
+            snapshot.source_path(next, path);
+            int32_t result = ::statx(AT_FDCWD, path.c_str(), AT_SYMLINK_NOFOLLOW, c_stat_mask, &entry_info) == 0 ? 0 : -errno;
+            fill_entry(snapshot, next, path, result, entry_info);
+        }
+        return true;
+    }
+
+    void serialize_snapshot(const Snapshot& snapshot, std::vector<byte>& out) {
+        out.clear();
+        BinaryWriter writer(out);
+        writer.put_bytes(c_snapshot_magic, sizeof(c_snapshot_magic));
+        writer.put_string(snapshot.id);
+        writer.put_string(snapshot.source);
+        writer.put(snapshot.time_ns);
+        writer.put_varint(snapshot.filter_rules.size());
+        for (const auto& rule : snapshot.filter_rules) writer.put_string(rule);
+        writer.put((uint8_t) snapshot.filter_ignore_case);
+        writer.put_varint(snapshot.entries.size());
+        for (files::PathId id = 0; id < snapshot.entries.size(); ++id) {
+            const auto& entry = snapshot.entries[id];
+            if (id != files::c_root_path) {
+                writer.put_varint(snapshot.paths.parent(id));
+                writer.put_string(snapshot.paths.name(id));
+            }
+            writer.put((uint8_t) entry.type);
+            writer.put(entry.flags);
+            writer.put_varint(entry.mode);
+            writer.put_varint(entry.size);
+            writer.put_varint(zigzag(entry.mtime_ns));
+            writer.put(entry.content);
+            if (entry.type == files::EntryType::Symlink) writer.put_string(snapshot.link_target(id));
+            writer.put_varint(entry.chunk_count);
+            for (const auto& chunk : snapshot.chunks_of(id)) {
+                writer.put(chunk.digest);
+                writer.put_varint(chunk.length);
+            }
+        }
+        hashing::Digest checksum = hashing::Sha256::digest(out.data(), out.size());
+        writer.put(checksum);
+    }
+
+    //! Format version from the magic, 0 when it isn't a manifest.
+    static uint32_t snapshot_version(const byte* data, size_t size) {
+        if (size < sizeof(c_snapshot_magic)) return 0;
+        if (std::memcmp(data, c_snapshot_magic, sizeof(c_snapshot_magic)) == 0) return 2;
+        if (std::memcmp(data, c_snapshot_magic_v1, sizeof(c_snapshot_magic_v1)) == 0) return 1;
+        return 0;
+    }
+
+    bool peek_snapshot_time(const byte* data, size_t size, int64_t& time_ns) {
+        if (snapshot_version(data, size) == 0) return false;
+        BinaryReader reader(data + sizeof(c_snapshot_magic), size - sizeof(c_snapshot_magic));
+        reader.get_string();
+        reader.get_string();
+        time_ns = reader.get<int64_t>();
+        return !reader.error();
+    }
+
+    bool deserialize_snapshot(const byte* data, size_t size, Snapshot& snapshot) {
+        if (size < sizeof(c_snapshot_magic) + sizeof(hashing::Digest)) return false;
+        size_t body = size - sizeof(hashing::Digest);
+        uint32_t version = snapshot_version(data, size);
+        if (version == 0) return false;
+        if (std::memcmp(data + body, hashing::Sha256::digest(data, body).data(), sizeof(hashing::Digest)) != 0) return false;
+
+        BinaryReader reader(data + sizeof(c_snapshot_magic), body - sizeof(c_snapshot_magic));
+        snapshot.id = reader.get_string();
+        snapshot.source = reader.get_string();
+        snapshot.time_ns = reader.get<int64_t>();
+        snapshot.filter_rules.clear();
+        snapshot.filter_ignore_case = false;
+        if (version >= 2) {
+            uint64_t rules = reader.get_varint();
+            if (reader.error() || rules > reader.remaining()) return false;
+            for (uint64_t i = 0; i < rules; ++i) snapshot.filter_rules.emplace_back(reader.get_string());
+            snapshot.filter_ignore_case = reader.get<uint8_t>() != 0;
+        }
+        uint64_t count = reader.get_varint();
+        if (reader.error() || count == 0 || count > reader.remaining()) return false;
+
+        snapshot.paths = files::PathStore();
+        snapshot.entries.clear();
+        snapshot.entries.reserve(count);
+        snapshot.chunks.clear();
+        snapshot.link_targets.clear();
+        for (files::PathId id = 0; id < count; ++id) {
+            files::PathId parent = files::c_invalid_path;
+            std::string_view name;
+            if (id != files::c_root_path) {
+                parent = (files::PathId) reader.get_varint();
+                name = reader.get_string();
+                if (parent >= id || !snapshot.paths.is_directory(parent)) return false;
+            }
+
+            SnapshotEntry entry {};
+            entry.type = (files::EntryType) reader.get<uint8_t>();
+            entry.flags = reader.get<uint8_t>();
+            entry.mode = (uint32_t) reader.get_varint();
+            entry.size = reader.get_varint();
+            entry.mtime_ns = unzigzag(reader.get_varint());
+            entry.content = reader.get<hashing::Digest>();
+            if (entry.type == files::EntryType::Symlink) snapshot.link_targets.emplace(id, std::string(reader.get_string()));
+            entry.first_chunk = (uint32_t) snapshot.chunks.size();
+            entry.chunk_count = (uint32_t) reader.get_varint();
+            if (reader.error() || entry.chunk_count > reader.remaining()) return false;
+            for (uint32_t i = 0; i < entry.chunk_count; ++i) {
+                ChunkRef chunk {};
+                chunk.digest = reader.get<hashing::Digest>();
+                chunk.length = (uint32_t) reader.get_varint();
+                snapshot.chunks.push_back(chunk);
+            }
+            if (reader.error()) return false;
+
+            if (id != files::c_root_path) {
+                bool is_directory = entry.type == files::EntryType::Directory;
+                files::PathId interned = is_directory ? snapshot.paths.intern_directory(parent, name) : snapshot.paths.add_leaf(parent, name);
+                if (interned != id) return false;
+            }
+            snapshot.entries.push_back(entry);
+        }
+        if (reader.error() || reader.remaining() != 0) return false;
+        // Metadata nodes aren't stored, they follow from the entries; content nodes are kept for merkle_check.
+        merkle_build(snapshot, false);
+        return true;
+    }
+}  // namespace backup
@@ -0,0 +1,261 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/verify.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <unordered_set>
+
+#include "backup/backup.h"
+#include "backup/merkle.h"
+#include "files/hash_cache.h"
+#include "files/reader.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+
+namespace backup {
+    static metrics::Counter& g_verify_bytes = metrics::counter("fward_verify_read_bytes_total", "Bytes rehashed by verify, live files and stored chunks.");
+    static metrics::Counter& g_verify_problems = metrics::counter("fward_verify_problems_total", "Problems and differences reported by verify.");
+
+    using DigestSet = std::unordered_set<hashing::Digest, hashing::DigestHash>;
+
+    const char* verify_issue_name(VerifyIssue issue) {
+        switch (issue) {
+            case VerifyIssue::TreeCorrupt:
+                return "tree-corrupt";
+            case VerifyIssue::ChunkMissing:
+                return "chunk-missing";
+            case VerifyIssue::ChunkCorrupt:
+                return "chunk-corrupt";
+            case VerifyIssue::Unreadable:
+                return "unreadable";
+            case VerifyIssue::Modified:
+                return "modified";
+            case VerifyIssue::Removed:
+                return "removed";
+            case VerifyIssue::Added:
+                return "added";
+        }
+        return "unknown";
+    }
+
+    bool VerifyReport::intact() const {
+        if (!unreadable_packs.empty()) return false;
+        for (const auto& problem : problems) {
+            switch (problem.issue) {
+                case VerifyIssue::TreeCorrupt:
+                case VerifyIssue::ChunkMissing:
+                case VerifyIssue::ChunkCorrupt:
+                    return false;
+                default:
+                    break;
+            }
+        }
+        return true;
+    }
+
+    static void add_problem(VerifyReport& report, VerifyIssue issue, const Snapshot& snapshot, files::PathId id) {
+        VerifyProblem problem { issue, snapshot.id, {} };
+        snapshot.source_path(id, problem.path);
+        report.problems.push_back(std::move(problem));
+        g_verify_problems.add();
+    }
+
+    //! Reports `id` and, for directories, every entry below it.
+    static void add_subtree(VerifyReport& report, VerifyIssue issue, const Snapshot& snapshot, files::PathId id) {
+        std::vector<files::PathId> pending { id };
+        while (!pending.empty()) {
+            files::PathId current = pending.back();
+            pending.pop_back();
+            add_problem(report, issue, snapshot, current);
+            for (files::PathId child : snapshot.children(current)) pending.push_back(child);
+        }
+    }
+
+    static void check_tree(const Snapshot& snapshot, VerifyReport& report) {
+        TRACE_ZONE("verify.tree");
+        std::vector<files::PathId> corrupt;
+        merkle_check(snapshot, corrupt);
+        for (files::PathId id : corrupt) add_problem(report, VerifyIssue::TreeCorrupt, snapshot, id);
+        for (files::PathId id = 0; id < snapshot.entries.size(); ++id) {
+            if (snapshot.entries[id].flags & c_entry_unreadable) add_problem(report, VerifyIssue::Unreadable, snapshot, id);
+        }
+        report.entries_checked += snapshot.entries.size();
+    }
+
+    //! One problem per file: missing chunks take precedence over damaged ones.
+    static void check_chunks(const Repository& repository, const Snapshot& snapshot, const DigestSet* damaged, VerifyReport& report) {
+        TRACE_ZONE("verify.chunks");
+        for (files::PathId id = 0; id < snapshot.entries.size(); ++id) {
+            bool missing = false;
+            bool corrupt = false;
+            for (const auto& chunk : snapshot.chunks_of(id)) {
+                if (!repository.contains(chunk.digest)) {
+                    missing = true;
+                    break;
+                }
+                if (damaged && damaged->contains(chunk.digest)) corrupt = true;
+            }
+            if (missing) {
+                add_problem(report, VerifyIssue::ChunkMissing, snapshot, id);
+            } else if (corrupt) {
+                add_problem(report, VerifyIssue::ChunkCorrupt, snapshot, id);
+            }
+        }
+    }
+
+    static bool same_contents(const Snapshot& stored, files::PathId stored_id, const Snapshot& live, files::PathId live_id, bool hash_xattrs,
+                              VerifyReport& report) {
+        const auto& entry = stored.entries[stored_id];
+        if (entry.type == files::EntryType::Symlink) return stored.link_target(stored_id) == live.link_target(live_id);
+        if (entry.type != files::EntryType::File || (entry.flags & c_entry_unreadable)) return true;
+
+        std::string path;
+        live.source_path(live_id, path);
+        const auto& live_entry = live.entries[live_id];
+
+        TRACE_ZONE("verify.rehash");
+        std::vector<ChunkRef> chunks;
+        uint64_t size = 0;
+        if (!hash_file(path, chunks, size)) return false;
+        report.files_rehashed++;
+        report.bytes_checked += size;
+        g_verify_bytes.add(size);
+        hashing::Digest digest = merkle_file_digest(size, chunks);
+        if (hash_xattrs && size == live_entry.size && live_entry.mtime_ns < live.time_ns - c_racy_window_ns) {
+            files::store_cached_hash(path, files::HashAlgorithm::ChunkedSha256, size, live_entry.mtime_ns, digest);
+        }
+        return digest == entry.content;
+    }
+
+    bool verify_quick(const Repository& repository, const Snapshot& snapshot, const std::string& live_root, const files::PathFilter* filter,
+                      bool hash_xattrs, VerifyReport& report) {
+        check_tree(snapshot, report);
+        check_chunks(repository, snapshot, nullptr, report);
+
+        TRACE_ZONE("verify.live");
+        Snapshot live;
+        // Additions are reported under the snapshot they were compared with.
+        live.id = snapshot.id;
+        live.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        // The live tree leaves out what the backup left out, or excluded paths would all show up as
+        // added; rules given for this run come after the recorded ones.
+        files::PathFilter live_filter(snapshot.filter_ignore_case || (filter && filter->case_insensitive()));
+        for (const auto& rule : snapshot.filter_rules) live_filter.add_rule(rule);
+        if (filter) {
+            for (const auto& rule : filter->rules()) live_filter.add_rule(rule);
+        }
+        live_filter.compile();
+        if (!capture_snapshot(live_root, live_filter.rule_count() ? &live_filter : nullptr, live)) return false;
+        merkle_build(live, false);
+
+        merkle_diff(snapshot, live, [&](TreeChange change, files::PathId stored_id, files::PathId live_id) {
+            switch (change) {
+                case TreeChange::Removed:
+                    add_subtree(report, VerifyIssue::Removed, snapshot, stored_id);
+                    break;
+                case TreeChange::Added:
+                    add_subtree(report, VerifyIssue::Added, live, live_id);
+                    break;
+                case TreeChange::Changed:
+                    // Metadata differs; only the contents decide whether the backup is still current.
+                    if (!same_contents(snapshot, stored_id, live, live_id, hash_xattrs, report)) add_problem(report, VerifyIssue::Modified, snapshot, stored_id);
+                    break;
+            }
+        });
+        return true;
+    }
+
+    //! Rehashes every chunk of one pack, recording the digests that don't match.
+    static void scrub_pack(const Repository& repository, uint32_t pack, const std::vector<hashing::Digest>& expected, DigestSet& damaged,
+                           std::mutex& mutex, std::atomic<uint64_t>& chunks, std::atomic<uint64_t>& bytes, std::atomic<uint64_t>& shards) {
+        TRACE_ZONE("verify.scrub");
+        std::vector<PackEntry> entries;
+        PackFile file;
+        // A striped pack first gets back the shards it lost, for as long as enough of them are left.
+        uint32_t rebuilt = 0;
+        if (repository.open_pack(pack, file) && !file.repair(rebuilt)) WARN("Pack {} could not be repaired.", repository.pack_id(pack));
+        shards.fetch_add(rebuilt, std::memory_order_relaxed);
+        if (!file.is_open() || !read_pack_index(file, entries)) {
+            std::lock_guard lock(mutex);
+            damaged.insert(expected.begin(), expected.end());
+            return;
+        }
+
+        // Packs are never rewritten in place, so the reader may map them; a scrub leaves the cache as it found it.
+        files::ReadOptions read_options;
+        read_options.immutable = true;
+        files::Reader reader;
+        if (!file.sharded() && !reader.open(repository.pack_path(pack), read_options)) {
+            std::lock_guard lock(mutex);
+            damaged.insert(expected.begin(), expected.end());
+            return;
+        }
+
+        std::vector<byte> delta_data;
+        std::vector<byte> buffer;
+        std::vector<hashing::Digest> bad;
+        for (const auto& entry : entries) {
+            std::span<const byte> data;
+            bool read;
+            if (entry.flags & c_pack_entry_delta) {
+                // Rebuilt through its bases, so damage anywhere in the chain shows up here.
+                read = repository.read_chunk(entry.digest, delta_data);
+                data = delta_data;
+            } else if (file.sharded()) {
+                buffer.resize(entry.length);
+                read = file.read_exact_at(buffer.data(), buffer.size(), entry.offset);
+                data = buffer;
+            } else {
+                read = reader.view(entry.offset, entry.length, data) && data.size() == entry.length;
+            }
+            if (!read || hashing::Sha256::digest(data.data(), data.size()) != entry.digest) bad.push_back(entry.digest);
+            chunks.fetch_add(1, std::memory_order_relaxed);
+            bytes.fetch_add(data.size(), std::memory_order_relaxed);
+            g_verify_bytes.add(data.size());
+        }
+        if (!bad.empty()) {
+            std::lock_guard lock(mutex);
+            damaged.insert(bad.begin(), bad.end());
+        }
+    }
+
+    bool verify_full(const Repository& repository, const std::vector<const Snapshot*>& snapshots, uint32_t threads, VerifyReport& report,
+                     tasks::Priority priority) {
+        for (const Snapshot* snapshot : snapshots) check_tree(*snapshot, report);
+        report.unreadable_packs = repository.unreadable_packs();
+
+        // What the index expects in each pack, so a pack that became unreadable still maps to its chunks.
+        std::vector<std::vector<hashing::Digest>> expected(repository.pack_count());
+        repository.for_each_chunk([&](const hashing::Digest& digest, const ChunkLocation& location) { expected[location.pack].push_back(digest); });
+
+        DigestSet damaged;
+        std::mutex mutex;
+        std::atomic<uint32_t> next_pack = 0;
+        std::atomic<uint64_t> chunks = 0;
+        std::atomic<uint64_t> bytes = 0;
+        std::atomic<uint64_t> shards = 0;
+        tasks::TaskGroup group(priority);
+        if (threads == 0) threads = group.scheduler().worker_count();
+
+        // One pack per task, each queueing the next: at most `threads` packs are in flight, and
+        // work of a higher priority gets a turn between packs.
+        std::function<void()> scrub_next = [&]() {
+            uint32_t pack = next_pack++;
+            if (pack >= repository.pack_count()) return;
+            scrub_pack(repository, pack, expected[pack], damaged, mutex, chunks, bytes, shards);
+            group.run(scrub_next);
+        };
+        for (uint32_t i = 0; i < threads && i < repository.pack_count(); ++i) group.run(scrub_next);
+        group.wait();
+        report.chunks_checked += chunks;
+        report.bytes_checked += bytes;
+        report.shards_rebuilt += shards;
+
+        for (const Snapshot* snapshot : snapshots) check_chunks(repository, *snapshot, &damaged, report);
+        return true;
+    }
+}  // namespace backup
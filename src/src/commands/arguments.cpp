@@ -0,0 +1,79 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "commands/arguments.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace commands {
+    Arguments::Arguments(int32_t argc, char** argv, std::initializer_list<std::string_view> with_value) {
+        bool only_positionals = false;
+        for (int32_t i = 0; i < argc; ++i) {
+            std::string_view argument = argv[i];
+            if (only_positionals || !argument.starts_with("--")) {
+                m_positionals.emplace_back(argument);
+                continue;
+            }
+            if (argument == "--") {
+                only_positionals = true;
+                continue;
+            }
+
+            std::string_view name = argument.substr(2);
+            std::string_view inline_value;
+            bool has_inline = false;
+            if (size_t equals = name.find('='); equals != std::string_view::npos) {
+                inline_value = name.substr(equals + 1);
+                name = name.substr(0, equals);
+                has_inline = true;
+            }
+
+            if (std::find(with_value.begin(), with_value.end(), name) == with_value.end()) {
+                if (has_inline) {
+                    m_error = FORMAT("--{} does not take a value", name);
+                    return;
+                }
+                m_flags.emplace_back(name);
+            } else if (has_inline) {
+                m_options.emplace_back(name, inline_value);
+            } else if (i + 1 < argc) {
+                m_options.emplace_back(name, argv[++i]);
+            } else {
+                m_error = FORMAT("--{} requires a value", name);
+                return;
+            }
+        }
+    }
+
+    bool Arguments::flag(std::string_view name) const {
+        return std::find(m_flags.begin(), m_flags.end(), name) != m_flags.end();
+    }
+
+    bool Arguments::has(std::string_view name) const {
+        return std::any_of(m_options.begin(), m_options.end(), [&](const auto& option) { return option.first == name; });
+    }
+
+    std::string Arguments::value(std::string_view name, std::string_view fallback) const {
+        for (auto it = m_options.rbegin(); it != m_options.rend(); ++it) {
+            if (it->first == name) return it->second;
+        }
+        return std::string(fallback);
+    }
+
+    std::vector<std::string> Arguments::values(std::string_view name) const {
+        std::vector<std::string> result;
+        for (const auto& [key, value] : m_options) {
+            if (key == name) result.push_back(value);
+        }
+        return result;
+    }
+
+    bool Arguments::number(std::string_view name, uint64_t& out) const {
+        if (!has(name)) return true;
+        std::string text = value(name);
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), out);
+        return error == std::errc() && end == text.data() + text.size();
+    }
+}  // namespace commands
@@ -0,0 +1,60 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include <filesystem>
+
+#include "backup/backup.h"
+#include "commands/commands.h"
+
+namespace commands {
+    int32_t backup(int32_t argc, char** argv) {
+        Arguments arguments(argc, argv, { "exclude", "exclude-from" });
+        if (!arguments.valid() || arguments.positional_count() != 2) {
+            if (!arguments.valid()) ERROR("{}", arguments.error());
+            print_usage();
+            return 2;
+        }
+
+        files::PathFilter filter;
+        if (!build_filter(arguments, filter)) return 2;
+
+        const std::string& repository_path = arguments.positional(1);
+        backup::Repository repository;
+        if (!backup::Repository::create(repository_path) || !repository.open(repository_path) || !repository.lock(false)) {
+            ERROR("Could not open repository '{}'.", repository_path);
+            return 1;
+        }
+
+        // The catalog is keyed by absolute path, and verify later finds the source from any directory.
+        std::error_code error;
+        backup::BackupOptions options;
+        options.source = std::filesystem::absolute(arguments.positional(0), error).lexically_normal().string();
+        options.filter = &filter;
+        options.hash_xattrs = arguments.flag("hash-xattrs");
+        backup::Catalog catalog;
+        if (!arguments.flag("rehash")) {
+            if (catalog.open(repository_path + "/catalog")) {
+                options.catalog = &catalog;
+            } else {
+                WARN("Could not open the catalog, every file will be read.");
+            }
+        }
+        backup::Snapshot snapshot;
+        backup::BackupStats stats;
+        if (!backup::run_backup(repository, options, snapshot, stats)) {
+            ERROR("Backup of '{}' failed.", options.source);
+            return 1;
+        }
+
+        LOG("{} files ({} unchanged), {} directories, {} bytes read.", stats.files, stats.files_unchanged, stats.directories, stats.bytes_read);
+        LOG("{} new chunks, {} as deltas ({} bytes), {} reused.", stats.chunks_added + stats.chunks_delta, stats.chunks_delta, stats.bytes_added,
+            stats.chunks_reused);
+        if (stats.errors) {
+            WARN("Snapshot {} saved with {} unreadable entries.", snapshot.id, stats.errors);
+            return 3;
+        }
+        SUCCESS("Snapshot {} saved.", snapshot.id);
+        return 0;
+    }
+}  // namespace commands
@@ -0,0 +1,151 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "commands/commands.h"
+
+#include <cmath>
+#include <cstdlib>
+
+#include "files/external_sort.h"
+
+namespace commands {
+    struct CommandInfo {
+        std::string_view name;
+        Command command;
+        std::string_view usage;
+    };
+
+    static constexpr CommandInfo c_commands[] = {
+        { "backup", backup, "backup <source> <repository> [--exclude <pattern>]... [--exclude-from <file>] [--ignore-case] [--rehash] [--hash-xattrs]" },
+        { "verify", verify, "verify <repository> [--snapshot <id>] [--full] [--against <path>] [--threads <n>] [--exclude <pattern>]... [--hash-xattrs]" },
+        { "restore", restore, "restore <repository> <target> [--snapshot <id>]" },
+        { "prune", prune, "prune <repository> [--keep-last <n>] [--keep-within <duration>] [--repack-below <percent>] [--threads <n>] [--dry-run]" },
+        { "shards", shards, "shards <repository> <directory>... --data <n> --parity <n>" },
+        { "daemon", daemon, "daemon <config>" },
+    };
+
+    Command find_command(std::string_view name) {
+        for (const auto& info : c_commands) {
+            if (info.name == name) return info.command;
+        }
+        return nullptr;
+    }
+
+    void print_usage() {
+        PRINTLN("usage: fward [--metrics <file>] [--metrics-format prometheus|json] [--metrics-interval <seconds>] [--trace <file>] [--memory <size>] <command> ...");
+        for (const auto& info : c_commands) PRINTLN("    fward {}", info.usage);
+    }
+
+    bool parse_global_options(int32_t argc, char** argv, GlobalOptions& options, int32_t& consumed) {
+        consumed = 0;
+        while (consumed < argc && std::string_view(argv[consumed]).starts_with("--")) {
+            std::string_view name = argv[consumed];
+            if (consumed + 1 >= argc) {
+                ERROR("{} requires a value.", name);
+                return false;
+            }
+            std::string_view value = argv[consumed + 1];
+            if (name == "--metrics") {
+                options.metrics_path = value;
+            } else if (name == "--metrics-format") {
+                if (!metrics::parse_export_format(value, options.metrics_format)) {
+                    ERROR("Unknown metrics format '{}'.", value);
+                    return false;
+                }
+            } else if (name == "--trace") {
+                options.trace_path = value;
+            } else if (name == "--memory") {
+                if (!parse_size(value, options.memory_budget)) {
+                    ERROR("Invalid memory budget '{}'.", value);
+                    return false;
+                }
+                // 0 lifts the bound; anything else has to leave room for a merge.
+                if (options.memory_budget && options.memory_budget < files::c_min_memory_budget) {
+                    ERROR("A memory budget below {} bytes leaves no room to merge.", files::c_min_memory_budget);
+                    return false;
+                }
+            } else if (name == "--metrics-interval") {
+                char* end = nullptr;
+                double seconds = std::strtod(std::string(value).c_str(), &end);
+                if (!end || *end || !std::isfinite(seconds)) {
+                    ERROR("Invalid metrics interval '{}'.", value);
+                    return false;
+                }
+                // Anything shorter would round down to 0 ms and keep the reporter spinning.
+                if (seconds < 0.001) {
+                    ERROR("A metrics interval must be at least 1 ms, got '{}'.", value);
+                    return false;
+                }
+                options.metrics_interval = std::chrono::milliseconds((int64_t) (seconds * 1000));
+            } else {
+                ERROR("Unknown option '{}'.", name);
+                return false;
+            }
+            consumed += 2;
+        }
+        return true;
+    }
+
+    bool parse_duration(std::string_view text, std::chrono::milliseconds& duration) {
+        char* end = nullptr;
+        std::string copy(text);
+        double value = std::strtod(copy.c_str(), &end);
+        if (end == copy.c_str() || value <= 0) return false;
+        std::string_view unit(end);
+        double seconds;
+        if (unit.empty() || unit == "s") {
+            seconds = value;
+        } else if (unit == "m") {
+            seconds = value * 60;
+        } else if (unit == "h") {
+            seconds = value * 3600;
+        } else if (unit == "d") {
+            seconds = value * 86400;
+        } else {
+            return false;
+        }
+        duration = std::chrono::milliseconds((int64_t) (seconds * 1000));
+        return duration.count() > 0;
+    }
+
+    bool parse_size(std::string_view text, uint64_t& size) {
+        char* end = nullptr;
+        std::string copy(text);
+        double value = std::strtod(copy.c_str(), &end);
+        if (end == copy.c_str() || value <= 0) return false;
+        std::string_view unit(end);
+        double scale;
+        if (unit.empty()) {
+            scale = 1;
+        } else if (unit == "K") {
+            scale = 1ull << 10;
+        } else if (unit == "M") {
+            scale = 1ull << 20;
+        } else if (unit == "G") {
+            scale = 1ull << 30;
+        } else {
+            return false;
+        }
+        size = (uint64_t) (value * scale);
+        return size > 0;
+    }
+
+    bool build_filter(const Arguments& arguments, files::PathFilter& filter) {
+        filter = files::PathFilter(arguments.flag("ignore-case"));
+        for (const auto& file : arguments.values("exclude-from")) {
+            if (!filter.load(file)) {
+                ERROR("Could not read exclude file '{}'.", file);
+                return false;
+            }
+        }
+        for (const auto& pattern : arguments.values("exclude")) {
+            if (!filter.add_rule(pattern)) {
+                ERROR("Invalid exclude pattern '{}'.", pattern);
+                return false;
+            }
+        }
+        filter.compile();
+        return true;
+    }
+}  // namespace commands
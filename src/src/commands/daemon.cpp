@@ -0,0 +1,118 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+
+#include "commands/commands.h"
+#include "service/daemon.h"
+
+namespace commands {
+    bool split_words(std::string_view line, std::vector<std::string>& words) {
+        words.clear();
+        size_t i = 0;
+        while (i < line.size()) {
+            if (std::isspace((unsigned char) line[i])) {
+                ++i;
+                continue;
+            }
+            std::string word;
+            while (i < line.size() && !std::isspace((unsigned char) line[i])) {
+                char quote = line[i];
+                if (quote != '"' && quote != '\'') {
+                    word += line[i++];
+                    continue;
+                }
+                size_t end = line.find(quote, i + 1);
+                if (end == std::string_view::npos) return false;
+                word.append(line.substr(i + 1, end - i - 1));
+                i = end + 1;
+            }
+            words.push_back(std::move(word));
+        }
+        return true;
+    }
+
+    bool parse_job(std::vector<std::string>& words, service::JobConfig& job) {
+        std::vector<char*> argv;
+        for (size_t i = 1; i < words.size(); ++i) argv.push_back(words[i].data());
+        Arguments arguments((int32_t) argv.size(), argv.data(), { "every", "exclude", "exclude-from", "threads", "keep-last", "keep-within", "repack-below" });
+        if (!arguments.valid()) {
+            ERROR("{}", arguments.error());
+            return false;
+        }
+        if (!parse_duration(arguments.value("every"), job.interval)) {
+            ERROR("Every job needs a valid --every <duration>.");
+            return false;
+        }
+
+        std::error_code error;
+        if (words[0] == "backup" && arguments.positional_count() == 2) {
+            job.kind = service::JobKind::Backup;
+            job.source = std::filesystem::absolute(arguments.positional(0), error).lexically_normal().string();
+            job.repository = arguments.positional(1);
+            job.rehash = arguments.flag("rehash");
+            job.hash_xattrs = arguments.flag("hash-xattrs");
+            return build_filter(arguments, job.filter);
+        }
+        uint64_t threads = 0;
+        if (words[0] == "scrub" && arguments.positional_count() == 1 && arguments.number("threads", threads)) {
+            job.kind = service::JobKind::Scrub;
+            job.repository = arguments.positional(0);
+            job.threads = (uint32_t) threads;
+            return true;
+        }
+        if (words[0] == "prune" && arguments.positional_count() == 1 && build_prune_options(arguments, job.prune)) {
+            job.kind = service::JobKind::Prune;
+            job.repository = arguments.positional(0);
+            job.prune.priority = tasks::Priority::Background;
+            return true;
+        }
+        ERROR("Unknown job '{}'.", words[0]);
+        return false;
+    }
+
+    static bool load_config(const std::string& path, std::vector<service::JobConfig>& jobs) {
+        std::ifstream stream(path);
+        if (!stream) {
+            ERROR("Could not read '{}'.", path);
+            return false;
+        }
+        jobs.clear();
+        std::string line;
+        std::vector<std::string> words;
+        for (uint32_t number = 1; std::getline(stream, line); ++number) {
+            if (!split_words(line, words)) {
+                ERROR("{}:{}: unterminated quote.", path, number);
+                return false;
+            }
+            if (words.empty() || words[0].starts_with('#')) continue;
+            if (!parse_job(words, jobs.emplace_back())) {
+                ERROR("{}:{}: invalid job.", path, number);
+                return false;
+            }
+        }
+        if (jobs.empty()) {
+            ERROR("'{}' has no jobs.", path);
+            return false;
+        }
+        return true;
+    }
+
+    int32_t daemon(int32_t argc, char** argv) {
+        Arguments arguments(argc, argv, {});
+        if (!arguments.valid() || arguments.positional_count() != 1) {
+            if (!arguments.valid()) ERROR("{}", arguments.error());
+            print_usage();
+            return 2;
+        }
+
+        const std::string& path = arguments.positional(0);
+        service::Daemon daemon;
+        if (!daemon.run([&](std::vector<service::JobConfig>& jobs) { return load_config(path, jobs); })) return 1;
+        SUCCESS("Daemon stopped.");
+        return 0;
+    }
+}  // namespace commands
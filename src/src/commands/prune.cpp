@@ -0,0 +1,60 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "commands/commands.h"
+
+namespace commands {
+    bool build_prune_options(const Arguments& arguments, backup::PruneOptions& options) {
+        uint64_t keep_last = 0;
+        uint64_t repack_below = 50;
+        uint64_t threads = 0;
+        if (!arguments.number("keep-last", keep_last) || !arguments.number("threads", threads)) return false;
+        if (!arguments.number("repack-below", repack_below) || repack_below > 100) {
+            ERROR("--repack-below takes a percentage.");
+            return false;
+        }
+        if (arguments.has("keep-within") && !parse_duration(arguments.value("keep-within"), options.keep_within)) {
+            ERROR("Invalid duration '{}'.", arguments.value("keep-within"));
+            return false;
+        }
+        options.keep_last = (uint32_t) keep_last;
+        options.repack_below = (double) repack_below / 100;
+        options.threads = (uint32_t) threads;
+        options.dry_run = arguments.flag("dry-run");
+        return true;
+    }
+
+    int32_t prune(int32_t argc, char** argv) {
+        Arguments arguments(argc, argv, { "keep-last", "keep-within", "repack-below", "threads" });
+        backup::PruneOptions options;
+        if (!arguments.valid() || arguments.positional_count() != 1 || !build_prune_options(arguments, options)) {
+            if (!arguments.valid()) ERROR("{}", arguments.error());
+            print_usage();
+            return 2;
+        }
+
+        const std::string& repository_path = arguments.positional(0);
+        backup::Repository repository;
+        if (!repository.open(repository_path)) {
+            ERROR("Could not open repository '{}'.", repository_path);
+            return 1;
+        }
+
+        backup::PruneStats stats;
+        if (!backup::run_prune(repository, options, stats)) {
+            ERROR("Prune of '{}' failed, nothing was lost.", repository_path);
+            return 1;
+        }
+        std::string_view verb = options.dry_run ? "would be " : "";
+        LOG("{} snapshots kept, {} {}forgotten.", stats.snapshots_kept, stats.snapshots_removed, verb);
+        LOG("{} live chunks, {} {}removed; {} packs {}deleted, {} {}rewritten into {}.", stats.chunks_live, stats.chunks_removed, verb,
+            stats.packs_removed, verb, stats.packs_repacked, verb, stats.packs_written);
+        if (stats.chunks_missing) {
+            WARN("Kept snapshots reference {} chunks the repository doesn't have; run verify --full.", stats.chunks_missing);
+            return 3;
+        }
+        SUCCESS("{} bytes {}freed.", stats.bytes_freed, verb);
+        return 0;
+    }
+}  // namespace commands
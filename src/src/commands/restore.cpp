@@ -0,0 +1,52 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/restore.h"
+#include "commands/commands.h"
+
+namespace commands {
+    int32_t restore(int32_t argc, char** argv) {
+        Arguments arguments(argc, argv, { "snapshot" });
+        if (!arguments.valid() || arguments.positional_count() != 2) {
+            if (!arguments.valid()) ERROR("{}", arguments.error());
+            print_usage();
+            return 2;
+        }
+
+        const std::string& repository_path = arguments.positional(0);
+        backup::Repository repository;
+        if (!repository.open(repository_path) || !repository.lock(false)) {
+            ERROR("Could not open repository '{}'.", repository_path);
+            return 1;
+        }
+
+        std::string id = arguments.value("snapshot");
+        if (id.empty()) {
+            id = repository.latest_snapshot_id();
+            if (id.empty()) {
+                ERROR("Repository '{}' has no snapshots.", repository_path);
+                return 1;
+            }
+        }
+        backup::Snapshot snapshot;
+        if (!repository.load_snapshot(id, snapshot)) {
+            ERROR("Snapshot {} is missing or damaged.", id);
+            return 1;
+        }
+
+        const std::string& target = arguments.positional(1);
+        backup::RestoreStats stats;
+        if (!backup::run_restore(repository, snapshot, target, stats)) {
+            ERROR("Could not restore into '{}'.", target);
+            return 1;
+        }
+        LOG("{} files, {} directories, {} links, {} bytes written.", stats.files, stats.directories, stats.links, stats.bytes_written);
+        if (stats.errors) {
+            ERROR("Snapshot {} restored with {} errors.", snapshot.id, stats.errors);
+            return 1;
+        }
+        SUCCESS("Snapshot {} restored to '{}'.", snapshot.id, target);
+        return 0;
+    }
+}  // namespace commands
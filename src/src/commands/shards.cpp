@@ -0,0 +1,66 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include <filesystem>
+
+#include "backup/repository.h"
+#include "commands/commands.h"
+
+namespace commands {
+    //! Sets the shard layout, creating the repository if need be, then stripes every pack that is still
+    //! whole. Running it again with the same layout finishes what an interrupted run or a failed
+    //! backup left whole.
+    int32_t shards(int32_t argc, char** argv) {
+        Arguments arguments(argc, argv, { "data", "parity" });
+        uint64_t data = 0;
+        uint64_t parity = 0;
+        if (!arguments.valid() || arguments.positional_count() < 2 || !arguments.number("data", data) || !arguments.number("parity", parity)) {
+            if (!arguments.valid()) ERROR("{}", arguments.error());
+            print_usage();
+            return 2;
+        }
+
+        backup::ShardLayout layout;
+        layout.data = (uint32_t) data;
+        layout.parity = (uint32_t) parity;
+        for (size_t i = 1; i < arguments.positional_count(); ++i) layout.directories.push_back(std::filesystem::absolute(arguments.positional(i)).string());
+        if (data > ReedSolomon::c_max_shards || parity > ReedSolomon::c_max_shards || !layout.codec.init(layout.data, layout.parity) ||
+            layout.directories.size() != data + parity) {
+            ERROR("Give one directory per shard, --data and --parity at least 1 and together at most {}.", ReedSolomon::c_max_shards);
+            return 2;
+        }
+
+        const std::string& repository_path = arguments.positional(0);
+        backup::Repository repository;
+        if (!backup::Repository::create(repository_path) || !repository.open(repository_path)) {
+            ERROR("Could not open repository '{}'.", repository_path);
+            return 1;
+        }
+        const auto& current = repository.shard_layout();
+        if (current.enabled() && (current.data != layout.data || current.parity != layout.parity || current.directories != layout.directories)) {
+            ERROR("Repository '{}' is striped over other directories already.", repository_path);
+            return 1;
+        }
+        if (!current.enabled() && (!backup::save_shard_layout(repository_path, layout) || !repository.open(repository_path))) {
+            ERROR("Could not write the shard layout of '{}'.", repository_path);
+            return 1;
+        }
+        // Shared, like a backup: prune must not delete a pack while it is striped.
+        if (!repository.lock(false)) {
+            ERROR("Could not lock repository '{}'.", repository_path);
+            return 1;
+        }
+
+        uint64_t failed = 0;
+        for (uint32_t pack = 0; pack < repository.pack_count(); ++pack) {
+            if (!repository.stripe_pack(repository.pack_id(pack))) failed++;
+        }
+        if (failed) {
+            ERROR("{} packs could not be striped and stay whole.", failed);
+            return 1;
+        }
+        SUCCESS("{} packs striped into {} data and {} parity shards.", repository.pack_count(), layout.data, layout.parity);
+        return 0;
+    }
+}  // namespace commands
@@ -0,0 +1,83 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/verify.h"
+#include "commands/commands.h"
+
+namespace commands {
+    static void print_report(const backup::VerifyReport& report) {
+        for (const auto& pack : report.unreadable_packs) PRINTLN("unreadable-pack  {}", pack);
+        for (const auto& problem : report.problems) {
+            PRINTLN("{}  {}  {}", backup::verify_issue_name(problem.issue), problem.snapshot, problem.path);
+        }
+        LOG("{} entries checked, {} files rehashed, {} chunks checked, {} bytes read.", report.entries_checked, report.files_rehashed,
+            report.chunks_checked, report.bytes_checked);
+        if (report.shards_rebuilt) LOG("{} shards rebuilt.", report.shards_rebuilt);
+    }
+
+    //! Quick mode compares one snapshot with the live tree, full mode scrubs the whole repository.
+    int32_t verify(int32_t argc, char** argv) {
+        Arguments arguments(argc, argv, { "snapshot", "against", "threads", "exclude", "exclude-from" });
+        uint64_t threads = 0;
+        if (!arguments.valid() || arguments.positional_count() != 1 || !arguments.number("threads", threads)) {
+            if (!arguments.valid()) ERROR("{}", arguments.error());
+            print_usage();
+            return 2;
+        }
+
+        const std::string& repository_path = arguments.positional(0);
+        backup::Repository repository;
+        if (!repository.open(repository_path) || !repository.lock(false)) {
+            ERROR("Could not open repository '{}'.", repository_path);
+            return 1;
+        }
+
+        std::vector<std::string> ids = repository.snapshot_ids();
+        if (arguments.has("snapshot")) {
+            ids = { arguments.value("snapshot") };
+        } else if (!arguments.flag("full") && !ids.empty()) {
+            ids = { repository.latest_snapshot_id() };
+        }
+        if (ids.empty()) {
+            ERROR("Repository '{}' has no snapshots.", repository_path);
+            return 1;
+        }
+
+        std::vector<backup::Snapshot> snapshots(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (!repository.load_snapshot(ids[i], snapshots[i])) {
+                ERROR("Snapshot {} is missing or damaged.", ids[i]);
+                return 1;
+            }
+        }
+
+        backup::VerifyReport report;
+        if (arguments.flag("full")) {
+            std::vector<const backup::Snapshot*> selected;
+            for (const auto& snapshot : snapshots) selected.push_back(&snapshot);
+            if (!backup::verify_full(repository, selected, (uint32_t) threads, report)) return 1;
+        } else {
+            files::PathFilter filter;
+            if (!build_filter(arguments, filter)) return 2;
+            const auto& snapshot = snapshots.front();
+            std::string live_root = arguments.value("against", snapshot.source);
+            if (!backup::verify_quick(repository, snapshot, live_root, &filter, arguments.flag("hash-xattrs"), report)) {
+                ERROR("Could not scan '{}'.", live_root);
+                return 1;
+            }
+        }
+
+        print_report(report);
+        if (!report.intact()) {
+            ERROR("Repository '{}' is damaged.", repository_path);
+            return 1;
+        }
+        if (!report.problems.empty()) {
+            WARN("Backup intact, {} differences found.", report.problems.size());
+            return 3;
+        }
+        SUCCESS("Backup intact.");
+        return 0;
+    }
+}  // namespace commands
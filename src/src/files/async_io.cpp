@@ -0,0 +1,380 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/async_io.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "metrics/metrics.h"
+
+namespace files {
+    static metrics::Counter& g_io_submitted = metrics::counter("fward_async_io_operations_total", "Operations issued through an IoContext.");
+    static metrics::Counter& g_io_enters = metrics::counter("fward_async_io_enters_total", "io_uring_enter calls, each submitting a whole batch.");
+
+    //! The mapped submission and completion rings. Raw syscalls rather than liburing, so there is no
+    //! extra dependency; only the few operations above are needed.
+    struct IoContext::Ring {
+        int32_t fd = -1;
+        void* sq_map = MAP_FAILED;
+        size_t sq_map_size = 0;
+        void* cq_map = MAP_FAILED;
+        size_t cq_map_size = 0;
+        io_uring_sqe* sqes = nullptr;
+        size_t sqes_size = 0;
+
+        uint32_t* sq_head = nullptr;
+        uint32_t* sq_tail = nullptr;
+        uint32_t sq_mask = 0;
+        uint32_t sq_entries = 0;
+        uint32_t* sq_array = nullptr;
+        uint32_t* cq_head = nullptr;
+        uint32_t* cq_tail = nullptr;
+        uint32_t cq_mask = 0;
+        io_uring_cqe* cqes = nullptr;
+        //! Filled but not yet passed to io_uring_enter.
+        uint32_t unsubmitted = 0;
+
+        ~Ring() {
+            if (sqes) ::munmap(sqes, sqes_size);
+            if (cq_map != MAP_FAILED && cq_map != sq_map) ::munmap(cq_map, cq_map_size);
+            if (sq_map != MAP_FAILED) ::munmap(sq_map, sq_map_size);
+            if (fd >= 0) ::close(fd);
+        }
+
+        bool open(uint32_t entries) {
+            io_uring_params params {};
+            fd = (int32_t) ::syscall(__NR_io_uring_setup, entries, &params);
+            if (fd < 0) return false;
+
+            sq_map_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+            cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            if (params.features & IORING_FEAT_SINGLE_MMAP) sq_map_size = cq_map_size = std::max(sq_map_size, cq_map_size);
+            sq_map = ::mmap(nullptr, sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (sq_map == MAP_FAILED) return false;
+            cq_map = sq_map;
+            if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+                cq_map = ::mmap(nullptr, cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+                if (cq_map == MAP_FAILED) return false;
+            }
+            sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            void* sqes_map = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            if (sqes_map == MAP_FAILED) return false;
+            sqes = (io_uring_sqe*) sqes_map;
+
+            auto* sq = (byte*) sq_map;
+            sq_head = (uint32_t*) (sq + params.sq_off.head);
+            sq_tail = (uint32_t*) (sq + params.sq_off.tail);
+            sq_mask = *(uint32_t*) (sq + params.sq_off.ring_mask);
+            sq_entries = params.sq_entries;
+            sq_array = (uint32_t*) (sq + params.sq_off.array);
+            auto* cq = (byte*) cq_map;
+            cq_head = (uint32_t*) (cq + params.cq_off.head);
+            cq_tail = (uint32_t*) (cq + params.cq_off.tail);
+            cq_mask = *(uint32_t*) (cq + params.cq_off.ring_mask);
+            cqes = (io_uring_cqe*) (cq + params.cq_off.cqes);
+            return true;
+        }
+
+        //! Next free submission entry, or nullptr when the ring is full; push() publishes it.
+        io_uring_sqe* next() {
+            uint32_t head = std::atomic_ref<uint32_t>(*sq_head).load(std::memory_order_acquire);
+            uint32_t tail = *sq_tail;
+            if (tail - head >= sq_entries) return nullptr;
+            io_uring_sqe* sqe = &sqes[tail & sq_mask];
+            std::memset(sqe, 0, sizeof(*sqe));
+            return sqe;
+        }
+        void push() {
+            uint32_t tail = *sq_tail;
+            sq_array[tail & sq_mask] = tail & sq_mask;
+            std::atomic_ref<uint32_t>(*sq_tail).store(tail + 1, std::memory_order_release);
+            unsubmitted++;
+        }
+
+        //! Submits everything filled so far and, with `wait`, blocks for at least one completion.
+        bool enter(bool wait) {
+            uint32_t flags = wait ? IORING_ENTER_GETEVENTS : 0;
+            while (true) {
+                long submitted = ::syscall(__NR_io_uring_enter, fd, unsubmitted, wait ? 1 : 0, flags, nullptr, 0);
+                if (submitted >= 0) {
+                    unsubmitted -= (uint32_t) submitted;
+                    g_io_enters.add();
+                    return true;
+                }
+                // A signal only interrupted the wait. EAGAIN and EBUSY are transient as well: the kernel
+                // is short on memory or still flushing completions.
+                if (errno != EINTR && errno != EAGAIN && errno != EBUSY) return false;
+            }
+        }
+
+        template<typename Visit>
+        void reap(Visit&& visit) {
+            uint32_t head = *cq_head;
+            uint32_t tail = std::atomic_ref<uint32_t>(*cq_tail).load(std::memory_order_acquire);
+            for (; head != tail; ++head) {
+                const io_uring_cqe& cqe = cqes[head & cq_mask];
+                visit(cqe.user_data, cqe.res);
+            }
+            std::atomic_ref<uint32_t>(*cq_head).store(head, std::memory_order_release);
+        }
+    };
+
+    IoContext::IoContext() = default;
+
+    IoContext::~IoContext() {
+        close();
+    }
+
+    bool IoContext::open(const IoOptions& options) {
+        close();
+        m_options = options;
+        m_options.queue_depth = std::max(1u, m_options.queue_depth);
+        if (m_options.use_io_uring) {
+            auto ring = std::make_unique<Ring>();
+            if (ring->open(m_options.queue_depth)) {
+                m_ring = std::move(ring);
+                return true;
+            }
+        }
+        m_pool = std::make_unique<tasks::TaskGroup>(tasks::Priority::Normal);
+        return true;
+    }
+
+    void IoContext::close() {
+        ASSERT_EX(!m_in_flight && !m_live_tasks, "IoContext closed with work in flight.");
+        m_ring.reset();
+        m_submitted.clear();
+        m_pool.reset();
+    }
+
+    bool IoContext::uses_io_uring() const {
+        return m_ring != nullptr;
+    }
+
+    bool IoContext::register_buffers(const std::vector<std::span<byte>>& buffers) {
+        if (!m_ring) return true;
+        std::vector<iovec> vectors;
+        for (const auto& buffer : buffers) vectors.push_back({ buffer.data(), buffer.size() });
+        return ::syscall(__NR_io_uring_register, m_ring->fd, IORING_REGISTER_BUFFERS, vectors.data(), (unsigned) vectors.size()) == 0;
+    }
+
+    IoOperation IoContext::read(int32_t fd, void* data, uint32_t size, uint64_t offset) {
+        IoOperation operation(*this, IoOpcode::Read, fd);
+        operation.m_data = data;
+        operation.m_length = size;
+        operation.m_offset = offset;
+        return operation;
+    }
+
+    IoOperation IoContext::write(int32_t fd, const void* data, uint32_t size, uint64_t offset) {
+        IoOperation operation(*this, IoOpcode::Write, fd);
+        operation.m_data = data;
+        operation.m_length = size;
+        operation.m_offset = offset;
+        return operation;
+    }
+
+    IoOperation IoContext::read_fixed(int32_t fd, uint32_t buffer, void* data, uint32_t size, uint64_t offset) {
+        IoOperation operation = read(fd, data, size, offset);
+        operation.m_opcode = IoOpcode::ReadFixed;
+        operation.m_flags = (int32_t) buffer;
+        return operation;
+    }
+
+    IoOperation IoContext::write_fixed(int32_t fd, uint32_t buffer, const void* data, uint32_t size, uint64_t offset) {
+        IoOperation operation = write(fd, data, size, offset);
+        operation.m_opcode = IoOpcode::WriteFixed;
+        operation.m_flags = (int32_t) buffer;
+        return operation;
+    }
+
+    IoOperation IoContext::openat(int32_t directory, const char* path, int32_t flags, uint32_t mode) {
+        IoOperation operation(*this, IoOpcode::OpenAt, directory);
+        operation.m_data = path;
+        operation.m_length = mode;
+        operation.m_flags = flags | O_CLOEXEC;
+        return operation;
+    }
+
+    IoOperation IoContext::statx(int32_t directory, const char* path, int32_t flags, uint32_t mask, struct statx* out) {
+        IoOperation operation(*this, IoOpcode::Statx, directory);
+        operation.m_data = path;
+        operation.m_length = mask;
+        operation.m_flags = flags;
+        operation.m_statx = out;
+        return operation;
+    }
+
+    IoOperation IoContext::close_fd(int32_t fd) {
+        return IoOperation(*this, IoOpcode::Close, fd);
+    }
+
+    void IoOperation::await_suspend(std::coroutine_handle<> handle) {
+        m_handle = handle;
+        m_context.queue(this);
+    }
+
+    void IoContext::queue(IoOperation* operation) {
+        ASSERT_EX(m_ring || m_pool, "IoContext used before open().");
+        m_queued.push_back(operation);
+        g_io_submitted.add();
+    }
+
+    void IoContext::complete(IoOperation* operation, int32_t result) {
+        operation->m_result = result;
+        m_ready.push_back(operation->m_handle);
+        m_in_flight--;
+    }
+
+    static void prepare(io_uring_sqe* sqe, uint8_t opcode, int32_t fd, const void* address, uint32_t length, uint64_t offset) {
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t) address;
+        sqe->len = length;
+        sqe->off = offset;
+    }
+
+    void IoContext::issue() {
+        while (!m_queued.empty() && m_in_flight < m_options.queue_depth) {
+            IoOperation* operation = m_queued.front();
+            if (!m_ring) {
+                m_queued.pop_front();
+                m_in_flight++;
+                m_pool->run([this, operation]() { run_blocking(operation); });
+                continue;
+            }
+
+            io_uring_sqe* sqe = m_ring->next();
+            if (!sqe) break;
+            m_queued.pop_front();
+            m_in_flight++;
+            switch (operation->m_opcode) {
+                case IoOpcode::Read:
+                    prepare(sqe, IORING_OP_READ, operation->m_fd, operation->m_data, operation->m_length, operation->m_offset);
+                    break;
+                case IoOpcode::Write:
+                    prepare(sqe, IORING_OP_WRITE, operation->m_fd, operation->m_data, operation->m_length, operation->m_offset);
+                    break;
+                case IoOpcode::ReadFixed:
+                    prepare(sqe, IORING_OP_READ_FIXED, operation->m_fd, operation->m_data, operation->m_length, operation->m_offset);
+                    sqe->buf_index = (uint16_t) operation->m_flags;
+                    break;
+                case IoOpcode::WriteFixed:
+                    prepare(sqe, IORING_OP_WRITE_FIXED, operation->m_fd, operation->m_data, operation->m_length, operation->m_offset);
+                    sqe->buf_index = (uint16_t) operation->m_flags;
+                    break;
+                case IoOpcode::OpenAt:
+                    prepare(sqe, IORING_OP_OPENAT, operation->m_fd, operation->m_data, operation->m_length, 0);
+                    sqe->open_flags = (uint32_t) operation->m_flags;
+                    break;
+                case IoOpcode::Statx:
+                    prepare(sqe, IORING_OP_STATX, operation->m_fd, operation->m_data, operation->m_length, (uint64_t) operation->m_statx);
+                    sqe->statx_flags = (uint32_t) operation->m_flags;
+                    break;
+                case IoOpcode::Close:
+                    prepare(sqe, IORING_OP_CLOSE, operation->m_fd, nullptr, 0, 0);
+                    break;
+            }
+            sqe->user_data = (uint64_t) operation;
+            m_ring->push();
+            m_submitted.insert(operation);
+        }
+    }
+
+    void IoContext::run_blocking(IoOperation* operation) {
+        long result = 0;
+        auto* data = (void*) operation->m_data;
+        switch (operation->m_opcode) {
+            case IoOpcode::Read:
+            case IoOpcode::ReadFixed:
+                result = ::pread(operation->m_fd, data, operation->m_length, (off_t) operation->m_offset);
+                break;
+            case IoOpcode::Write:
+            case IoOpcode::WriteFixed:
+                result = ::pwrite(operation->m_fd, data, operation->m_length, (off_t) operation->m_offset);
+                break;
+            case IoOpcode::OpenAt:
+                result = ::openat(operation->m_fd, (const char*) data, operation->m_flags, (mode_t) operation->m_length);
+                break;
+            case IoOpcode::Statx:
+                result = ::statx(operation->m_fd, (const char*) data, operation->m_flags, operation->m_length, operation->m_statx);
+                break;
+            case IoOpcode::Close:
+                result = ::close(operation->m_fd);
+                break;
+        }
+        if (result < 0) result = -errno;
+
+        std::lock_guard lock(m_mutex);
+        m_completed.emplace_back(operation, (int32_t) result);
+        m_completed_signal.notify_one();
+    }
+
+    void IoContext::wait_completions() {
+        if (m_ring) {
+            if (!m_ring->enter(true)) {
+                abandon_ring(-errno);
+                return;
+            }
+            m_ring->reap([&](uint64_t data, int32_t result) {
+                auto* operation = (IoOperation*) data;
+                m_submitted.erase(operation);
+                complete(operation, result);
+            });
+            return;
+        }
+        std::vector<std::pair<IoOperation*, int32_t>> completed;
+        {
+            std::unique_lock lock(m_mutex);
+            while (m_completed.empty()) {
+                // The blocking calls may be queued behind this very thread, e.g. when a worker drives
+                // the context, so it runs queued tasks meanwhile like TaskGroup::wait() does.
+                lock.unlock();
+                bool ran = m_pool->scheduler().run_pending();
+                lock.lock();
+                if (!ran) m_completed_signal.wait_for(lock, std::chrono::milliseconds(1), [&]() { return !m_completed.empty(); });
+            }
+            completed.swap(m_completed);
+        }
+        for (auto [operation, result] : completed) complete(operation, result);
+    }
+
+    void IoContext::abandon_ring(int32_t error) {
+        ERROR("io_uring_enter failed: {}, continuing with blocking calls.", std::strerror(-error));
+        // Unmapping the ring and closing it has the kernel cancel whatever it still holds.
+        m_ring.reset();
+        for (IoOperation* operation : m_submitted) complete(operation, error);
+        m_submitted.clear();
+        m_pool = std::make_unique<tasks::TaskGroup>(tasks::Priority::Normal);
+    }
+
+    void IoContext::spawn(IoTask<void> task) {
+        auto handle = std::exchange(task.m_handle, nullptr);
+        handle.promise().owner = this;
+        m_live_tasks++;
+        m_ready.push_back(handle);
+    }
+
+    void IoContext::run() {
+        while (true) {
+            // Everything runnable first, so the next batch collects as many operations as possible.
+            while (!m_ready.empty()) {
+                auto handle = m_ready.front();
+                m_ready.pop_front();
+                handle.resume();
+            }
+            if (!m_live_tasks) return;
+            ASSERT_EX(m_in_flight || !m_queued.empty(), "Spawned tasks are stuck without I/O.");
+            issue();
+            wait_completions();
+        }
+    }
+}  // namespace files
@@ -0,0 +1,141 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/device.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(LINUX)
+    #include <linux/fiemap.h>
+    #include <linux/fs.h>
+    #include <sys/ioctl.h>
+    #include <sys/sysmacros.h>
+#endif
+
+#include "metrics/metrics.h"
+
+namespace files {
+    static metrics::Counter& g_sorted_files = metrics::counter("fward_io_sorted_files_total", "Files read in physical order from rotational disks.");
+
+    //! Assumed where sysfs has none; network and FUSE mounts also do better with several requests in flight.
+    static constexpr uint32_t c_default_queue_depth = 64;
+    //! Requests each reader keeps in flight through readahead.
+    static constexpr uint32_t c_requests_per_reader = 8;
+    static constexpr uint32_t c_max_readers = 32;
+
+    uint32_t BlockDevice::readers() const {
+        if (rotational) return 1;
+        uint32_t depth = queue_depth ? queue_depth : c_default_queue_depth;
+        return std::clamp(depth / c_requests_per_reader, 2u, c_max_readers);
+    }
+
+#if defined(LINUX)
+    static bool read_line(const std::filesystem::path& path, std::string& line) {
+        std::ifstream stream(path);
+        return stream && std::getline(stream, line);
+    }
+#endif
+
+    BlockDevice block_device(uint64_t dev, const std::string& sysfs) {
+        BlockDevice device;
+        device.id = dev;
+#if defined(LINUX)
+        std::error_code error;
+        auto path = std::filesystem::canonical(FORMAT("{}/dev/block/{}:{}", sysfs, major(dev), minor(dev)), error);
+        if (error) return device;
+        // A partition's directory sits inside its disk's, and only the disk has a queue.
+        if (std::filesystem::exists(path / "partition", error)) path = path.parent_path();
+        device.name = path.filename().string();
+
+        std::string line;
+        uint32_t disk_major = 0;
+        uint32_t disk_minor = 0;
+        if (read_line(path / "dev", line) && std::sscanf(line.c_str(), "%u:%u", &disk_major, &disk_minor) == 2) device.id = makedev(disk_major, disk_minor);
+        if (read_line(path / "queue/rotational", line)) device.rotational = line == "1";
+        if (read_line(path / "queue/nr_requests", line)) device.queue_depth = (uint32_t) std::strtoul(line.c_str(), nullptr, 10);
+#else
+        (void) sysfs;
+#endif
+        return device;
+    }
+
+    bool physical_offset(int32_t fd, uint64_t& offset) {
+#if defined(LINUX)
+        alignas(struct fiemap) byte buffer[sizeof(struct fiemap) + sizeof(struct fiemap_extent)] {};
+        auto* map = reinterpret_cast<struct fiemap*>(buffer);
+        map->fm_length = FIEMAP_MAX_OFFSET;
+        map->fm_extent_count = 1;
+        if (::ioctl(fd, FS_IOC_FIEMAP, map) != 0 || map->fm_mapped_extents == 0) return false;
+        const auto& extent = map->fm_extents[0];
+        // Delayed allocation has no address yet; inline data is read along with the inode.
+        if (extent.fe_flags & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DATA_INLINE)) return false;
+        offset = extent.fe_physical;
+        return true;
+#else
+        (void) fd;
+        (void) offset;
+        return false;
+#endif
+    }
+
+    DeviceQueues::Queue& DeviceQueues::queue_of(uint64_t dev) {
+        auto it = m_by_dev.find(dev);
+        if (it != m_by_dev.end()) return *m_queues[it->second];
+
+        BlockDevice device = block_device(dev, m_sysfs);
+        auto same = std::find_if(m_queues.begin(), m_queues.end(), [&](const auto& queue) { return queue->device.id == device.id; });
+        size_t index = (size_t) (same - m_queues.begin());
+        if (same == m_queues.end()) {
+            m_queues.push_back(std::make_unique<Queue>());
+            m_queues.back()->device = std::move(device);
+        }
+        m_by_dev.emplace(dev, index);
+        return *m_queues[index];
+    }
+
+    void DeviceQueues::add(const std::string& path, uint64_t tag) {
+        struct stat info {};
+        Queue& queue = queue_of(::stat(path.c_str(), &info) == 0 ? (uint64_t) info.st_dev : 0);
+        // Files without a known position go last, in the order they came.
+        uint64_t offset = UINT64_MAX;
+        if (queue.device.rotational) {
+            int32_t fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd >= 0) {
+                physical_offset(fd, offset);
+                ::close(fd);
+            }
+        }
+        queue.items.push_back({ offset, tag });
+    }
+
+    void DeviceQueues::run(tasks::TaskGroup& group, const std::function<void(uint64_t tag)>& job) {
+        uint32_t rounds = 0;
+        for (const auto& queue : m_queues) {
+            if (queue->device.rotational) {
+                std::stable_sort(queue->items.begin(), queue->items.end(), [](const Item& a, const Item& b) { return a.offset < b.offset; });
+                g_sorted_files.add(queue->items.size());
+            }
+            rounds = std::max(rounds, queue->device.readers());
+        }
+        // Every disk gets its first reader before any gets its second, so none waits for a free worker
+        // behind the readers of a faster one.
+        for (uint32_t round = 0; round < rounds; ++round) {
+            for (const auto& queue : m_queues) {
+                if (round >= queue->device.readers() || round >= queue->items.size()) continue;
+                group.run([&group, &job, queue = queue.get()]() {
+                    for (size_t i = queue->next++; i < queue->items.size() && !group.cancelled(); i = queue->next++) job(queue->items[i].tag);
+                });
+            }
+        }
+        group.wait();
+        m_queues.clear();
+        m_by_dev.clear();
+    }
+}  // namespace files
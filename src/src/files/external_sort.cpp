@@ -0,0 +1,19 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/external_sort.h"
+
+#include <atomic>
+
+namespace files {
+    static std::atomic<uint64_t> g_memory_budget = 0;
+
+    void set_memory_budget(uint64_t bytes) {
+        g_memory_budget.store(bytes, std::memory_order_relaxed);
+    }
+
+    uint64_t memory_budget() {
+        return g_memory_budget.load(std::memory_order_relaxed);
+    }
+}  // namespace files
@@ -0,0 +1,259 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/file.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace files {
+    File::~File() {
+        close();
+    }
+
+    File::File(File&& other) noexcept : m_fd(other.m_fd) {
+        other.m_fd = -1;
+    }
+
+    File& File::operator=(File&& other) noexcept {
+        if (this != &other) {
+            close();
+            m_fd = other.m_fd;
+            other.m_fd = -1;
+        }
+        return *this;
+    }
+
+    bool File::open(const std::string& path, FileMode mode) {
+        return open_at(AT_FDCWD, path, mode);
+    }
+
+    bool File::open_at(int32_t directory, const std::string& name, FileMode mode) {
+        close();
+        int flags = O_CLOEXEC;
+        switch (mode) {
+            case FileMode::Read:
+                flags |= O_RDONLY;
+                break;
+            case FileMode::Write:
+                flags |= O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW;
+                break;
+            case FileMode::ReadWrite:
+                flags |= O_RDWR | O_CREAT;
+                break;
+            case FileMode::Append:
+                flags |= O_WRONLY | O_CREAT | O_APPEND;
+                break;
+            case FileMode::Directory:
+                flags |= O_RDONLY | O_DIRECTORY | O_NOFOLLOW;
+                break;
+        }
+        do {
+            m_fd = ::openat(directory, name.c_str(), flags, 0644);
+        } while (m_fd < 0 && errno == EINTR);
+        return m_fd >= 0;
+    }
+
+    bool File::create_at(int32_t directory, const std::string& name) {
+        if (open_at(directory, name, FileMode::Write)) return true;
+        // O_NOFOLLOW reports a symlink as ELOOP; replace the link itself, never what it points to.
+        if (errno != ELOOP || ::unlinkat(directory, name.c_str(), 0) != 0) return false;
+        return open_at(directory, name, FileMode::Write);
+    }
+
+    bool File::open_temporary(const std::string& directory) {
+        close();
+#if defined(LINUX)
+        do {
+            m_fd = ::open(directory.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+        } while (m_fd < 0 && errno == EINTR);
+        if (m_fd >= 0) return true;
+#endif
+        // Filesystems without O_TMPFILE: a named file, unlinked before anyone else can use it.
+        std::string path = directory + "/.tmp-XXXXXX";
+        m_fd = ::mkostemp(path.data(), O_CLOEXEC);
+        if (m_fd < 0) return false;
+        ::unlink(path.c_str());
+        return true;
+    }
+
+    void File::close() {
+        if (m_fd >= 0) ::close(m_fd);
+        m_fd = -1;
+    }
+
+    int64_t File::read(void* data, size_t size) {
+        while (true) {
+            ssize_t result = ::read(m_fd, data, size);
+            if (result >= 0 || errno != EINTR) return result;
+        }
+    }
+
+    int64_t File::read_at(void* data, size_t size, uint64_t offset) const {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t result = ::pread(m_fd, (byte*) data + done, size - done, (off_t) (offset + done));
+            if (result < 0) {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+            if (result == 0) break;
+            done += (size_t) result;
+        }
+        return (int64_t) done;
+    }
+
+    bool File::read_exact_at(void* data, size_t size, uint64_t offset) const {
+        return read_at(data, size, offset) == (int64_t) size;
+    }
+
+    bool File::write_all(const void* data, size_t size) {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t result = ::write(m_fd, (const byte*) data + done, size - done);
+            if (result < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            done += (size_t) result;
+        }
+        return true;
+    }
+
+    bool File::write_all_at(const void* data, size_t size, uint64_t offset) {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t result = ::pwrite(m_fd, (const byte*) data + done, size - done, (off_t) (offset + done));
+            if (result < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            done += (size_t) result;
+        }
+        return true;
+    }
+
+    bool File::sync() {
+#if defined(LINUX)
+        return ::fdatasync(m_fd) == 0;
+#else
+        return ::fsync(m_fd) == 0;
+#endif
+    }
+
+    bool File::truncate(uint64_t size) {
+        return ::ftruncate(m_fd, (off_t) size) == 0;
+    }
+
+    bool File::reserve(uint64_t size) {
+#if defined(LINUX)
+        uint64_t current = this->size();
+        if (size <= current) return true;
+        return ::posix_fallocate(m_fd, (off_t) current, (off_t) (size - current)) == 0;
+#else
+        return true;
+#endif
+    }
+
+    uint64_t File::size() const {
+        struct stat info {};
+        if (::fstat(m_fd, &info) != 0) return 0;
+        return (uint64_t) info.st_size;
+    }
+
+    bool write_file_atomic(const std::string& path, const void* data, size_t size) {
+        std::string temporary = path + ".tmp";
+        File file;
+        if (!file.open(temporary, FileMode::Write) || !file.write_all(data, size) || !file.sync()) {
+            ::unlink(temporary.c_str());
+            return false;
+        }
+        file.close();
+        if (::rename(temporary.c_str(), path.c_str()) != 0) {
+            ::unlink(temporary.c_str());
+            return false;
+        }
+        size_t slash = path.rfind('/');
+        if (slash == std::string::npos) return sync_directory(".");
+        return sync_directory(slash == 0 ? "/" : path.substr(0, slash));
+    }
+
+    bool write_file_exclusive(const std::string& path, const void* data, size_t size) {
+        std::string temporary = path + ".tmp";
+        File file;
+        if (!file.open(temporary, FileMode::Write) || !file.write_all(data, size) || !file.sync()) {
+            ::unlink(temporary.c_str());
+            return false;
+        }
+        file.close();
+        // Unlike rename, link never replaces its target; the complete file appears under `path` or not at all.
+        int result = ::link(temporary.c_str(), path.c_str());
+        int error = errno;
+        ::unlink(temporary.c_str());
+        if (result != 0) {
+            errno = error;
+            return false;
+        }
+        size_t slash = path.rfind('/');
+        if (slash == std::string::npos) return sync_directory(".");
+        return sync_directory(slash == 0 ? "/" : path.substr(0, slash));
+    }
+
+    bool read_whole_file(const std::string& path, std::vector<byte>& out) {
+        File file;
+        if (!file.open(path, FileMode::Read)) return false;
+        out.resize(file.size());
+        int64_t read = file.read_at(out.data(), out.size(), 0);
+        if (read < 0) return false;
+        out.resize((size_t) read);
+        return true;
+    }
+
+    int64_t read_small_file(const std::string& path, size_t limit, std::vector<byte>& out) {
+        int flags = O_RDONLY | O_CLOEXEC;
+#if defined(LINUX)
+        // Spares an inode update per file, but only the owner may ask for it.
+        flags |= O_NOATIME;
+#endif
+        int fd;
+        do {
+            fd = ::open(path.c_str(), flags, 0);
+#if defined(LINUX)
+            if (fd < 0 && errno == EPERM && (flags & O_NOATIME)) {
+                flags &= ~O_NOATIME;
+                errno = EINTR;
+            }
+#endif
+        } while (fd < 0 && errno == EINTR);
+        if (fd < 0) return -1;
+
+        size_t start = out.size();
+        out.resize(start + limit);
+        size_t done = 0;
+        bool failed = false;
+        while (done < limit) {
+            ssize_t result = ::read(fd, out.data() + start + done, limit - done);
+            if (result < 0 && errno == EINTR) continue;
+            if (result <= 0) {
+                failed = result < 0;
+                break;
+            }
+            done += (size_t) result;
+        }
+        ::close(fd);
+        out.resize(start + (failed ? 0 : done));
+        return failed ? -1 : (int64_t) done;
+    }
+
+    bool sync_directory(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) return false;
+        bool synced = ::fsync(fd) == 0;
+        ::close(fd);
+        return synced;
+    }
+}  // namespace files
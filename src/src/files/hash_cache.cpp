@@ -0,0 +1,76 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/hash_cache.h"
+
+#if defined(LINUX) || defined(MACOS)
+    #include <sys/xattr.h>
+#endif
+
+#include "metrics/metrics.h"
+#include "utils/binary.h"
+
+namespace files {
+    static metrics::Counter& g_cache_hits = metrics::counter("fward_hash_cache_hits_total", "Files whose cached hash spared reading them.");
+    static metrics::Counter& g_cache_stores = metrics::counter("fward_hash_cache_stores_total", "Hashes written to file attributes.");
+
+    static constexpr const char* c_attribute = "user.fward.hash";
+    static constexpr uint8_t c_format = 1;
+    //! Format, algorithm, size, mtime and the digest.
+    static constexpr size_t c_value_size = 1 + 1 + 8 + 8 + 32;
+
+#if defined(LINUX)
+    static ssize_t get_attribute(const std::string& path, void* value, size_t size) {
+        return ::getxattr(path.c_str(), c_attribute, value, size);
+    }
+    static int set_attribute(const std::string& path, const void* value, size_t size) {
+        return ::setxattr(path.c_str(), c_attribute, value, size, 0);
+    }
+#elif defined(MACOS)
+    static ssize_t get_attribute(const std::string& path, void* value, size_t size) {
+        return ::getxattr(path.c_str(), c_attribute, value, size, 0, 0);
+    }
+    static int set_attribute(const std::string& path, const void* value, size_t size) {
+        return ::setxattr(path.c_str(), c_attribute, value, size, 0, 0);
+    }
+#else
+    static ssize_t get_attribute(const std::string&, void*, size_t) {
+        return -1;
+    }
+    static int set_attribute(const std::string&, const void*, size_t) {
+        return -1;
+    }
+#endif
+
+    bool load_cached_hash(const std::string& path, HashAlgorithm algorithm, uint64_t size, int64_t mtime_ns, hashing::Digest& digest) {
+        byte value[c_value_size];
+        if (get_attribute(path, value, sizeof(value)) != (ssize_t) sizeof(value)) return false;
+        BinaryReader reader(value, sizeof(value));
+        auto format = reader.get<uint8_t>();
+        auto stored_algorithm = reader.get<uint8_t>();
+        auto stored_size = reader.get<uint64_t>();
+        auto stored_mtime = reader.get<int64_t>();
+        auto stored_digest = reader.get<hashing::Digest>();
+        if (reader.error() || format != c_format || stored_algorithm != (uint8_t) algorithm || stored_size != size || stored_mtime != mtime_ns) {
+            return false;
+        }
+        digest = stored_digest;
+        g_cache_hits.add();
+        return true;
+    }
+
+    bool store_cached_hash(const std::string& path, HashAlgorithm algorithm, uint64_t size, int64_t mtime_ns, const hashing::Digest& digest) {
+        std::vector<byte> value;
+        value.reserve(c_value_size);
+        BinaryWriter writer(value);
+        writer.put(c_format);
+        writer.put((uint8_t) algorithm);
+        writer.put(size);
+        writer.put(mtime_ns);
+        writer.put(digest);
+        if (set_attribute(path, value.data(), value.size()) != 0) return false;
+        g_cache_stores.add();
+        return true;
+    }
+}  // namespace files
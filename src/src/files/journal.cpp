@@ -0,0 +1,196 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/journal.h"
+
+#include <chrono>
+#include <cstring>
+#include <unistd.h>
+
+#include "hashing/crc32c.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+
+namespace files {
+    static constexpr char c_journal_magic[8] = { 'F', 'W', 'J', 'R', 'N', 'L', '0', '1' };
+    static constexpr size_t c_header_size = sizeof(c_journal_magic) + sizeof(uint64_t);
+    static constexpr size_t c_record_header_size = 2 * sizeof(uint32_t);
+    //! Growing the file in large steps keeps the syncs to data only, without a size update each time.
+    static constexpr uint64_t c_reserve_step = 8 * 1024 * 1024;
+
+    static metrics::Counter& g_journal_records = metrics::counter("fward_journal_records_total", "Records appended to write-ahead journals.");
+    static metrics::Counter& g_journal_syncs = metrics::counter("fward_journal_syncs_total", "Group commits, each one write and fdatasync.");
+    static metrics::Gauge& g_journal_pending = metrics::gauge("fward_journal_pending_bytes", "Bytes appended but not yet being written.");
+    static metrics::Histogram& g_journal_sync_seconds =
+        metrics::histogram("fward_journal_sync_seconds", "Time to write and sync one batch.", metrics::latency_bounds());
+
+    static uint32_t record_crc(uint32_t length, const byte* payload) {
+        return hashing::crc32c(payload, length, hashing::crc32c(&length, sizeof(length)));
+    }
+
+    Journal::~Journal() {
+        close();
+    }
+
+    bool Journal::create(uint64_t base) {
+        byte header[c_header_size];
+        std::memcpy(header, c_journal_magic, sizeof(c_journal_magic));
+        std::memcpy(header + sizeof(c_journal_magic), &base, sizeof(base));
+        if (!write_file_atomic(m_path, header, sizeof(header))) return false;
+        return m_file.open(m_path, FileMode::ReadWrite);
+    }
+
+    bool Journal::open(const std::string& path, const ReplayVisitor& replay, const JournalOptions& options) {
+        close();
+        m_path = path;
+        m_options = options;
+        m_pending.clear();
+        m_pending_records = 0;
+        m_last_batch_records = 0;
+        m_failed = false;
+
+        std::vector<byte> data;
+        if (::access(path.c_str(), F_OK) == 0 && !read_whole_file(path, data)) return false;
+        if (data.size() < c_header_size || std::memcmp(data.data(), c_journal_magic, sizeof(c_journal_magic)) != 0) {
+            // Missing, or torn while it was being created; either way there is nothing to replay.
+            if (!create(0)) return false;
+            m_base = m_appended = m_durable = 0;
+            m_offset = m_reserved = c_header_size;
+            return true;
+        }
+
+        std::memcpy(&m_base, data.data() + sizeof(c_journal_magic), sizeof(m_base));
+        uint64_t lsn = m_base;
+        size_t offset = c_header_size;
+        while (data.size() - offset >= c_record_header_size) {
+            uint32_t length;
+            uint32_t crc;
+            std::memcpy(&length, data.data() + offset, sizeof(length));
+            std::memcpy(&crc, data.data() + offset + sizeof(length), sizeof(crc));
+            const byte* payload = data.data() + offset + c_record_header_size;
+            if (length > data.size() - offset - c_record_header_size || crc != record_crc(length, payload)) break;
+            // A record the caller can't make sense of is as good as a corrupt one.
+            if (!replay(lsn + 1, payload, length)) break;
+            ++lsn;
+            offset += c_record_header_size + length;
+        }
+
+        // Cut off the torn tail, otherwise new records would be followed by stale ones.
+        if (!m_file.open(path, FileMode::ReadWrite)) return false;
+        if (offset != data.size() && (!m_file.truncate(offset) || !m_file.sync())) return false;
+        m_appended = m_durable = lsn;
+        m_offset = m_reserved = offset;
+        return true;
+    }
+
+    void Journal::close() {
+        if (!m_file.is_open()) return;
+        sync();
+        m_file.close();
+    }
+
+    uint64_t Journal::append(const void* data, size_t size) {
+        auto length = (uint32_t) size;
+        uint32_t crc = record_crc(length, (const byte*) data);
+
+        std::lock_guard lock(m_mutex);
+        size_t at = m_pending.size();
+        m_pending.resize(at + c_record_header_size + size);
+        std::memcpy(m_pending.data() + at, &length, sizeof(length));
+        std::memcpy(m_pending.data() + at + sizeof(length), &crc, sizeof(crc));
+        std::memcpy(m_pending.data() + at + c_record_header_size, data, size);
+        m_pending_records++;
+        g_journal_records.add();
+        g_journal_pending.set((int64_t) m_pending.size());
+        if (m_pending.size() >= m_options.max_batch_bytes) m_batch_full.notify_one();
+        return ++m_appended;
+    }
+
+    bool Journal::flush_batch(std::unique_lock<std::mutex>& lock) {
+        m_flushing = true;
+        // Only hold the batch open when the last one was shared; a lone writer shouldn't pay the delay.
+        if (m_last_batch_records > 1 && m_options.max_delay_us && m_pending.size() < m_options.max_batch_bytes) {
+            m_batch_full.wait_for(lock, std::chrono::microseconds(m_options.max_delay_us),
+                                  [&]() { return m_pending.size() >= m_options.max_batch_bytes; });
+        }
+
+        std::swap(m_pending, m_writing);
+        uint64_t covered = m_appended;
+        uint64_t offset = m_offset;
+        m_offset += m_writing.size();
+        m_last_batch_records = m_pending_records;
+        m_pending_records = 0;
+        uint64_t reserve = 0;
+        if (m_offset > m_reserved) reserve = m_reserved = (m_offset + c_reserve_step - 1) / c_reserve_step * c_reserve_step;
+
+        g_journal_pending.set(0);
+
+        lock.unlock();
+        TRACE_ZONE("journal.sync");
+        auto started = std::chrono::steady_clock::now();
+        // Preallocation only saves size updates; a filesystem without it still takes the writes.
+        if (reserve) m_file.reserve(reserve);
+        bool written = m_file.write_all_at(m_writing.data(), m_writing.size(), offset) && m_file.sync();
+        g_journal_sync_seconds.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+        g_journal_syncs.add();
+        lock.lock();
+
+        m_writing.clear();
+        m_flushing = false;
+        if (written) {
+            m_durable = covered;
+        } else {
+            m_failed = true;
+        }
+        m_durable_changed.notify_all();
+        return written;
+    }
+
+    bool Journal::wait(uint64_t lsn) {
+        std::unique_lock lock(m_mutex);
+        while (true) {
+            if (m_durable >= lsn) return true;
+            if (m_failed) return false;
+            if (m_flushing) {
+                m_durable_changed.wait(lock);
+            } else {
+                flush_batch(lock);
+            }
+        }
+    }
+
+    bool Journal::reset(uint64_t base) {
+        std::unique_lock lock(m_mutex);
+        m_durable_changed.wait(lock, [&]() { return !m_flushing; });
+        ASSERT_EX(base == m_appended, "Journal reset while writers are active.");
+
+        m_file.close();
+        if (!create(base)) {
+            m_failed = true;
+            m_durable_changed.notify_all();
+            return false;
+        }
+        m_pending.clear();
+        m_pending_records = 0;
+        m_base = m_appended = m_durable = base;
+        m_offset = m_reserved = c_header_size;
+        m_durable_changed.notify_all();
+        return true;
+    }
+
+    uint64_t Journal::last_lsn() const {
+        std::lock_guard lock(m_mutex);
+        return m_appended;
+    }
+
+    uint64_t Journal::durable_lsn() const {
+        std::lock_guard lock(m_mutex);
+        return m_durable;
+    }
+
+    uint64_t Journal::size() const {
+        std::lock_guard lock(m_mutex);
+        return m_offset - c_header_size + m_pending.size();
+    }
+}  // namespace files
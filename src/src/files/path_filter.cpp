@@ -0,0 +1,359 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/path_filter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+namespace files {
+    //! Component names longer than this are folded into a heap buffer instead of the stack.
+    static constexpr size_t c_fold_stack_size = 256;
+
+    static bool is_meta(char ch) {
+        return ch == '*' || ch == '?' || ch == '[';
+    }
+
+    //! Returns true when `component` contains an unescaped glob character.
+    static bool has_meta(std::string_view component) {
+        for (size_t i = 0; i < component.size(); ++i) {
+            if (component[i] == '\\') {
+                ++i;
+                continue;
+            }
+            if (is_meta(component[i])) return true;
+        }
+        return false;
+    }
+
+    static std::string unescape(std::string_view component) {
+        std::string result;
+        result.reserve(component.size());
+        for (size_t i = 0; i < component.size(); ++i) {
+            if (component[i] == '\\' && i + 1 < component.size()) ++i;
+            result += component[i];
+        }
+        return result;
+    }
+
+    static void fold_into(std::string_view value, char* out) {
+        for (size_t i = 0; i < value.size(); ++i) {
+            out[i] = (char) std::tolower((byte) value[i]);
+        }
+    }
+
+    static std::string fold(std::string_view value) {
+        std::string result(value.size(), '\0');
+        fold_into(value, result.data());
+        return result;
+    }
+
+    //! Matches `ch` against the bracket expression starting at `pattern[start] == '['`.
+    //! Returns false when the bracket is never closed, in which case it is a literal '['.
+    static bool match_class(std::string_view pattern, size_t start, char ch, size_t& end, bool& matched) {
+        size_t i = start + 1;
+        bool negate = false;
+        if (i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^')) {
+            negate = true;
+            ++i;
+        }
+        bool found = false;
+        bool first = true;
+        while (i < pattern.size() && (first || pattern[i] != ']')) {
+            first = false;
+            char low = pattern[i];
+            if (low == '\\' && i + 1 < pattern.size()) low = pattern[++i];
+            char high = low;
+            if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+                i += 2;
+                high = pattern[i];
+                if (high == '\\' && i + 1 < pattern.size()) high = pattern[++i];
+            }
+            if ((byte) ch >= (byte) low && (byte) ch <= (byte) high) found = true;
+            ++i;
+        }
+        if (i >= pattern.size()) return false;
+        end = i + 1;
+        matched = found != negate;
+        return true;
+    }
+
+    bool glob_match(std::string_view pattern, std::string_view name) {
+        size_t p = 0;
+        size_t n = 0;
+        size_t star_p = std::string_view::npos;
+        size_t star_n = 0;
+        while (n < name.size()) {
+            if (p < pattern.size()) {
+                char ch = pattern[p];
+                if (ch == '*') {
+                    while (p < pattern.size() && pattern[p] == '*') ++p;
+                    star_p = p;
+                    star_n = n;
+                    continue;
+                }
+                if (ch == '?') {
+                    ++p;
+                    ++n;
+                    continue;
+                }
+                if (ch == '[') {
+                    size_t end = 0;
+                    bool matched = false;
+                    if (match_class(pattern, p, name[n], end, matched)) {
+                        if (matched) {
+                            p = end;
+                            ++n;
+                            continue;
+                        }
+                    } else if (name[n] == '[') {
+                        ++p;
+                        ++n;
+                        continue;
+                    }
+                } else {
+                    size_t next = p + 1;
+                    if (ch == '\\' && next < pattern.size()) ch = pattern[next++];
+                    if (ch == name[n]) {
+                        p = next;
+                        ++n;
+                        continue;
+                    }
+                }
+            }
+            if (star_p == std::string_view::npos) return false;
+            p = star_p;
+            n = ++star_n;
+        }
+        while (p < pattern.size() && pattern[p] == '*') ++p;
+        return p == pattern.size();
+    }
+
+    PathFilter::PathFilter(bool case_insensitive) : m_case_insensitive(case_insensitive) {
+        m_nodes.emplace_back();
+    }
+
+    uint32_t PathFilter::child(uint32_t node, std::string_view component) {
+        auto create = [this]() {
+            m_nodes.emplace_back();
+            return (uint32_t) (m_nodes.size() - 1);
+        };
+
+        if (component == "**") {
+            if (m_nodes[node].recursive == 0) {
+                uint32_t id = create();
+                m_nodes[id].is_recursive = true;
+                m_nodes[node].recursive = id;
+            }
+            return m_nodes[node].recursive;
+        }
+
+        // The map lives inside m_nodes, so the new node is only created once the map is no longer used.
+        auto insert = [&](NameMap& map, std::string key) {
+            auto it = map.find(key);
+            if (it != map.end()) return it->second;
+            auto id = (uint32_t) m_nodes.size();
+            map.emplace(std::move(key), id);
+            create();
+            return id;
+        };
+        auto bucket = [](std::vector<AffixBucket>& buckets, uint32_t length) -> NameMap& {
+            for (auto& bucket : buckets) {
+                if (bucket.length == length) return bucket.targets;
+            }
+            buckets.push_back({ length, {} });
+            return buckets.back().targets;
+        };
+
+        if (!has_meta(component)) {
+            return insert(m_nodes[node].literals, unescape(component));
+        }
+        if (component.front() == '*' && !has_meta(component.substr(1))) {
+            std::string suffix = unescape(component.substr(1));
+            auto length = (uint32_t) suffix.size();
+            return insert(bucket(m_nodes[node].suffixes, length), std::move(suffix));
+        }
+        if (component.back() == '*' && component.size() > 1 && component[component.size() - 2] != '\\' &&
+            !has_meta(component.substr(0, component.size() - 1))) {
+            std::string prefix = unescape(component.substr(0, component.size() - 1));
+            auto length = (uint32_t) prefix.size();
+            return insert(bucket(m_nodes[node].prefixes, length), std::move(prefix));
+        }
+        for (const auto& glob : m_nodes[node].globs) {
+            if (glob.pattern == component) return glob.target;
+        }
+        uint32_t id = create();
+        m_nodes[node].globs.push_back({ std::string(component), id });
+        return id;
+    }
+
+    bool PathFilter::add_rule(std::string_view line) {
+        ASSERT_EX(!m_compiled, "Rules can not be added after compile().");
+
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        // Trailing spaces are ignored unless escaped with a backslash.
+        while (!line.empty() && line.back() == ' ' && !(line.size() > 1 && line[line.size() - 2] == '\\')) {
+            line.remove_suffix(1);
+        }
+        if (line.empty() || line.front() == '#') return true;
+        std::string_view text = line;
+
+        Rule rule {};
+        if (line.front() == '!') {
+            rule.negated = true;
+            line.remove_prefix(1);
+        }
+        while (!line.empty() && line.back() == '/') {
+            rule.directory_only = true;
+            line.remove_suffix(1);
+        }
+        bool anchored = line.find('/') != std::string_view::npos;
+        while (!line.empty() && line.front() == '/') line.remove_prefix(1);
+        if (line.empty()) return false;
+
+        std::vector<std::string_view> components;
+        if (!anchored) components.emplace_back("**");
+        while (!line.empty()) {
+            size_t slash = line.find('/');
+            std::string_view component = line.substr(0, slash);
+            line.remove_prefix(slash == std::string_view::npos ? line.size() : slash + 1);
+            if (component.empty()) continue;
+            if (component == "**" && !components.empty() && components.back() == "**") continue;
+            components.push_back(component);
+        }
+        if (components.empty()) return false;
+        // "dir/**" matches everything inside dir but not dir itself.
+        if (components.back() == "**") components.emplace_back("*");
+
+        uint32_t node = 0;
+        for (auto component : components) {
+            node = m_case_insensitive ? child(node, fold(component)) : child(node, component);
+        }
+        auto index = (int32_t) m_rules.size();
+        m_rules.push_back(rule);
+        m_lines.emplace_back(text);
+        if (rule.directory_only) {
+            m_nodes[node].accept_directory = index;
+        } else {
+            m_nodes[node].accept_any = index;
+        }
+        return true;
+    }
+
+    bool PathFilter::load(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) return false;
+        bool valid = true;
+        std::string line;
+        while (std::getline(file, line)) {
+            valid &= add_rule(line);
+        }
+        return valid;
+    }
+
+    void PathFilter::compile() {
+        for (auto& node : m_nodes) {
+            auto by_length = [](const AffixBucket& left, const AffixBucket& right) { return left.length < right.length; };
+            std::sort(node.suffixes.begin(), node.suffixes.end(), by_length);
+            std::sort(node.prefixes.begin(), node.prefixes.end(), by_length);
+        }
+        m_compiled = true;
+    }
+
+    void PathFilter::close(std::vector<uint32_t>& states) const {
+        // Consecutive "**" are collapsed while parsing, so one level of closure is enough.
+        size_t count = states.size();
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t recursive = m_nodes[states[i]].recursive;
+            if (recursive != 0) states.push_back(recursive);
+        }
+        std::sort(states.begin(), states.end());
+        states.erase(std::unique(states.begin(), states.end()), states.end());
+    }
+
+    template<typename Visit>
+    void PathFilter::step(const std::vector<uint32_t>& states, std::string_view name, Visit&& visit) const {
+        char stack[c_fold_stack_size];
+        std::string heap;
+        if (m_case_insensitive) {
+            char* out = stack;
+            if (name.size() > c_fold_stack_size) {
+                heap.resize(name.size());
+                out = heap.data();
+            }
+            fold_into(name, out);
+            name = { out, name.size() };
+        }
+
+        for (uint32_t state : states) {
+            const auto& node = m_nodes[state];
+            if (node.is_recursive) visit(state);
+            if (!node.literals.empty()) {
+                auto it = node.literals.find(name);
+                if (it != node.literals.end()) visit(it->second);
+            }
+            for (const auto& bucket : node.suffixes) {
+                if (bucket.length > name.size()) break;
+                auto it = bucket.targets.find(name.substr(name.size() - bucket.length));
+                if (it != bucket.targets.end()) visit(it->second);
+            }
+            for (const auto& bucket : node.prefixes) {
+                if (bucket.length > name.size()) break;
+                auto it = bucket.targets.find(name.substr(0, bucket.length));
+                if (it != bucket.targets.end()) visit(it->second);
+            }
+            for (const auto& glob : node.globs) {
+                if (glob_match(glob.pattern, name)) visit(glob.target);
+            }
+        }
+    }
+
+    FilterVerdict PathFilter::verdict(int32_t rule) const {
+        if (rule < 0) return FilterVerdict::Unmatched;
+        return m_rules[rule].negated ? FilterVerdict::Included : FilterVerdict::Excluded;
+    }
+
+    PathFilter::Cursor PathFilter::root() const {
+        ASSERT_EX(m_compiled, "PathFilter::compile() must be called before matching.");
+        Cursor cursor;
+        cursor.m_states.push_back(0);
+        close(cursor.m_states);
+        return cursor;
+    }
+
+    FilterVerdict PathFilter::match(const Cursor& parent, std::string_view name, bool is_directory) const {
+        int32_t best = -1;
+        step(parent.m_states, name, [&](uint32_t target) {
+            const auto& node = m_nodes[target];
+            best = std::max(best, node.accept_any);
+            if (is_directory) best = std::max(best, node.accept_directory);
+        });
+        return verdict(best);
+    }
+
+    PathFilter::Cursor PathFilter::enter(const Cursor& parent, std::string_view name) const {
+        Cursor cursor;
+        step(parent.m_states, name, [&](uint32_t target) { cursor.m_states.push_back(target); });
+        close(cursor.m_states);
+        return cursor;
+    }
+
+    FilterVerdict PathFilter::match(std::string_view path, bool is_directory) const {
+        Cursor cursor = root();
+        while (!path.empty() && path.front() == '/') path.remove_prefix(1);
+        while (!path.empty() && path.back() == '/') path.remove_suffix(1);
+        while (!path.empty()) {
+            size_t slash = path.find('/');
+            if (slash == std::string_view::npos) return match(cursor, path, is_directory);
+            std::string_view component = path.substr(0, slash);
+            path.remove_prefix(slash + 1);
+            if (component.empty()) continue;
+            if (match(cursor, component, true) == FilterVerdict::Excluded) return FilterVerdict::Excluded;
+            cursor = enter(cursor, component);
+            if (cursor.exhausted()) return FilterVerdict::Unmatched;
+        }
+        return FilterVerdict::Unmatched;
+    }
+}  // namespace files
@@ -0,0 +1,172 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/path_store.h"
+
+#include <cstring>
+
+namespace files {
+    static size_t hash_entry(PathId parent, std::string_view name) {
+        return std::hash<std::string_view> {}(name) ^ (parent * 0x9E3779B97F4A7C15ull);
+    }
+
+    PathStore::PathStore() {
+        m_nodes.push_back({ c_invalid_path, 0, c_directory_bit, 0 });
+        m_index.assign(1024, c_invalid_path);
+    }
+
+    std::string_view PathStore::name(PathId id) const {
+        const Node& node = m_nodes[id];
+        size_t length = node.length & ~c_directory_bit;
+        if (length == 0) return {};
+        return { m_blocks[node.name >> c_block_bits].get() + (node.name & (c_block_size - 1)), length };
+    }
+
+    uint32_t PathStore::store_name(std::string_view name) {
+        if (name.empty()) return 0;
+        if (m_block_used + name.size() > c_block_size) {
+            CHECK_EX(m_blocks.size() < (1ull << (32 - c_block_bits)), "PathStore name arena exhausted.");
+            m_blocks.push_back(std::make_unique<char[]>(c_block_size));
+            m_block_used = 0;
+        }
+        auto offset = (uint32_t) (((m_blocks.size() - 1) << c_block_bits) | m_block_used);
+        std::memcpy(m_blocks.back().get() + m_block_used, name.data(), name.size());
+        m_block_used += (uint32_t) name.size();
+        return offset;
+    }
+
+    PathId PathStore::append(PathId parent, std::string_view name, bool is_directory) {
+        CHECK_EX(name.size() < c_directory_bit, "Path component too long: {}", name.size());
+        CHECK_EX(m_nodes.size() < c_invalid_path, "PathStore is full.");
+        // compare() and contains() walk by depth, so it must not wrap; such a path is the caller's to report.
+        if (m_nodes[parent].depth >= c_max_depth) return c_invalid_path;
+        auto length = (uint16_t) name.size();
+        if (is_directory) length |= c_directory_bit;
+        m_nodes.push_back({ parent, store_name(name), length, (uint16_t) (m_nodes[parent].depth + 1) });
+        return (PathId) (m_nodes.size() - 1);
+    }
+
+    size_t PathStore::slot(PathId parent, std::string_view name) const {
+        size_t mask = m_index.size() - 1;
+        size_t i = hash_entry(parent, name) & mask;
+        while (true) {
+            PathId id = m_index[i];
+            if (id == c_invalid_path || (m_nodes[id].parent == parent && this->name(id) == name)) return i;
+            i = (i + 1) & mask;
+        }
+    }
+
+    void PathStore::grow_index() {
+        std::vector<PathId> old(m_index.size() * 2, c_invalid_path);
+        old.swap(m_index);
+        for (PathId id : old) {
+            if (id != c_invalid_path) m_index[slot(m_nodes[id].parent, name(id))] = id;
+        }
+    }
+
+    PathId PathStore::intern_directory(PathId parent, std::string_view name) {
+        size_t i = slot(parent, name);
+        if (m_index[i] != c_invalid_path) return m_index[i];
+
+        PathId id = append(parent, name, true);
+        if (id == c_invalid_path) return id;
+        m_index[i] = id;
+        if (++m_directories * 10 > m_index.size() * 7) grow_index();
+        return id;
+    }
+
+    PathId PathStore::find_directory(PathId parent, std::string_view name) const {
+        return m_index[slot(parent, name)];
+    }
+
+    PathId PathStore::add_leaf(PathId parent, std::string_view name) {
+        return append(parent, name, false);
+    }
+
+    PathId PathStore::intern(std::string_view path, bool is_directory) {
+        PathId current = c_root_path;
+        while (!path.empty()) {
+            size_t slash = path.find('/');
+            std::string_view component = path.substr(0, slash);
+            path.remove_prefix(slash == std::string_view::npos ? path.size() : slash + 1);
+            if (component.empty() || component == ".") continue;
+            bool last = path.find_first_not_of('/') == std::string_view::npos;
+            if (last && !is_directory) return add_leaf(current, component);
+            current = intern_directory(current, component);
+            if (current == c_invalid_path) break;
+        }
+        return current;
+    }
+
+    size_t PathStore::path(PathId id, char* buffer, size_t capacity) const {
+        if (id == c_root_path) {
+            if (capacity >= 2) std::memcpy(buffer, "/", 2);
+            return 1;
+        }
+        size_t length = 0;
+        for (PathId current = id; current != c_root_path; current = m_nodes[current].parent) {
+            length += 1 + (m_nodes[current].length & ~c_directory_bit);
+        }
+        if (length + 1 > capacity) return length;
+
+        buffer[length] = '\0';
+        size_t end = length;
+        for (PathId current = id; current != c_root_path; current = m_nodes[current].parent) {
+            std::string_view part = name(current);
+            end -= part.size();
+            std::memcpy(buffer + end, part.data(), part.size());
+            buffer[--end] = '/';
+        }
+        return length;
+    }
+
+    void PathStore::path(PathId id, std::string& out) const {
+        out.resize(out.capacity());
+        size_t length = path(id, out.data(), out.size() + 1);
+        if (length > out.size()) {
+            out.resize(length);
+            path(id, out.data(), length + 1);
+        }
+        out.resize(length);
+    }
+
+    std::string PathStore::path(PathId id) const {
+        std::string result;
+        path(id, result);
+        return result;
+    }
+
+    int32_t PathStore::compare(PathId left, PathId right) const {
+        if (left == right) return 0;
+        // Lift the deeper one to the same depth; if it lands on the other, that one is its ancestor.
+        PathId a = left;
+        PathId b = right;
+        while (m_nodes[a].depth > m_nodes[b].depth) {
+            a = m_nodes[a].parent;
+            if (a == b) return 1;
+        }
+        while (m_nodes[b].depth > m_nodes[a].depth) {
+            b = m_nodes[b].parent;
+            if (a == b) return -1;
+        }
+        while (m_nodes[a].parent != m_nodes[b].parent) {
+            a = m_nodes[a].parent;
+            b = m_nodes[b].parent;
+        }
+        int32_t order = name(a).compare(name(b));
+        if (order != 0) return order < 0 ? -1 : 1;
+        // Identical names only happen for leaves that were added twice.
+        return a < b ? -1 : 1;
+    }
+
+    bool PathStore::contains(PathId ancestor, PathId id) const {
+        if (m_nodes[id].depth < m_nodes[ancestor].depth) return false;
+        while (m_nodes[id].depth > m_nodes[ancestor].depth) id = m_nodes[id].parent;
+        return id == ancestor;
+    }
+
+    size_t PathStore::memory_usage() const {
+        return m_nodes.capacity() * sizeof(Node) + m_blocks.size() * c_block_size + m_index.capacity() * sizeof(PathId);
+    }
+}  // namespace files
@@ -0,0 +1,222 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/reader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "metrics/metrics.h"
+
+#if !defined(__NR_cachestat)
+    #define __NR_cachestat 451
+#endif
+
+namespace files {
+    static metrics::Counter& g_files_buffered = metrics::counter("fward_read_buffered_files_total", "Files read with pread.");
+    static metrics::Counter& g_files_mapped = metrics::counter("fward_read_mapped_files_total", "Files read through a mapping.");
+    static metrics::Counter& g_files_direct = metrics::counter("fward_read_direct_files_total", "Files read with O_DIRECT.");
+    static metrics::Counter& g_direct_fallbacks = metrics::counter("fward_read_direct_fallbacks_total", "Direct reads that failed and were retried buffered.");
+
+    //! Files up to this size are never mapped; setting up the mapping costs more than the copy.
+    static constexpr uint64_t c_small_file_size = 1024 * 1024;
+    //! Uncached files from this size on bypass the cache instead of being dropped behind the reader.
+    static constexpr uint64_t c_direct_min_size = 32 * 1024 * 1024;
+    //! Smallest window read at once, so a large file never turns into a stream of small reads.
+    static constexpr size_t c_min_window = 8 * 1024 * 1024;
+    //! What was read is dropped from the cache in steps of this size rather than after every window.
+    static constexpr uint64_t c_drop_step = 32 * 1024 * 1024;
+
+    static const size_t c_page_size = (size_t) ::sysconf(_SC_PAGESIZE);
+
+    //! Layouts of the cachestat(2) arguments, which older kernel headers don't have.
+    struct CachestatRange {
+        uint64_t offset;
+        uint64_t length;
+    };
+    struct Cachestat {
+        uint64_t cached;
+        uint64_t dirty;
+        uint64_t writeback;
+        uint64_t evicted;
+        uint64_t recently_evicted;
+    };
+
+    //! Whether most of the file is in the page cache, i.e. someone else is using it. Kernels without
+    //! cachestat (before 6.5) report every file as uncached.
+    static bool is_cached(int32_t fd, uint64_t size) {
+        CachestatRange range { 0, 0 };
+        Cachestat stat {};
+        if (size == 0 || ::syscall(__NR_cachestat, fd, &range, &stat, 0) != 0) return false;
+        uint64_t pages = (size + c_page_size - 1) / c_page_size;
+        return stat.cached * 2 > pages;
+    }
+
+    //! Offset alignment O_DIRECT needs for this file, 0 when its filesystem can't do direct I/O.
+    static size_t direct_alignment(int32_t fd) {
+        struct statx info {};
+        if (::statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &info) != 0 || !(info.stx_mask & STATX_DIOALIGN)) {
+            // Kernels before 6.1 don't say; a page is what every filesystem accepts, if it accepts any.
+            return c_page_size;
+        }
+        // Windows are page aligned, so a stricter memory alignment can't be met.
+        if (info.stx_dio_mem_align == 0 || info.stx_dio_mem_align > c_page_size) return 0;
+        return info.stx_dio_offset_align;
+    }
+
+    void Reader::AlignedFree::operator()(byte* data) const {
+        std::free(data);
+    }
+
+    Reader::Reader() = default;
+
+    Reader::~Reader() {
+        close();
+    }
+
+    bool Reader::open(const std::string& path, const ReadOptions& options) {
+        close();
+        if (!m_file.open(path, FileMode::Read)) return false;
+        int32_t fd = m_file.descriptor();
+        m_size = m_file.size();
+        bool cached = is_cached(fd, m_size);
+        m_drop_cache = options.keep_cache_clean && !cached;
+
+        m_strategy = options.strategy;
+        if (m_strategy == ReadStrategy::Auto) {
+            if (options.immutable && m_size > c_small_file_size && (cached || !options.keep_cache_clean)) {
+                m_strategy = ReadStrategy::Mapped;
+            } else if (m_drop_cache && m_size >= c_direct_min_size) {
+                m_strategy = ReadStrategy::Direct;
+            } else {
+                m_strategy = ReadStrategy::Buffered;
+            }
+        }
+
+        if (m_strategy == ReadStrategy::Mapped) {
+            void* mapping = m_size ? ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+            if (mapping != MAP_FAILED) {
+                ::madvise(mapping, m_size, MADV_SEQUENTIAL);
+                m_mapping = (const byte*) mapping;
+                g_files_mapped.add();
+                return true;
+            }
+            m_strategy = ReadStrategy::Buffered;
+        }
+        if (m_strategy == ReadStrategy::Direct) {
+            size_t align = direct_alignment(fd);
+            int flags = ::fcntl(fd, F_GETFL);
+            if (align && flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_DIRECT) == 0) {
+                m_align = align;
+                // Nothing to drop: direct reads don't go through the cache.
+                m_drop_cache = false;
+                g_files_direct.add();
+                return true;
+            }
+            m_strategy = ReadStrategy::Buffered;
+        }
+        if (m_size > c_small_file_size) ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        g_files_buffered.add();
+        return true;
+    }
+
+    void Reader::close() {
+        // Unmapped first, mapped pages can't be dropped.
+        if (m_mapping) ::munmap((void*) m_mapping, m_size);
+        m_mapping = nullptr;
+        if (m_file.is_open() && m_drop_cache) ::posix_fadvise(m_file.descriptor(), (off_t) m_dropped, 0, POSIX_FADV_DONTNEED);
+        m_file.close();
+        m_size = 0;
+        m_drop_cache = false;
+        m_dropped = 0;
+        m_align = 1;
+        m_buffer_offset = 0;
+        m_buffered = 0;
+        m_eof = false;
+    }
+
+    bool Reader::view(uint64_t offset, size_t length, std::span<const byte>& out) {
+        if (m_mapping) {
+            uint64_t start = std::min(offset, m_size);
+            out = { m_mapping + start, (size_t) std::min<uint64_t>(length, m_size - start) };
+            drop_behind(start);
+            return true;
+        }
+
+        bool covered = offset >= m_buffer_offset && (m_eof || offset + length <= m_buffer_offset + m_buffered);
+        if (!covered && !fill(offset, length)) return false;
+        size_t start = (size_t) std::min<uint64_t>(offset - m_buffer_offset, m_buffered);
+        out = { m_buffer.get() + start, std::min(length, m_buffered - start) };
+        return true;
+    }
+
+    bool Reader::fill(uint64_t offset, size_t length) {
+        uint64_t base = offset / m_align * m_align;
+        size_t capacity = std::max<size_t>((size_t) (offset - base) + length, c_min_window);
+        capacity = (capacity + m_align - 1) / m_align * m_align;
+
+        // Whatever of the window is still buffered moves to the front instead of being read again.
+        size_t keep = 0;
+        if (base >= m_buffer_offset && base < m_buffer_offset + m_buffered) keep = (size_t) (m_buffer_offset + m_buffered - base);
+        if (capacity > m_capacity) {
+            std::unique_ptr<byte, AlignedFree> buffer((byte*) std::aligned_alloc(c_page_size, (capacity + c_page_size - 1) / c_page_size * c_page_size));
+            if (!buffer) return false;
+            if (keep) std::memcpy(buffer.get(), m_buffer.get() + (base - m_buffer_offset), keep);
+            m_buffer = std::move(buffer);
+            m_capacity = capacity;
+        } else if (keep) {
+            std::memmove(m_buffer.get(), m_buffer.get() + (base - m_buffer_offset), keep);
+        }
+        m_buffer_offset = base;
+        m_buffered = keep;
+        m_eof = false;
+
+        // One request for the whole rest of the window; the kernel splits it as the device likes.
+        while (m_buffered < capacity) {
+            size_t wanted = capacity - m_buffered;
+            ssize_t result = ::pread(m_file.descriptor(), m_buffer.get() + m_buffered, wanted, (off_t) (m_buffer_offset + m_buffered));
+            if (result < 0) {
+                if (errno == EINTR) continue;
+                if (m_strategy != ReadStrategy::Direct || !fall_back_to_buffered()) return false;
+                continue;
+            }
+            m_buffered += (size_t) result;
+            // Regular files only come up short at their end, and a direct read can't continue past it anyway.
+            if ((size_t) result < wanted) {
+                m_eof = true;
+                break;
+            }
+        }
+        drop_behind(base);
+        return true;
+    }
+
+    bool Reader::fall_back_to_buffered() {
+        // Some filesystems accept O_DIRECT on open and only refuse the reads, e.g. with EINVAL.
+        int flags = ::fcntl(m_file.descriptor(), F_GETFL);
+        if (flags < 0 || ::fcntl(m_file.descriptor(), F_SETFL, flags & ~O_DIRECT) != 0) return false;
+        g_direct_fallbacks.add();
+        m_strategy = ReadStrategy::Buffered;
+        m_align = 1;
+        // Direct I/O was there to keep the cache clean; dropping behind the reader does that now.
+        m_drop_cache = true;
+        return true;
+    }
+
+    void Reader::drop_behind(uint64_t offset) {
+        offset = offset / c_page_size * c_page_size;
+        if (!m_drop_cache || offset < m_dropped + c_drop_step) return;
+        // Pages still mapped by us would stay cached, so they are unmapped from this range first.
+        if (m_mapping) ::madvise((void*) (m_mapping + m_dropped), offset - m_dropped, MADV_DONTNEED);
+        ::posix_fadvise(m_file.descriptor(), (off_t) m_dropped, (off_t) (offset - m_dropped), POSIX_FADV_DONTNEED);
+        m_dropped = offset;
+    }
+}  // namespace files
@@ -0,0 +1,121 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/scanner.h"
+
+#include <vector>
+
+#if defined(POSIX_NATIVE)
+    #include <dirent.h>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+#else
+    #include <filesystem>
+#endif
+
+namespace files {
+    struct PendingDirectory {
+        std::string path;
+        uint32_t depth;
+        PathFilter::Cursor cursor;
+    };
+
+#if defined(POSIX_NATIVE)
+    static EntryType entry_type(int dir_fd, const dirent* entry) {
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN) {
+            struct stat info {};
+            if (fstatat(dir_fd, entry->d_name, &info, AT_SYMLINK_NOFOLLOW) != 0) return EntryType::Other;
+            if (S_ISREG(info.st_mode)) return EntryType::File;
+            if (S_ISDIR(info.st_mode)) return EntryType::Directory;
+            if (S_ISLNK(info.st_mode)) return EntryType::Symlink;
+            return EntryType::Other;
+        }
+        switch (type) {
+            case DT_REG:
+                return EntryType::File;
+            case DT_DIR:
+                return EntryType::Directory;
+            case DT_LNK:
+                return EntryType::Symlink;
+            default:
+                return EntryType::Other;
+        }
+    }
+
+    //! Calls `callback(name, type)` for every entry in `path`, returns false when it can't be opened.
+    template<typename Callback>
+    static bool list_directory(const std::string& path, Callback&& callback) {
+        DIR* dir = opendir(path.c_str());
+        if (!dir) return false;
+        int dir_fd = dirfd(dir);
+        while (const dirent* entry = readdir(dir)) {
+            std::string_view name(entry->d_name);
+            if (name == "." || name == "..") continue;
+            callback(name, entry_type(dir_fd, entry));
+        }
+        closedir(dir);
+        return true;
+    }
+#else
+    template<typename Callback>
+    static bool list_directory(const std::string& path, Callback&& callback) {
+        std::error_code error;
+        std::filesystem::directory_iterator it(path, error);
+        if (error) return false;
+        for (; it != std::filesystem::directory_iterator(); it.increment(error)) {
+            if (error) return false;
+            auto status = it->symlink_status(error);
+            EntryType type = EntryType::Other;
+            if (std::filesystem::is_symlink(status)) {
+                type = EntryType::Symlink;
+            } else if (std::filesystem::is_directory(status)) {
+                type = EntryType::Directory;
+            } else if (std::filesystem::is_regular_file(status)) {
+                type = EntryType::File;
+            }
+            std::string name = it->path().filename().string();
+            callback(std::string_view(name), type);
+        }
+        return true;
+    }
+#endif
+
+    ScanStats scan(const std::string& root, const PathFilter* filter, const ScanVisitor& visitor) {
+        ScanStats stats {};
+        std::string start = root;
+        while (start.size() > 1 && start.back() == '/') start.pop_back();
+
+        std::vector<PendingDirectory> pending;
+        pending.push_back({ std::move(start), 0, filter ? filter->root() : PathFilter::Cursor {} });
+
+        std::string path;
+        while (!pending.empty()) {
+            PendingDirectory directory = std::move(pending.back());
+            pending.pop_back();
+            stats.directories++;
+
+            bool filtering = filter && !directory.cursor.exhausted();
+            bool listed = list_directory(directory.path, [&](std::string_view name, EntryType type) {
+                bool is_directory = type == EntryType::Directory;
+                if (filtering && filter->match(directory.cursor, name, is_directory) == FilterVerdict::Excluded) {
+                    stats.excluded++;
+                    return;
+                }
+
+                path.assign(directory.path);
+                if (path.back() != '/') path += '/';
+                path.append(name);
+                if (type == EntryType::File) stats.files++;
+
+                ScanEntry entry { path, std::string_view(path).substr(path.size() - name.size()), type, directory.depth + 1 };
+                if (visitor(entry) && is_directory) {
+                    pending.push_back({ path, directory.depth + 1, filtering ? filter->enter(directory.cursor, name) : PathFilter::Cursor {} });
+                }
+            });
+            if (!listed) stats.errors++;
+        }
+        return stats;
+    }
+}  // namespace files
@@ -0,0 +1,219 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "hashing/crc32c.h"
+
+#include <array>
+#include <bit>
+#include <cstring>
+
+#if defined(COMP_CPU_X86_64)
+    #include <nmmintrin.h>
+    #include <wmmintrin.h>
+#elif defined(COMP_CPU_AARCH64)
+    #include <arm_acle.h>
+    #include <arm_neon.h>
+#endif
+
+#include "utils/cpu.h"
+
+namespace hashing {
+    static constexpr uint32_t c_polynomial = 0x82F63B78;  // Reflected 0x1EDC6F41.
+
+    //! Table k advances a byte by k further zero bytes, so eight lookups take a whole word (slice-by-8).
+    static constexpr std::array<std::array<uint32_t, 256>, 8> make_tables() {
+        std::array<std::array<uint32_t, 256>, 8> tables {};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (c_polynomial & (0 - (crc & 1)));
+            tables[0][i] = crc;
+        }
+        for (size_t k = 1; k < tables.size(); ++k) {
+            for (uint32_t i = 0; i < 256; ++i) tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+        }
+        return tables;
+    }
+
+    static constexpr auto c_tables = make_tables();
+
+    // Polynomials below are reflected like the crc itself: bit 31 is x^0.
+
+    //! a * b modulo the CRC polynomial.
+    static constexpr uint32_t multiply_mod(uint32_t a, uint32_t b) {
+        uint32_t product = 0;
+        for (uint32_t bit = 1u << 31; bit; bit >>= 1) {
+            if (a & bit) product ^= b;
+            b = (b & 1) ? (b >> 1) ^ c_polynomial : b >> 1;
+        }
+        return product;
+    }
+
+    //! x^power modulo the CRC polynomial, by squaring.
+    static constexpr uint32_t x_power_mod(uint64_t power) {
+        uint32_t result = 1u << 31;
+        uint32_t square = 1u << 30;
+        for (; power; power >>= 1) {
+            if (power & 1) result = multiply_mod(result, square);
+            square = multiply_mod(square, square);
+        }
+        return result;
+    }
+
+    using CrcFunction = uint32_t (*)(uint32_t crc, const byte* data, size_t size);
+
+    //! Works on the raw crc, without the inversions before and after, like the instructions do.
+    static uint32_t crc_generic(uint32_t crc, const byte* data, size_t size) {
+        if constexpr (std::endian::native == std::endian::little) {
+            for (; size >= 8; data += 8, size -= 8) {
+                uint64_t word;
+                std::memcpy(&word, data, sizeof(word));
+                word ^= crc;
+                crc = c_tables[7][word & 0xFF] ^ c_tables[6][(word >> 8) & 0xFF] ^ c_tables[5][(word >> 16) & 0xFF] ^
+                      c_tables[4][(word >> 24) & 0xFF] ^ c_tables[3][(word >> 32) & 0xFF] ^ c_tables[2][(word >> 40) & 0xFF] ^
+                      c_tables[1][(word >> 48) & 0xFF] ^ c_tables[0][word >> 56];
+            }
+        }
+        for (; size; ++data, --size) crc = (crc >> 8) ^ c_tables[0][(crc ^ *data) & 0xFF];
+        return crc;
+    }
+
+    // The crc instructions take three cycles but can start one per cycle, so large inputs are split into
+    // three streams that run interleaved and are joined afterwards. Long blocks carry the bulk; short
+    // ones take what is left, so only the last few hundred bytes run as a single stream.
+    static constexpr size_t c_long_block = 8192;
+    static constexpr size_t c_short_block = 256;
+
+    //! Multipliers for the carry-less shift of a stream over one and two blocks of each size. A 32 by
+    //! 32 bit carry-less product comes out one bit up, and reducing its 64 bits through the crc
+    //! instruction multiplies by x^32, so each is x^(8 * bytes - 33).
+    static constexpr uint32_t c_shift_long_1 = x_power_mod(c_long_block * 8 - 33);
+    static constexpr uint32_t c_shift_long_2 = x_power_mod(2 * c_long_block * 8 - 33);
+    static constexpr uint32_t c_shift_short_1 = x_power_mod(c_short_block * 8 - 33);
+    static constexpr uint32_t c_shift_short_2 = x_power_mod(2 * c_short_block * 8 - 33);
+    static constexpr uint32_t c_x_33 = x_power_mod(33);
+
+    //! The crc of a stream followed by as many zero bytes as `multiplier` stands for, which joins it to
+    //! the next: crc(a + b) = shift(crc(a), |b|) ^ crc(b). Without carry-less multiplication it's done
+    //! in software, too slow to pay off for short blocks, so those are left out then.
+    static uint32_t shift_software(uint32_t crc, uint32_t multiplier) {
+        return multiply_mod(multiply_mod(multiplier, c_x_33), crc);
+    }
+
+#if defined(COMP_CPU_X86_64)
+    COMP_TARGET("sse4.2")
+    static uint32_t crc_words_sse42(uint32_t crc, const byte* data, size_t size) {
+        uint64_t value = crc;
+        for (; size >= 8; data += 8, size -= 8) {
+            uint64_t word;
+            std::memcpy(&word, data, sizeof(word));
+            value = _mm_crc32_u64(value, word);
+        }
+        crc = (uint32_t) value;
+        for (; size; ++data, --size) crc = _mm_crc32_u8(crc, *data);
+        return crc;
+    }
+
+    COMP_TARGET("sse4.2,pclmul")
+    static uint32_t shift_pclmul(uint32_t crc, uint32_t multiplier) {
+        __m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128((int32_t) crc), _mm_cvtsi32_si128((int32_t) multiplier), 0);
+        return (uint32_t) _mm_crc32_u64(0, (uint64_t) _mm_cvtsi128_si64(product));
+    }
+
+    //! Runs three streams of `block` bytes side by side for as long as `size` allows.
+    template<uint32_t (*Shift)(uint32_t, uint32_t)>
+    COMP_TARGET("sse4.2")
+    static uint32_t crc_streams_x86(uint32_t crc, const byte*& data, size_t& size, size_t block, uint32_t shift_1, uint32_t shift_2) {
+        for (; size >= 3 * block; data += 3 * block, size -= 3 * block) {
+            uint64_t crc0 = crc, crc1 = 0, crc2 = 0;
+            for (size_t i = 0; i < block; i += 8) {
+                uint64_t word0, word1, word2;
+                std::memcpy(&word0, data + i, 8);
+                std::memcpy(&word1, data + block + i, 8);
+                std::memcpy(&word2, data + 2 * block + i, 8);
+                crc0 = _mm_crc32_u64(crc0, word0);
+                crc1 = _mm_crc32_u64(crc1, word1);
+                crc2 = _mm_crc32_u64(crc2, word2);
+            }
+            crc = Shift((uint32_t) crc0, shift_2) ^ Shift((uint32_t) crc1, shift_1) ^ (uint32_t) crc2;
+        }
+        return crc;
+    }
+
+    template<uint32_t (*Shift)(uint32_t, uint32_t)>
+    COMP_TARGET("sse4.2")
+    static uint32_t crc_x86(uint32_t crc, const byte* data, size_t size) {
+        crc = crc_streams_x86<Shift>(crc, data, size, c_long_block, c_shift_long_1, c_shift_long_2);
+        if constexpr (Shift != shift_software) crc = crc_streams_x86<Shift>(crc, data, size, c_short_block, c_shift_short_1, c_shift_short_2);
+        return crc_words_sse42(crc, data, size);
+    }
+#elif defined(COMP_CPU_AARCH64)
+    COMP_TARGET("arch=armv8-a+crc")
+    static uint32_t crc_words_arm(uint32_t crc, const byte* data, size_t size) {
+        for (; size >= 8; data += 8, size -= 8) {
+            uint64_t word;
+            std::memcpy(&word, data, sizeof(word));
+            crc = __crc32cd(crc, word);
+        }
+        for (; size; ++data, --size) crc = __crc32cb(crc, *data);
+        return crc;
+    }
+
+    COMP_TARGET("arch=armv8-a+crc+crypto")
+    static uint32_t shift_pmull(uint32_t crc, uint32_t multiplier) {
+        return __crc32cd(0, (uint64_t) vmull_p64(crc, multiplier));
+    }
+
+    template<uint32_t (*Shift)(uint32_t, uint32_t)>
+    COMP_TARGET("arch=armv8-a+crc")
+    static uint32_t crc_streams_arm(uint32_t crc, const byte*& data, size_t& size, size_t block, uint32_t shift_1, uint32_t shift_2) {
+        for (; size >= 3 * block; data += 3 * block, size -= 3 * block) {
+            uint32_t crc0 = crc, crc1 = 0, crc2 = 0;
+            for (size_t i = 0; i < block; i += 8) {
+                uint64_t word0, word1, word2;
+                std::memcpy(&word0, data + i, 8);
+                std::memcpy(&word1, data + block + i, 8);
+                std::memcpy(&word2, data + 2 * block + i, 8);
+                crc0 = __crc32cd(crc0, word0);
+                crc1 = __crc32cd(crc1, word1);
+                crc2 = __crc32cd(crc2, word2);
+            }
+            crc = Shift(crc0, shift_2) ^ Shift(crc1, shift_1) ^ crc2;
+        }
+        return crc;
+    }
+
+    template<uint32_t (*Shift)(uint32_t, uint32_t)>
+    COMP_TARGET("arch=armv8-a+crc")
+    static uint32_t crc_arm(uint32_t crc, const byte* data, size_t size) {
+        crc = crc_streams_arm<Shift>(crc, data, size, c_long_block, c_shift_long_1, c_shift_long_2);
+        if constexpr (Shift != shift_software) crc = crc_streams_arm<Shift>(crc, data, size, c_short_block, c_shift_short_1, c_shift_short_2);
+        return crc_words_arm(crc, data, size);
+    }
+#endif
+
+    struct CrcKernel {
+        const char* name;
+        CrcFunction function;
+    };
+
+    static CrcKernel select_crc([[maybe_unused]] const CpuFeatures& cpu) {
+#if defined(COMP_CPU_X86_64)
+        if (cpu.sse42 && cpu.pclmul) return { "sse4.2+pclmul", crc_x86<shift_pclmul> };
+        if (cpu.sse42) return { "sse4.2", crc_x86<shift_software> };
+#elif defined(COMP_CPU_AARCH64)
+        if (cpu.arm_crc32 && cpu.arm_pmull) return { "crc32+pmull", crc_arm<shift_pmull> };
+        if (cpu.arm_crc32) return { "crc32", crc_arm<shift_software> };
+#endif
+        return { "generic", crc_generic };
+    }
+
+    const char* crc32c_kernel(const CpuFeatures& cpu) {
+        return select_crc(cpu).name;
+    }
+
+    uint32_t crc32c(const void* data, size_t size, uint32_t crc) {
+        static const CrcFunction function = select_crc(cpu_features()).function;
+        return ~function(~crc, (const byte*) data, size);
+    }
+}  // namespace hashing
@@ -0,0 +1,142 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "hashing/rolling.h"
+
+#if defined(COMP_CPU_X86_64)
+    #include <immintrin.h>
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif
+
+#include "utils/cpu.h"
+
+namespace hashing {
+    // b = sum((size - i) * x[i]) = size * sum(x[i]) - sum(i * x[i]), so the kernels only produce the
+    // plain sum and the index-weighted sum of their prefix and the scalar tail finishes both.
+    struct BlockSums {
+        uint32_t sum = 0;
+        uint32_t weighted = 0;
+        size_t done = 0;
+    };
+
+    using BlockSumsFunction = BlockSums (*)(const byte* data, size_t size);
+
+#if defined(COMP_CPU_X86_64)
+    //! block_sums() below on 32-byte blocks.
+    COMP_TARGET("avx2")
+    static BlockSums block_sums_avx2(const byte* data, size_t size) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i weights_low = _mm256_set_epi16(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+        const __m256i weights_high = _mm256_set_epi16(31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16);
+        __m256i sums = zero;
+        __m256i prefix = zero;
+        __m256i weighted = zero;
+
+        size_t blocks = size / 32;
+        for (size_t j = 0; j < blocks; ++j) {
+            __m256i bytes = _mm256_loadu_si256((const __m256i*) (data + j * 32));
+            prefix = _mm256_add_epi32(prefix, sums);
+            sums = _mm256_add_epi32(sums, _mm256_sad_epu8(bytes, zero));
+            // Widened per 16-byte half, as the unpack instructions would interleave the halves.
+            __m256i low = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes));
+            __m256i high = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1));
+            weighted = _mm256_add_epi32(weighted, _mm256_madd_epi16(low, weights_low));
+            weighted = _mm256_add_epi32(weighted, _mm256_madd_epi16(high, weights_high));
+        }
+
+        auto horizontal = [](__m256i value) COMP_TARGET("avx2") {
+            __m128i half = _mm_add_epi32(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+            half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+            half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+            return (uint32_t) _mm_cvtsi128_si32(half);
+        };
+        uint32_t sum = horizontal(sums);
+        return { sum, 32 * ((uint32_t) (blocks - 1) * sum - horizontal(prefix)) + horizontal(weighted), blocks * 32 };
+    }
+#endif
+
+#if defined(__SSE2__)
+    static BlockSums block_sums(const byte* data, size_t size) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i weights_low = _mm_set_epi16(7, 6, 5, 4, 3, 2, 1, 0);
+        const __m128i weights_high = _mm_set_epi16(15, 14, 13, 12, 11, 10, 9, 8);
+        __m128i sums = zero;
+        __m128i prefix = zero;
+        __m128i weighted = zero;
+
+        size_t blocks = size / 16;
+        for (size_t j = 0; j < blocks; ++j) {
+            __m128i bytes = _mm_loadu_si128((const __m128i*) (data + j * 16));
+            // Adding the running total before each block leaves sum((blocks - 1 - j) * s[j]) in `prefix`.
+            prefix = _mm_add_epi32(prefix, sums);
+            sums = _mm_add_epi32(sums, _mm_sad_epu8(bytes, zero));
+            weighted = _mm_add_epi32(weighted, _mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero), weights_low));
+            weighted = _mm_add_epi32(weighted, _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero), weights_high));
+        }
+
+        auto horizontal = [](__m128i value) {
+            value = _mm_add_epi32(value, _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2)));
+            value = _mm_add_epi32(value, _mm_shuffle_epi32(value, _MM_SHUFFLE(2, 3, 0, 1)));
+            return (uint32_t) _mm_cvtsi128_si32(value);
+        };
+        uint32_t sum = horizontal(sums);
+        return { sum, 16 * ((uint32_t) (blocks - 1) * sum - horizontal(prefix)) + horizontal(weighted), blocks * 16 };
+    }
+#elif defined(__ARM_NEON)
+    static BlockSums block_sums(const byte* data, size_t size) {
+        static constexpr uint8_t c_weights[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+        const uint8x8_t weights_low = vld1_u8(c_weights);
+        const uint8x8_t weights_high = vld1_u8(c_weights + 8);
+        uint32x4_t sums = vdupq_n_u32(0);
+        uint32x4_t prefix = vdupq_n_u32(0);
+        uint32x4_t weighted = vdupq_n_u32(0);
+
+        size_t blocks = size / 16;
+        for (size_t j = 0; j < blocks; ++j) {
+            uint8x16_t bytes = vld1q_u8(data + j * 16);
+            prefix = vaddq_u32(prefix, sums);
+            sums = vpadalq_u16(sums, vpaddlq_u8(bytes));
+            weighted = vpadalq_u16(weighted, vmull_u8(vget_low_u8(bytes), weights_low));
+            weighted = vpadalq_u16(weighted, vmull_u8(vget_high_u8(bytes), weights_high));
+        }
+        uint32_t sum = vaddvq_u32(sums);
+        return { sum, 16 * ((uint32_t) (blocks - 1) * sum - vaddvq_u32(prefix)) + vaddvq_u32(weighted), blocks * 16 };
+    }
+#else
+    static BlockSums block_sums(const byte*, size_t) {
+        return {};
+    }
+#endif
+
+    struct BlockSumsKernel {
+        const char* name;
+        BlockSumsFunction function;
+    };
+
+    static BlockSumsKernel select_block_sums([[maybe_unused]] const CpuFeatures& cpu) {
+#if defined(COMP_CPU_X86_64)
+        if (cpu.avx2) return { "avx2", block_sums_avx2 };
+#endif
+        return { "generic", block_sums };
+    }
+
+    const char* rolling_checksum_kernel(const CpuFeatures& cpu) {
+        return select_block_sums(cpu).name;
+    }
+
+    uint32_t rolling_checksum(const byte* data, size_t size) {
+        static const BlockSumsFunction function = select_block_sums(cpu_features()).function;
+        BlockSums sums = function(data, size);
+        for (size_t i = sums.done; i < size; ++i) {
+            sums.sum += data[i];
+            sums.weighted += (uint32_t) i * data[i];
+        }
+        uint32_t a = sums.sum & 0xFFFF;
+        uint32_t b = ((uint32_t) size * sums.sum - sums.weighted) & 0xFFFF;
+        return a | (b << 16);
+    }
+}  // namespace hashing
@@ -0,0 +1,207 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "hashing/sha256.h"
+
+#include <algorithm>
+
+#if defined(COMP_CPU_X86_64)
+    #include <immintrin.h>
+#elif defined(COMP_CPU_AARCH64)
+    #include <arm_neon.h>
+#endif
+
+#include "utils/cpu.h"
+
+namespace hashing {
+    static constexpr uint32_t c_round_constants[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be,
+        0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa,
+        0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85,
+        0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+        0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
+        0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    static inline uint32_t rotate_right(uint32_t value, uint32_t count) {
+        return (value >> count) | (value << (32 - count));
+    }
+
+    static inline uint32_t load_big_endian(const byte* data) {
+        return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) | ((uint32_t) data[2] << 8) | (uint32_t) data[3];
+    }
+
+    using CompressFunction = void (*)(uint32_t* state, const byte* data, size_t blocks);
+
+    static void compress_generic(uint32_t* state, const byte* data, size_t blocks) {
+        for (; blocks; --blocks, data += 64) {
+            uint32_t w[64];
+            for (int i = 0; i < 16; ++i) w[i] = load_big_endian(data + i * 4);
+            for (int i = 16; i < 64; ++i) {
+                uint32_t s0 = rotate_right(w[i - 15], 7) ^ rotate_right(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                uint32_t s1 = rotate_right(w[i - 2], 17) ^ rotate_right(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int i = 0; i < 64; ++i) {
+                uint32_t s1 = rotate_right(e, 6) ^ rotate_right(e, 11) ^ rotate_right(e, 25);
+                uint32_t choose = (e & f) ^ (~e & g);
+                uint32_t t1 = h + s1 + choose + c_round_constants[i] + w[i];
+                uint32_t s0 = rotate_right(a, 2) ^ rotate_right(a, 13) ^ rotate_right(a, 22);
+                uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+                uint32_t t2 = s0 + majority;
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+            state[5] += f;
+            state[6] += g;
+            state[7] += h;
+        }
+    }
+
+#if defined(COMP_CPU_X86_64)
+    // The rounds instruction works on the state as ABEF and CDGH halves; it does two rounds per call
+    // and takes their message words plus constants from the low half of its third operand.
+    COMP_TARGET("sha,sse4.1,ssse3")
+    static void compress_sha_ni(uint32_t* state, const byte* data, size_t blocks) {
+        const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull);
+        __m128i dcba = _mm_loadu_si128((const __m128i*) &state[0]);
+        __m128i hgfe = _mm_loadu_si128((const __m128i*) &state[4]);
+        __m128i cdab = _mm_shuffle_epi32(dcba, 0xB1);
+        __m128i efgh = _mm_shuffle_epi32(hgfe, 0x1B);
+        __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+        __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+        for (; blocks; --blocks, data += 64) {
+            const __m128i abef_start = abef;
+            const __m128i cdgh_start = cdgh;
+            // Words 4i..4i+3 of the schedule live in w[i % 4] while rounds 4i..4i+3 run.
+            __m128i w[4];
+            for (int i = 0; i < 4; ++i) w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (data + i * 16)), byte_swap);
+            for (int i = 0; i < 16; ++i) {
+                if (i >= 4) {
+                    __m128i next = _mm_sha256msg1_epu32(w[i % 4], w[(i + 1) % 4]);
+                    next = _mm_add_epi32(next, _mm_alignr_epi8(w[(i + 3) % 4], w[(i + 2) % 4], 4));
+                    w[i % 4] = _mm_sha256msg2_epu32(next, w[(i + 3) % 4]);
+                }
+                __m128i words = _mm_add_epi32(w[i % 4], _mm_loadu_si128((const __m128i*) &c_round_constants[i * 4]));
+                cdgh = _mm_sha256rnds2_epu32(cdgh, abef, words);
+                abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(words, 0x0E));
+            }
+            abef = _mm_add_epi32(abef, abef_start);
+            cdgh = _mm_add_epi32(cdgh, cdgh_start);
+        }
+
+        __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+        __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+        _mm_storeu_si128((__m128i*) &state[0], _mm_blend_epi16(feba, dchg, 0xF0));
+        _mm_storeu_si128((__m128i*) &state[4], _mm_alignr_epi8(dchg, feba, 8));
+    }
+#elif defined(COMP_CPU_AARCH64)
+    COMP_TARGET("arch=armv8-a+sha2")
+    static void compress_arm(uint32_t* state, const byte* data, size_t blocks) {
+        uint32x4_t abcd = vld1q_u32(&state[0]);
+        uint32x4_t efgh = vld1q_u32(&state[4]);
+        for (; blocks; --blocks, data += 64) {
+            const uint32x4_t abcd_start = abcd;
+            const uint32x4_t efgh_start = efgh;
+            uint32x4_t w[4];
+            for (int i = 0; i < 4; ++i) w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+            for (int i = 0; i < 16; ++i) {
+                if (i >= 4) w[i % 4] = vsha256su1q_u32(vsha256su0q_u32(w[i % 4], w[(i + 1) % 4]), w[(i + 2) % 4], w[(i + 3) % 4]);
+                uint32x4_t words = vaddq_u32(w[i % 4], vld1q_u32(&c_round_constants[i * 4]));
+                uint32x4_t previous = abcd;
+                abcd = vsha256hq_u32(abcd, efgh, words);
+                efgh = vsha256h2q_u32(efgh, previous, words);
+            }
+            abcd = vaddq_u32(abcd, abcd_start);
+            efgh = vaddq_u32(efgh, efgh_start);
+        }
+        vst1q_u32(&state[0], abcd);
+        vst1q_u32(&state[4], efgh);
+    }
+#endif
+
+    struct CompressKernel {
+        const char* name;
+        CompressFunction function;
+    };
+
+    static CompressKernel select_compress([[maybe_unused]] const CpuFeatures& cpu) {
+#if defined(COMP_CPU_X86_64)
+        if (cpu.sha && cpu.sse41 && cpu.ssse3) return { "sha-ni", compress_sha_ni };
+#elif defined(COMP_CPU_AARCH64)
+        if (cpu.sha) return { "armv8-sha2", compress_arm };
+#endif
+        return { "generic", compress_generic };
+    }
+
+    const char* Sha256::kernel(const CpuFeatures& cpu) {
+        return select_compress(cpu).name;
+    }
+
+    Sha256::Sha256() : m_state { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 } { }
+
+    void Sha256::compress(const byte* data, size_t blocks) {
+        static const CompressFunction function = select_compress(cpu_features()).function;
+        function(m_state, data, blocks);
+    }
+
+    void Sha256::update(const void* data, size_t size) {
+        auto input = (const byte*) data;
+        m_length += size;
+        if (m_buffered > 0) {
+            size_t take = std::min(size, sizeof(m_buffer) - m_buffered);
+            std::memcpy(m_buffer + m_buffered, input, take);
+            m_buffered += take;
+            input += take;
+            size -= take;
+            if (m_buffered < sizeof(m_buffer)) return;
+            compress(m_buffer, 1);
+            m_buffered = 0;
+        }
+        size_t blocks = size / 64;
+        if (blocks) compress(input, blocks);
+        input += blocks * 64;
+        size -= blocks * 64;
+        std::memcpy(m_buffer, input, size);
+        m_buffered = size;
+    }
+
+    Digest Sha256::finish() {
+        uint64_t bits = m_length * 8;
+        byte padding[72] = { 0x80 };
+        size_t pad = (m_buffered < 56 ? 56 : 120) - m_buffered;
+        for (int i = 0; i < 8; ++i) padding[pad + i] = (byte) (bits >> (56 - i * 8));
+        update(padding, pad + 8);
+
+        Digest digest {};
+        for (int i = 0; i < 8; ++i) {
+            digest[i * 4] = (byte) (m_state[i] >> 24);
+            digest[i * 4 + 1] = (byte) (m_state[i] >> 16);
+            digest[i * 4 + 2] = (byte) (m_state[i] >> 8);
+            digest[i * 4 + 3] = (byte) m_state[i];
+        }
+        return digest;
+    }
+
+    Digest Sha256::digest(const void* data, size_t size) {
+        Sha256 hasher;
+        hasher.update(data, size);
+        return hasher.finish();
+    }
+}  // namespace hashing
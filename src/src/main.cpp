@@ -2,8 +2,41 @@
 // Created by Bram Nijenkamp on 05-01-2024.
 //
 
+#include "commands/commands.h"
+#include "files/external_sort.h"
+#include "metrics/trace.h"
 #include "system.h"
 
 int32_t main(int32_t argc, char** argv) {
-    return 0;
-}
\ No newline at end of file
+    commands::GlobalOptions options;
+    int32_t consumed = 0;
+    if (!commands::parse_global_options(argc - 1, argv + 1, options, consumed)) return 2;
+    argc -= consumed;
+    argv += consumed;
+
+    if (argc < 2) {
+        commands::print_usage();
+        return 2;
+    }
+    commands::Command command = commands::find_command(argv[1]);
+    if (!command) {
+        ERROR("Unknown command '{}'.", argv[1]);
+        commands::print_usage();
+        return 2;
+    }
+
+    files::set_memory_budget(options.memory_budget);
+    metrics::Exporter exporter;
+    if (!options.metrics_path.empty() && !exporter.start(options.metrics_path, options.metrics_format, options.metrics_interval)) {
+        ERROR("Could not write metrics to '{}'.", options.metrics_path);
+        return 2;
+    }
+    if (!options.trace_path.empty()) metrics::trace_start();
+    int32_t result = command(argc - 2, argv + 2);
+    exporter.stop();
+    if (!options.trace_path.empty() && !metrics::trace_stop(options.trace_path)) {
+        ERROR("Could not write the trace to '{}'.", options.trace_path);
+        if (!result) result = 1;
+    }
+    return result;
+}
@@ -0,0 +1,73 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "metrics/exporter.h"
+
+#include <csignal>
+
+#include "files/file.h"
+#include "metrics/metrics.h"
+
+namespace metrics {
+    Exporter::~Exporter() {
+        stop();
+    }
+
+    bool Exporter::start(const std::string& path, ExportFormat format, std::chrono::milliseconds interval) {
+        stop();
+        m_path = path;
+        m_format = format;
+        m_interval = interval;
+        m_stopping = false;
+        // Fail early on an unwritable path instead of silently in the background.
+        if (!write()) return false;
+        m_thread = std::thread([this]() { run(); });
+        return true;
+    }
+
+    void Exporter::stop() {
+        if (!m_thread.joinable()) return;
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        m_thread.join();
+        write();
+    }
+
+    void Exporter::run() {
+        // Signals belong to the main thread, e.g. the daemon's signalfd.
+        sigset_t all;
+        sigfillset(&all);
+        ::pthread_sigmask(SIG_BLOCK, &all, nullptr);
+        std::unique_lock lock(m_mutex);
+        while (!m_wake.wait_for(lock, m_interval, [&]() { return m_stopping; })) {
+            lock.unlock();
+            if (!write()) WARN("Could not write metrics to '{}'.", m_path);
+            lock.lock();
+        }
+    }
+
+    bool Exporter::write() const {
+        std::string text;
+        if (m_format == ExportFormat::Json) {
+            write_json(text);
+        } else {
+            write_prometheus(text);
+        }
+        return files::write_file_atomic(m_path, text.data(), text.size());
+    }
+
+    bool parse_export_format(std::string_view name, ExportFormat& format) {
+        if (name == "prometheus") {
+            format = ExportFormat::Prometheus;
+        } else if (name == "json") {
+            format = ExportFormat::Json;
+        } else {
+            return false;
+        }
+        return true;
+    }
+}  // namespace metrics
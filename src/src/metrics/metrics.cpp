@@ -0,0 +1,287 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "metrics/metrics.h"
+
+#include <bitset>
+#include <charconv>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace metrics {
+    struct MetricInfo {
+        std::string name;
+        std::string help;
+        MetricType type;
+        void* metric;
+    };
+
+    //! Process-wide bookkeeping: which slots are taken, the live thread blocks, and the totals of
+    //! threads that have exited. Only registration, thread start and exit, and scrapes take the lock.
+    class Registry {
+       public:
+        static Registry& global() {
+            // Leaked on purpose: threads may still exit and fold their slots in during static destruction.
+            static auto* registry = new Registry();
+            return *registry;
+        }
+
+        template<typename Metric, typename... Args>
+        Metric& get(std::string_view name, std::string_view help, MetricType type, uint32_t slots, bool double_sum, Args&&... args) {
+            std::lock_guard lock(m_mutex);
+            for (const auto& info : m_infos) {
+                if (info.name != name) continue;
+                ASSERT_EX(info.type == type, "Metric registered twice with different types.");
+                return *(Metric*) info.metric;
+            }
+            CHECK_EX(m_next_slot + slots <= c_max_slots, "Out of metric slots.");
+            uint32_t first = m_next_slot;
+            m_next_slot += slots;
+            if (double_sum) m_double_slots.set(first + slots - 1);
+
+            auto& storage = std::get<std::deque<Metric>>(m_storage);
+            Metric& metric = storage.emplace_back(first, std::forward<Args>(args)...);
+            m_infos.push_back({ std::string(name), std::string(help), type, &metric });
+            return metric;
+        }
+
+        detail::ThreadSlots* attach() {
+            auto* slots = new detail::ThreadSlots();
+            std::lock_guard lock(m_mutex);
+            slots->next = m_threads;
+            if (m_threads) m_threads->previous = slots;
+            m_threads = slots;
+            return slots;
+        }
+
+        void detach(detail::ThreadSlots* slots) {
+            std::lock_guard lock(m_mutex);
+            for (uint32_t i = 0; i < m_next_slot; ++i) m_retired[i] = combine(i, m_retired[i], slots->values[i].load(std::memory_order_relaxed));
+            if (slots->previous) slots->previous->next = slots->next;
+            if (slots->next) slots->next->previous = slots->previous;
+            if (m_threads == slots) m_threads = slots->next;
+            delete slots;
+        }
+
+        //! Calls `visit(info, values)` for every metric, with `values` pointing at its aggregated slots.
+        template<typename Visit>
+        void scrape(Visit&& visit) {
+            std::lock_guard lock(m_mutex);
+            std::vector<uint64_t> totals(m_retired, m_retired + m_next_slot);
+            for (auto* slots = m_threads; slots; slots = slots->next) {
+                for (uint32_t i = 0; i < m_next_slot; ++i) totals[i] = combine(i, totals[i], slots->values[i].load(std::memory_order_relaxed));
+            }
+            for (const auto& info : m_infos) {
+                uint32_t first = 0;
+                switch (info.type) {
+                    case MetricType::Counter:
+                        first = ((Counter*) info.metric)->slot();
+                        break;
+                    case MetricType::Gauge:
+                        first = ((Gauge*) info.metric)->slot();
+                        break;
+                    case MetricType::Histogram:
+                        first = ((Histogram*) info.metric)->first_slot();
+                        break;
+                }
+                visit(info, totals.data() + first);
+            }
+        }
+
+       private:
+        uint64_t combine(uint32_t slot, uint64_t left, uint64_t right) const {
+            if (!m_double_slots.test(slot)) return left + right;
+            return std::bit_cast<uint64_t>(std::bit_cast<double>(left) + std::bit_cast<double>(right));
+        }
+
+        std::mutex m_mutex;
+        std::vector<MetricInfo> m_infos;
+        std::tuple<std::deque<Counter>, std::deque<Gauge>, std::deque<Histogram>> m_storage;
+        uint32_t m_next_slot = 0;
+        std::bitset<c_max_slots> m_double_slots;
+        uint64_t m_retired[c_max_slots] {};
+        detail::ThreadSlots* m_threads = nullptr;
+    };
+
+    namespace detail {
+        //! Owns the thread's block so its counts survive the thread.
+        struct Attachment {
+            ~Attachment() {
+                if (t_slots) Registry::global().detach(t_slots);
+                t_slots = nullptr;
+            }
+        };
+        static thread_local Attachment t_attachment;
+
+        ThreadSlots* attach() {
+            (void) &t_attachment;  // Odr-use, so the destructor is registered for this thread.
+            t_slots = Registry::global().attach();
+            return t_slots;
+        }
+    }  // namespace detail
+
+    Counter& counter(std::string_view name, std::string_view help) {
+        return Registry::global().get<Counter>(name, help, MetricType::Counter, 1, false);
+    }
+
+    Gauge& gauge(std::string_view name, std::string_view help) {
+        return Registry::global().get<Gauge>(name, help, MetricType::Gauge, 1, false);
+    }
+
+    Histogram& histogram(std::string_view name, std::string_view help, std::vector<double> bounds) {
+        auto slots = (uint32_t) bounds.size() + 2;
+        return Registry::global().get<Histogram>(name, help, MetricType::Histogram, slots, true, std::move(bounds));
+    }
+
+    std::vector<double> latency_bounds() {
+        return { 0.00001, 0.0001, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 10 };
+    }
+
+    //! Shortest text that reads back as the same double, so bucket labels stay readable.
+    static std::string format_number(double value) {
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        return { buffer, result.ptr };
+    }
+
+    static int64_t gauge_value(const Gauge& gauge, const uint64_t* values) {
+        return gauge.shared() + (int64_t) values[0];
+    }
+
+    //! HELP text may not contain raw newlines, and backslashes escape.
+    static void append_help(std::string& out, std::string_view help) {
+        for (char c : help) {
+            if (c == '\\') {
+                out += "\\\\";
+            } else if (c == '\n') {
+                out += "\\n";
+            } else {
+                out += c;
+            }
+        }
+    }
+
+    // The writers append piece by piece: FORMAT would substitute again into a help text or name
+    // that happens to contain "{}".
+    void write_prometheus(std::string& out) {
+        out.clear();
+        Registry::global().scrape([&](const MetricInfo& info, const uint64_t* values) {
+            out += "# HELP ";
+            out += info.name;
+            out += ' ';
+            append_help(out, info.help);
+            out += "\n# TYPE ";
+            out += info.name;
+            switch (info.type) {
+                case MetricType::Counter:
+                    out += " counter\n";
+                    out += info.name;
+                    out += ' ';
+                    out += std::to_string(values[0]);
+                    out += '\n';
+                    break;
+                case MetricType::Gauge:
+                    out += " gauge\n";
+                    out += info.name;
+                    out += ' ';
+                    out += std::to_string(gauge_value(*(Gauge*) info.metric, values));
+                    out += '\n';
+                    break;
+                case MetricType::Histogram: {
+                    const auto& bounds = ((Histogram*) info.metric)->bounds();
+                    out += " histogram\n";
+                    uint64_t cumulative = 0;
+                    for (size_t i = 0; i <= bounds.size(); ++i) {
+                        cumulative += values[i];
+                        out += info.name;
+                        out += "_bucket{le=\"";
+                        out += i < bounds.size() ? format_number(bounds[i]) : "+Inf";
+                        out += "\"} ";
+                        out += std::to_string(cumulative);
+                        out += '\n';
+                    }
+                    out += info.name;
+                    out += "_sum ";
+                    out += format_number(std::bit_cast<double>(values[bounds.size() + 1]));
+                    out += '\n';
+                    out += info.name;
+                    out += "_count ";
+                    out += std::to_string(cumulative);
+                    out += '\n';
+                    break;
+                }
+            }
+        });
+    }
+
+    void write_json(std::string& out) {
+        out = "{";
+        bool first = true;
+        Registry::global().scrape([&](const MetricInfo& info, const uint64_t* values) {
+            out += first ? "\n  " : ",\n  ";
+            first = false;
+            append_json_string(out, info.name);
+            out += ": ";
+            switch (info.type) {
+                case MetricType::Counter:
+                    out += std::to_string(values[0]);
+                    break;
+                case MetricType::Gauge:
+                    out += std::to_string(gauge_value(*(Gauge*) info.metric, values));
+                    break;
+                case MetricType::Histogram: {
+                    const auto& bounds = ((Histogram*) info.metric)->bounds();
+                    uint64_t count = 0;
+                    out += "{\"buckets\": {";
+                    for (size_t i = 0; i <= bounds.size(); ++i) {
+                        count += values[i];
+                        if (i) out += ", ";
+                        out += '"';
+                        out += i < bounds.size() ? format_number(bounds[i]) : "+Inf";
+                        out += "\": ";
+                        out += std::to_string(values[i]);
+                    }
+                    out += "}, \"sum\": ";
+                    out += format_number(std::bit_cast<double>(values[bounds.size() + 1]));
+                    out += ", \"count\": ";
+                    out += std::to_string(count);
+                    out += '}';
+                    break;
+                }
+            }
+        });
+        out += "\n}\n";
+    }
+
+    void append_json_string(std::string& out, std::string_view value) {
+        static constexpr char c_hex[] = "0123456789abcdef";
+        out += '"';
+        for (char c : value) {
+            switch (c) {
+                case '"':
+                    out += "\\\"";
+                    break;
+                case '\\':
+                    out += "\\\\";
+                    break;
+                case '\n':
+                    out += "\\n";
+                    break;
+                case '\t':
+                    out += "\\t";
+                    break;
+                default:
+                    if ((unsigned char) c < 0x20) {
+                        out += "\\u00";
+                        out += c_hex[(unsigned char) c >> 4];
+                        out += c_hex[c & 0xF];
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+        out += '"';
+    }
+}  // namespace metrics
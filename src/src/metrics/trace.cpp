@@ -0,0 +1,175 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "metrics/trace.h"
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unistd.h>
+#include <vector>
+#if defined(LINUX)
+    #include <pthread.h>
+    #include <sys/syscall.h>
+#endif
+
+#include "files/file.h"
+#include "metrics/metrics.h"
+
+namespace metrics {
+    //! Zones are stored once they end, as a single complete ("X") event, which halves the
+    //! buffer traffic compared to separate begin and end events.
+    struct TraceEvent {
+        const char* name;
+        uint64_t begin_ns;
+        uint64_t end_ns;
+    };
+
+    static constexpr uint32_t c_trace_chunk_events = 16384;
+    //! Per thread, about 24 MiB; zones past it are counted and dropped.
+    static constexpr uint64_t c_trace_max_events = 1024 * 1024;
+
+    //! Only the owning thread appends; `count` and `next` are published with release stores, so
+    //! trace_stop() can read a buffer while its thread is still finishing a zone.
+    struct TraceChunk {
+        TraceEvent events[c_trace_chunk_events];
+        std::atomic<uint32_t> count = 0;
+        std::atomic<TraceChunk*> next = nullptr;
+    };
+
+    struct TraceBuffer {
+        int64_t tid = 0;
+        std::string thread_name;
+        TraceChunk head;
+        TraceChunk* tail = &head;
+        uint64_t events = 0;
+        std::atomic<uint64_t> dropped = 0;
+        std::vector<std::unique_ptr<TraceChunk>> chunks;
+    };
+
+    //! Buffers are kept until the process exits, even after their thread did: nothing is
+    //! written until trace_stop().
+    class TraceRegistry {
+       public:
+        static TraceRegistry& global() {
+            static auto* registry = new TraceRegistry();
+            return *registry;
+        }
+
+        TraceBuffer* attach() {
+            auto buffer = std::make_unique<TraceBuffer>();
+#if defined(LINUX)
+            buffer->tid = (int64_t) ::syscall(SYS_gettid);
+            char name[32] {};
+            if (::pthread_getname_np(::pthread_self(), name, sizeof(name)) == 0) buffer->thread_name = name;
+#endif
+            std::lock_guard lock(m_mutex);
+#if !defined(LINUX)
+            buffer->tid = (int64_t) m_buffers.size() + 1;
+#endif
+            return m_buffers.emplace_back(std::move(buffer)).get();
+        }
+
+        template<typename Visit>
+        void visit(Visit&& visit) {
+            std::lock_guard lock(m_mutex);
+            for (const auto& buffer : m_buffers) visit(*buffer);
+        }
+
+        uint64_t m_start_ns = 0;
+
+       private:
+        std::mutex m_mutex;
+        std::vector<std::unique_ptr<TraceBuffer>> m_buffers;
+    };
+
+#if defined(COMP_TAG_GCC) || defined(COMP_TAG_CLANG)
+    static thread_local TraceBuffer* t_trace_buffer __attribute__((tls_model("initial-exec"))) = nullptr;
+#else
+    static thread_local TraceBuffer* t_trace_buffer = nullptr;
+#endif
+
+    void detail::trace_record(const char* name, uint64_t begin_ns, uint64_t end_ns) {
+        TraceBuffer* buffer = t_trace_buffer;
+        if (!buffer) [[unlikely]]
+            buffer = t_trace_buffer = TraceRegistry::global().attach();
+        if (buffer->events >= c_trace_max_events) [[unlikely]] {
+            buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        TraceChunk* chunk = buffer->tail;
+        uint32_t count = chunk->count.load(std::memory_order_relaxed);
+        if (count == c_trace_chunk_events) [[unlikely]] {
+            auto& next = buffer->chunks.emplace_back(std::make_unique<TraceChunk>());
+            chunk->next.store(next.get(), std::memory_order_release);
+            chunk = buffer->tail = next.get();
+            count = 0;
+        }
+        chunk->events[count] = { name, begin_ns, end_ns };
+        chunk->count.store(count + 1, std::memory_order_release);
+        buffer->events++;
+    }
+
+    void trace_start() {
+        TraceRegistry::global().m_start_ns = detail::trace_now();
+        detail::g_tracing.store(true, std::memory_order_relaxed);
+    }
+
+    //! Microseconds since the start of the trace, with the nanoseconds kept as decimals.
+    static void append_time(std::string& out, uint64_t ns) {
+        char buffer[32];
+        int length = std::snprintf(buffer, sizeof(buffer), "%llu.%03u", (unsigned long long) (ns / 1000), (unsigned) (ns % 1000));
+        out.append(buffer, (size_t) length);
+    }
+
+    bool trace_stop(const std::string& path) {
+        detail::g_tracing.store(false, std::memory_order_relaxed);
+        auto& registry = TraceRegistry::global();
+        const uint64_t start = registry.m_start_ns;
+        const std::string pid = std::to_string(::getpid());
+
+        std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        uint64_t dropped = 0;
+        registry.visit([&](const TraceBuffer& buffer) {
+            const std::string tid = std::to_string(buffer.tid);
+            if (!buffer.thread_name.empty()) {
+                out += first ? "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" : ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":";
+                first = false;
+                out += pid;
+                out += ",\"tid\":";
+                out += tid;
+                out += ",\"args\":{\"name\":";
+                append_json_string(out, buffer.thread_name);
+                out += "}}";
+            }
+            for (const TraceChunk* chunk = &buffer.head; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+                uint32_t count = chunk->count.load(std::memory_order_acquire);
+                for (uint32_t i = 0; i < count; ++i) {
+                    const TraceEvent& event = chunk->events[i];
+                    // Zones that were already open when tracing started.
+                    if (event.begin_ns < start) continue;
+                    out += first ? "\n{\"name\":" : ",\n{\"name\":";
+                    first = false;
+                    append_json_string(out, event.name);
+                    out += ",\"cat\":\"fward\",\"ph\":\"X\",\"ts\":";
+                    append_time(out, event.begin_ns - start);
+                    out += ",\"dur\":";
+                    append_time(out, event.end_ns - event.begin_ns);
+                    out += ",\"pid\":";
+                    out += pid;
+                    out += ",\"tid\":";
+                    out += tid;
+                    out += "}";
+                }
+            }
+            dropped += buffer.dropped.load(std::memory_order_relaxed);
+        });
+        out += "\n]}\n";
+
+        if (dropped) WARN("Trace buffers were full; {} zones were dropped.", dropped);
+        return files::write_file_atomic(path, out.data(), out.size());
+    }
+}  // namespace metrics
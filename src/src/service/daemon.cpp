@@ -0,0 +1,215 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "service/daemon.h"
+
+#include <csignal>
+
+#include "backup/verify.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+#include "utils/cpu.h"
+
+namespace service {
+    static metrics::Counter& g_jobs = metrics::counter("fward_daemon_jobs_total", "Jobs the daemon ran.");
+    static metrics::Counter& g_job_failures = metrics::counter("fward_daemon_job_failures_total", "Jobs that failed or found damage.");
+    static metrics::Gauge& g_jobs_queued = metrics::gauge("fward_daemon_jobs_queued", "Jobs waiting for the worker.");
+
+    Daemon::~Daemon() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        if (m_worker.joinable()) m_worker.join();
+    }
+
+    bool Daemon::run(ConfigLoader loader) {
+        m_loader = std::move(loader);
+        std::vector<JobConfig> configs;
+        if (!m_loader(configs)) return false;
+        if (!m_loop.open()) {
+            ERROR("Could not create the event loop.");
+            return false;
+        }
+        // Before the worker starts, so it and every thread it spawns inherit the blocked mask.
+        bool signals = m_loop.add_signals({ SIGHUP, SIGTERM, SIGINT }, [this](int32_t signal) {
+            if (signal == SIGHUP) {
+                std::vector<JobConfig> reloaded;
+                if (!m_loader(reloaded) || !configure(std::move(reloaded))) {
+                    ERROR("Reload failed, keeping the previous configuration.");
+                    return;
+                }
+                LOG("Configuration reloaded, {} jobs.", m_jobs.size());
+                return;
+            }
+            LOG("Stopping once the running job is done.");
+            for (const auto& job : m_jobs) m_loop.remove_timer(job->timer);
+            {
+                std::lock_guard lock(m_mutex);
+                m_stopping = true;
+                g_jobs_queued.sub((int64_t) m_queue.size());
+                m_queue.clear();
+            }
+            m_wake.notify_all();
+        });
+        if (!signals) {
+            ERROR("Could not set up signal handling.");
+            return false;
+        }
+        if (!configure(std::move(configs))) return false;
+
+        m_worker = std::thread([this]() { work(); });
+        LOG("Daemon started, {} jobs, CPU features: {}.", m_jobs.size(), cpu_feature_names());
+        bool result = m_loop.run();
+        m_worker.join();
+        m_loop.close();
+        return result;
+    }
+
+    bool Daemon::configure(std::vector<JobConfig> configs) {
+        std::vector<std::shared_ptr<Job>> jobs;
+        std::unordered_map<std::string, std::shared_ptr<RepositoryState>> states;
+        for (auto& config : configs) {
+            auto job = std::make_shared<Job>();
+            auto& state = states[config.repository];
+            if (!state) {
+                // Jobs queued under the old configuration keep their state alive until they ran.
+                auto it = m_states.find(config.repository);
+                state = it != m_states.end() ? it->second : std::make_shared<RepositoryState>();
+                state->path = config.repository;
+            }
+            job->state = state;
+            job->config = std::move(config);
+            jobs.push_back(std::move(job));
+        }
+
+        for (const auto& job : m_jobs) m_loop.remove_timer(job->timer);
+        for (const auto& job : jobs) {
+            std::weak_ptr<Job> weak = job;
+            auto interval = job->config.interval;
+            if (!m_loop.add_timer(interval, interval, [this, weak]() {
+                    if (auto job = weak.lock()) enqueue(job);
+                }, job->timer)) {
+                ERROR("Could not create a timer.");
+                for (const auto& added : jobs) m_loop.remove_timer(added->timer);
+                return false;
+            }
+        }
+        m_jobs = std::move(jobs);
+        m_states = std::move(states);
+        return true;
+    }
+
+    void Daemon::enqueue(const std::shared_ptr<Job>& job) {
+        if (job->queued.exchange(true)) return;
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_stopping) return;
+            m_queue.push_back(job);
+        }
+        g_jobs_queued.add();
+        m_wake.notify_one();
+    }
+
+    void Daemon::work() {
+        std::unique_lock lock(m_mutex);
+        while (true) {
+            m_wake.wait(lock, [&]() { return m_stopping || !m_queue.empty(); });
+            if (m_stopping) break;
+            auto job = std::move(m_queue.front());
+            m_queue.pop_front();
+            lock.unlock();
+
+            g_jobs_queued.sub();
+            g_jobs.add();
+            if (!run_job(*job)) g_job_failures.add();
+            if (job->state->repository) job->state->repository->unlock();
+            job->queued = false;
+            job.reset();
+            lock.lock();
+        }
+        lock.unlock();
+        m_loop.stop();
+    }
+
+    bool Daemon::open_repository(RepositoryState& state, bool create, bool with_catalog) {
+        if (!state.repository) {
+            auto repository = std::make_unique<backup::Repository>();
+            if ((create && !backup::Repository::create(state.path)) || !repository->open(state.path)) return false;
+            state.repository = std::move(repository);
+        }
+        // Held until the job is done. Locking refreshes the index, as other processes may have written
+        // or pruned packs since the last job.
+        if (!state.repository->lock(false)) return false;
+        if (with_catalog && !state.catalog) {
+            auto catalog = std::make_unique<backup::Catalog>();
+            if (catalog->open(state.path + "/catalog")) {
+                state.catalog = std::move(catalog);
+            } else {
+                WARN("Could not open the catalog of '{}', every file will be read.", state.path);
+            }
+        }
+        return true;
+    }
+
+    bool Daemon::run_job(Job& job) {
+        const auto& config = job.config;
+        auto& state = *job.state;
+        if (!open_repository(state, config.kind == JobKind::Backup, config.kind == JobKind::Backup && !config.rehash)) {
+            ERROR("Could not open repository '{}'.", state.path);
+            return false;
+        }
+
+        if (config.kind == JobKind::Backup) {
+            TRACE_ZONE("job.backup");
+            backup::BackupOptions options;
+            options.source = config.source;
+            options.filter = &config.filter;
+            options.catalog = config.rehash ? nullptr : state.catalog.get();
+            options.hash_xattrs = config.hash_xattrs;
+            backup::Snapshot snapshot;
+            backup::BackupStats stats;
+            if (!backup::run_backup(*state.repository, options, snapshot, stats)) {
+                ERROR("Backup of '{}' failed.", config.source);
+                // Drops the half-written pack; the next run starts from what is on disk.
+                state.repository.reset();
+                return false;
+            }
+            LOG("Snapshot {} of '{}': {} files ({} unchanged), {} bytes added, {} unreadable.", snapshot.id, config.source, stats.files,
+                stats.files_unchanged, stats.bytes_added, stats.errors);
+            return true;
+        }
+
+        if (config.kind == JobKind::Prune) {
+            TRACE_ZONE("job.prune");
+            backup::PruneStats stats;
+            if (!backup::run_prune(*state.repository, config.prune, stats)) {
+                ERROR("Prune of '{}' failed.", state.path);
+                return false;
+            }
+            LOG("Prune of '{}': {} snapshots forgotten, {} packs deleted, {} rewritten, {} bytes freed.", state.path, stats.snapshots_removed,
+                stats.packs_removed, stats.packs_repacked, stats.bytes_freed);
+            return stats.chunks_missing == 0;
+        }
+
+        TRACE_ZONE("job.scrub");
+        std::vector<backup::Snapshot> snapshots;
+        for (const auto& id : state.repository->snapshot_ids()) {
+            if (!state.repository->load_snapshot(id, snapshots.emplace_back())) {
+                ERROR("Snapshot {} in '{}' is missing or damaged.", id, state.path);
+                return false;
+            }
+        }
+        std::vector<const backup::Snapshot*> selected;
+        for (const auto& snapshot : snapshots) selected.push_back(&snapshot);
+        backup::VerifyReport report;
+        if (!backup::verify_full(*state.repository, selected, config.threads, report, tasks::Priority::Background) || !report.intact()) {
+            ERROR("Repository '{}' is damaged: {} problems, {} unreadable packs.", state.path, report.problems.size(), report.unreadable_packs.size());
+            return false;
+        }
+        LOG("Scrub of '{}': {} chunks, {} bytes intact.", state.path, report.chunks_checked, report.bytes_checked);
+        return true;
+    }
+}  // namespace service
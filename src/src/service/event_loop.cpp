@@ -0,0 +1,147 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "service/event_loop.h"
+
+#include <cerrno>
+#include <csignal>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace service {
+    static timespec to_timespec(std::chrono::milliseconds duration) {
+        return { (time_t) (duration.count() / 1000), (long) (duration.count() % 1000) * 1000000 };
+    }
+
+    EventLoop::~EventLoop() {
+        close();
+    }
+
+    bool EventLoop::open() {
+        close();
+        m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+        if (m_epoll < 0) return false;
+        m_wake = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (m_wake < 0) return false;
+        m_stopping = false;
+        return watch(m_wake, [this]() {
+            uint64_t count;
+            while (::read(m_wake, &count, sizeof(count)) < 0 && errno == EINTR) { }
+            run_posted();
+        });
+    }
+
+    void EventLoop::close() {
+        for (int32_t fd : m_owned) ::close(fd);
+        m_owned.clear();
+        m_sources.clear();
+        if (m_wake >= 0) ::close(m_wake);
+        if (m_epoll >= 0) ::close(m_epoll);
+        m_wake = m_epoll = -1;
+    }
+
+    bool EventLoop::watch(int32_t fd, Callback callback) {
+        epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) != 0) return false;
+        m_sources[fd] = std::move(callback);
+        return true;
+    }
+
+    void EventLoop::unwatch(int32_t fd) {
+        ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+        m_sources.erase(fd);
+        std::erase(m_owned, fd);
+        ::close(fd);
+    }
+
+    bool EventLoop::add_timer(std::chrono::milliseconds delay, std::chrono::milliseconds interval, Callback callback, int32_t& id) {
+        int32_t fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        if (fd < 0) return false;
+        itimerspec spec {};
+        // An all-zero it_value would disarm the timer instead of firing right away.
+        spec.it_value = to_timespec(std::max(delay, std::chrono::milliseconds(1)));
+        spec.it_interval = to_timespec(interval);
+        bool armed = ::timerfd_settime(fd, 0, &spec, nullptr) == 0 && watch(fd, [fd, callback = std::move(callback)]() {
+            // Missed expirations collapse into one call; a job that overran its interval runs once, not twice.
+            uint64_t expirations;
+            if (::read(fd, &expirations, sizeof(expirations)) == sizeof(expirations)) callback();
+        });
+        if (!armed) {
+            ::close(fd);
+            return false;
+        }
+        m_owned.push_back(fd);
+        id = fd;
+        return true;
+    }
+
+    void EventLoop::remove_timer(int32_t id) {
+        if (m_sources.contains(id)) unwatch(id);
+    }
+
+    bool EventLoop::add_signals(std::initializer_list<int32_t> signals, std::function<void(int32_t signal)> callback) {
+        sigset_t mask;
+        sigemptyset(&mask);
+        for (int32_t signal : signals) sigaddset(&mask, signal);
+        if (::sigprocmask(SIG_BLOCK, &mask, nullptr) != 0) return false;
+        int32_t fd = ::signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+        if (fd < 0) return false;
+        bool watched = watch(fd, [fd, callback = std::move(callback)]() {
+            signalfd_siginfo info;
+            while (::read(fd, &info, sizeof(info)) == sizeof(info)) callback((int32_t) info.ssi_signo);
+        });
+        if (!watched) {
+            ::close(fd);
+            return false;
+        }
+        m_owned.push_back(fd);
+        return true;
+    }
+
+    void EventLoop::post(Callback callback) {
+        {
+            std::lock_guard lock(m_mutex);
+            m_posted.push_back(std::move(callback));
+        }
+        uint64_t one = 1;
+        while (::write(m_wake, &one, sizeof(one)) < 0 && errno == EINTR) { }
+    }
+
+    void EventLoop::stop() {
+        post([this]() { m_stopping = true; });
+    }
+
+    void EventLoop::run_posted() {
+        std::vector<Callback> posted;
+        {
+            std::lock_guard lock(m_mutex);
+            posted.swap(m_posted);
+        }
+        for (auto& callback : posted) callback();
+    }
+
+    bool EventLoop::run() {
+        epoll_event events[16];
+        while (!m_stopping) {
+            int count = ::epoll_wait(m_epoll, events, 16, -1);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            for (int i = 0; i < count && !m_stopping; ++i) {
+                // A callback may have removed a later source of this batch.
+                auto it = m_sources.find(events[i].data.fd);
+                if (it == m_sources.end()) continue;
+                Callback callback = it->second;
+                callback();
+            }
+        }
+        return true;
+    }
+}  // namespace service
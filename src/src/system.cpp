@@ -4,7 +4,7 @@
 
 #include "system.h"
 
-namespace log {
+namespace logging {
     static bool print_ansi_coloring = true;
 
     void print_enable_ansi_coloring(bool enabled) {
@@ -81,4 +81,4 @@ namespace log {
         }
     }
 
-}  // namespace log
\ No newline at end of file
+}  // namespace logging
\ No newline at end of file
@@ -0,0 +1,269 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "tasks/scheduler.h"
+
+#include <algorithm>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#if defined(POSIX_NATIVE)
+    #include <pthread.h>
+#endif
+#if defined(LINUX)
+    #include <sched.h>
+#endif
+
+#include "metrics/metrics.h"
+
+namespace tasks {
+    static metrics::Counter& g_tasks_run = metrics::counter("fward_tasks_run_total", "Tasks the scheduler ran.");
+    static metrics::Counter& g_tasks_stolen = metrics::counter("fward_tasks_stolen_total", "Tasks a worker took from another worker's deque.");
+    static metrics::Counter& g_tasks_cancelled = metrics::counter("fward_tasks_cancelled_total", "Tasks skipped because their group was cancelled.");
+
+    static thread_local const void* t_scheduler = nullptr;
+    static thread_local int32_t t_worker = -1;
+
+#if defined(LINUX)
+    //! Parses a sysfs cpu list such as "0-3,8-11".
+    static std::vector<uint32_t> parse_cpu_list(const std::string& text) {
+        std::vector<uint32_t> cpus;
+        size_t i = 0;
+        while (i < text.size()) {
+            char* end = nullptr;
+            unsigned long first = std::strtoul(text.c_str() + i, &end, 10);
+            if (end == text.c_str() + i) break;
+            unsigned long last = first;
+            i = end - text.c_str();
+            if (i < text.size() && text[i] == '-') {
+                last = std::strtoul(text.c_str() + i + 1, &end, 10);
+                i = end - text.c_str();
+            }
+            for (unsigned long cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) cpus.push_back((uint32_t) cpu);
+            if (i < text.size() && text[i] == ',') ++i;
+            else break;
+        }
+        return cpus;
+    }
+
+    CpuTopology CpuTopology::detect() {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (::sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+            for (uint32_t cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) CPU_SET(cpu, &allowed);
+        }
+
+        CpuTopology topology;
+        std::error_code error;
+        std::vector<std::filesystem::path> nodes;
+        for (const auto& item : std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+            std::string name = item.path().filename().string();
+            if (name.starts_with("node") && name.size() > 4 && std::isdigit((unsigned char) name[4])) nodes.push_back(item.path());
+        }
+        std::sort(nodes.begin(), nodes.end());
+        for (const auto& node : nodes) {
+            std::ifstream stream(node / "cpulist");
+            std::string text;
+            std::getline(stream, text);
+            std::vector<uint32_t> cpus;
+            for (uint32_t cpu : parse_cpu_list(text)) {
+                if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+            }
+            if (!cpus.empty()) topology.nodes.push_back(std::move(cpus));
+        }
+
+        if (topology.nodes.empty()) {
+            std::vector<uint32_t> cpus;
+            for (uint32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+            }
+            topology.nodes.push_back(std::move(cpus));
+        }
+        return topology;
+    }
+#else
+    //! Without sysfs and affinity masks every CPU counts as one node and workers aren't pinned.
+    CpuTopology CpuTopology::detect() {
+        CpuTopology topology;
+        std::vector<uint32_t> cpus;
+        for (uint32_t cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) cpus.push_back(cpu);
+        topology.nodes.push_back(std::move(cpus));
+        return topology;
+    }
+#endif
+
+    uint32_t CpuTopology::cpu_count() const {
+        uint32_t count = 0;
+        for (const auto& node : nodes) count += (uint32_t) node.size();
+        return count;
+    }
+
+    Scheduler::Scheduler(uint32_t workers) {
+        CpuTopology topology = CpuTopology::detect();
+        // Spread workers over the nodes the way the CPUs are spread, node by node.
+        std::vector<uint32_t> node_of_cpu;
+        for (uint32_t node = 0; node < topology.nodes.size(); ++node) node_of_cpu.insert(node_of_cpu.end(), topology.nodes[node].size(), node);
+        if (node_of_cpu.empty()) node_of_cpu.push_back(0);
+        if (workers == 0) workers = (uint32_t) node_of_cpu.size();
+
+        m_workers.resize(workers);
+        for (uint32_t i = 0; i < workers; ++i) {
+            m_workers[i] = std::make_unique<Worker>();
+            m_workers[i]->node = node_of_cpu[(size_t) i * node_of_cpu.size() / workers];
+        }
+        for (uint32_t i = 0; i < workers; ++i) {
+            auto& victims = m_workers[i]->victims;
+            // Starting after ourselves, so thieves don't all pile onto worker 0.
+            for (uint32_t step = 1; step < workers; ++step) victims.push_back((i + step) % workers);
+            std::stable_partition(victims.begin(), victims.end(), [&](uint32_t victim) { return m_workers[victim]->node == m_workers[i]->node; });
+        }
+
+        for (uint32_t i = 0; i < workers; ++i) {
+            // With a single node the kernel balances better than a fixed mask would.
+            std::vector<uint32_t> cpus;
+            if (topology.nodes.size() > 1) cpus = topology.nodes[m_workers[i]->node];
+            m_workers[i]->thread = std::thread([this, i, cpus]() { run(i, cpus); });
+        }
+    }
+
+    Scheduler::~Scheduler() {
+        {
+            std::lock_guard lock(m_sleep_mutex);
+            m_stopping = true;
+        }
+        m_sleep.notify_all();
+        for (auto& worker : m_workers) worker->thread.join();
+    }
+
+    Scheduler& Scheduler::global() {
+        // Leaked on purpose: idle workers may still be parked when static destructors run.
+        static auto* scheduler = new Scheduler();
+        return *scheduler;
+    }
+
+    void Scheduler::submit(Task task, Priority priority) {
+        auto level = (size_t) priority;
+        if (t_scheduler == this) {
+            auto& worker = *m_workers[t_worker];
+            std::lock_guard lock(worker.mutex);
+            worker.queues[level].push_back(std::move(task));
+        } else {
+            std::lock_guard lock(m_injected_mutex);
+            m_injected[level].push_back(std::move(task));
+        }
+        m_pending.fetch_add(1, std::memory_order_release);
+        {
+            // Pairs with the predicate check in run(), so a worker about to sleep can't miss this task.
+            std::lock_guard lock(m_sleep_mutex);
+        }
+        m_sleep.notify_one();
+    }
+
+    bool Scheduler::take(int32_t self, Task& task) {
+        if (!m_pending.load(std::memory_order_acquire)) return false;
+        for (size_t level = 0; level < c_priority_count; ++level) {
+            if (self >= 0) {
+                auto& worker = *m_workers[self];
+                std::lock_guard lock(worker.mutex);
+                if (!worker.queues[level].empty()) {
+                    task = std::move(worker.queues[level].back());
+                    worker.queues[level].pop_back();
+                    return true;
+                }
+            }
+            {
+                std::lock_guard lock(m_injected_mutex);
+                if (!m_injected[level].empty()) {
+                    task = std::move(m_injected[level].front());
+                    m_injected[level].pop_front();
+                    return true;
+                }
+            }
+            auto steal = [&](uint32_t victim) {
+                auto& worker = *m_workers[victim];
+                std::lock_guard lock(worker.mutex);
+                if (worker.queues[level].empty()) return false;
+                task = std::move(worker.queues[level].front());
+                worker.queues[level].pop_front();
+                g_tasks_stolen.add();
+                return true;
+            };
+            if (self >= 0) {
+                for (uint32_t victim : m_workers[self]->victims) {
+                    if (steal(victim)) return true;
+                }
+            } else {
+                for (uint32_t victim = 0; victim < m_workers.size(); ++victim) {
+                    if (steal(victim)) return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool Scheduler::run_one(int32_t self) {
+        Task task;
+        if (!take(self, task)) return false;
+        m_pending.fetch_sub(1, std::memory_order_relaxed);
+        if (task.group->cancelled()) {
+            g_tasks_cancelled.add();
+        } else {
+            task.function();
+            g_tasks_run.add();
+        }
+        task.group->finish();
+        return true;
+    }
+
+    bool Scheduler::run_pending() {
+        return run_one(t_scheduler == this ? t_worker : -1);
+    }
+
+    void Scheduler::run(uint32_t index, const std::vector<uint32_t>& cpus) {
+        t_scheduler = this;
+        t_worker = (int32_t) index;
+#if defined(POSIX_NATIVE)
+        // Signals are for the thread that set up their handling, not for workers.
+        sigset_t all;
+        sigfillset(&all);
+        ::pthread_sigmask(SIG_BLOCK, &all, nullptr);
+#endif
+#if defined(LINUX)
+        if (!cpus.empty()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (uint32_t cpu : cpus) CPU_SET(cpu, &set);
+            ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+        }
+#endif
+
+        while (true) {
+            if (run_one((int32_t) index)) continue;
+            std::unique_lock lock(m_sleep_mutex);
+            m_sleep.wait(lock, [&]() { return m_stopping || m_pending.load(std::memory_order_acquire) > 0; });
+            if (m_stopping) return;
+        }
+    }
+
+    void TaskGroup::run(std::function<void()> function) {
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        m_scheduler.submit({ std::move(function), this }, m_priority);
+    }
+
+    void TaskGroup::finish() {
+        std::lock_guard lock(m_mutex);
+        if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) m_done.notify_all();
+    }
+
+    void TaskGroup::wait() {
+        while (m_pending.load(std::memory_order_acquire)) {
+            if (m_scheduler.run_pending()) continue;
+            // Rechecks now and then: a running task of another group may queue work we can help with.
+            std::unique_lock lock(m_mutex);
+            m_done.wait_for(lock, std::chrono::milliseconds(1), [&]() { return !m_pending.load(std::memory_order_acquire); });
+        }
+        // finish() may still be inside its critical section; the group must not go away before it left.
+        std::lock_guard lock(m_mutex);
+    }
+}  // namespace tasks
@@ -0,0 +1,112 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "utils/cpu.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <unordered_map>
+
+#if defined(COMP_CPU_X86_64) || defined(COMP_CPU_X86)
+    #include <cpuid.h>
+#elif defined(COMP_CPU_AARCH64) && defined(LINUX)
+    #include <sys/auxv.h>
+#endif
+
+#include "utils/stl_case_insensitive.h"
+
+struct CpuFeatureName {
+    std::string_view name;
+    bool CpuFeatures::*flag;
+};
+
+static constexpr CpuFeatureName c_feature_names[] = {
+    { "ssse3", &CpuFeatures::ssse3 },   { "sse4.1", &CpuFeatures::sse41 }, { "sse4.2", &CpuFeatures::sse42 },
+    { "pclmul", &CpuFeatures::pclmul }, { "avx2", &CpuFeatures::avx2 },    { "avx512", &CpuFeatures::avx512 },
+    { "sha", &CpuFeatures::sha },       { "neon", &CpuFeatures::neon },    { "crc32", &CpuFeatures::arm_crc32 },
+    { "pmull", &CpuFeatures::arm_pmull },
+};
+
+#if defined(COMP_CPU_X86_64) || defined(COMP_CPU_X86)
+//! The register state the OS saves on context switches (XCR0); a CPU feature is useless without it.
+static uint64_t saved_state() {
+    uint32_t low, high;
+    __asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return ((uint64_t) high << 32) | low;
+}
+#endif
+
+static CpuFeatures detect() {
+    CpuFeatures features;
+#if defined(COMP_CPU_X86_64) || defined(COMP_CPU_X86)
+    uint32_t eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return features;
+    features.ssse3 = ecx & bit_SSSE3;
+    features.sse41 = ecx & bit_SSE4_1;
+    features.sse42 = ecx & bit_SSE4_2;
+    features.pclmul = ecx & bit_PCLMUL;
+    bool os_saves_avx = (ecx & bit_OSXSAVE) && (saved_state() & 0x06) == 0x06;
+    // Opmask and both halves of the upper ZMM registers, on top of the AVX state.
+    bool os_saves_avx512 = os_saves_avx && (saved_state() & 0xE6) == 0xE6;
+
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        features.avx2 = os_saves_avx && (ebx & bit_AVX2);
+        features.avx512 = os_saves_avx512 && (ebx & bit_AVX512F) && (ebx & bit_AVX512BW) && (ebx & bit_AVX512VL);
+        features.sha = ebx & bit_SHA;
+    }
+#elif defined(COMP_CPU_AARCH64)
+    features.neon = true;
+    #if defined(LINUX)
+    unsigned long capabilities = ::getauxval(AT_HWCAP);
+    features.arm_crc32 = capabilities & HWCAP_CRC32;
+    features.arm_pmull = capabilities & HWCAP_PMULL;
+    features.sha = capabilities & HWCAP_SHA2;
+    #elif defined(MACOS)
+    // Every Apple core has them.
+    features.arm_crc32 = true;
+    features.arm_pmull = true;
+    features.sha = true;
+    #endif
+#endif
+
+    const char* disabled = std::getenv("FWARD_CPU_DISABLE");
+    if (disabled && !disable_cpu_features(features, disabled)) WARN("FWARD_CPU_DISABLE='{}' names unknown features, they are ignored.", disabled);
+    return features;
+}
+
+bool disable_cpu_features(CpuFeatures& features, std::string_view list) {
+    bool known = true;
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view name = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view {} : list.substr(comma + 1);
+        while (!name.empty() && std::isspace((unsigned char) name.front())) name.remove_prefix(1);
+        while (!name.empty() && std::isspace((unsigned char) name.back())) name.remove_suffix(1);
+        if (name.empty()) continue;
+
+        bool found = false;
+        for (const auto& feature : c_feature_names) {
+            if (!CaseInsensitiveEqual {}(feature.name, name)) continue;
+            features.*feature.flag = false;
+            found = true;
+        }
+        known &= found;
+    }
+    return known;
+}
+
+const CpuFeatures& cpu_features() {
+    static const CpuFeatures features = detect();
+    return features;
+}
+
+std::string cpu_feature_names() {
+    std::string names;
+    for (const auto& feature : c_feature_names) {
+        if (!(cpu_features().*feature.flag)) continue;
+        if (!names.empty()) names += ' ';
+        names += feature.name;
+    }
+    return names;
+}
@@ -0,0 +1,94 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "utils/hex.h"
+
+#if defined(COMP_CPU_X86_64)
+    #include <tmmintrin.h>
+#elif defined(COMP_CPU_AARCH64)
+    #include <arm_neon.h>
+#endif
+
+#include "utils/cpu.h"
+
+using HexEncodeFunction = void (*)(const byte* data, size_t size, char* out);
+
+static void hex_encode_generic(const byte* data, size_t size, char* out) {
+    static constexpr char c_digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < size; ++i) {
+        out[i * 2] = c_digits[data[i] >> 4];
+        out[i * 2 + 1] = c_digits[data[i] & 0x0F];
+    }
+}
+
+// Both vector versions look the nibbles up in a 16-entry digit table, then interleave high and low.
+#if defined(COMP_CPU_X86_64)
+COMP_TARGET("ssse3")
+static void hex_encode_ssse3(const byte* data, size_t size, char* out) {
+    const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*) (data + i));
+        __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));
+        __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, nibble));
+        _mm_storeu_si128((__m128i*) (out + i * 2), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128((__m128i*) (out + i * 2 + 16), _mm_unpackhi_epi8(high, low));
+    }
+    hex_encode_generic(data + i, size - i, out + i * 2);
+}
+#elif defined(COMP_CPU_AARCH64)
+static void hex_encode_neon(const byte* data, size_t size, char* out) {
+    static constexpr uint8_t c_digits[16] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+    const uint8x16_t digits = vld1q_u8(c_digits);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        uint8x16_t bytes = vld1q_u8(data + i);
+        uint8x16x2_t pairs = { { vqtbl1q_u8(digits, vshrq_n_u8(bytes, 4)), vqtbl1q_u8(digits, vandq_u8(bytes, vdupq_n_u8(0x0F))) } };
+        vst2q_u8((uint8_t*) out + i * 2, pairs);
+    }
+    hex_encode_generic(data + i, size - i, out + i * 2);
+}
+#endif
+
+struct HexEncodeKernel {
+    const char* name;
+    HexEncodeFunction function;
+};
+
+static HexEncodeKernel select_hex_encode([[maybe_unused]] const CpuFeatures& cpu) {
+#if defined(COMP_CPU_X86_64)
+    if (cpu.ssse3) return { "ssse3", hex_encode_ssse3 };
+#elif defined(COMP_CPU_AARCH64)
+    if (cpu.neon) return { "neon", hex_encode_neon };
+#endif
+    return { "generic", hex_encode_generic };
+}
+
+const char* hex_encode_kernel(const CpuFeatures& cpu) {
+    return select_hex_encode(cpu).name;
+}
+
+void hex_encode(const byte* data, size_t size, char* out) {
+    static const HexEncodeFunction function = select_hex_encode(cpu_features()).function;
+    function(data, size, out);
+}
+
+static int32_t hex_value(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+bool hex_decode(std::string_view hex, byte* out, size_t size) {
+    if (hex.size() != size * 2) return false;
+    for (size_t i = 0; i < size; ++i) {
+        int32_t high = hex_value(hex[i * 2]);
+        int32_t low = hex_value(hex[i * 2 + 1]);
+        if (high < 0 || low < 0) return false;
+        out[i] = (byte) ((high << 4) | low);
+    }
+    return true;
+}
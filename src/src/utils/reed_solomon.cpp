@@ -0,0 +1,285 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "utils/reed_solomon.h"
+
+#include <algorithm>
+#include <array>
+
+#if defined(COMP_CPU_X86_64)
+    #include <immintrin.h>
+#elif defined(COMP_CPU_AARCH64)
+    #include <arm_neon.h>
+#endif
+
+#include "utils/cpu.h"
+
+//! x^8 + x^4 + x^3 + x^2 + 1, with x a generator of the multiplicative group.
+static constexpr uint32_t c_polynomial = 0x11D;
+//! Shards are combined in slices of this size, so the inputs of one slice stay in cache while every
+//! output row is computed from them.
+static constexpr size_t c_slice = 16 * 1024;
+
+struct GaloisTables {
+    //! Twice the period, so the sum of two logarithms needs no reduction.
+    std::array<uint8_t, 512> exp {};
+    std::array<uint8_t, 256> log {};
+};
+
+static constexpr GaloisTables make_galois_tables() {
+    GaloisTables tables;
+    uint32_t value = 1;
+    for (uint32_t i = 0; i < 255; ++i) {
+        tables.exp[i] = (uint8_t) value;
+        tables.log[value] = (uint8_t) i;
+        value <<= 1;
+        if (value & 0x100) value ^= c_polynomial;
+    }
+    for (uint32_t i = 255; i < tables.exp.size(); ++i) tables.exp[i] = tables.exp[i - 255];
+    return tables;
+}
+
+static constexpr auto c_galois = make_galois_tables();
+
+static uint8_t gf_multiply(uint8_t a, uint8_t b) {
+    if (a == 0 || b == 0) return 0;
+    return c_galois.exp[c_galois.log[a] + c_galois.log[b]];
+}
+
+static uint8_t gf_inverse(uint8_t a) {
+    return c_galois.exp[255 - c_galois.log[a]];
+}
+
+//! Products of `coefficient` with every low nibble, then with every high nibble; since multiplying
+//! distributes over XOR, their sum is the product with a whole byte.
+static void append_tables(uint8_t coefficient, std::vector<uint8_t>& tables) {
+    for (uint8_t nibble = 0; nibble < 16; ++nibble) tables.push_back(gf_multiply(coefficient, nibble));
+    for (uint8_t nibble = 0; nibble < 16; ++nibble) tables.push_back(gf_multiply(coefficient, (uint8_t) (nibble << 4)));
+}
+
+//! out[x] = sum of tables[i] applied to inputs[i][x], over bytes [offset, offset + size).
+using CombineFunction = void (*)(const uint8_t* tables, const byte* const* inputs, size_t count, byte* out, size_t offset, size_t size);
+
+static void combine_generic(const uint8_t* tables, const byte* const* inputs, size_t count, byte* out, size_t offset, size_t size) {
+    out += offset;
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* table = tables + 32 * i;
+        const byte* in = inputs[i] + offset;
+        for (size_t x = 0; x < size; ++x) {
+            auto product = (byte) (table[in[x] & 0x0F] ^ table[16 + (in[x] >> 4)]);
+            out[x] = i == 0 ? product : (byte) (out[x] ^ product);
+        }
+    }
+}
+
+#if defined(COMP_CPU_X86_64)
+COMP_TARGET("avx2")
+static void combine_avx2(const uint8_t* tables, const byte* const* inputs, size_t count, byte* out, size_t offset, size_t size) {
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    size_t done = size & ~(size_t) 63;
+    for (size_t x = offset; x < offset + done; x += 64) {
+        __m256i sum0 = _mm256_setzero_si256();
+        __m256i sum1 = _mm256_setzero_si256();
+        for (size_t i = 0; i < count; ++i) {
+            // The 16-byte tables sit in both lanes, as VPSHUFB looks up within each lane.
+            __m256i low = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) (tables + 32 * i)));
+            __m256i high = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) (tables + 32 * i + 16)));
+            __m256i in0 = _mm256_loadu_si256((const __m256i*) (inputs[i] + x));
+            __m256i in1 = _mm256_loadu_si256((const __m256i*) (inputs[i] + x + 32));
+            sum0 = _mm256_xor_si256(sum0, _mm256_shuffle_epi8(low, _mm256_and_si256(in0, mask)));
+            sum0 = _mm256_xor_si256(sum0, _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi64(in0, 4), mask)));
+            sum1 = _mm256_xor_si256(sum1, _mm256_shuffle_epi8(low, _mm256_and_si256(in1, mask)));
+            sum1 = _mm256_xor_si256(sum1, _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi64(in1, 4), mask)));
+        }
+        _mm256_storeu_si256((__m256i*) (out + x), sum0);
+        _mm256_storeu_si256((__m256i*) (out + x + 32), sum1);
+    }
+    combine_generic(tables, inputs, count, out, offset + done, size - done);
+}
+
+COMP_TARGET("ssse3")
+static void combine_ssse3(const uint8_t* tables, const byte* const* inputs, size_t count, byte* out, size_t offset, size_t size) {
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    size_t done = size & ~(size_t) 31;
+    for (size_t x = offset; x < offset + done; x += 32) {
+        __m128i sum0 = _mm_setzero_si128();
+        __m128i sum1 = _mm_setzero_si128();
+        for (size_t i = 0; i < count; ++i) {
+            __m128i low = _mm_loadu_si128((const __m128i*) (tables + 32 * i));
+            __m128i high = _mm_loadu_si128((const __m128i*) (tables + 32 * i + 16));
+            __m128i in0 = _mm_loadu_si128((const __m128i*) (inputs[i] + x));
+            __m128i in1 = _mm_loadu_si128((const __m128i*) (inputs[i] + x + 16));
+            sum0 = _mm_xor_si128(sum0, _mm_shuffle_epi8(low, _mm_and_si128(in0, mask)));
+            sum0 = _mm_xor_si128(sum0, _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi64(in0, 4), mask)));
+            sum1 = _mm_xor_si128(sum1, _mm_shuffle_epi8(low, _mm_and_si128(in1, mask)));
+            sum1 = _mm_xor_si128(sum1, _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi64(in1, 4), mask)));
+        }
+        _mm_storeu_si128((__m128i*) (out + x), sum0);
+        _mm_storeu_si128((__m128i*) (out + x + 16), sum1);
+    }
+    combine_generic(tables, inputs, count, out, offset + done, size - done);
+}
+#elif defined(COMP_CPU_AARCH64)
+static void combine_neon(const uint8_t* tables, const byte* const* inputs, size_t count, byte* out, size_t offset, size_t size) {
+    const uint8x16_t mask = vdupq_n_u8(0x0F);
+    size_t done = size & ~(size_t) 31;
+    for (size_t x = offset; x < offset + done; x += 32) {
+        uint8x16_t sum0 = vdupq_n_u8(0);
+        uint8x16_t sum1 = vdupq_n_u8(0);
+        for (size_t i = 0; i < count; ++i) {
+            uint8x16_t low = vld1q_u8(tables + 32 * i);
+            uint8x16_t high = vld1q_u8(tables + 32 * i + 16);
+            uint8x16_t in0 = vld1q_u8((const uint8_t*) inputs[i] + x);
+            uint8x16_t in1 = vld1q_u8((const uint8_t*) inputs[i] + x + 16);
+            sum0 = veorq_u8(sum0, veorq_u8(vqtbl1q_u8(low, vandq_u8(in0, mask)), vqtbl1q_u8(high, vshrq_n_u8(in0, 4))));
+            sum1 = veorq_u8(sum1, veorq_u8(vqtbl1q_u8(low, vandq_u8(in1, mask)), vqtbl1q_u8(high, vshrq_n_u8(in1, 4))));
+        }
+        vst1q_u8((uint8_t*) out + x, sum0);
+        vst1q_u8((uint8_t*) out + x + 16, sum1);
+    }
+    combine_generic(tables, inputs, count, out, offset + done, size - done);
+}
+#endif
+
+struct CombineKernel {
+    const char* name;
+    CombineFunction function;
+};
+
+static CombineKernel select_combine([[maybe_unused]] const CpuFeatures& cpu) {
+#if defined(COMP_CPU_X86_64)
+    if (cpu.avx2) return { "avx2", combine_avx2 };
+    if (cpu.ssse3) return { "ssse3", combine_ssse3 };
+#elif defined(COMP_CPU_AARCH64)
+    if (cpu.neon) return { "neon", combine_neon };
+#endif
+    return { "generic", combine_generic };
+}
+
+const char* ReedSolomon::kernel(const CpuFeatures& cpu) {
+    return select_combine(cpu).name;
+}
+
+//! Computes every output row from the same inputs, slice by slice.
+static void combine_rows(const std::vector<const std::vector<uint8_t>*>& rows, const std::vector<const byte*>& inputs,
+                         const std::vector<byte*>& outputs, size_t size) {
+    static const CombineFunction function = select_combine(cpu_features()).function;
+    for (size_t offset = 0; offset < size; offset += c_slice) {
+        size_t length = std::min(c_slice, size - offset);
+        for (size_t row = 0; row < rows.size(); ++row) function(rows[row]->data(), inputs.data(), inputs.size(), outputs[row], offset, length);
+    }
+}
+
+//! Inverts the `size` by `size` matrix in `matrix` in place by Gauss-Jordan elimination.
+static bool invert(std::vector<uint8_t>& matrix, size_t size) {
+    std::vector<uint8_t> inverse(size * size, 0);
+    for (size_t i = 0; i < size; ++i) inverse[i * size + i] = 1;
+    for (size_t column = 0; column < size; ++column) {
+        size_t pivot = column;
+        while (pivot < size && matrix[pivot * size + column] == 0) ++pivot;
+        if (pivot == size) return false;
+        if (pivot != column) {
+            std::swap_ranges(matrix.begin() + (ptrdiff_t) (pivot * size), matrix.begin() + (ptrdiff_t) ((pivot + 1) * size),
+                             matrix.begin() + (ptrdiff_t) (column * size));
+            std::swap_ranges(inverse.begin() + (ptrdiff_t) (pivot * size), inverse.begin() + (ptrdiff_t) ((pivot + 1) * size),
+                             inverse.begin() + (ptrdiff_t) (column * size));
+        }
+        uint8_t scale = gf_inverse(matrix[column * size + column]);
+        for (size_t j = 0; j < size; ++j) {
+            matrix[column * size + j] = gf_multiply(matrix[column * size + j], scale);
+            inverse[column * size + j] = gf_multiply(inverse[column * size + j], scale);
+        }
+        for (size_t row = 0; row < size; ++row) {
+            uint8_t factor = matrix[row * size + column];
+            if (row == column || factor == 0) continue;
+            for (size_t j = 0; j < size; ++j) {
+                matrix[row * size + j] ^= gf_multiply(factor, matrix[column * size + j]);
+                inverse[row * size + j] ^= gf_multiply(factor, inverse[column * size + j]);
+            }
+        }
+    }
+    matrix = std::move(inverse);
+    return true;
+}
+
+bool ReedSolomon::init(uint32_t data, uint32_t parity) {
+    if (data == 0 || parity == 0 || data + parity > c_max_shards) return false;
+    m_data = data;
+    m_parity = parity;
+    // Cauchy entries 1 / (x_j + y_i) with x_j = data + j and y_i = i: the two sets are disjoint, so
+    // no entry divides by zero.
+    m_matrix.resize((size_t) parity * data);
+    m_tables.assign(parity, {});
+    for (uint32_t j = 0; j < parity; ++j) {
+        for (uint32_t i = 0; i < data; ++i) {
+            uint8_t coefficient = gf_inverse((uint8_t) ((data + j) ^ i));
+            m_matrix[(size_t) j * data + i] = coefficient;
+            append_tables(coefficient, m_tables[j]);
+        }
+    }
+    return true;
+}
+
+void ReedSolomon::encode(std::span<const byte* const> data, std::span<byte* const> parity, size_t size) const {
+    ASSERT_EX(data.size() == m_data && parity.size() == m_parity, "Shard count doesn't match the code.");
+    std::vector<const std::vector<uint8_t>*> rows;
+    for (const auto& tables : m_tables) rows.push_back(&tables);
+    combine_rows(rows, { data.begin(), data.end() }, { parity.begin(), parity.end() }, size);
+}
+
+bool ReedSolomon::reconstruct(std::span<byte* const> shards, std::span<const bool> present, size_t size) const {
+    ASSERT_EX(shards.size() == m_data + m_parity && present.size() == shards.size(), "Shard count doesn't match the code.");
+    std::vector<uint32_t> sources;
+    for (uint32_t i = 0; i < shards.size() && sources.size() < m_data; ++i) {
+        if (present[i]) sources.push_back(i);
+    }
+    if (sources.size() < m_data) return false;
+
+    bool parity_wanted = false;
+    for (uint32_t j = 0; j < m_parity; ++j) parity_wanted |= !present[m_data + j] && shards[m_data + j];
+
+    // The generator rows of the sources, inverted, turn the sources back into the data shards.
+    std::vector<uint8_t> decode((size_t) m_data * m_data, 0);
+    for (uint32_t row = 0; row < m_data; ++row) {
+        uint32_t source = sources[row];
+        if (source < m_data) {
+            decode[(size_t) row * m_data + source] = 1;
+        } else {
+            std::copy_n(m_matrix.begin() + (ptrdiff_t) ((source - m_data) * m_data), m_data, decode.begin() + (ptrdiff_t) (row * m_data));
+        }
+    }
+    if (!invert(decode, m_data)) return false;
+
+    // Parity is computed from all data shards, so the ones nobody asked for are rebuilt too then.
+    std::vector<std::vector<byte>> scratch;
+    std::vector<byte*> data(shards.begin(), shards.begin() + m_data);
+    std::vector<std::vector<uint8_t>> tables;
+    std::vector<byte*> outputs;
+    for (uint32_t i = 0; i < m_data; ++i) {
+        if (present[i]) continue;
+        if (!data[i]) {
+            if (!parity_wanted) continue;
+            data[i] = scratch.emplace_back(size).data();
+        }
+        auto& row = tables.emplace_back();
+        for (uint32_t j = 0; j < m_data; ++j) append_tables(decode[(size_t) i * m_data + j], row);
+        outputs.push_back(data[i]);
+    }
+    std::vector<const byte*> inputs;
+    for (uint32_t source : sources) inputs.push_back(shards[source]);
+    std::vector<const std::vector<uint8_t>*> rows;
+    for (const auto& row : tables) rows.push_back(&row);
+    combine_rows(rows, inputs, outputs, size);
+
+    if (!parity_wanted) return true;
+    rows.clear();
+    outputs.clear();
+    for (uint32_t j = 0; j < m_parity; ++j) {
+        if (present[m_data + j] || !shards[m_data + j]) continue;
+        rows.push_back(&m_tables[j]);
+        outputs.push_back(shards[m_data + j]);
+    }
+    combine_rows(rows, { data.begin(), data.end() }, outputs, size);
+    return true;
+}
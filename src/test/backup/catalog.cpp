@@ -0,0 +1,147 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/catalog.h"
+
+#include "test.h"
+
+static backup::CatalogRecord record_of(uint64_t size, uint8_t marker) {
+    backup::CatalogRecord record;
+    record.size = size;
+    record.mtime_ns = 1'792'411'200'000'000'000 + (int64_t) size;
+    backup::ChunkRef chunk {};
+    chunk.digest.fill(marker);
+    chunk.length = (uint32_t) size;
+    record.chunks.push_back(chunk);
+    return record;
+}
+
+DOCTEST_TEST_CASE("catalog: a checkpoint followed by journalled changes is restored on reopen") {
+    TestDirectory directory;
+    std::string path = directory / "catalog";
+    {
+        backup::Catalog catalog;
+        DOCTEST_REQUIRE(catalog.open(path));
+        catalog.put("/srv/a", record_of(1, 0xa1));
+        catalog.put("/srv/b", record_of(2, 0xb1));
+        catalog.put("/srv/c", record_of(3, 0xc1));
+        DOCTEST_REQUIRE(catalog.checkpoint());
+
+        // Only the journal knows about these.
+        catalog.put("/srv/a", record_of(10, 0xa2));
+        catalog.erase("/srv/b");
+        std::vector<backup::CatalogUpdate> updates { { "/srv/d", record_of(4, 0xd1) }, { "/srv/e", record_of(5, 0xe1) } };
+        DOCTEST_CHECK(catalog.wait(catalog.put(updates)));
+
+        // Only one process may have the catalog open.
+        backup::Catalog other;
+        DOCTEST_CHECK_FALSE(other.open(path));
+    }
+
+    backup::Catalog catalog;
+    DOCTEST_REQUIRE(catalog.open(path));
+    DOCTEST_CHECK(catalog.size() == 4);
+    backup::CatalogRecord record;
+    DOCTEST_REQUIRE(catalog.find("/srv/a", record));
+    DOCTEST_CHECK(record.size == 10);
+    DOCTEST_REQUIRE(record.chunks.size() == 1);
+    DOCTEST_CHECK(record.chunks.front().digest[0] == 0xa2);
+    DOCTEST_CHECK_FALSE(catalog.find("/srv/b", record));
+    DOCTEST_REQUIRE(catalog.find("/srv/c", record));
+    DOCTEST_CHECK(record.mtime_ns == 1'792'411'200'000'000'003);
+    DOCTEST_REQUIRE(catalog.find("/srv/e", record));
+    DOCTEST_CHECK(record.chunks.front().length == 5);
+}
+
+DOCTEST_TEST_CASE("catalog: a damaged checkpoint starts the catalog over") {
+    TestDirectory directory;
+    std::string path = directory / "catalog";
+    {
+        backup::Catalog catalog;
+        DOCTEST_REQUIRE(catalog.open(path));
+        catalog.put("/srv/a", record_of(1, 0xa1));
+        DOCTEST_REQUIRE(catalog.checkpoint());
+        DOCTEST_CHECK(catalog.wait(catalog.put("/srv/b", record_of(2, 0xb1))));
+    }
+    files::File file;
+    DOCTEST_REQUIRE(file.open(path + "/checkpoint", files::FileMode::ReadWrite));
+    DOCTEST_CHECK(file.write_all_at("X", 1, 10));
+    file.close();
+
+    backup::Catalog catalog;
+    DOCTEST_REQUIRE(catalog.open(path));
+    DOCTEST_CHECK(catalog.size() == 0);
+}
+
+DOCTEST_TEST_CASE("catalog: a journal record that doesn't parse ends replay instead of failing open") {
+    TestDirectory directory;
+    std::string path = directory / "catalog";
+    {
+        backup::Catalog catalog;
+        DOCTEST_REQUIRE(catalog.open(path));
+        DOCTEST_CHECK(catalog.wait(catalog.put("/srv/a", record_of(1, 0xa1))));
+    }
+    {
+        // Intact as far as the journal can tell, but no catalog operation.
+        files::Journal journal;
+        DOCTEST_REQUIRE(journal.open(path + "/journal", [](uint64_t, const byte*, size_t) { return true; }));
+        DOCTEST_CHECK(journal.commit("\xff", 1));
+        DOCTEST_CHECK(journal.commit("\x01", 1));
+    }
+    {
+        backup::Catalog catalog;
+        DOCTEST_REQUIRE(catalog.open(path));
+        DOCTEST_CHECK(catalog.size() == 1);
+        DOCTEST_CHECK(catalog.wait(catalog.put("/srv/b", record_of(2, 0xb1))));
+    }
+
+    // The bad records were cut off, so the one written after them is replayed too.
+    backup::Catalog catalog;
+    DOCTEST_REQUIRE(catalog.open(path));
+    DOCTEST_CHECK(catalog.size() == 2);
+    backup::CatalogRecord record;
+    DOCTEST_CHECK(catalog.find("/srv/b", record));
+}
+
+DOCTEST_TEST_CASE("catalog: batched puts survive a reopen") {
+    TestDirectory directory;
+    std::string path = directory / "catalog";
+    auto record_at = [](uint32_t batch, uint32_t index) {
+        backup::CatalogRecord record = record_of(batch * 1000 + index, (uint8_t) index);
+        // Several chunks, so a record's length isn't fixed by its path.
+        for (uint32_t i = 0; i < index % 4; ++i) record.chunks.push_back(record.chunks.front());
+        return record;
+    };
+    {
+        backup::Catalog catalog;
+        DOCTEST_REQUIRE(catalog.open(path));
+        uint64_t lsn = 0;
+        for (uint32_t batch = 0; batch < 3; ++batch) {
+            std::vector<backup::CatalogUpdate> updates;
+            for (uint32_t index = 0; index < 100; ++index) updates.push_back({ FORMAT("/srv/batch{}/file{}", batch, index), record_at(batch, index) });
+            // A later batch also replaces some earlier entries.
+            if (batch == 2) {
+                for (uint32_t index = 0; index < 10; ++index) updates.push_back({ FORMAT("/srv/batch0/file{}", index), record_at(9, index) });
+            }
+            lsn = catalog.put(updates);
+        }
+        DOCTEST_CHECK(catalog.wait(lsn));
+    }
+
+    backup::Catalog catalog;
+    DOCTEST_REQUIRE(catalog.open(path));
+    DOCTEST_CHECK(catalog.size() == 300);
+    for (uint32_t batch = 0; batch < 3; ++batch) {
+        for (uint32_t index = 0; index < 100; ++index) {
+            backup::CatalogRecord expected = record_at(batch == 0 && index < 10 ? 9 : batch, index);
+            backup::CatalogRecord record;
+            DOCTEST_REQUIRE(catalog.find(FORMAT("/srv/batch{}/file{}", batch, index), record));
+            DOCTEST_CHECK(record.size == expected.size);
+            DOCTEST_CHECK(record.mtime_ns == expected.mtime_ns);
+            DOCTEST_REQUIRE(record.chunks.size() == expected.chunks.size());
+            DOCTEST_CHECK(record.chunks.back().digest == expected.chunks.back().digest);
+            DOCTEST_CHECK(record.chunks.back().length == expected.chunks.back().length);
+        }
+    }
+}
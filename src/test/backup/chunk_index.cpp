@@ -0,0 +1,112 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/chunk_index.h"
+
+#include <random>
+
+#include "test.h"
+
+using backup::ChunkIndex;
+using backup::ChunkLocation;
+
+static std::vector<hashing::Digest> random_digests(size_t count, uint32_t seed) {
+    std::mt19937_64 random(seed);
+    std::vector<hashing::Digest> digests(count);
+    for (auto& digest : digests) {
+        for (auto& value : digest) value = (byte) random();
+    }
+    return digests;
+}
+
+//! Everything but `entry` is derived from the position, so a wrong record can't pass.
+static ChunkLocation location_of(size_t index, uint32_t pack = 0) {
+    return { pack, (uint32_t) index * 3 + 1, (uint64_t) index * 4096, 0, (uint32_t) index ^ 0x5A5A5A5A, (uint32_t) index };
+}
+
+static bool found_at(const ChunkIndex& index, const hashing::Digest& digest, size_t position, uint32_t pack = 0) {
+    ChunkLocation location {};
+    ChunkLocation expected = location_of(position, pack);
+    return index.find(digest, location) && location.pack == expected.pack && location.offset == expected.offset &&
+           location.length == expected.length && location.checksum == expected.checksum && location.entry == expected.entry;
+}
+
+DOCTEST_TEST_CASE("chunk_index: lookups cover the mapped run and the entries inserted since") {
+    TestDirectory directory;
+    std::string path = directory / "index";
+    std::vector<hashing::Digest> digests = random_digests(30000, 1);
+    // Extremes and a cluster sharing their leading bits, where interpolation guesses worst.
+    digests[0].fill(0x00);
+    digests[1].fill(0xFF);
+    for (size_t i = 2; i < 200; ++i) digests[i][0] = digests[i][1] = digests[i][2] = 0x80;
+    std::vector<std::string> packs { "pack-a", "pack-b" };
+    {
+        ChunkIndex index;
+        for (size_t i = 0; i < 20000; ++i) DOCTEST_CHECK(index.insert(digests[i], location_of(i)));
+        DOCTEST_REQUIRE(index.save(path, packs));
+    }
+
+    ChunkIndex index;
+    std::vector<std::string> loaded;
+    DOCTEST_REQUIRE(index.load(path, loaded));
+    DOCTEST_CHECK(loaded == packs);
+    DOCTEST_CHECK(index.size() == 20000);
+    DOCTEST_CHECK(index.recent_count() == 0);
+    for (size_t i = 20000; i < digests.size(); ++i) DOCTEST_CHECK(index.insert(digests[i], location_of(i, 1)));
+    DOCTEST_CHECK(index.recent_count() == 10000);
+    // Already indexed, in the run or since.
+    DOCTEST_CHECK_FALSE(index.insert(digests[5], location_of(99)));
+    DOCTEST_CHECK_FALSE(index.insert(digests[25000], location_of(99)));
+
+    auto check_all = [&]() {
+        size_t wrong = 0;
+        for (size_t i = 0; i < digests.size(); ++i) wrong += !found_at(index, digests[i], i, i < 20000 ? 0 : 1);
+        DOCTEST_CHECK(wrong == 0);
+        size_t found = 0;
+        for (const auto& digest : random_digests(10000, 2)) found += index.contains(digest);
+        DOCTEST_CHECK(found == 0);
+    };
+    check_all();
+    index.compact();
+    DOCTEST_CHECK(index.recent_count() == 0);
+    DOCTEST_CHECK(index.size() == digests.size());
+    check_all();
+
+    // Saving merges the recent entries into the file as well.
+    for (size_t i = 20000; i < digests.size(); ++i) DOCTEST_CHECK_FALSE(index.insert(digests[i], location_of(i)));
+    DOCTEST_REQUIRE(index.save(path, packs));
+    ChunkIndex reloaded;
+    DOCTEST_REQUIRE(reloaded.load(path, loaded));
+    DOCTEST_CHECK(reloaded.size() == digests.size());
+    DOCTEST_CHECK(found_at(reloaded, digests[25000], 25000, 1));
+    DOCTEST_CHECK(found_at(reloaded, digests[1], 1));
+}
+
+DOCTEST_TEST_CASE("chunk_index: a rebuild keeps the lower pack of a duplicate") {
+    TestDirectory directory;
+    std::string path = directory / "index";
+    std::vector<hashing::Digest> digests = random_digests(5000, 3);
+
+    ChunkIndex index;
+    std::vector<std::string> packs;
+    DOCTEST_REQUIRE(index.rebuild(
+        path,
+        [&](const ChunkIndex::AddEntry& add) {
+            // Pack 1 first, so the order the entries come in can't decide.
+            for (size_t i = 0; i < digests.size(); i += 2) add(digests[i], location_of(i, 1));
+            for (size_t i = 0; i < digests.size(); ++i) add(digests[i], location_of(i, 0));
+            packs = { "pack-a", "pack-b" };
+            return true;
+        },
+        packs));
+    DOCTEST_CHECK(index.size() == digests.size());
+    size_t wrong = 0;
+    for (size_t i = 0; i < digests.size(); ++i) wrong += !found_at(index, digests[i], i, 0);
+    DOCTEST_CHECK(wrong == 0);
+
+    ChunkIndex damaged;
+    std::vector<std::string> loaded;
+    DOCTEST_CHECK_FALSE(damaged.load(directory / "missing", loaded));
+    DOCTEST_CHECK(damaged.size() == 0);
+}
@@ -0,0 +1,89 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/chunker.h"
+
+#include <random>
+#include <set>
+
+#include "hashing/sha256.h"
+#include "test.h"
+
+static const backup::ChunkerOptions c_options { 2 * 1024, 8 * 1024, 32 * 1024 };
+
+static std::vector<size_t> cut_points(const backup::Chunker& chunker, const std::vector<byte>& data) {
+    std::vector<size_t> cuts;
+    size_t offset = 0;
+    while (offset < data.size()) {
+        size_t cut = chunker.next_cut(data.data() + offset, data.size() - offset);
+        DOCTEST_REQUIRE(cut > 0);
+        offset += cut;
+        cuts.push_back(offset);
+    }
+    return cuts;
+}
+
+static std::vector<byte> random_bytes(size_t size, uint64_t seed) {
+    std::mt19937_64 random(seed);
+    std::vector<byte> data(size);
+    for (auto& value : data) value = (byte) random();
+    return data;
+}
+
+DOCTEST_TEST_CASE("chunker: cuts respect the size limits") {
+    backup::Chunker chunker(c_options);
+    auto data = random_bytes(1024 * 1024, 1);
+    auto cuts = cut_points(chunker, data);
+    DOCTEST_REQUIRE(cuts.back() == data.size());
+    size_t previous = 0;
+    for (size_t i = 0; i < cuts.size(); ++i) {
+        size_t length = cuts[i] - previous;
+        DOCTEST_CHECK(length <= c_options.max_size);
+        if (i + 1 < cuts.size()) DOCTEST_CHECK(length > c_options.min_size);
+        previous = cuts[i];
+    }
+    // Normalized chunking keeps the average close to the target.
+    size_t average = data.size() / cuts.size();
+    DOCTEST_CHECK(average > c_options.average_size / 2);
+    DOCTEST_CHECK(average < c_options.average_size * 2);
+
+    // A run of identical bytes never matches the mask and is cut at the maximum size.
+    std::vector<byte> zeros(100 * 1024, 0);
+    DOCTEST_CHECK(chunker.next_cut(zeros.data(), zeros.size()) == c_options.max_size);
+}
+
+DOCTEST_TEST_CASE("chunker: boundaries are stable after an insert") {
+    backup::Chunker chunker(c_options);
+    auto original = random_bytes(2 * 1024 * 1024, 2);
+    auto edited = original;
+    size_t insert_at = original.size() / 2;
+    auto inserted = random_bytes(100, 3);
+    edited.insert(edited.begin() + (ptrdiff_t) insert_at, inserted.begin(), inserted.end());
+
+    auto before = cut_points(chunker, original);
+    auto after = cut_points(chunker, edited);
+
+    // Every cut before the insert is unchanged and the cuts after it resynchronise, shifted by the insert.
+    std::set<size_t> shifted;
+    for (size_t cut : after) shifted.insert(cut < insert_at ? cut : cut - inserted.size());
+    size_t missing = 0;
+    for (size_t cut : before) {
+        if (!shifted.contains(cut)) missing++;
+    }
+    DOCTEST_CHECK(missing <= 2);
+
+    auto digests = [](const std::vector<byte>& data, const std::vector<size_t>& cuts) {
+        std::set<hashing::Digest> result;
+        size_t previous = 0;
+        for (size_t cut : cuts) {
+            result.insert(hashing::Sha256::digest(data.data() + previous, cut - previous));
+            previous = cut;
+        }
+        return result;
+    };
+    auto old_chunks = digests(original, before);
+    size_t reused = 0;
+    for (const auto& digest : digests(edited, after)) reused += old_chunks.contains(digest);
+    DOCTEST_CHECK(reused + 3 >= after.size());
+}
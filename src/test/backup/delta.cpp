@@ -0,0 +1,81 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/delta.h"
+
+#include <random>
+
+#include "test.h"
+
+using backup::c_delta_block_size;
+
+static std::vector<byte> random_bytes(size_t size, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::vector<byte> data(size);
+    for (auto& value : data) value = (byte) random();
+    return data;
+}
+
+static std::vector<byte> round_trip(const std::vector<byte>& base, const std::vector<byte>& target, size_t& delta_size) {
+    hashing::Digest digest = hashing::Sha256::digest(base.data(), base.size());
+    backup::DeltaSignature signature(base.data(), base.size());
+    std::vector<byte> delta;
+    DOCTEST_REQUIRE(backup::delta_encode(digest, base.data(), signature, target.data(), target.size(), target.size() + 64, delta));
+    delta_size = delta.size();
+
+    hashing::Digest recorded {};
+    DOCTEST_CHECK(backup::delta_base(delta.data(), delta.size(), recorded));
+    DOCTEST_CHECK(recorded == digest);
+    std::vector<byte> rebuilt;
+    DOCTEST_REQUIRE(backup::delta_apply(base.data(), base.size(), delta.data(), delta.size(), rebuilt));
+    return rebuilt;
+}
+
+DOCTEST_TEST_CASE("delta: edited targets are rebuilt exactly from their base") {
+    std::vector<byte> base = random_bytes(16 * c_delta_block_size + 123, 1);
+    size_t delta_size = 0;
+
+    DOCTEST_CHECK(round_trip(base, base, delta_size) == base);
+    DOCTEST_CHECK(delta_size < 256);
+
+    // Bytes inserted off the block grid, so every later match has to be found by rolling.
+    std::vector<byte> inserted = base;
+    inserted.insert(inserted.begin() + 5 * c_delta_block_size + 17, 100, 0x5A);
+    DOCTEST_CHECK(round_trip(base, inserted, delta_size) == inserted);
+    DOCTEST_CHECK(delta_size < 2 * c_delta_block_size);
+
+    std::vector<byte> changed = base;
+    for (size_t i = 0; i < changed.size(); i += 3 * c_delta_block_size) changed[i] ^= 0xFF;
+    DOCTEST_CHECK(round_trip(base, changed, delta_size) == changed);
+
+    std::vector<byte> truncated(base.begin(), base.begin() + 7 * c_delta_block_size + 5);
+    DOCTEST_CHECK(round_trip(base, truncated, delta_size) == truncated);
+
+    std::vector<byte> tiny(base.begin(), base.begin() + 10);
+    DOCTEST_CHECK(round_trip(base, tiny, delta_size) == tiny);
+
+    std::vector<byte> empty;
+    DOCTEST_CHECK(round_trip(base, empty, delta_size) == empty);
+}
+
+DOCTEST_TEST_CASE("delta: unrelated data exceeds the limit") {
+    std::vector<byte> base = random_bytes(8 * c_delta_block_size, 2);
+    std::vector<byte> target = random_bytes(8 * c_delta_block_size, 3);
+    backup::DeltaSignature signature(base.data(), base.size());
+    std::vector<byte> delta;
+    DOCTEST_CHECK_FALSE(backup::delta_encode({}, base.data(), signature, target.data(), target.size(), target.size() / 2, delta));
+}
+
+DOCTEST_TEST_CASE("delta: a delta is rejected against a base it doesn't fit") {
+    std::vector<byte> base = random_bytes(4 * c_delta_block_size, 4);
+    std::vector<byte> target = base;
+    target[10] ^= 1;
+    backup::DeltaSignature signature(base.data(), base.size());
+    std::vector<byte> delta;
+    DOCTEST_REQUIRE(backup::delta_encode({}, base.data(), signature, target.data(), target.size(), target.size(), delta));
+
+    std::vector<byte> rebuilt;
+    DOCTEST_CHECK_FALSE(backup::delta_apply(base.data(), 2 * c_delta_block_size, delta.data(), delta.size(), rebuilt));
+    DOCTEST_CHECK_FALSE(backup::delta_apply(base.data(), base.size(), delta.data(), delta.size() - 1, rebuilt));
+}
@@ -0,0 +1,133 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/prune.h"
+
+#include <fcntl.h>
+#include <fstream>
+#include <random>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "backup/delta.h"
+#include "test.h"
+
+using backup::ChunkRef;
+using backup::Snapshot;
+
+static std::vector<byte> random_bytes(size_t size, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::vector<byte> data(size);
+    for (auto& value : data) value = (byte) random();
+    return data;
+}
+
+static hashing::Digest store(backup::Repository& repository, const std::vector<byte>& data) {
+    hashing::Digest digest = hashing::Sha256::digest(data.data(), data.size());
+    bool added = false;
+    DOCTEST_REQUIRE(repository.store_chunk(digest, data.data(), data.size(), added));
+    return digest;
+}
+
+//! A snapshot of `/srv/data` holding one file made of `chunk`.
+static void save_snapshot_of(backup::Repository& repository, const hashing::Digest& chunk, uint32_t length, int64_t time_ns) {
+    Snapshot snapshot;
+    snapshot.source = "/srv/data";
+    snapshot.time_ns = time_ns;
+    snapshot.entries.push_back({ files::EntryType::Directory, 0, S_IFDIR | 0755 });
+    DOCTEST_REQUIRE(snapshot.paths.intern("file", false) == 1);
+    backup::SnapshotEntry entry { files::EntryType::File, 0, S_IFREG | 0644, length };
+    entry.chunk_count = 1;
+    snapshot.entries.push_back(entry);
+    snapshot.chunks.push_back(ChunkRef { chunk, length });
+    DOCTEST_REQUIRE(repository.save_snapshot(snapshot));
+}
+
+DOCTEST_TEST_CASE("prune: marks the chunks of kept snapshots and the bases of their deltas") {
+    TestDirectory directory;
+    std::string path = directory / "repository";
+    DOCTEST_REQUIRE(backup::Repository::create(path));
+    backup::Repository repository;
+    DOCTEST_REQUIRE(repository.open(path));
+
+    std::vector<byte> base = random_bytes(64 * 1024, 1);
+    std::vector<byte> target = base;
+    target[1000] ^= 0xFF;
+    hashing::Digest base_digest = store(repository, base);
+    hashing::Digest old_digest = store(repository, random_bytes(64 * 1024, 2));
+    hashing::Digest garbage_digest = store(repository, random_bytes(64 * 1024, 3));
+
+    // Only the delta is referenced; its base has to survive with it.
+    hashing::Digest target_digest = hashing::Sha256::digest(target.data(), target.size());
+    backup::DeltaSignature signature(base.data(), base.size());
+    std::vector<byte> delta;
+    DOCTEST_REQUIRE(backup::delta_encode(base_digest, base.data(), signature, target.data(), target.size(), target.size(), delta));
+    bool added = false;
+    DOCTEST_REQUIRE(repository.store_delta(target_digest, delta.data(), delta.size(), added));
+    DOCTEST_REQUIRE(repository.flush());
+
+    save_snapshot_of(repository, old_digest, 64 * 1024, 1'792'411'200'000'000'000);
+    save_snapshot_of(repository, target_digest, (uint32_t) target.size(), 1'792'411'300'000'000'000);
+    std::string newest = repository.latest_snapshot_id();
+
+    backup::PruneOptions options;
+    options.keep_last = 1;
+    options.repack_below = 1;
+    options.dry_run = true;
+    backup::PruneStats stats;
+    DOCTEST_REQUIRE(backup::run_prune(repository, options, stats));
+    DOCTEST_CHECK(stats.snapshots_removed == 1);
+    DOCTEST_CHECK(stats.chunks_live == 2);
+    DOCTEST_CHECK(stats.chunks_removed == 2);
+    DOCTEST_CHECK(repository.snapshot_ids().size() == 2);
+    DOCTEST_CHECK(repository.contains(garbage_digest));
+
+    options.dry_run = false;
+    stats = {};
+    DOCTEST_REQUIRE(backup::run_prune(repository, options, stats));
+    DOCTEST_CHECK(stats.snapshots_kept == 1);
+    DOCTEST_CHECK(stats.snapshots_removed == 1);
+    DOCTEST_CHECK(stats.chunks_live == 2);
+    DOCTEST_CHECK(stats.chunks_removed == 2);
+    DOCTEST_CHECK(stats.chunks_missing == 0);
+    DOCTEST_CHECK(repository.snapshot_ids() == std::vector<std::string> { newest });
+
+    // Checked against a freshly opened repository, not just the in-memory index.
+    backup::Repository reopened;
+    DOCTEST_REQUIRE(reopened.open(path));
+    DOCTEST_CHECK(reopened.contains(base_digest));
+    DOCTEST_CHECK(reopened.contains(target_digest));
+    DOCTEST_CHECK_FALSE(reopened.contains(old_digest));
+    DOCTEST_CHECK_FALSE(reopened.contains(garbage_digest));
+    std::vector<byte> data;
+    DOCTEST_REQUIRE(reopened.read_chunk(target_digest, data));
+    DOCTEST_CHECK(data == target);
+}
+
+DOCTEST_TEST_CASE("prune: a prune that fails releases the repository lock") {
+    TestDirectory directory;
+    std::string path = directory / "repository";
+    DOCTEST_REQUIRE(backup::Repository::create(path));
+    backup::Repository repository;
+    DOCTEST_REQUIRE(repository.open(path));
+    hashing::Digest digest = store(repository, random_bytes(4096, 4));
+    DOCTEST_REQUIRE(repository.flush());
+    save_snapshot_of(repository, digest, 4096, 1'792'411'200'000'000'000);
+    std::string id = repository.latest_snapshot_id();
+    {
+        std::ofstream damaged(path + "/snapshots/" + id + ".snap", std::ios::binary | std::ios::trunc);
+        damaged << "not a snapshot";
+    }
+
+    backup::PruneOptions options;
+    options.keep_last = 1;
+    backup::PruneStats stats;
+    DOCTEST_CHECK_FALSE(backup::run_prune(repository, options, stats));
+    // A backup could take the lock now; flock on another descriptor would fail while prune held it.
+    int32_t fd = ::open((path + "/lock").c_str(), O_RDWR | O_CLOEXEC);
+    DOCTEST_REQUIRE(fd >= 0);
+    DOCTEST_CHECK(::flock(fd, LOCK_EX | LOCK_NB) == 0);
+    ::close(fd);
+}
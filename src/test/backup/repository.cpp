@@ -0,0 +1,41 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/repository.h"
+
+#include <set>
+#include <sys/stat.h>
+
+#include "test.h"
+
+DOCTEST_TEST_CASE("repository: snapshots saved in the same instant all survive, in time order") {
+    TestDirectory directory;
+    std::string path = directory / "repository";
+    DOCTEST_REQUIRE(backup::Repository::create(path));
+    backup::Repository repository;
+    DOCTEST_REQUIRE(repository.open(path));
+
+    backup::Snapshot snapshot;
+    snapshot.source = "/srv/data";
+    snapshot.entries.push_back({ files::EntryType::Directory, 0, S_IFDIR | 0755 });
+    std::set<std::string> saved;
+    for (int i = 0; i < 5; ++i) {
+        snapshot.time_ns = 1'792'411'200'999'999'999;
+        DOCTEST_REQUIRE(repository.save_snapshot(snapshot));
+        DOCTEST_CHECK(snapshot.time_ns == 1'792'411'200'999'999'999 + i);
+        saved.insert(snapshot.id);
+    }
+    DOCTEST_CHECK(saved.size() == 5);
+
+    auto ids = repository.snapshot_ids();
+    DOCTEST_REQUIRE(ids.size() == 5);
+    DOCTEST_CHECK(ids.back() == snapshot.id);
+    DOCTEST_CHECK(repository.latest_snapshot_id() == snapshot.id);
+
+    backup::Snapshot loaded;
+    DOCTEST_REQUIRE(repository.load_snapshot(ids.back(), loaded));
+    DOCTEST_CHECK(loaded.time_ns == snapshot.time_ns);
+    DOCTEST_REQUIRE(repository.load_snapshot(ids.front(), loaded));
+    DOCTEST_CHECK(loaded.time_ns == 1'792'411'200'999'999'999);
+}
@@ -0,0 +1,130 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/restore.h"
+
+#include <fstream>
+#include <map>
+#include <random>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "backup/backup.h"
+#include "test.h"
+
+DOCTEST_TEST_CASE("restore: never writes through symlinks in the target") {
+    TestDirectory directory;
+    std::string path = directory / "repository";
+    DOCTEST_REQUIRE(backup::Repository::create(path));
+    backup::Repository repository;
+    DOCTEST_REQUIRE(repository.open(path));
+
+    // Empty files have no chunks, so the repository needs no data for them.
+    backup::Snapshot snapshot;
+    snapshot.entries.push_back({ files::EntryType::Directory, 0, S_IFDIR | 0755 });
+    auto add = [&](std::string_view name, files::EntryType type, uint32_t mode) {
+        DOCTEST_REQUIRE(snapshot.paths.intern(name, type == files::EntryType::Directory) == snapshot.entries.size());
+        snapshot.entries.push_back({ type, 0, mode });
+    };
+    add("dir", files::EntryType::Directory, S_IFDIR | 0755);
+    add("dir/inner", files::EntryType::File, S_IFREG | 0644);
+    add("file", files::EntryType::File, S_IFREG | 0644);
+    add("plain", files::EntryType::Directory, S_IFDIR | 0700);
+
+    std::string outside = directory / "outside";
+    std::string target = directory / "target";
+    std::filesystem::create_directories(outside);
+    std::filesystem::create_directories(target);
+    std::ofstream(outside + "/file") << "keep";
+    DOCTEST_REQUIRE(symlink(outside.c_str(), (target + "/dir").c_str()) == 0);
+    DOCTEST_REQUIRE(symlink((outside + "/file").c_str(), (target + "/file").c_str()) == 0);
+
+    backup::RestoreStats stats;
+    DOCTEST_REQUIRE(backup::run_restore(repository, snapshot, target, stats));
+    DOCTEST_CHECK(stats.errors == 1);
+
+    // The symlinked directory is rejected with its contents, the symlinked file is replaced.
+    DOCTEST_CHECK_FALSE(std::filesystem::exists(outside + "/inner"));
+    DOCTEST_CHECK(std::filesystem::is_symlink(target + "/dir"));
+    DOCTEST_CHECK_FALSE(std::filesystem::is_symlink(target + "/file"));
+    DOCTEST_CHECK(std::filesystem::file_size(target + "/file") == 0);
+    DOCTEST_CHECK(std::filesystem::file_size(outside + "/file") == 4);
+    DOCTEST_CHECK(std::filesystem::is_directory(target + "/plain"));
+}
+
+namespace {
+    std::string random_contents(size_t size, uint32_t seed) {
+        std::mt19937 random(seed);
+        std::string data(size, '\0');
+        for (auto& value : data) value = (char) random();
+        return data;
+    }
+
+    std::string read_file(const std::string& path) {
+        std::ifstream stream(path, std::ios::binary);
+        return { std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+    }
+}  // namespace
+
+DOCTEST_TEST_CASE("restore: many files over several directories and packs come back byte for byte") {
+    TestDirectory directory;
+    std::string source = directory / "source";
+    std::string path = directory / "repository";
+    DOCTEST_REQUIRE(backup::Repository::create(path));
+    backup::Repository repository;
+    DOCTEST_REQUIRE(repository.open(path));
+
+    // Every backup ends its pack, so each round adds one. Later rounds rewrite some earlier files,
+    // leaving the files of one directory spread over all packs in no particular order.
+    std::map<std::string, std::string> files;
+    backup::Snapshot snapshot;
+    for (uint32_t round = 0; round < 3; ++round) {
+        for (uint32_t dir = 0; dir < 4; ++dir) {
+            std::filesystem::create_directories(FORMAT("{}/dir{}/sub", source, dir));
+            for (uint32_t file = 0; file < 40; ++file) {
+                if (round > 0 && (file + dir + round) % 3 != 0) continue;
+                uint32_t seed = round * 10'000 + dir * 100 + file;
+                // Mostly small files for the batches, some over 64 KiB and a few empty ones.
+                size_t size = file % 10 == 0 ? 100 * 1024 + seed % 5000 : file % 13 == 0 ? 0 : 100 + seed * 37 % 8000;
+                std::string name = FORMAT("dir{}/{}file{}", dir, file % 2 ? "sub/" : "", file);
+                files[name] = random_contents(size, seed);
+                std::ofstream(source + "/" + name, std::ios::binary | std::ios::trunc) << files[name];
+            }
+        }
+        backup::BackupOptions options;
+        options.source = source;
+        backup::BackupStats stats;
+        DOCTEST_REQUIRE(backup::run_backup(repository, options, snapshot, stats));
+    }
+    DOCTEST_REQUIRE(symlink("dir0/file0", (source + "/link").c_str()) == 0);
+    {
+        backup::BackupOptions options;
+        options.source = source;
+        backup::BackupStats stats;
+        DOCTEST_REQUIRE(backup::run_backup(repository, options, snapshot, stats));
+    }
+    DOCTEST_CHECK(repository.pack_count() >= 3);
+
+    backup::Snapshot loaded;
+    DOCTEST_REQUIRE(repository.load_snapshot(snapshot.id, loaded));
+    std::string target = directory / "target";
+    backup::RestoreStats stats;
+    DOCTEST_REQUIRE(backup::run_restore(repository, loaded, target, stats));
+    DOCTEST_CHECK(stats.errors == 0);
+    DOCTEST_CHECK(stats.files == files.size());
+    DOCTEST_CHECK(stats.links == 1);
+
+    uint64_t bytes = 0;
+    for (const auto& [name, contents] : files) {
+        DOCTEST_CHECK_MESSAGE(read_file(target + "/" + name) == contents, name << " differs");
+        bytes += contents.size();
+    }
+    DOCTEST_CHECK(stats.bytes_written == bytes);
+    DOCTEST_CHECK(std::filesystem::read_symlink(target + "/link") == "dir0/file0");
+
+    // Nothing more than what was backed up.
+    size_t restored = 0;
+    for (const auto& item : std::filesystem::recursive_directory_iterator(target)) restored += item.is_regular_file() && !item.is_symlink();
+    DOCTEST_CHECK(restored == files.size());
+}
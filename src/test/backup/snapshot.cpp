@@ -0,0 +1,140 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/snapshot.h"
+
+#include <sys/stat.h>
+
+#include "backup/merkle.h"
+#include "test.h"
+
+using backup::ChunkRef;
+using backup::Snapshot;
+using backup::SnapshotEntry;
+using files::EntryType;
+using files::PathId;
+
+static hashing::Digest digest_of(std::string_view data) {
+    return hashing::Sha256::digest(data.data(), data.size());
+}
+
+//! /dir/a.txt (two chunks), /dir/empty, /link -> dir/a.txt and /b.bin (one chunk).
+static Snapshot sample_snapshot() {
+    Snapshot snapshot;
+    snapshot.id = "20261019T120000.000000001Z-0123456789ab";
+    snapshot.source = "/srv/data";
+    snapshot.time_ns = 1'792'411'200'000'000'001;
+    snapshot.entries.push_back({ EntryType::Directory, 0, S_IFDIR | 0755, 0, -5 });
+
+    auto add = [&](std::string_view path, EntryType type, uint64_t size, std::vector<ChunkRef> chunks = {}) {
+        PathId id = snapshot.paths.intern(path, type == EntryType::Directory);
+        DOCTEST_REQUIRE(id == snapshot.entries.size());
+        SnapshotEntry entry { type, 0, (uint32_t) (type == EntryType::Directory ? S_IFDIR | 0700 : S_IFREG | 0644), size, 1'700'000'000'123'456'789 };
+        entry.first_chunk = (uint32_t) snapshot.chunks.size();
+        entry.chunk_count = (uint32_t) chunks.size();
+        snapshot.chunks.insert(snapshot.chunks.end(), chunks.begin(), chunks.end());
+        snapshot.entries.push_back(entry);
+        if (type == EntryType::File) snapshot.entries[id].content = backup::merkle_file_digest(size, snapshot.chunks_of(id));
+        return id;
+    };
+    add("dir", EntryType::Directory, 0);
+    add("dir/a.txt", EntryType::File, 300, { { digest_of("first"), 200 }, { digest_of("second"), 100 } });
+    add("dir/empty", EntryType::File, 0);
+    PathId link = add("link", EntryType::Symlink, 9);
+    snapshot.link_targets.emplace(link, "dir/a.txt");
+    add("b.bin", EntryType::File, 42, { { digest_of("third"), 42 } });
+    backup::merkle_build(snapshot, true);
+    return snapshot;
+}
+
+DOCTEST_TEST_CASE("snapshot: serialize and deserialize round-trip") {
+    Snapshot snapshot = sample_snapshot();
+    snapshot.filter_rules = { "*.tmp", "!keep.tmp", "/cache/" };
+    std::vector<byte> bytes;
+    backup::serialize_snapshot(snapshot, bytes);
+
+    Snapshot loaded;
+    DOCTEST_REQUIRE(backup::deserialize_snapshot(bytes.data(), bytes.size(), loaded));
+    DOCTEST_CHECK(loaded.id == snapshot.id);
+    DOCTEST_CHECK(loaded.source == snapshot.source);
+    DOCTEST_CHECK(loaded.time_ns == snapshot.time_ns);
+    DOCTEST_CHECK(loaded.filter_rules == snapshot.filter_rules);
+    DOCTEST_CHECK_FALSE(loaded.filter_ignore_case);
+    DOCTEST_REQUIRE(loaded.entries.size() == snapshot.entries.size());
+    for (PathId id = 0; id < snapshot.entries.size(); ++id) {
+        const auto& expected = snapshot.entries[id];
+        const auto& actual = loaded.entries[id];
+        DOCTEST_CHECK(loaded.paths.path(id) == snapshot.paths.path(id));
+        DOCTEST_CHECK(actual.type == expected.type);
+        DOCTEST_CHECK(actual.mode == expected.mode);
+        DOCTEST_CHECK(actual.size == expected.size);
+        DOCTEST_CHECK(actual.mtime_ns == expected.mtime_ns);
+        DOCTEST_CHECK(actual.content == expected.content);
+        DOCTEST_CHECK(actual.meta == expected.meta);
+        DOCTEST_REQUIRE(actual.chunk_count == expected.chunk_count);
+        for (uint32_t i = 0; i < expected.chunk_count; ++i) {
+            DOCTEST_CHECK(loaded.chunks_of(id)[i].digest == snapshot.chunks_of(id)[i].digest);
+            DOCTEST_CHECK(loaded.chunks_of(id)[i].length == snapshot.chunks_of(id)[i].length);
+        }
+    }
+    DOCTEST_CHECK(loaded.link_target(4) == "dir/a.txt");
+    DOCTEST_CHECK(loaded.children(files::c_root_path).size() == 3);
+
+    std::vector<byte> again;
+    backup::serialize_snapshot(loaded, again);
+    DOCTEST_CHECK(again == bytes);
+}
+
+DOCTEST_TEST_CASE("snapshot: damaged manifests are rejected") {
+    std::vector<byte> bytes;
+    backup::serialize_snapshot(sample_snapshot(), bytes);
+    Snapshot loaded;
+
+    auto flipped = bytes;
+    flipped[flipped.size() / 2] ^= 0x01;
+    DOCTEST_CHECK_FALSE(backup::deserialize_snapshot(flipped.data(), flipped.size(), loaded));
+    DOCTEST_CHECK_FALSE(backup::deserialize_snapshot(bytes.data(), bytes.size() - 1, loaded));
+    DOCTEST_CHECK_FALSE(backup::deserialize_snapshot(bytes.data(), 8, loaded));
+}
+
+DOCTEST_TEST_CASE("merkle: check finds tampered entries") {
+    Snapshot snapshot = sample_snapshot();
+    std::vector<PathId> corrupt;
+    DOCTEST_REQUIRE(backup::merkle_check(snapshot, corrupt));
+    DOCTEST_CHECK(corrupt.empty());
+
+    // A chunk swapped under a file breaks that file's content node, not its parent's listing.
+    snapshot.chunks[snapshot.entries[2].first_chunk].digest = digest_of("tampered");
+    DOCTEST_CHECK_FALSE(backup::merkle_check(snapshot, corrupt));
+    DOCTEST_CHECK(corrupt == std::vector<PathId> { 2 });
+
+    // A rewritten file node breaks the parent directory node instead.
+    corrupt.clear();
+    snapshot.entries[2].content = backup::merkle_file_digest(snapshot.entries[2].size, snapshot.chunks_of(2));
+    DOCTEST_CHECK_FALSE(backup::merkle_check(snapshot, corrupt));
+    DOCTEST_CHECK(corrupt == std::vector<PathId> { 1 });
+
+    corrupt.clear();
+    Snapshot relinked = sample_snapshot();
+    relinked.link_targets[4] = "elsewhere";
+    DOCTEST_CHECK_FALSE(backup::merkle_check(relinked, corrupt));
+    DOCTEST_CHECK(corrupt == std::vector<PathId> { 4 });
+}
+
+DOCTEST_TEST_CASE("merkle: diff reports changes per entry") {
+    Snapshot stored = sample_snapshot();
+    Snapshot live = sample_snapshot();
+    live.entries[5].mtime_ns += 1;
+    backup::merkle_build(live, false);
+
+    std::vector<std::pair<backup::TreeChange, PathId>> changes;
+    backup::merkle_diff(stored, live, [&](backup::TreeChange change, PathId stored_id, PathId) { changes.emplace_back(change, stored_id); });
+    DOCTEST_REQUIRE(changes.size() == 1);
+    DOCTEST_CHECK(changes[0].first == backup::TreeChange::Changed);
+    DOCTEST_CHECK(changes[0].second == 5);
+
+    changes.clear();
+    backup::merkle_diff(stored, sample_snapshot(), [&](backup::TreeChange change, PathId stored_id, PathId) { changes.emplace_back(change, stored_id); });
+    DOCTEST_CHECK(changes.empty());
+}
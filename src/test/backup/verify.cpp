@@ -0,0 +1,93 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "backup/verify.h"
+
+#include <fstream>
+#include <sys/stat.h>
+
+#include "backup/backup.h"
+#include "files/hash_cache.h"
+#include "test.h"
+
+//! Backs up `source` into a new repository at `path` and returns the stored snapshot.
+static backup::Snapshot backup_tree(backup::Repository& repository, const std::string& path, const std::string& source,
+                                    const files::PathFilter* filter) {
+    DOCTEST_REQUIRE(backup::Repository::create(path));
+    DOCTEST_REQUIRE(repository.open(path));
+    backup::BackupOptions options;
+    options.source = source;
+    options.filter = filter;
+    backup::Snapshot snapshot;
+    backup::BackupStats stats;
+    DOCTEST_REQUIRE(backup::run_backup(repository, options, snapshot, stats));
+
+    backup::Snapshot loaded;
+    DOCTEST_REQUIRE(repository.load_snapshot(snapshot.id, loaded));
+    return loaded;
+}
+
+DOCTEST_TEST_CASE("verify: quick mode leaves out what the backup excluded") {
+    TestDirectory directory;
+    std::string source = directory / "source";
+    std::filesystem::create_directories(source + "/cache");
+    std::ofstream(source + "/kept.txt") << "kept";
+    std::ofstream(source + "/scratch.tmp") << "scratch";
+    std::ofstream(source + "/cache/entry") << "entry";
+
+    files::PathFilter filter(true);
+    DOCTEST_REQUIRE(filter.add_rule("*.TMP"));
+    DOCTEST_REQUIRE(filter.add_rule("# comment"));
+    DOCTEST_REQUIRE(filter.add_rule("cache/"));
+    filter.compile();
+    DOCTEST_CHECK(filter.rules() == std::vector<std::string> { "*.TMP", "cache/" });
+
+    backup::Repository repository;
+    backup::Snapshot snapshot = backup_tree(repository, directory / "repository", source, &filter);
+    DOCTEST_CHECK(snapshot.filter_rules == filter.rules());
+    DOCTEST_CHECK(snapshot.filter_ignore_case);
+    DOCTEST_CHECK(snapshot.entries.size() == 2);
+
+    // Without rules on the command line, the recorded ones keep the excluded paths out.
+    backup::VerifyReport report;
+    DOCTEST_REQUIRE(backup::verify_quick(repository, snapshot, source, nullptr, false, report));
+    DOCTEST_CHECK(report.problems.empty());
+
+    // Rules given for the run are added to them.
+    std::ofstream(source + "/new.log") << "new";
+    std::ofstream(source + "/other.txt") << "other";
+    files::PathFilter extra;
+    DOCTEST_REQUIRE(extra.add_rule("*.log"));
+    extra.compile();
+    report = {};
+    DOCTEST_REQUIRE(backup::verify_quick(repository, snapshot, source, &extra, false, report));
+    DOCTEST_REQUIRE(report.problems.size() == 1);
+    DOCTEST_CHECK(report.problems[0].issue == backup::VerifyIssue::Added);
+    DOCTEST_CHECK(report.problems[0].path == source + "/other.txt");
+}
+
+DOCTEST_TEST_CASE("verify: a forged cached hash doesn't hide a modified file") {
+    TestDirectory directory;
+    std::string source = directory / "source";
+    std::filesystem::create_directories(source);
+    std::ofstream(source + "/file") << "original contents";
+
+    backup::Repository repository;
+    backup::Snapshot snapshot = backup_tree(repository, directory / "repository", source, nullptr);
+    DOCTEST_REQUIRE(snapshot.entries.size() == 2);
+    const hashing::Digest& content = snapshot.entries[1].content;
+
+    // The attribute claims the stored contents for exactly the size and mtime the file has now.
+    std::ofstream(source + "/file", std::ios::trunc) << "tampered";
+    struct stat info {};
+    DOCTEST_REQUIRE(::stat((source + "/file").c_str(), &info) == 0);
+    int64_t mtime_ns = (int64_t) info.st_mtim.tv_sec * 1'000'000'000 + info.st_mtim.tv_nsec;
+    if (!files::store_cached_hash(source + "/file", files::HashAlgorithm::ChunkedSha256, info.st_size, mtime_ns, content)) return;
+
+    backup::VerifyReport report;
+    DOCTEST_REQUIRE(backup::verify_quick(repository, snapshot, source, nullptr, true, report));
+    DOCTEST_REQUIRE(report.problems.size() == 1);
+    DOCTEST_CHECK(report.problems[0].issue == backup::VerifyIssue::Modified);
+    DOCTEST_CHECK(report.files_rehashed == 1);
+}
@@ -0,0 +1,77 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "commands/commands.h"
+
+#include "test.h"
+
+//! Splits and parses one config line.
+static bool parse_line(std::string_view line, service::JobConfig& job) {
+    std::vector<std::string> words;
+    DOCTEST_REQUIRE(commands::split_words(line, words));
+    DOCTEST_REQUIRE_FALSE(words.empty());
+    return commands::parse_job(words, job);
+}
+
+DOCTEST_TEST_CASE("daemon config: words split on whitespace and quotes keep spaces") {
+    std::vector<std::string> words;
+    DOCTEST_REQUIRE(commands::split_words("  backup\t/srv/data  '/mnt/my backups' --exclude \"*.tmp files\" --exclude a'b c'd ", words));
+    DOCTEST_CHECK(words == std::vector<std::string> { "backup", "/srv/data", "/mnt/my backups", "--exclude", "*.tmp files", "--exclude", "ab cd" });
+
+    DOCTEST_REQUIRE(commands::split_words("   ", words));
+    DOCTEST_CHECK(words.empty());
+    DOCTEST_REQUIRE(commands::split_words("'' x", words));
+    DOCTEST_CHECK(words == std::vector<std::string> { "", "x" });
+
+    DOCTEST_CHECK_FALSE(commands::split_words("backup '/srv/data /mnt", words));
+    DOCTEST_CHECK_FALSE(commands::split_words("backup \"", words));
+}
+
+DOCTEST_TEST_CASE("daemon config: valid jobs are parsed") {
+    service::JobConfig backup;
+    DOCTEST_REQUIRE(parse_line("backup /srv/data/../data/ /mnt/repository --every 6h --exclude '*.tmp' --ignore-case --hash-xattrs", backup));
+    DOCTEST_CHECK(backup.kind == service::JobKind::Backup);
+    DOCTEST_CHECK(backup.source == "/srv/data/");
+    DOCTEST_CHECK(backup.repository == "/mnt/repository");
+    DOCTEST_CHECK(backup.interval == std::chrono::hours(6));
+    DOCTEST_CHECK(backup.filter.rules() == std::vector<std::string> { "*.tmp" });
+    DOCTEST_CHECK(backup.filter.case_insensitive());
+    DOCTEST_CHECK(backup.filter.excluded("a/B.TMP", false));
+    DOCTEST_CHECK(backup.hash_xattrs);
+    DOCTEST_CHECK_FALSE(backup.rehash);
+
+    service::JobConfig scrub;
+    DOCTEST_REQUIRE(parse_line("scrub /mnt/repository --every 1d --threads 3", scrub));
+    DOCTEST_CHECK(scrub.kind == service::JobKind::Scrub);
+    DOCTEST_CHECK(scrub.repository == "/mnt/repository");
+    DOCTEST_CHECK(scrub.interval == std::chrono::hours(24));
+    DOCTEST_CHECK(scrub.threads == 3);
+
+    service::JobConfig prune;
+    DOCTEST_REQUIRE(parse_line("prune /mnt/repository --every 90m --keep-last 7", prune));
+    DOCTEST_CHECK(prune.kind == service::JobKind::Prune);
+    DOCTEST_CHECK(prune.interval == std::chrono::minutes(90));
+    DOCTEST_CHECK(prune.prune.keep_last == 7);
+    DOCTEST_CHECK(prune.prune.priority == tasks::Priority::Background);
+}
+
+DOCTEST_TEST_CASE("daemon config: a missing or bad --every is rejected") {
+    service::JobConfig job;
+    DOCTEST_CHECK_FALSE(parse_line("scrub /mnt/repository", job));
+    DOCTEST_CHECK_FALSE(parse_line("scrub /mnt/repository --every", job));
+    DOCTEST_CHECK_FALSE(parse_line("scrub /mnt/repository --every soon", job));
+    DOCTEST_CHECK_FALSE(parse_line("scrub /mnt/repository --every 0", job));
+    DOCTEST_CHECK_FALSE(parse_line("scrub /mnt/repository --every -5m", job));
+    DOCTEST_CHECK_FALSE(parse_line("scrub /mnt/repository --every 5w", job));
+}
+
+DOCTEST_TEST_CASE("daemon config: unknown jobs and wrong arguments are rejected") {
+    service::JobConfig job;
+    DOCTEST_CHECK_FALSE(parse_line("restore /mnt/repository /srv/data --every 1h", job));
+    DOCTEST_CHECK_FALSE(parse_line("Backup /srv/data /mnt/repository --every 1h", job));
+    DOCTEST_CHECK_FALSE(parse_line("backup /srv/data --every 1h", job));
+    DOCTEST_CHECK_FALSE(parse_line("scrub /mnt/repository --every 1h --threads many", job));
+    DOCTEST_CHECK_FALSE(parse_line("scrub /mnt/a /mnt/b --every 1h", job));
+    DOCTEST_CHECK_FALSE(parse_line("backup /srv/data /mnt/repository --every 1h --exclude /", job));
+}
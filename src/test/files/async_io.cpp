@@ -0,0 +1,148 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/async_io.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "test.h"
+
+namespace {
+    struct Results {
+        int32_t opened = 0;
+        int32_t written = 0;
+        int32_t read = 0;
+        int32_t short_read = 0;
+        int32_t past_end = 0;
+        int32_t closed = 0;
+        int32_t missing = 0;
+        int32_t bad_fd = 0;
+        int32_t stat = 0;
+        struct statx info {};
+        char buffer[32] {};
+        char tail[32] {};
+    };
+
+    //! Writes a file, reads it back whole, across its end and past it, then provokes two errors.
+    files::IoTask<void> exercise(files::IoContext& io, std::string path, Results& results) {
+        results.opened = co_await io.openat(AT_FDCWD, path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (results.opened < 0) co_return;
+        results.written = co_await io.write(results.opened, "hello, async world", 18, 0);
+        results.read = co_await io.read(results.opened, results.buffer, 18, 0);
+        results.short_read = co_await io.read(results.opened, results.tail, sizeof(results.tail), 7);
+        results.past_end = co_await io.read(results.opened, results.tail + 16, 4, 100);
+        results.stat = co_await io.statx(AT_FDCWD, path.c_str(), 0, STATX_SIZE, &results.info);
+        results.closed = co_await io.close_fd(results.opened);
+        std::string missing = path + ".missing";
+        results.missing = co_await io.openat(AT_FDCWD, missing.c_str(), O_RDONLY);
+        results.bad_fd = co_await io.read(results.opened, results.buffer, 4, 0);
+    }
+
+    void check_exercise(bool use_io_uring) {
+        TestDirectory directory;
+        files::IoContext io;
+        files::IoOptions options;
+        options.use_io_uring = use_io_uring;
+        DOCTEST_REQUIRE(io.open(options));
+        if (!use_io_uring) DOCTEST_CHECK_FALSE(io.uses_io_uring());
+
+        Results results;
+        io.spawn(exercise(io, directory / "file", results));
+        io.run();
+        DOCTEST_REQUIRE(results.opened >= 0);
+        DOCTEST_CHECK(results.written == 18);
+        DOCTEST_CHECK(results.read == 18);
+        DOCTEST_CHECK(std::string(results.buffer, 18) == "hello, async world");
+        // Reads across the end return what is there, past it nothing; neither is an error.
+        DOCTEST_CHECK(results.short_read == 11);
+        DOCTEST_CHECK(std::string(results.tail, 11) == "async world");
+        DOCTEST_CHECK(results.past_end == 0);
+        DOCTEST_CHECK(results.stat == 0);
+        DOCTEST_CHECK(results.info.stx_size == 18);
+        DOCTEST_CHECK(results.closed == 0);
+        DOCTEST_CHECK(results.missing == -ENOENT);
+        DOCTEST_CHECK(results.bad_fd == -EBADF);
+    }
+
+    //! Many operations at once, more than the queue holds, each checking its own slice.
+    files::IoTask<void> read_slice(files::IoContext& io, int32_t fd, uint32_t index, uint32_t& matched) {
+        char slice[8];
+        int32_t result = co_await io.read(fd, slice, sizeof(slice), (uint64_t) index * sizeof(slice));
+        char expected[9];
+        std::snprintf(expected, sizeof(expected), "%08u", index);
+        if (result == (int32_t) sizeof(slice) && std::memcmp(slice, expected, sizeof(slice)) == 0) matched++;
+    }
+}  // namespace
+
+DOCTEST_TEST_CASE("async io: reads, writes and errors through io_uring") {
+    check_exercise(true);
+}
+
+DOCTEST_TEST_CASE("async io: reads, writes and errors through the fallback") {
+    check_exercise(false);
+}
+
+DOCTEST_TEST_CASE("async io: more operations than the queue depth all complete") {
+    TestDirectory directory;
+    std::string path = directory / "slices";
+    std::string contents;
+    for (uint32_t i = 0; i < 300; ++i) {
+        char slice[9];
+        std::snprintf(slice, sizeof(slice), "%08u", i);
+        contents += slice;
+    }
+    int32_t fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    DOCTEST_REQUIRE(fd >= 0);
+    DOCTEST_REQUIRE(::write(fd, contents.data(), contents.size()) == (ssize_t) contents.size());
+
+    for (bool use_io_uring : { true, false }) {
+        files::IoContext io;
+        files::IoOptions options;
+        options.queue_depth = 16;
+        options.use_io_uring = use_io_uring;
+        DOCTEST_REQUIRE(io.open(options));
+        uint32_t matched = 0;
+        for (uint32_t i = 0; i < 300; ++i) io.spawn(read_slice(io, fd, i, matched));
+        io.run();
+        DOCTEST_CHECK(matched == 300);
+    }
+    ::close(fd);
+}
+
+DOCTEST_TEST_CASE("async io: the fallback driven from every worker at once doesn't deadlock") {
+    TestDirectory directory;
+    std::string path = directory / "file";
+    int32_t fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    DOCTEST_REQUIRE(fd >= 0);
+    DOCTEST_REQUIRE(::write(fd, "0123456789", 10) == 10);
+
+    // Twice as many contexts as workers: each waits for blocking calls queued on the same pool.
+    tasks::TaskGroup group(tasks::Priority::Normal);
+    uint32_t contexts = 2 * group.scheduler().worker_count();
+    std::atomic<uint32_t> completed = 0;
+    for (uint32_t i = 0; i < contexts; ++i) {
+        group.run([&]() {
+            files::IoContext io;
+            files::IoOptions options;
+            options.use_io_uring = false;
+            io.open(options);
+            uint32_t matched = 0;
+            for (uint32_t slice = 0; slice < 4; ++slice) {
+                io.spawn([](files::IoContext& io, int32_t fd, uint32_t& matched) -> files::IoTask<void> {
+                    char data[10];
+                    if (co_await io.read(fd, data, sizeof(data), 0) == 10 && std::memcmp(data, "0123456789", 10) == 0) matched++;
+                }(io, fd, matched));
+            }
+            io.run();
+            if (matched == 4) completed++;
+        });
+    }
+    group.wait();
+    DOCTEST_CHECK(completed == contexts);
+    ::close(fd);
+}
@@ -0,0 +1,147 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/device.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(LINUX)
+    #include <sys/sysmacros.h>
+#endif
+
+#include "test.h"
+
+DOCTEST_TEST_CASE("device: readers follow the kind of disk and its queue depth") {
+    files::BlockDevice disk;
+    disk.rotational = true;
+    disk.queue_depth = 256;
+    DOCTEST_CHECK(disk.readers() == 1);
+
+    files::BlockDevice ssd;
+    ssd.queue_depth = 64;
+    DOCTEST_CHECK(ssd.readers() == 8);
+    ssd.queue_depth = 8;
+    DOCTEST_CHECK(ssd.readers() == 2);
+    ssd.queue_depth = 1023;
+    DOCTEST_CHECK(ssd.readers() == 32);
+    // Unknown depths count as 64.
+    ssd.queue_depth = 0;
+    DOCTEST_CHECK(ssd.readers() == 8);
+}
+
+#if defined(LINUX)
+namespace {
+    //! A sysfs tree with one disk, `major`:0, holding a partition `major`:1.
+    struct FakeSysfs {
+        TestDirectory directory;
+
+        void add_disk(const std::string& name, uint32_t major, bool rotational, uint32_t queue_depth) {
+            std::string disk = directory / ("devices/" + name);
+            std::filesystem::create_directories(disk + "/queue");
+            std::filesystem::create_directories(disk + "/" + name + "1");
+            std::filesystem::create_directories(directory / "dev/block");
+            std::ofstream(disk + "/dev") << major << ":0\n";
+            std::ofstream(disk + "/queue/rotational") << (rotational ? "1" : "0") << "\n";
+            std::ofstream(disk + "/queue/nr_requests") << queue_depth << "\n";
+            std::ofstream(disk + "/" + name + "1/dev") << major << ":1\n";
+            std::ofstream(disk + "/" + name + "1/partition") << "1\n";
+            std::filesystem::create_directory_symlink("../../devices/" + name, directory / FORMAT("dev/block/{}:0", major));
+            std::filesystem::create_directory_symlink("../../devices/" + name + "/" + name + "1", directory / FORMAT("dev/block/{}:1", major));
+        }
+        std::string root() {
+            return directory.path();
+        }
+    };
+}  // namespace
+
+DOCTEST_TEST_CASE("device: a rotational disk gets one reader, an SSD as many as its queue fills") {
+    FakeSysfs sysfs;
+    sysfs.add_disk("sdz", 8, true, 128);
+    sysfs.add_disk("nvme9n1", 259, false, 1023);
+
+    files::BlockDevice disk = files::block_device(makedev(8, 0), sysfs.root());
+    DOCTEST_CHECK(disk.name == "sdz");
+    DOCTEST_CHECK(disk.id == makedev(8, 0));
+    DOCTEST_CHECK(disk.rotational);
+    DOCTEST_CHECK(disk.queue_depth == 128);
+    DOCTEST_CHECK(disk.readers() == 1);
+
+    files::BlockDevice ssd = files::block_device(makedev(259, 0), sysfs.root());
+    DOCTEST_CHECK(ssd.name == "nvme9n1");
+    DOCTEST_CHECK_FALSE(ssd.rotational);
+    DOCTEST_CHECK(ssd.queue_depth == 1023);
+    DOCTEST_CHECK(ssd.readers() == 32);
+
+    // Devices sysfs doesn't know keep the filesystem's number and the defaults.
+    files::BlockDevice unknown = files::block_device(makedev(0, 42), sysfs.root());
+    DOCTEST_CHECK(unknown.id == makedev(0, 42));
+    DOCTEST_CHECK(unknown.name.empty());
+    DOCTEST_CHECK(unknown.readers() == 8);
+}
+
+DOCTEST_TEST_CASE("device: a partition resolves to its parent disk") {
+    FakeSysfs sysfs;
+    sysfs.add_disk("sdz", 8, false, 32);
+
+    files::BlockDevice partition = files::block_device(makedev(8, 1), sysfs.root());
+    DOCTEST_CHECK(partition.name == "sdz");
+    DOCTEST_CHECK(partition.id == makedev(8, 0));
+    DOCTEST_CHECK(partition.queue_depth == 32);
+    DOCTEST_CHECK(partition.readers() == 4);
+}
+
+DOCTEST_TEST_CASE("device: files on a rotational disk are read in physical order") {
+    TestDirectory directory;
+    struct stat info {};
+    DOCTEST_REQUIRE(::stat(directory.path().c_str(), &info) == 0);
+    // The filesystem the test directory lives on is presented as a spinning disk.
+    FakeSysfs sysfs;
+    sysfs.add_disk("sdz", major(info.st_dev), true, 128);
+    if (minor(info.st_dev) > 1) {
+        std::string link = sysfs.directory / FORMAT("dev/block/{}:{}", major(info.st_dev), minor(info.st_dev));
+        std::filesystem::create_directory_symlink("../../devices/sdz", link);
+    }
+
+    // Synced, so the data has its place on disk before FIEMAP is asked.
+    std::vector<std::string> paths;
+    std::vector<uint64_t> offsets;
+    for (uint32_t i = 0; i < 8; ++i) {
+        paths.push_back(directory / FORMAT("file{}", i));
+        int32_t fd = ::open(paths.back().c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        DOCTEST_REQUIRE(fd >= 0);
+        std::vector<char> data(64 * 1024, (char) ('a' + i));
+        DOCTEST_REQUIRE(::write(fd, data.data(), data.size()) == (ssize_t) data.size());
+        ::fsync(fd);
+        uint64_t offset = UINT64_MAX;
+        files::physical_offset(fd, offset);
+        offsets.push_back(offset);
+        ::close(fd);
+    }
+    if (std::all_of(offsets.begin(), offsets.end(), [](uint64_t offset) { return offset == UINT64_MAX; })) return;
+
+    // Queued in reverse; read by position, with files FIEMAP can't place last in queue order.
+    files::DeviceQueues queues(sysfs.root());
+    std::vector<uint64_t> expected;
+    for (uint32_t i = 8; i-- > 0;) {
+        queues.add(paths[i], i);
+        expected.push_back(i);
+    }
+    std::stable_sort(expected.begin(), expected.end(), [&](uint64_t a, uint64_t b) { return offsets[a] < offsets[b]; });
+    DOCTEST_CHECK(queues.device_count() == 1);
+
+    std::mutex mutex;
+    std::vector<uint64_t> order;
+    tasks::TaskGroup group(tasks::Priority::Normal);
+    queues.run(group, [&](uint64_t tag) {
+        std::lock_guard lock(mutex);
+        order.push_back(tag);
+    });
+    DOCTEST_CHECK(order == expected);
+}
+#endif
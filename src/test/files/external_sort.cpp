@@ -0,0 +1,91 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/external_sort.h"
+
+#include <random>
+
+#include "test.h"
+
+DOCTEST_TEST_CASE("external_sort: loser trees merge any number of sources") {
+    struct Record {
+        uint32_t key;
+        uint32_t source;
+    };
+    auto less = [](const Record& a, const Record& b) { return a.key < b.key; };
+
+    std::mt19937 random(3);
+    for (size_t k : { 1, 2, 3, 5, 6, 7, 13, 31 }) {
+        // Some sources empty, keys drawn from a small range so ties between sources are common.
+        std::vector<std::vector<Record>> sources(k);
+        for (size_t source = 0; source < k; ++source) {
+            size_t count = source % 4 == 1 ? 0 : random() % 50;
+            for (size_t i = 0; i < count; ++i) sources[source].push_back({ (uint32_t) (random() % 40), (uint32_t) source });
+            std::sort(sources[source].begin(), sources[source].end(), less);
+        }
+
+        files::LoserTree<Record, decltype(less)> tree(k, less);
+        std::vector<size_t> positions(k, 0);
+        for (size_t source = 0; source < k; ++source) tree.set(source, sources[source].empty() ? nullptr : sources[source].data());
+        tree.build();
+        std::vector<Record> merged;
+        while (const Record* record = tree.top()) {
+            size_t source = tree.winner();
+            DOCTEST_CHECK(record->source == source);
+            merged.push_back(*record);
+            size_t next = ++positions[source];
+            tree.replace(next < sources[source].size() ? &sources[source][next] : nullptr);
+        }
+
+        size_t total = 0;
+        for (const auto& source : sources) total += source.size();
+        DOCTEST_CHECK(merged.size() == total);
+        // Sorted, and equal keys in source order.
+        bool ordered = true;
+        for (size_t i = 1; i < merged.size(); ++i) {
+            ordered = ordered && (merged[i - 1].key < merged[i].key || (merged[i - 1].key == merged[i].key && merged[i - 1].source <= merged[i].source));
+        }
+        DOCTEST_CHECK_MESSAGE(ordered, "k = " << k);
+    }
+}
+
+DOCTEST_TEST_CASE("external_sort: a small budget merges in several passes and keeps few runs open") {
+    TestDirectory directory;
+    // Two runs per merge, each run a few hundred thousand records.
+    files::ExternalSorter<uint64_t> sorter(files::c_min_memory_budget, directory.path());
+    std::mt19937_64 random(4);
+    std::vector<uint64_t> expected;
+    size_t most_runs = 0;
+    for (size_t i = 0; i < 3'000'000; ++i) {
+        uint64_t value = random() % 1'000'000;
+        expected.push_back(value);
+        DOCTEST_REQUIRE(sorter.push(value));
+        most_runs = std::max(most_runs, sorter.run_count());
+    }
+    DOCTEST_CHECK(sorter.size() == expected.size());
+    // Seven full buffers: a binary counter of merged runs never holds more than three.
+    DOCTEST_CHECK(most_runs <= 3);
+
+    std::sort(expected.begin(), expected.end());
+    std::vector<uint64_t> sorted;
+    sorted.reserve(expected.size());
+    DOCTEST_REQUIRE(sorter.merge([&](uint64_t value) {
+        sorted.push_back(value);
+        return true;
+    }));
+    DOCTEST_CHECK(sorted == expected);
+}
+
+DOCTEST_TEST_CASE("external_sort: everything that fits is sorted in memory") {
+    TestDirectory directory;
+    files::ExternalSorter<uint32_t, std::greater<>> sorter(files::c_min_memory_budget, directory.path());
+    for (uint32_t value : { 5, 1, 4, 1, 3 }) DOCTEST_REQUIRE(sorter.push(value));
+    DOCTEST_CHECK(sorter.run_count() == 0);
+    std::vector<uint32_t> sorted;
+    DOCTEST_REQUIRE(sorter.merge([&](uint32_t value) {
+        sorted.push_back(value);
+        return true;
+    }));
+    DOCTEST_CHECK(sorted == std::vector<uint32_t> { 5, 4, 3, 1, 1 });
+}
@@ -0,0 +1,139 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/hash_cache.h"
+
+#include <fstream>
+#include <vector>
+#if defined(LINUX) || defined(MACOS)
+    #include <sys/xattr.h>
+#endif
+
+#include "test.h"
+
+namespace {
+    constexpr const char* c_attribute = "user.fward.hash";
+    constexpr uint64_t c_size = 4;
+    constexpr int64_t c_mtime_ns = 1'792'411'200'123'456'789;
+
+    hashing::Digest sample_digest() {
+        return hashing::Sha256::digest("data", 4);
+    }
+
+    //! A file with a cached hash; false when the filesystem holding the test directory has no user attributes.
+    bool cached_file(const std::string& path) {
+        std::ofstream(path) << "data";
+        return files::store_cached_hash(path, files::HashAlgorithm::ChunkedSha256, c_size, c_mtime_ns, sample_digest());
+    }
+
+#if defined(MACOS)
+    std::vector<byte> read_attribute(const std::string& path) {
+        std::vector<byte> value(64);
+        ssize_t size = ::getxattr(path.c_str(), c_attribute, value.data(), value.size(), 0, 0);
+        value.resize(size < 0 ? 0 : size);
+        return value;
+    }
+    bool write_attribute(const std::string& path, const std::vector<byte>& value) {
+        return ::setxattr(path.c_str(), c_attribute, value.data(), value.size(), 0, 0) == 0;
+    }
+#elif defined(LINUX)
+    std::vector<byte> read_attribute(const std::string& path) {
+        std::vector<byte> value(64);
+        ssize_t size = ::getxattr(path.c_str(), c_attribute, value.data(), value.size());
+        value.resize(size < 0 ? 0 : size);
+        return value;
+    }
+    bool write_attribute(const std::string& path, const std::vector<byte>& value) {
+        return ::setxattr(path.c_str(), c_attribute, value.data(), value.size(), 0) == 0;
+    }
+#else
+    // Without attributes cached_file() fails and the tests end before these are needed.
+    std::vector<byte> read_attribute(const std::string&) {
+        return {};
+    }
+    bool write_attribute(const std::string&, const std::vector<byte>&) {
+        return false;
+    }
+#endif
+
+    bool load(const std::string& path, uint64_t size = c_size, int64_t mtime_ns = c_mtime_ns) {
+        hashing::Digest digest {};
+        return files::load_cached_hash(path, files::HashAlgorithm::ChunkedSha256, size, mtime_ns, digest) && digest == sample_digest();
+    }
+}  // namespace
+
+DOCTEST_TEST_CASE("hash cache: a stored hash loads back while size and mtime match") {
+    TestDirectory directory;
+    std::string path = directory / "file";
+    if (!cached_file(path)) return;
+
+    hashing::Digest digest {};
+    DOCTEST_REQUIRE(files::load_cached_hash(path, files::HashAlgorithm::ChunkedSha256, c_size, c_mtime_ns, digest));
+    DOCTEST_CHECK(digest == sample_digest());
+    DOCTEST_CHECK(read_attribute(path).size() == 50);
+
+    // Storing again replaces the value.
+    hashing::Digest other = hashing::Sha256::digest("other", 5);
+    DOCTEST_REQUIRE(files::store_cached_hash(path, files::HashAlgorithm::ChunkedSha256, 5, c_mtime_ns + 1, other));
+    DOCTEST_REQUIRE(files::load_cached_hash(path, files::HashAlgorithm::ChunkedSha256, 5, c_mtime_ns + 1, digest));
+    DOCTEST_CHECK(digest == other);
+}
+
+DOCTEST_TEST_CASE("hash cache: a different size or mtime rejects the hash") {
+    TestDirectory directory;
+    std::string path = directory / "file";
+    if (!cached_file(path)) return;
+
+    DOCTEST_CHECK(load(path));
+    DOCTEST_CHECK_FALSE(load(path, c_size + 1));
+    DOCTEST_CHECK_FALSE(load(path, 0));
+    DOCTEST_CHECK_FALSE(load(path, c_size, c_mtime_ns + 1));
+    DOCTEST_CHECK_FALSE(load(path, c_size, c_mtime_ns - 1'000'000'000));
+}
+
+DOCTEST_TEST_CASE("hash cache: another algorithm or format is rejected") {
+    TestDirectory directory;
+    std::string path = directory / "file";
+    if (!cached_file(path)) return;
+
+    hashing::Digest digest {};
+    DOCTEST_CHECK_FALSE(files::load_cached_hash(path, (files::HashAlgorithm) 2, c_size, c_mtime_ns, digest));
+
+    std::vector<byte> value = read_attribute(path);
+    DOCTEST_REQUIRE(value.size() == 50);
+    std::vector<byte> changed = value;
+    changed[0] = 2;
+    DOCTEST_REQUIRE(write_attribute(path, changed));
+    DOCTEST_CHECK_FALSE(load(path));
+
+    changed = value;
+    changed[1] = 0;
+    DOCTEST_REQUIRE(write_attribute(path, changed));
+    DOCTEST_CHECK_FALSE(load(path));
+
+    DOCTEST_REQUIRE(write_attribute(path, value));
+    DOCTEST_CHECK(load(path));
+}
+
+DOCTEST_TEST_CASE("hash cache: a missing, truncated or oversized attribute is rejected") {
+    TestDirectory directory;
+    std::string path = directory / "file";
+    if (!cached_file(path)) return;
+
+    std::vector<byte> value = read_attribute(path);
+    DOCTEST_REQUIRE(value.size() == 50);
+    for (size_t size : { 0, 1, 18, 49 }) {
+        DOCTEST_REQUIRE(write_attribute(path, std::vector<byte>(value.begin(), value.begin() + size)));
+        DOCTEST_CHECK_FALSE(load(path));
+    }
+    std::vector<byte> longer = value;
+    longer.push_back(0);
+    DOCTEST_REQUIRE(write_attribute(path, longer));
+    DOCTEST_CHECK_FALSE(load(path));
+
+    std::string bare = directory / "bare";
+    std::ofstream(bare) << "data";
+    DOCTEST_CHECK_FALSE(load(bare));
+    DOCTEST_CHECK_FALSE(load(directory / "missing"));
+}
@@ -0,0 +1,159 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/journal.h"
+
+#include <filesystem>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+    //! Magic and base lsn, then a length and a checksum before each payload.
+    constexpr uint64_t c_header_size = 16;
+    constexpr uint64_t c_record_header_size = 8;
+
+    struct Replayed {
+        std::vector<uint64_t> lsns;
+        std::vector<std::string> records;
+
+        files::Journal::ReplayVisitor visitor() {
+            return [this](uint64_t lsn, const byte* data, size_t size) {
+                lsns.push_back(lsn);
+                records.emplace_back((const char*) data, size);
+                return true;
+            };
+        }
+    };
+}  // namespace
+
+DOCTEST_TEST_CASE("journal: committed records are replayed in order on the next open") {
+    TestDirectory directory;
+    std::string path = directory / "journal";
+    {
+        files::Journal journal;
+        Replayed replayed;
+        DOCTEST_REQUIRE(journal.open(path, replayed.visitor()));
+        DOCTEST_CHECK(replayed.records.empty());
+        DOCTEST_CHECK(journal.commit("first", 5));
+        uint64_t second = journal.append("second", 6);
+        uint64_t third = journal.append("", 0);
+        DOCTEST_CHECK(third == second + 1);
+        DOCTEST_CHECK(journal.wait(third));
+        DOCTEST_CHECK(journal.durable_lsn() == 3);
+    }
+
+    files::Journal journal;
+    Replayed replayed;
+    DOCTEST_REQUIRE(journal.open(path, replayed.visitor()));
+    DOCTEST_CHECK(replayed.lsns == std::vector<uint64_t> { 1, 2, 3 });
+    DOCTEST_CHECK(replayed.records == std::vector<std::string> { "first", "second", "" });
+    DOCTEST_CHECK(journal.last_lsn() == 3);
+    DOCTEST_CHECK(journal.commit("fourth", 6));
+    DOCTEST_CHECK(journal.last_lsn() == 4);
+}
+
+DOCTEST_TEST_CASE("journal: a torn tail is cut off and later records follow the intact ones") {
+    TestDirectory directory;
+    std::string path = directory / "journal";
+    uint64_t intact_size = c_header_size + c_record_header_size + 4;
+    {
+        files::Journal journal;
+        Replayed replayed;
+        DOCTEST_REQUIRE(journal.open(path, replayed.visitor()));
+        DOCTEST_CHECK(journal.commit("kept", 4));
+        DOCTEST_CHECK(journal.commit("torn record", 11));
+    }
+    // The log is preallocated beyond its records; cut the second one short instead.
+    std::filesystem::resize_file(path, intact_size + c_record_header_size + 5);
+
+    {
+        files::Journal journal;
+        Replayed replayed;
+        DOCTEST_REQUIRE(journal.open(path, replayed.visitor()));
+        DOCTEST_CHECK(replayed.records == std::vector<std::string> { "kept" });
+        DOCTEST_CHECK(std::filesystem::file_size(path) == intact_size);
+        DOCTEST_CHECK(journal.commit("after", 5));
+    }
+
+    files::Journal journal;
+    Replayed replayed;
+    DOCTEST_REQUIRE(journal.open(path, replayed.visitor()));
+    DOCTEST_CHECK(replayed.lsns == std::vector<uint64_t> { 1, 2 });
+    DOCTEST_CHECK(replayed.records == std::vector<std::string> { "kept", "after" });
+}
+
+DOCTEST_TEST_CASE("journal: a corrupt record ends replay") {
+    TestDirectory directory;
+    std::string path = directory / "journal";
+    uint64_t intact_size = c_header_size + c_record_header_size + 4;
+    {
+        files::Journal journal;
+        Replayed replayed;
+        DOCTEST_REQUIRE(journal.open(path, replayed.visitor()));
+        DOCTEST_CHECK(journal.commit("kept", 4));
+        DOCTEST_CHECK(journal.commit("flipped", 7));
+        DOCTEST_CHECK(journal.commit("lost", 4));
+    }
+    files::File file;
+    DOCTEST_REQUIRE(file.open(path, files::FileMode::ReadWrite));
+    DOCTEST_CHECK(file.write_all_at("F", 1, intact_size + c_record_header_size));
+    file.close();
+
+    files::Journal journal;
+    Replayed replayed;
+    DOCTEST_REQUIRE(journal.open(path, replayed.visitor()));
+    DOCTEST_CHECK(replayed.records == std::vector<std::string> { "kept" });
+    DOCTEST_CHECK(journal.last_lsn() == 1);
+}
+
+DOCTEST_TEST_CASE("journal: reset starts an empty log at the given lsn") {
+    TestDirectory directory;
+    std::string path = directory / "journal";
+    {
+        files::Journal journal;
+        Replayed replayed;
+        DOCTEST_REQUIRE(journal.open(path, replayed.visitor()));
+        DOCTEST_CHECK(journal.commit("one", 3));
+        DOCTEST_CHECK(journal.commit("two", 3));
+        DOCTEST_REQUIRE(journal.reset(2));
+        DOCTEST_CHECK(journal.size() == 0);
+        DOCTEST_CHECK(journal.commit("three", 5));
+    }
+
+    files::Journal journal;
+    Replayed replayed;
+    DOCTEST_REQUIRE(journal.open(path, replayed.visitor()));
+    DOCTEST_CHECK(replayed.lsns == std::vector<uint64_t> { 3 });
+    DOCTEST_CHECK(replayed.records == std::vector<std::string> { "three" });
+}
+
+DOCTEST_TEST_CASE("journal: a record the visitor rejects ends replay and is cut off") {
+    TestDirectory directory;
+    std::string path = directory / "journal";
+    {
+        files::Journal journal;
+        Replayed replayed;
+        DOCTEST_REQUIRE(journal.open(path, replayed.visitor()));
+        DOCTEST_CHECK(journal.commit("kept", 4));
+        DOCTEST_CHECK(journal.commit("rejected", 8));
+        DOCTEST_CHECK(journal.commit("lost", 4));
+    }
+    {
+        files::Journal journal;
+        std::vector<std::string> seen;
+        DOCTEST_REQUIRE(journal.open(path, [&](uint64_t, const byte* data, size_t size) {
+            seen.emplace_back((const char*) data, size);
+            return seen.back() != "rejected";
+        }));
+        DOCTEST_CHECK(seen == std::vector<std::string> { "kept", "rejected" });
+        DOCTEST_CHECK(journal.last_lsn() == 1);
+        DOCTEST_CHECK(journal.commit("after", 5));
+    }
+
+    files::Journal journal;
+    Replayed replayed;
+    DOCTEST_REQUIRE(journal.open(path, replayed.visitor()));
+    DOCTEST_CHECK(replayed.records == std::vector<std::string> { "kept", "after" });
+}
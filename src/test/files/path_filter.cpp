@@ -0,0 +1,91 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/path_filter.h"
+
+#include "test.h"
+
+using files::FilterVerdict;
+using files::PathFilter;
+
+static PathFilter compile(std::initializer_list<std::string_view> rules) {
+    PathFilter filter;
+    for (auto rule : rules) DOCTEST_REQUIRE(filter.add_rule(rule));
+    filter.compile();
+    return filter;
+}
+
+DOCTEST_TEST_CASE("path_filter: glob components") {
+    DOCTEST_CHECK(files::glob_match("*.log", "build.log"));
+    DOCTEST_CHECK_FALSE(files::glob_match("*.log", "build.log.gz"));
+    DOCTEST_CHECK(files::glob_match("file?.txt", "file1.txt"));
+    DOCTEST_CHECK(files::glob_match("[a-c]x", "bx"));
+    DOCTEST_CHECK_FALSE(files::glob_match("[!a-c]x", "bx"));
+    DOCTEST_CHECK(files::glob_match("\\*", "*"));
+    DOCTEST_CHECK_FALSE(files::glob_match("\\*", "a"));
+}
+
+DOCTEST_TEST_CASE("path_filter: negation re-includes, last rule wins") {
+    auto filter = compile({ "*.log", "!keep.log", "# comment", "" });
+    DOCTEST_CHECK(filter.rule_count() == 2);
+    DOCTEST_CHECK(filter.match("a/debug.log", false) == FilterVerdict::Excluded);
+    DOCTEST_CHECK(filter.match("a/keep.log", false) == FilterVerdict::Included);
+    DOCTEST_CHECK(filter.match("a/keep.txt", false) == FilterVerdict::Unmatched);
+
+    auto reversed = compile({ "!keep.log", "*.log" });
+    DOCTEST_CHECK(reversed.match("keep.log", false) == FilterVerdict::Excluded);
+}
+
+DOCTEST_TEST_CASE("path_filter: an excluded directory can't be re-included from below") {
+    auto filter = compile({ "build/", "!build/keep.txt" });
+    DOCTEST_CHECK(filter.match("build", true) == FilterVerdict::Excluded);
+    DOCTEST_CHECK(filter.match("build/keep.txt", false) == FilterVerdict::Excluded);
+}
+
+DOCTEST_TEST_CASE("path_filter: anchoring") {
+    auto filter = compile({ "/root.txt", "docs/*.md", "any.txt" });
+    DOCTEST_CHECK(filter.excluded("root.txt", false));
+    DOCTEST_CHECK_FALSE(filter.excluded("sub/root.txt", false));
+    DOCTEST_CHECK(filter.excluded("docs/readme.md", false));
+    DOCTEST_CHECK_FALSE(filter.excluded("sub/docs/readme.md", false));
+    DOCTEST_CHECK(filter.excluded("any.txt", false));
+    DOCTEST_CHECK(filter.excluded("a/b/c/any.txt", false));
+}
+
+DOCTEST_TEST_CASE("path_filter: double star") {
+    auto filter = compile({ "src/**/gen", "**/cache/*.bin" });
+    DOCTEST_CHECK(filter.excluded("src/gen", true));
+    DOCTEST_CHECK(filter.excluded("src/a/b/gen", false));
+    DOCTEST_CHECK_FALSE(filter.excluded("lib/gen", false));
+    DOCTEST_CHECK(filter.excluded("cache/x.bin", false));
+    DOCTEST_CHECK(filter.excluded("deep/down/cache/x.bin", false));
+}
+
+DOCTEST_TEST_CASE("path_filter: directory-only patterns") {
+    auto filter = compile({ "node_modules/", "tmp" });
+    DOCTEST_CHECK(filter.excluded("node_modules", true));
+    DOCTEST_CHECK(filter.excluded("web/node_modules", true));
+    DOCTEST_CHECK_FALSE(filter.excluded("node_modules", false));
+    DOCTEST_CHECK(filter.excluded("tmp", true));
+    DOCTEST_CHECK(filter.excluded("tmp", false));
+}
+
+DOCTEST_TEST_CASE("path_filter: cursors prune exhausted subtrees") {
+    auto filter = compile({ "/a/b/c.txt" });
+    auto root = filter.root();
+    DOCTEST_CHECK(filter.match(root, "a", true) == FilterVerdict::Unmatched);
+    auto a = filter.enter(root, "a");
+    DOCTEST_CHECK_FALSE(a.exhausted());
+    DOCTEST_CHECK(filter.enter(root, "other").exhausted());
+    auto b = filter.enter(a, "b");
+    DOCTEST_CHECK(filter.match(b, "c.txt", false) == FilterVerdict::Excluded);
+}
+
+DOCTEST_TEST_CASE("path_filter: case-insensitive matching") {
+    PathFilter filter(true);
+    DOCTEST_REQUIRE(filter.add_rule("*.JPG"));
+    filter.compile();
+    DOCTEST_CHECK(filter.excluded("photos/IMG.jpg", false));
+    DOCTEST_CHECK(filter.excluded("photos/img.JpG", false));
+}
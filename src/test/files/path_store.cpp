@@ -0,0 +1,98 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/path_store.h"
+
+#include <algorithm>
+
+#include "test.h"
+
+using files::PathId;
+using files::PathStore;
+
+DOCTEST_TEST_CASE("path_store: paths are rebuilt from interned components") {
+    PathStore store;
+    PathId file = store.intern("/home/user/notes.txt", false);
+    PathId directory = store.intern("/home/user/", true);
+
+    DOCTEST_CHECK(store.path(file) == "/home/user/notes.txt");
+    DOCTEST_CHECK(store.path(directory) == "/home/user");
+    DOCTEST_CHECK(store.path(files::c_root_path) == "/");
+    DOCTEST_CHECK(store.parent(file) == directory);
+    DOCTEST_CHECK(store.name(file) == "notes.txt");
+    DOCTEST_CHECK(store.depth(file) == 3);
+    DOCTEST_CHECK(store.is_directory(directory));
+    DOCTEST_CHECK_FALSE(store.is_directory(file));
+    DOCTEST_CHECK(store.intern("home//./user", true) == directory);
+    DOCTEST_CHECK(store.find_directory(store.find_directory(files::c_root_path, "home"), "user") == directory);
+}
+
+DOCTEST_TEST_CASE("path_store: path() into a caller buffer") {
+    PathStore store;
+    PathId id = store.intern("/a/bc/def", false);
+
+    char small[4] = { 'x', 'x', 'x', 'x' };
+    DOCTEST_CHECK(store.path(id, small, sizeof(small)) == 9);
+    DOCTEST_CHECK(small[0] == 'x');
+
+    char exact[10];
+    DOCTEST_REQUIRE(store.path(id, exact, sizeof(exact)) == 9);
+    DOCTEST_CHECK(std::string_view(exact) == "/a/bc/def");
+
+    std::string reused = "a much longer previous value";
+    store.path(id, reused);
+    DOCTEST_CHECK(reused == "/a/bc/def");
+}
+
+DOCTEST_TEST_CASE("path_store: compare() sorts like component-wise paths") {
+    PathStore store;
+    std::vector<std::string> paths = { "/b", "/a/z", "/a", "/a/b/c", "/a-b", "/a/b", "/c/d/e/f", "/a/b/a" };
+    std::vector<PathId> ids;
+    for (const auto& path : paths) ids.push_back(store.intern(path, true));
+
+    std::sort(ids.begin(), ids.end(), [&](PathId a, PathId b) { return store.compare(a, b) < 0; });
+    std::vector<std::string> sorted;
+    for (PathId id : ids) sorted.push_back(store.path(id));
+    DOCTEST_CHECK(sorted == std::vector<std::string> { "/a", "/a/b", "/a/b/a", "/a/b/c", "/a/z", "/a-b", "/b", "/c/d/e/f" });
+
+    PathId a = store.intern("/a", true);
+    PathId abc = store.intern("/a/b/c", true);
+    DOCTEST_CHECK(store.compare(a, abc) < 0);
+    DOCTEST_CHECK(store.compare(abc, a) > 0);
+    DOCTEST_CHECK(store.compare(a, a) == 0);
+    DOCTEST_CHECK(store.contains(a, abc));
+    DOCTEST_CHECK_FALSE(store.contains(abc, a));
+
+    // Leaves are not deduplicated, equal names order by insertion.
+    PathId first = store.intern("/a/dup", false);
+    PathId second = store.intern("/a/dup", false);
+    DOCTEST_CHECK(first != second);
+    DOCTEST_CHECK(store.compare(first, second) < 0);
+    DOCTEST_CHECK(store.compare(second, first) > 0);
+}
+
+DOCTEST_TEST_CASE("path_store: many directories survive index growth") {
+    PathStore store;
+    std::vector<PathId> ids;
+    for (int i = 0; i < 5000; ++i) ids.push_back(store.intern("/d" + std::to_string(i % 100) + "/e" + std::to_string(i), true));
+    for (int i = 0; i < 5000; ++i) {
+        DOCTEST_CHECK(store.intern("/d" + std::to_string(i % 100) + "/e" + std::to_string(i), true) == ids[i]);
+    }
+    DOCTEST_CHECK(store.size() == 1 + 100 + 5000);
+}
+
+DOCTEST_TEST_CASE("path_store: paths deeper than the depth field are refused, not wrapped") {
+    PathStore store;
+    PathId parent = files::c_root_path;
+    for (uint32_t depth = 1; depth <= PathStore::c_max_depth; ++depth) parent = store.intern_directory(parent, "d");
+    DOCTEST_REQUIRE(parent != files::c_invalid_path);
+    DOCTEST_CHECK(store.depth(parent) == PathStore::c_max_depth);
+
+    DOCTEST_CHECK(store.add_leaf(parent, "file") == files::c_invalid_path);
+    DOCTEST_CHECK(store.intern_directory(parent, "deeper") == files::c_invalid_path);
+    DOCTEST_CHECK(store.find_directory(parent, "deeper") == files::c_invalid_path);
+    // Still usable afterwards.
+    PathId sibling = store.add_leaf(files::c_root_path, "sibling");
+    DOCTEST_CHECK(store.path(sibling) == "/sibling");
+}
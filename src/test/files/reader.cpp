@@ -0,0 +1,42 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/reader.h"
+
+#include <random>
+
+#include "test.h"
+
+DOCTEST_TEST_CASE("reader: every strategy reads the same bytes") {
+    TestDirectory directory;
+    std::string path = directory / "data";
+    // Not a multiple of a page, so direct reads end on a short one.
+    std::vector<byte> data(20 * 1024 * 1024 + 4097);
+    std::mt19937 random(5);
+    for (auto& value : data) value = (byte) random();
+    DOCTEST_REQUIRE(files::write_file_atomic(path, data.data(), data.size()));
+
+    for (auto strategy : { files::ReadStrategy::Buffered, files::ReadStrategy::Mapped, files::ReadStrategy::Direct }) {
+        files::Reader reader;
+        files::ReadOptions options;
+        options.strategy = strategy;
+        options.immutable = true;
+        DOCTEST_REQUIRE(reader.open(path, options));
+        DOCTEST_CHECK(reader.size() == data.size());
+
+        // Odd offsets and lengths that straddle the windows.
+        uint64_t offset = 0;
+        size_t length = 1;
+        bool same = true;
+        while (offset < data.size()) {
+            std::span<const byte> view;
+            DOCTEST_REQUIRE(reader.view(offset, length, view));
+            size_t expected = std::min<size_t>(length, data.size() - offset);
+            same = same && view.size() == expected && std::equal(view.begin(), view.end(), data.begin() + (ptrdiff_t) offset);
+            offset += view.size();
+            length = length * 3 + 4095;
+        }
+        DOCTEST_CHECK(same);
+    }
+}
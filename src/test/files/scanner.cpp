@@ -0,0 +1,34 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "files/scanner.h"
+
+#include <fstream>
+#include <unistd.h>
+
+#include "test.h"
+
+DOCTEST_TEST_CASE("scanner: only regular files count as files") {
+    TestDirectory root;
+    std::filesystem::create_directories(root / "sub/skip");
+    std::ofstream(root / "a.txt") << "a";
+    std::ofstream(root / "sub/b.txt") << "b";
+    std::ofstream(root / "sub/skip/c.txt") << "c";
+    DOCTEST_REQUIRE(symlink("a.txt", (root / "link").c_str()) == 0);
+
+    files::PathFilter filter;
+    DOCTEST_REQUIRE(filter.add_rule("skip/"));
+    filter.compile();
+
+    size_t links = 0;
+    auto stats = files::scan(root.path(), &filter, [&](const files::ScanEntry& entry) {
+        if (entry.type == files::EntryType::Symlink) links++;
+        return true;
+    });
+    DOCTEST_CHECK(stats.files == 2);
+    DOCTEST_CHECK(stats.directories == 2);
+    DOCTEST_CHECK(stats.excluded == 1);
+    DOCTEST_CHECK(stats.errors == 0);
+    DOCTEST_CHECK(links == 1);
+}
@@ -0,0 +1,66 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "hashing/crc32c.h"
+
+#include <random>
+#include <vector>
+
+#include "test.h"
+
+//! One bit at a time with the reflected polynomial, the definition the fast paths must meet.
+static uint32_t reference_crc32c(const byte* data, size_t size, uint32_t crc = 0) {
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static std::vector<byte> random_bytes(size_t size, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::vector<byte> data(size);
+    for (auto& value : data) value = (byte) random();
+    return data;
+}
+
+DOCTEST_TEST_CASE("crc32c: standard check values") {
+    DOCTEST_CHECK(hashing::crc32c("123456789", 9) == 0xE3069283);
+    DOCTEST_CHECK(hashing::crc32c("", 0) == 0);
+    std::vector<byte> zeros(32, 0);
+    DOCTEST_CHECK(hashing::crc32c(zeros.data(), zeros.size()) == 0x8A9136AA);
+    std::vector<byte> ones(32, 0xFF);
+    DOCTEST_CHECK(hashing::crc32c(ones.data(), ones.size()) == 0x62A8AB43);
+}
+
+// The kernel is chosen once per process; FWARD_CPU_DISABLE=sse4.2 or pclmul runs this against the others.
+DOCTEST_TEST_CASE("crc32c: every length around the stream block boundaries matches the bitwise reference") {
+    std::vector<byte> data = random_bytes(2 * 3 * 8192 + 3 * 256 + 64, 9);
+    std::vector<size_t> sizes;
+    for (size_t size = 0; size <= 1024; ++size) sizes.push_back(size);
+    for (size_t boundary : { 3 * 256, 2 * 3 * 256, 3 * 8192, 3 * 8192 + 3 * 256, 2 * 3 * 8192, 2 * 3 * 8192 + 3 * 256 }) {
+        for (size_t size = boundary - 17; size <= boundary + 17; ++size) sizes.push_back(size);
+    }
+
+    for (size_t size : sizes) {
+        // Starts off an 8-byte boundary too, for the word loops.
+        for (size_t start : { 0, 3 }) {
+            DOCTEST_CHECK_MESSAGE(hashing::crc32c(data.data() + start, size) == reference_crc32c(data.data() + start, size),
+                                  "length " << size << " from " << start);
+        }
+    }
+}
+
+DOCTEST_TEST_CASE("crc32c: continuing from a previous result matches one pass") {
+    std::vector<byte> data = random_bytes(3 * 8192 + 3 * 256 + 5, 10);
+    uint32_t whole = hashing::crc32c(data.data(), data.size());
+    DOCTEST_CHECK(whole == reference_crc32c(data.data(), data.size()));
+
+    for (size_t split = 0; split <= data.size(); split += split < 1024 ? 1 : 97) {
+        uint32_t first = hashing::crc32c(data.data(), split);
+        DOCTEST_CHECK_MESSAGE(hashing::crc32c(data.data() + split, data.size() - split, first) == whole, "split at " << split);
+    }
+    DOCTEST_CHECK(hashing::crc32c(data.data() + 100, 200, 0x12345678) == reference_crc32c(data.data() + 100, 200, 0x12345678));
+}
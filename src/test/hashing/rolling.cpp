@@ -0,0 +1,51 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "hashing/rolling.h"
+
+#include <random>
+#include <vector>
+
+#include "backup/delta.h"
+#include "test.h"
+
+//! The definition in rolling.h, one byte at a time.
+static uint32_t reference_checksum(const byte* data, size_t size) {
+    uint32_t a = 0;
+    uint32_t b = 0;
+    for (size_t i = 0; i < size; ++i) {
+        a += data[i];
+        b += (uint32_t) (size - i) * data[i];
+    }
+    return (a & 0xFFFF) | ((b & 0xFFFF) << 16);
+}
+
+// The kernel is chosen once per process; FWARD_CPU_DISABLE=avx2 runs this against the SSE2 one.
+DOCTEST_TEST_CASE("rolling: the vector kernels match the scalar definition for every length") {
+    std::mt19937 random(7);
+    std::vector<byte> data(2 * backup::c_delta_block_size + 1);
+    for (auto& value : data) value = (byte) random();
+    // Long runs of 0xFF push the 32-bit lane sums the furthest.
+    std::vector<byte> saturated(data.size(), 0xFF);
+
+    for (size_t size = 0; size <= 2 * backup::c_delta_block_size; ++size) {
+        // Odd starts keep the loads unaligned.
+        DOCTEST_CHECK_MESSAGE(hashing::rolling_checksum(data.data() + 1, size) == reference_checksum(data.data() + 1, size), "length " << size);
+        DOCTEST_CHECK_MESSAGE(hashing::rolling_checksum(saturated.data(), size) == reference_checksum(saturated.data(), size), "length " << size);
+    }
+}
+
+DOCTEST_TEST_CASE("rolling: sliding the window matches checksumming it afresh") {
+    std::mt19937 random(11);
+    std::vector<byte> data(3 * backup::c_delta_block_size);
+    for (auto& value : data) value = (byte) random();
+
+    for (size_t window : { (size_t) 1, (size_t) 31, backup::c_delta_block_size }) {
+        uint32_t checksum = hashing::rolling_checksum(data.data(), window);
+        for (size_t position = 1; position + window <= data.size(); ++position) {
+            checksum = hashing::rolling_update(checksum, data[position - 1], data[position + window - 1], window);
+            DOCTEST_CHECK_MESSAGE(checksum == reference_checksum(data.data() + position, window), "window " << window << " at " << position);
+        }
+    }
+}
@@ -0,0 +1,40 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "hashing/sha256.h"
+
+#include <string>
+
+#include "test.h"
+#include "utils/hex.h"
+
+static std::string sha256_hex(std::string_view data) {
+    return to_hex(hashing::Sha256::digest(data.data(), data.size()));
+}
+
+DOCTEST_TEST_CASE("sha256: standard test vectors") {
+    DOCTEST_CHECK(sha256_hex("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    DOCTEST_CHECK(sha256_hex("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    DOCTEST_CHECK(sha256_hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    DOCTEST_CHECK(sha256_hex("abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu") ==
+          "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1");
+    DOCTEST_CHECK(sha256_hex(std::string(1000000, 'a')) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+DOCTEST_TEST_CASE("sha256: incremental updates match one-shot digests") {
+    std::string data;
+    for (int i = 0; i < 1000; ++i) data += (char) (i * 31 + 7);
+
+    for (size_t split : { 0, 1, 55, 56, 63, 64, 65, 128, 999 }) {
+        for (size_t step : { 1, 7, 64, 1000 }) {
+            hashing::Sha256 hasher;
+            hasher.update(data.data(), split);
+            for (size_t offset = split; offset < data.size(); offset += step) {
+                hasher.update(data.data() + offset, std::min(step, data.size() - offset));
+            }
+            DOCTEST_CHECK(hasher.finish() == hashing::Sha256::digest(data.data(), data.size()));
+        }
+    }
+}
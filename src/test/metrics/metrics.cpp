@@ -0,0 +1,50 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "metrics/metrics.h"
+
+#include "test.h"
+
+static std::string json_string(std::string_view value) {
+    std::string out;
+    metrics::append_json_string(out, value);
+    return out;
+}
+
+DOCTEST_TEST_CASE("metrics: JSON strings are escaped") {
+    DOCTEST_CHECK(json_string("plain") == "\"plain\"");
+    DOCTEST_CHECK(json_string("a \"quoted\" \\ path") == "\"a \\\"quoted\\\" \\\\ path\"");
+    DOCTEST_CHECK(json_string("line\nbreak\ttab") == "\"line\\nbreak\\ttab\"");
+    DOCTEST_CHECK(json_string(std::string_view("\x01\x1f", 2)) == "\"\\u0001\\u001f\"");
+    DOCTEST_CHECK(json_string("{}") == "\"{}\"");
+}
+
+DOCTEST_TEST_CASE("metrics: names and help texts are written as they are") {
+    metrics::counter("fward_test_{}_\"total\"", "Help with {} and a\nsecond line.").add(3);
+
+    std::string json;
+    metrics::write_json(json);
+    DOCTEST_CHECK(json.find("\n  \"fward_test_{}_\\\"total\\\"\": 3") != std::string::npos);
+
+    std::string text;
+    metrics::write_prometheus(text);
+    DOCTEST_CHECK(text.find("# HELP fward_test_{}_\"total\" Help with {} and a\\nsecond line.\n") != std::string::npos);
+    DOCTEST_CHECK(text.find("\nfward_test_{}_\"total\" 3\n") != std::string::npos);
+}
+
+DOCTEST_TEST_CASE("metrics: histograms count every observation once") {
+    auto& histogram = metrics::histogram("fward_test_seconds", "Test latencies.", { 0.5, 1 });
+    histogram.observe(0.25);
+    histogram.observe(0.75);
+    histogram.observe(4);
+
+    std::string text;
+    metrics::write_prometheus(text);
+    DOCTEST_CHECK(text.find("fward_test_seconds_bucket{le=\"0.5\"} 1\nfward_test_seconds_bucket{le=\"1\"} 2\n"
+                            "fward_test_seconds_bucket{le=\"+Inf\"} 3\nfward_test_seconds_sum 5\nfward_test_seconds_count 3\n") != std::string::npos);
+
+    std::string json;
+    metrics::write_json(json);
+    DOCTEST_CHECK(json.find("\"fward_test_seconds\": {\"buckets\": {\"0.5\": 1, \"1\": 1, \"+Inf\": 1}, \"sum\": 5, \"count\": 3}") != std::string::npos);
+}
@@ -0,0 +1,24 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "metrics/trace.h"
+
+#include "files/file.h"
+#include "test.h"
+
+DOCTEST_TEST_CASE("trace: zone names are escaped in the trace") {
+    TestDirectory directory;
+    std::string path = directory / "trace.json";
+    metrics::trace_start();
+    {
+        TRACE_ZONE("zone \"{}\" \\ name");
+    }
+    DOCTEST_REQUIRE(metrics::trace_stop(path));
+
+    std::vector<byte> data;
+    DOCTEST_REQUIRE(files::read_whole_file(path, data));
+    std::string trace(data.begin(), data.end());
+    DOCTEST_CHECK(trace.find("{\"name\":\"zone \\\"{}\\\" \\\\ name\",\"cat\":\"fward\"") != std::string::npos);
+    DOCTEST_CHECK(trace.ends_with("\n]}\n"));
+}
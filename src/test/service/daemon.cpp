@@ -0,0 +1,126 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "service/daemon.h"
+
+#include <csignal>
+#include <pthread.h>
+
+#include "metrics/metrics.h"
+#include "test.h"
+
+namespace {
+    //! Current value of a counter or gauge, summed over every thread.
+    int64_t metric_value(std::string_view name) {
+        std::string json;
+        metrics::write_json(json);
+        std::string key = "\"" + std::string(name) + "\": ";
+        size_t at = json.find(key);
+        if (at == std::string::npos) return 0;
+        return std::strtoll(json.c_str() + at + key.size(), nullptr, 10);
+    }
+
+    //! Polls `condition` for up to five seconds.
+    template<typename Condition>
+    bool eventually(Condition condition) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() > deadline) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return true;
+    }
+
+    service::JobConfig scrub_job(const std::string& repository, std::chrono::milliseconds interval) {
+        service::JobConfig job;
+        job.kind = service::JobKind::Scrub;
+        job.repository = repository;
+        job.interval = interval;
+        job.threads = 1;
+        return job;
+    }
+
+    //! Runs a daemon on its own thread. Signals go to that thread only, which blocks them once the
+    //! daemon has set up its signal handling, so they are sent after its first job started.
+    class DaemonThread {
+       public:
+        explicit DaemonThread(service::ConfigLoader loader) {
+            m_thread = std::thread([this, loader = std::move(loader)]() { m_result = m_daemon.run(loader); });
+        }
+        ~DaemonThread() {
+            if (m_thread.joinable()) stop();
+        }
+
+        void signal(int32_t number) {
+            ::pthread_kill(m_thread.native_handle(), number);
+        }
+        bool stop() {
+            signal(SIGTERM);
+            m_thread.join();
+            return m_result;
+        }
+
+       private:
+        service::Daemon m_daemon;
+        std::thread m_thread;
+        std::atomic<bool> m_result = false;
+    };
+}  // namespace
+
+DOCTEST_TEST_CASE("daemon: a job that is still running is not queued again") {
+    TestDirectory directory;
+    std::string path = directory / "repository";
+    DOCTEST_REQUIRE(backup::Repository::create(path));
+    // Holding the lock exclusively keeps the scrub waiting for it inside the job.
+    backup::Repository holder;
+    DOCTEST_REQUIRE(holder.open(path));
+    DOCTEST_REQUIRE(holder.lock(true));
+
+    int64_t jobs = metric_value("fward_daemon_jobs_total");
+    int64_t queued = metric_value("fward_daemon_jobs_queued");
+    DaemonThread daemon([&](std::vector<service::JobConfig>& configs) {
+        configs = { scrub_job(path, std::chrono::milliseconds(10)) };
+        return true;
+    });
+    DOCTEST_REQUIRE(eventually([&]() { return metric_value("fward_daemon_jobs_total") == jobs + 1; }));
+
+    // Twenty or so ticks later the job is neither run nor queued a second time.
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    DOCTEST_CHECK(metric_value("fward_daemon_jobs_total") == jobs + 1);
+    DOCTEST_CHECK(metric_value("fward_daemon_jobs_queued") == queued);
+
+    holder.unlock();
+    DOCTEST_CHECK(eventually([&]() { return metric_value("fward_daemon_jobs_total") >= jobs + 3; }));
+    DOCTEST_CHECK(daemon.stop());
+    DOCTEST_CHECK(metric_value("fward_daemon_jobs_queued") == queued);
+}
+
+DOCTEST_TEST_CASE("daemon: SIGHUP replaces the job set") {
+    TestDirectory directory;
+    std::string path = directory / "repository";
+    DOCTEST_REQUIRE(backup::Repository::create(path));
+
+    std::atomic<uint32_t> loads = 0;
+    int64_t jobs = metric_value("fward_daemon_jobs_total");
+    int64_t failures = metric_value("fward_daemon_job_failures_total");
+    // The first configuration only has a job that fails, the second only one that succeeds.
+    DaemonThread daemon([&](std::vector<service::JobConfig>& configs) {
+        bool first = loads++ == 0;
+        configs = { scrub_job(first ? directory / "missing" : path, std::chrono::milliseconds(10)) };
+        return true;
+    });
+    DOCTEST_REQUIRE(eventually([&]() { return metric_value("fward_daemon_job_failures_total") > failures; }));
+
+    daemon.signal(SIGHUP);
+    DOCTEST_REQUIRE(eventually([&]() { return loads == 2; }));
+    // A failing job queued before the reload may still run, later ones come from the new set only.
+    int64_t reloaded = metric_value("fward_daemon_jobs_total");
+    DOCTEST_REQUIRE(eventually([&]() { return metric_value("fward_daemon_jobs_total") >= reloaded + 2; }));
+    int64_t settled = metric_value("fward_daemon_job_failures_total");
+    int64_t runs = metric_value("fward_daemon_jobs_total");
+    DOCTEST_REQUIRE(eventually([&]() { return metric_value("fward_daemon_jobs_total") >= runs + 3; }));
+    DOCTEST_CHECK(metric_value("fward_daemon_job_failures_total") == settled);
+    DOCTEST_CHECK(metric_value("fward_daemon_jobs_total") > jobs);
+    DOCTEST_CHECK(daemon.stop());
+}
@@ -0,0 +1,181 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "tasks/scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "test.h"
+
+namespace {
+    //! Polls `condition` for up to five seconds; a scheduler that deadlocks fails instead of hanging.
+    template<typename Condition>
+    bool eventually(Condition condition) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() > deadline) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    //! Occupies one worker until opened, so the tasks queued meanwhile are all waiting together.
+    struct Gate {
+        std::atomic<bool> entered = false;
+        std::atomic<bool> open = false;
+
+        std::function<void()> task() {
+            return [this]() {
+                entered = true;
+                eventually([this]() { return open.load(); });
+            };
+        }
+    };
+}  // namespace
+
+DOCTEST_TEST_CASE("scheduler: higher priorities run first, each in submission order") {
+    tasks::Scheduler scheduler(1);
+    tasks::TaskGroup blocker(tasks::Priority::Normal, scheduler);
+    Gate gate;
+    blocker.run(gate.task());
+    DOCTEST_REQUIRE(eventually([&]() { return gate.entered.load(); }));
+
+    std::mutex mutex;
+    std::vector<std::string> order;
+    auto record = [&](std::string name) {
+        return [&, name]() {
+            std::lock_guard lock(mutex);
+            order.push_back(name);
+        };
+    };
+    tasks::TaskGroup background(tasks::Priority::Background, scheduler);
+    tasks::TaskGroup normal(tasks::Priority::Normal, scheduler);
+    tasks::TaskGroup foreground(tasks::Priority::Foreground, scheduler);
+    background.run(record("background 1"));
+    normal.run(record("normal 1"));
+    background.run(record("background 2"));
+    foreground.run(record("foreground 1"));
+    normal.run(record("normal 2"));
+    foreground.run(record("foreground 2"));
+
+    // Waiting here would run tasks on this thread too; the order is the worker's alone.
+    gate.open = true;
+    DOCTEST_REQUIRE(eventually([&]() {
+        std::lock_guard lock(mutex);
+        return order.size() == 6;
+    }));
+    DOCTEST_CHECK(order == std::vector<std::string> { "foreground 1", "foreground 2", "normal 1", "normal 2", "background 1", "background 2" });
+}
+
+DOCTEST_TEST_CASE("scheduler: an idle worker steals from a busy one") {
+    tasks::Scheduler scheduler(2);
+    tasks::TaskGroup group(tasks::Priority::Normal, scheduler);
+    std::atomic<uint32_t> finished = 0;
+    std::atomic<bool> stolen = true;
+    std::atomic<bool> done = false;
+
+    // The children go to the parent's own deque; with the parent still busy only the other worker can run them.
+    group.run([&]() {
+        auto parent = std::this_thread::get_id();
+        for (uint32_t i = 0; i < 4; ++i) {
+            group.run([&, parent]() {
+                if (std::this_thread::get_id() == parent) stolen = false;
+                finished++;
+            });
+        }
+        eventually([&]() { return finished == 4; });
+        done = true;
+    });
+    DOCTEST_REQUIRE(eventually([&]() { return done.load(); }));
+    DOCTEST_CHECK(finished == 4);
+    DOCTEST_CHECK(stolen);
+}
+
+DOCTEST_TEST_CASE("scheduler: waiting inside a task runs the nested tasks instead of deadlocking") {
+    // A single worker, so nothing but the waiting task itself can run what it waits for.
+    tasks::Scheduler scheduler(1);
+    tasks::TaskGroup outer(tasks::Priority::Normal, scheduler);
+    std::atomic<uint32_t> sum = 0;
+    std::atomic<bool> done = false;
+    outer.run([&]() {
+        tasks::TaskGroup inner(tasks::Priority::Normal, scheduler);
+        for (uint32_t i = 1; i <= 10; ++i) {
+            inner.run([&, i]() {
+                tasks::TaskGroup innermost(tasks::Priority::Background, scheduler);
+                innermost.run([&, i]() { sum += i; });
+                innermost.wait();
+            });
+        }
+        inner.wait();
+        done = true;
+    });
+    DOCTEST_REQUIRE(eventually([&]() { return done.load(); }));
+    DOCTEST_CHECK(sum == 55);
+}
+
+DOCTEST_TEST_CASE("scheduler: cancelling a group skips its queued tasks") {
+    tasks::Scheduler scheduler(1);
+    tasks::TaskGroup blocker(tasks::Priority::Normal, scheduler);
+    Gate gate;
+    blocker.run(gate.task());
+    DOCTEST_REQUIRE(eventually([&]() { return gate.entered.load(); }));
+
+    std::atomic<uint32_t> ran = 0;
+    tasks::TaskGroup cancelled(tasks::Priority::Foreground, scheduler);
+    for (uint32_t i = 0; i < 8; ++i) cancelled.run([&]() { ran++; });
+    tasks::TaskGroup kept(tasks::Priority::Foreground, scheduler);
+    kept.run([&]() { ran += 100; });
+    cancelled.cancel();
+    gate.open = true;
+    cancelled.wait();
+    kept.wait();
+    DOCTEST_CHECK(cancelled.cancelled());
+    DOCTEST_CHECK(ran == 100);
+
+    // A task that already runs sees the cancellation and stops on its own.
+    tasks::TaskGroup running(tasks::Priority::Normal, scheduler);
+    std::atomic<bool> started = false;
+    running.run([&]() {
+        started = true;
+        eventually([&]() { return running.cancelled(); });
+    });
+    DOCTEST_REQUIRE(eventually([&]() { return started.load(); }));
+    running.cancel();
+    running.wait();
+}
+
+DOCTEST_TEST_CASE("scheduler: tasks submitted from other threads all run") {
+    tasks::Scheduler scheduler(2);
+    tasks::TaskGroup group(tasks::Priority::Normal, scheduler);
+    std::atomic<uint64_t> sum = 0;
+    std::mutex mutex;
+    std::vector<std::thread::id> runners;
+
+    std::vector<std::thread> submitters;
+    for (uint32_t thread = 0; thread < 4; ++thread) {
+        submitters.emplace_back([&, thread]() {
+            for (uint64_t i = 0; i < 250; ++i) {
+                group.run([&, thread, i]() {
+                    sum += thread * 1000 + i;
+                    std::lock_guard lock(mutex);
+                    runners.push_back(std::this_thread::get_id());
+                });
+            }
+        });
+    }
+    std::vector<std::thread::id> submitter_ids;
+    for (auto& submitter : submitters) submitter_ids.push_back(submitter.get_id());
+    for (auto& submitter : submitters) submitter.join();
+    DOCTEST_REQUIRE(eventually([&]() {
+        std::lock_guard lock(mutex);
+        return runners.size() == 1000;
+    }));
+    group.wait();
+
+    // 4 * (0 + 1 + ... + 249) plus 250 * (0 + 1000 + 2000 + 3000).
+    DOCTEST_CHECK(sum == 4 * 31125 + 250 * 6000);
+    // Submitting threads only queue; the workers pick the tasks up from the injection queue.
+    for (auto id : runners) DOCTEST_CHECK(std::find(submitter_ids.begin(), submitter_ids.end(), id) == submitter_ids.end());
+}
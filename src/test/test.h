@@ -17,4 +17,35 @@
 #include <doctest/doctest.h>
 #if defined(_WIN32) || defined(_WIN64)
     #pragma warning(pop)
-#endif
\ No newline at end of file
+#endif
+#if defined(POSIX_NATIVE)
+    #include <cstdlib>
+    #include <filesystem>
+    #include <string>
+
+//! Fresh directory below the system temp directory, removed with everything in it on destruction.
+class TestDirectory {
+   public:
+    TestDirectory() {
+        std::string pattern = (std::filesystem::temp_directory_path() / "fward-test-XXXXXX").string();
+        if (mkdtemp(pattern.data())) m_path = pattern;
+        DOCTEST_REQUIRE(!m_path.empty());
+    }
+    ~TestDirectory() {
+        std::error_code error;
+        std::filesystem::remove_all(m_path, error);
+    }
+    TestDirectory(TestDirectory&&) = delete;
+    TestDirectory(const TestDirectory&) = delete;
+
+    COMP_NO_DISCARD const std::string& path() const {
+        return m_path;
+    }
+    COMP_NO_DISCARD std::string operator/(std::string_view name) const {
+        return m_path + "/" + std::string(name);
+    }
+
+   private:
+    std::string m_path;
+};
+#endif
@@ -0,0 +1,117 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "utils/cpu.h"
+
+#include <string>
+
+#include "hashing/crc32c.h"
+#include "hashing/rolling.h"
+#include "hashing/sha256.h"
+#include "utils/hex.h"
+#include "utils/reed_solomon.h"
+#include "test.h"
+
+static CpuFeatures all_features() {
+    CpuFeatures features;
+    features.ssse3 = features.sse41 = features.sse42 = features.pclmul = features.avx2 = features.avx512 = features.sha = true;
+    features.neon = features.arm_crc32 = features.arm_pmull = true;
+    return features;
+}
+
+DOCTEST_TEST_CASE("cpu: disabled features are parsed from a comma separated list") {
+    CpuFeatures features = all_features();
+    DOCTEST_CHECK(disable_cpu_features(features, "avx2"));
+    DOCTEST_CHECK_FALSE(features.avx2);
+    DOCTEST_CHECK(features.avx512);
+
+    features = all_features();
+    DOCTEST_CHECK(disable_cpu_features(features, "AVX512, Sha ,sse4.2,,pmull"));
+    DOCTEST_CHECK_FALSE(features.avx512);
+    DOCTEST_CHECK_FALSE(features.sha);
+    DOCTEST_CHECK_FALSE(features.sse42);
+    DOCTEST_CHECK_FALSE(features.arm_pmull);
+    DOCTEST_CHECK(features.sse41);
+    DOCTEST_CHECK(features.arm_crc32);
+
+    features = all_features();
+    DOCTEST_CHECK(disable_cpu_features(features, ""));
+    DOCTEST_CHECK(disable_cpu_features(features, " , "));
+    DOCTEST_CHECK(features.avx2);
+}
+
+DOCTEST_TEST_CASE("cpu: unknown names are reported and the known ones still apply") {
+    CpuFeatures features = all_features();
+    DOCTEST_CHECK_FALSE(disable_cpu_features(features, "avx3,ssse3"));
+    DOCTEST_CHECK_FALSE(features.ssse3);
+    DOCTEST_CHECK(features.avx2);
+
+    features = all_features();
+    // Names are whole words: neither a prefix nor a joined list matches.
+    DOCTEST_CHECK_FALSE(disable_cpu_features(features, "sse4"));
+    DOCTEST_CHECK_FALSE(disable_cpu_features(features, "avx2 sha"));
+    DOCTEST_CHECK(features.sse41);
+    DOCTEST_CHECK(features.sse42);
+    DOCTEST_CHECK(features.avx2);
+    DOCTEST_CHECK(features.sha);
+}
+
+DOCTEST_TEST_CASE("cpu: without features every kernel is the generic one") {
+    CpuFeatures none;
+    DOCTEST_CHECK(std::string(hashing::crc32c_kernel(none)) == "generic");
+    DOCTEST_CHECK(std::string(hashing::Sha256::kernel(none)) == "generic");
+    DOCTEST_CHECK(std::string(hashing::rolling_checksum_kernel(none)) == "generic");
+    DOCTEST_CHECK(std::string(hex_encode_kernel(none)) == "generic");
+    DOCTEST_CHECK(std::string(ReedSolomon::kernel(none)) == "generic");
+
+    CpuFeatures features = all_features();
+    DOCTEST_REQUIRE(disable_cpu_features(features, "ssse3,sse4.1,sse4.2,pclmul,avx2,avx512,sha,neon,crc32,pmull"));
+    DOCTEST_CHECK(std::string(hashing::crc32c_kernel(features)) == "generic");
+    DOCTEST_CHECK(std::string(hashing::Sha256::kernel(features)) == "generic");
+    DOCTEST_CHECK(std::string(hashing::rolling_checksum_kernel(features)) == "generic");
+    DOCTEST_CHECK(std::string(hex_encode_kernel(features)) == "generic");
+    DOCTEST_CHECK(std::string(ReedSolomon::kernel(features)) == "generic");
+}
+
+#if defined(COMP_CPU_X86_64)
+DOCTEST_TEST_CASE("cpu: disabling a feature steps down to the next kernel") {
+    CpuFeatures features = all_features();
+    DOCTEST_CHECK(std::string(hashing::crc32c_kernel(features)) == "sse4.2+pclmul");
+    DOCTEST_CHECK(std::string(hashing::Sha256::kernel(features)) == "sha-ni");
+    DOCTEST_CHECK(std::string(hashing::rolling_checksum_kernel(features)) == "avx2");
+    DOCTEST_CHECK(std::string(hex_encode_kernel(features)) == "ssse3");
+    DOCTEST_CHECK(std::string(ReedSolomon::kernel(features)) == "avx2");
+
+    DOCTEST_REQUIRE(disable_cpu_features(features, "pclmul,avx2"));
+    DOCTEST_CHECK(std::string(hashing::crc32c_kernel(features)) == "sse4.2");
+    DOCTEST_CHECK(std::string(hashing::rolling_checksum_kernel(features)) == "generic");
+    DOCTEST_CHECK(std::string(ReedSolomon::kernel(features)) == "ssse3");
+    DOCTEST_CHECK(std::string(hashing::Sha256::kernel(features)) == "sha-ni");
+
+    // SHA-NI needs the SSE4.1 and SSSE3 shuffles too.
+    DOCTEST_REQUIRE(disable_cpu_features(features, "sse4.1"));
+    DOCTEST_CHECK(std::string(hashing::Sha256::kernel(features)) == "generic");
+    DOCTEST_CHECK(std::string(hex_encode_kernel(features)) == "ssse3");
+}
+#elif defined(COMP_CPU_AARCH64)
+DOCTEST_TEST_CASE("cpu: disabling a feature steps down to the next kernel") {
+    CpuFeatures features = all_features();
+    DOCTEST_CHECK(std::string(hashing::crc32c_kernel(features)) == "crc32+pmull");
+    DOCTEST_CHECK(std::string(hashing::Sha256::kernel(features)) == "armv8-sha2");
+    DOCTEST_CHECK(std::string(ReedSolomon::kernel(features)) == "neon");
+
+    DOCTEST_REQUIRE(disable_cpu_features(features, "pmull,sha"));
+    DOCTEST_CHECK(std::string(hashing::crc32c_kernel(features)) == "crc32");
+    DOCTEST_CHECK(std::string(hashing::Sha256::kernel(features)) == "generic");
+    DOCTEST_CHECK(std::string(hex_encode_kernel(features)) == "neon");
+}
+#endif
+
+DOCTEST_TEST_CASE("cpu: the kernels in use follow the detected features") {
+    // FWARD_CPU_DISABLE is applied before anything picks a kernel, so it routes them all.
+    DOCTEST_CHECK(std::string(hashing::crc32c_kernel()) == hashing::crc32c_kernel(cpu_features()));
+    if (!cpu_features().sse42 && !cpu_features().arm_crc32) DOCTEST_CHECK(std::string(hashing::crc32c_kernel()) == "generic");
+    if (!cpu_features().avx2) DOCTEST_CHECK(std::string(hashing::rolling_checksum_kernel()) == "generic");
+    if (!cpu_features().sha) DOCTEST_CHECK(std::string(hashing::Sha256::kernel()) == "generic");
+}
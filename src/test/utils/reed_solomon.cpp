@@ -0,0 +1,93 @@
+//
+// Created by Bram Nijenkamp on 19-10-2026.
+//
+
+#include "utils/reed_solomon.h"
+
+#include <bit>
+#include <random>
+
+#include "test.h"
+
+namespace {
+    struct Shards {
+        std::vector<std::vector<byte>> buffers;
+        std::vector<byte*> pointers;
+
+        explicit Shards(std::vector<std::vector<byte>> contents) : buffers(std::move(contents)) {
+            for (auto& buffer : buffers) pointers.push_back(buffer.data());
+        }
+    };
+
+    //! `data` random shards followed by their parity.
+    std::vector<std::vector<byte>> encoded(const ReedSolomon& code, size_t size, std::mt19937& random) {
+        Shards shards(std::vector<std::vector<byte>>(code.data_shards() + code.parity_shards(), std::vector<byte>(size)));
+        for (uint32_t i = 0; i < code.data_shards(); ++i) {
+            for (auto& value : shards.buffers[i]) value = (byte) random();
+        }
+        std::vector<const byte*> data(shards.pointers.begin(), shards.pointers.begin() + code.data_shards());
+        code.encode(data, std::span(shards.pointers).subspan(code.data_shards()), size);
+        return shards.buffers;
+    }
+}  // namespace
+
+DOCTEST_TEST_CASE("reed_solomon: every erasure pattern within the parity is rebuilt") {
+    std::mt19937 random(8);
+    for (auto [data, parity] : { std::pair(1u, 1u), std::pair(2u, 1u), std::pair(3u, 2u), std::pair(5u, 3u), std::pair(10u, 4u) }) {
+        ReedSolomon code;
+        DOCTEST_REQUIRE(code.init(data, parity));
+        uint32_t total = data + parity;
+        // Shorter and longer than the vector kernels' 16 and 32 bytes, and neither a multiple of them.
+        for (size_t size : { 1, 31, 100 }) {
+            std::vector<std::vector<byte>> original = encoded(code, size, random);
+            size_t failures = 0;
+            for (uint32_t lost = 1; lost < (1u << total); ++lost) {
+                if ((uint32_t) std::popcount(lost) > parity) continue;
+                Shards damaged(original);
+                bool present[ReedSolomon::c_max_shards];
+                for (uint32_t i = 0; i < total; ++i) {
+                    present[i] = !(lost & (1u << i));
+                    if (!present[i]) std::fill(damaged.buffers[i].begin(), damaged.buffers[i].end(), (byte) 0xEE);
+                }
+                bool rebuilt = code.reconstruct(damaged.pointers, std::span(present, total), size);
+                failures += !rebuilt || damaged.buffers != original;
+            }
+            DOCTEST_CHECK_MESSAGE(failures == 0, data << "+" << parity << " shards of " << size << " bytes");
+        }
+    }
+}
+
+DOCTEST_TEST_CASE("reed_solomon: more losses than parity are refused") {
+    std::mt19937 random(9);
+    ReedSolomon code;
+    DOCTEST_REQUIRE(code.init(4, 2));
+    Shards shards(encoded(code, 64, random));
+    bool present[] = { true, false, true, false, false, true };
+    DOCTEST_CHECK_FALSE(code.reconstruct(shards.pointers, present, 64));
+
+    // Only the shards with a buffer are written.
+    std::vector<std::vector<byte>> original = shards.buffers;
+    std::fill(shards.buffers[1].begin(), shards.buffers[1].end(), (byte) 0);
+    shards.pointers[4] = nullptr;
+    bool some[] = { true, false, true, true, false, true };
+    DOCTEST_CHECK(code.reconstruct(shards.pointers, some, 64));
+    DOCTEST_CHECK(shards.buffers[1] == original[1]);
+}
+
+DOCTEST_TEST_CASE("reed_solomon: encoding works byte by byte") {
+    // The vector kernels and the scalar tail have to agree: a prefix encodes to the prefix of the parity.
+    std::mt19937 random(10);
+    ReedSolomon code;
+    DOCTEST_REQUIRE(code.init(6, 3));
+    std::vector<std::vector<byte>> full = encoded(code, 1000, random);
+    Shards prefix(std::vector<std::vector<byte>>(9, std::vector<byte>(77)));
+    for (uint32_t i = 0; i < 6; ++i) std::copy_n(full[i].begin(), 77, prefix.buffers[i].begin());
+    std::vector<const byte*> data(prefix.pointers.begin(), prefix.pointers.begin() + 6);
+    code.encode(data, std::span(prefix.pointers).subspan(6), 77);
+    for (uint32_t i = 6; i < 9; ++i) DOCTEST_CHECK(std::equal(prefix.buffers[i].begin(), prefix.buffers[i].end(), full[i].begin()));
+
+    DOCTEST_CHECK_FALSE(code.init(0, 1));
+    DOCTEST_CHECK_FALSE(code.init(1, 0));
+    DOCTEST_CHECK_FALSE(code.init(200, 57));
+    DOCTEST_CHECK(code.init(200, 56));
+}